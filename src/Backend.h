@@ -0,0 +1,28 @@
+#ifndef X86EMU_BACKEND
+#define X86EMU_BACKEND
+
+#include <inttypes.h>
+#include <functional>
+
+// Video output and keyboard input of the emulator. MainLoop() runs on the main thread
+// until the user quits or StopMainLoop() is called. The emulator thread reports every
+// slice of emulated time it ran through Advance(), and sleeps between slices only when
+// IsRealTime().
+class Backend
+{
+public:
+    // constructor & destructor
+    virtual ~Backend() = default;
+
+    // public methods
+    virtual bool Initialize() = 0;
+    virtual void MainLoop() = 0;
+    virtual void StopMainLoop() = 0;
+
+    virtual bool IsRealTime() = 0;
+    virtual void Advance(int64_t usec) = 0;
+
+    std::function<void (uint8_t scancode)>  onKeyEvent;
+};
+
+#endif /* X86EMU_BACKEND */
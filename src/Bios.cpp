@@ -7,6 +7,8 @@
 #include "CpuInterface.h"
 #include "Memory.h"
 #include "Vga.h"
+#include "Bus.h"
+#include "Keyboard.h"
 #include "Bios.h"
 
 #ifndef _WIN32
@@ -102,6 +104,7 @@ Bios::Bios(Memory& memory, Vga& vga)
     : m_memory(memory.GetMem())
     , m_memorySize(memory.GetMemSize())
     , m_vga   (vga)
+    , m_keyboard(nullptr)
 {
     // BIOS Data Area
     m_memory[0x44a] = 80; // number of columns
@@ -720,6 +723,28 @@ void Bios::Int1Ah(CpuInterface* cpu)
     }
 }
 
+void Bios::RegisterPorts(Bus& bus, Keyboard& keyboard)
+{
+    m_keyboard = &keyboard;
+
+    // pseudoport written by the int 9 handler to move a key to the BIOS buffer
+    bus.Register(0x68, 1, this);
+}
+
+uint8_t Bios::PortRead(uint16_t port)
+{
+    printf("Unhandled read port = 0x%04x\n", port);
+    return 0;
+}
+
+void Bios::PortWrite(uint16_t port, uint8_t value)
+{
+    if (m_keyboard->HasKey())
+    {
+        AddKey(m_keyboard->GetKey());
+    }
+}
+
 void Bios::AddKey(uint8_t key)
 {
     if (key != 0)
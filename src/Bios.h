@@ -8,7 +8,9 @@
 #include <map>
 
 // forward declarations
+class Bus;
 class CpuInterface;
+class Keyboard;
 class Memory;
 class Vga;
 
@@ -20,6 +22,10 @@ public:
     ~Bios();
 
     // public methods
+    void    RegisterPorts(Bus& bus, Keyboard& keyboard);
+    uint8_t PortRead(uint16_t port);
+    void    PortWrite(uint16_t port, uint8_t value);
+
     void Int10h(CpuInterface *cpu);
     void Int11h(CpuInterface *cpu);
     void Int12h(CpuInterface *cpu);
@@ -49,9 +55,10 @@ private:
         bool changed;
     };
 
-    uint8_t* m_memory;
-    uint32_t m_memorySize;
-    Vga&     m_vga;
+    uint8_t*  m_memory;
+    uint32_t  m_memorySize;
+    Vga&      m_vga;
+    Keyboard* m_keyboard;       // pseudoport 0x68 moves its keys to the buffer
 
     uint8_t m_cursorX;
     uint8_t m_cursorY;
@@ -0,0 +1,68 @@
+#include <stdio.h>
+#include <algorithm>
+#include "Bus.h"
+
+// constructor & destructor
+Bus::Bus(Vga& vga)
+    : m_vga(vga)
+{
+    m_portHandlers.push_back({ nullptr, &Bus::UnhandledRead, &Bus::UnhandledWrite, nullptr, nullptr });
+    std::fill(m_portMap, m_portMap + 0x10000, 0);
+
+    // devices register their own ports with RegisterPorts(), these belong to hardware
+    // that isn't emulated - system control port B, Adlib address / status and data ports, ignore
+    MapPorts(0x61, 1, nullptr,
+        [](void*, uint16_t) -> uint8_t { return 0; },
+        [](void*, uint16_t, uint8_t) {},
+        nullptr, nullptr);
+
+    MapPorts(0x388, 2, nullptr,
+        [](void*, uint16_t) -> uint8_t { return 0; },
+        [](void*, uint16_t, uint8_t) {},
+        nullptr, nullptr);
+
+    // Joystick, ignore
+    MapPorts(0x201, 1, nullptr,
+        [](void*, uint16_t) -> uint8_t { return 0xff; },
+        [](void*, uint16_t, uint8_t) {},
+        nullptr, nullptr);
+}
+
+// public methods
+void Bus::MapPorts(uint16_t port, int count, void* context,
+                   PortRead8 read8, PortWrite8 write8, PortRead16 read16, PortWrite16 write16)
+{
+    PortHandler handler;
+
+    handler.context = context;
+    handler.read8   = read8  ? read8  : &Bus::UnhandledRead;
+    handler.write8  = write8 ? write8 : &Bus::UnhandledWrite;
+    handler.read16  = read16;
+    handler.write16 = write16;
+
+    m_portHandlers.push_back(handler);
+
+    if (m_portHandlers.size() > 0x100)
+    {
+        printf("Bus::MapPorts() too many port handlers\n");
+        m_portHandlers.pop_back();
+        return;
+    }
+
+    for (int n = 0; n < count && port + n < 0x10000; n++)
+    {
+        m_portMap[port + n] = m_portHandlers.size() - 1;
+    }
+}
+
+// private methods
+uint8_t Bus::UnhandledRead(void* context, uint16_t port)
+{
+    printf("Unhandled read port = 0x%04x\n", port);
+    return 0;
+}
+
+void Bus::UnhandledWrite(void* context, uint16_t port, uint8_t value)
+{
+    printf("Unhandled write port = 0x%04x, value = %d (0x%02x)\n", port, value, value);
+}
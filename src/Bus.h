@@ -0,0 +1,133 @@
+#ifndef X86EMU_BUS
+#define X86EMU_BUS
+
+#include <inttypes.h>
+#include <vector>
+#include "Vga.h"
+
+// Devices of the emulated PC as seen by the Cpu. A Cpu with a bus calls it directly
+// instead of going through the CpuInterface std::function callbacks, which are left
+// for setups without the full machine.
+//
+// I/O ports are decoded through a 64K table of handler indices that the devices
+// register their own ports into (Register() from their RegisterPorts()), so an access
+// costs one lookup and one indirect call. A handler set has separate 16-bit entries;
+// ports without them see the low byte of a 16-bit write and return a zero extended
+// byte for a 16-bit read.
+class Bus
+{
+public:
+    typedef uint8_t  (*PortRead8)  (void* context, uint16_t port);
+    typedef void     (*PortWrite8) (void* context, uint16_t port, uint8_t value);
+    typedef uint16_t (*PortRead16) (void* context, uint16_t port);
+    typedef void     (*PortWrite16)(void* context, uint16_t port, uint16_t value);
+
+    // constructor & destructor
+    Bus(Vga& vga);
+
+    // public methods
+    void     MapPorts(uint16_t port, int count, void* context,
+                      PortRead8 read8, PortWrite8 write8, PortRead16 read16, PortWrite16 write16);
+
+    // 'count' ports from 'port' decoded by the device's PortRead() / PortWrite(),
+    // Register16() also hands 16-bit writes to its PortWrite16()
+    template <class Device>
+    void     Register(uint16_t port, int count, Device* device);
+    template <class Device>
+    void     Register16(uint16_t port, int count, Device* device);
+
+    uint32_t PortRead(uint16_t port, int size);
+    void     PortWrite(uint16_t port, int size, uint32_t value);
+
+    uint8_t  VgaMemRead(uint32_t addr);
+    void     VgaMemWrite(uint32_t addr, uint8_t value);
+    void     VgaMemWriteBlock(uint32_t addr, const uint8_t* data, uint32_t count);
+    void     VgaMemFillBlock(uint32_t addr, uint8_t value, uint32_t count);
+
+private:
+    struct PortHandler
+    {
+        void*       context;
+        PortRead8   read8;
+        PortWrite8  write8;
+        PortRead16  read16;
+        PortWrite16 write16;
+    };
+
+    Vga&      m_vga;
+
+    std::vector<PortHandler> m_portHandlers;    // entry 0 logs unhandled accesses
+    uint8_t                  m_portMap[0x10000];
+
+    // private methods
+    static uint8_t UnhandledRead(void* context, uint16_t port);
+    static void    UnhandledWrite(void* context, uint16_t port, uint8_t value);
+};
+
+// public methods
+template <class Device>
+void Bus::Register(uint16_t port, int count, Device* device)
+{
+    MapPorts(port, count, device,
+        [](void* device, uint16_t port) { return static_cast<Device*>(device)->PortRead(port); },
+        [](void* device, uint16_t port, uint8_t value) { static_cast<Device*>(device)->PortWrite(port, value); },
+        nullptr, nullptr);
+}
+
+template <class Device>
+void Bus::Register16(uint16_t port, int count, Device* device)
+{
+    MapPorts(port, count, device,
+        [](void* device, uint16_t port) { return static_cast<Device*>(device)->PortRead(port); },
+        [](void* device, uint16_t port, uint8_t value) { static_cast<Device*>(device)->PortWrite(port, value); },
+        nullptr,
+        [](void* device, uint16_t port, uint16_t value) { static_cast<Device*>(device)->PortWrite16(port, value); });
+}
+
+inline uint32_t Bus::PortRead(uint16_t port, int size)
+{
+    const PortHandler& handler = m_portHandlers[m_portMap[port]];
+
+    if (size == 2 && handler.read16)
+    {
+        return handler.read16(handler.context, port);
+    }
+
+    return handler.read8(handler.context, port);
+}
+
+inline void Bus::PortWrite(uint16_t port, int size, uint32_t value)
+{
+    const PortHandler& handler = m_portHandlers[m_portMap[port]];
+
+    if (size == 2 && handler.write16)
+    {
+        handler.write16(handler.context, port, value);
+    }
+    else
+    {
+        handler.write8(handler.context, port, value);
+    }
+}
+
+inline uint8_t Bus::VgaMemRead(uint32_t addr)
+{
+    return m_vga.MemRead(addr);
+}
+
+inline void Bus::VgaMemWrite(uint32_t addr, uint8_t value)
+{
+    m_vga.MemWrite(addr, value);
+}
+
+inline void Bus::VgaMemWriteBlock(uint32_t addr, const uint8_t* data, uint32_t count)
+{
+    m_vga.MemWriteBlock(addr, data, count);
+}
+
+inline void Bus::VgaMemFillBlock(uint32_t addr, uint8_t value, uint32_t count)
+{
+    m_vga.MemFillBlock(addr, value, count);
+}
+
+#endif /* X86EMU_BUS */
@@ -1,14 +1,29 @@
 #include <stdio.h>
 #include <stdarg.h>
+#include <string.h>
 #include <algorithm>
 #include <string>
+#include "Bus.h"
 #include "Cpu.h"
 #include "Memory.h"
+#include "ModRm.h"
 #include "Disasm.h"
-
-#define ModRm_Case(v) case (v+0x00): case (v+0x08): case (v+0x10): case (v+0x18): case (v+0x20): case (v+0x28): case (v+0x30): case (v+0x38)
-#define AddrClamp16(v) ((v) & 0xffff)
-//#define AddrClamp16(v) (v)
+#include "Profiler.h"
+#include "SamplingProfiler.h"
+#include "Tracer.h"
+
+#define Opcode_Case(v) case (v): ExecuteOpcode<(v)>(ip); break
+#define Opcode_Case16(v) \
+    Opcode_Case(v+0x00); Opcode_Case(v+0x01); Opcode_Case(v+0x02); Opcode_Case(v+0x03); \
+    Opcode_Case(v+0x04); Opcode_Case(v+0x05); Opcode_Case(v+0x06); Opcode_Case(v+0x07); \
+    Opcode_Case(v+0x08); Opcode_Case(v+0x09); Opcode_Case(v+0x0a); Opcode_Case(v+0x0b); \
+    Opcode_Case(v+0x0c); Opcode_Case(v+0x0d); Opcode_Case(v+0x0e); Opcode_Case(v+0x0f)
+
+#define AluOp_Handlers(name) \
+    { { &Cpu::name<0, false>, &Cpu::name<0, true> }, { &Cpu::name<1, false>, &Cpu::name<1, true> }, \
+      { &Cpu::name<2, false>, &Cpu::name<2, true> }, { &Cpu::name<3, false>, &Cpu::name<3, true> }, \
+      { &Cpu::name<4, false>, &Cpu::name<4, true> }, { &Cpu::name<5, false>, &Cpu::name<5, true> }, \
+      { &Cpu::name<6, false>, &Cpu::name<6, true> }, { &Cpu::name<7, false>, &Cpu::name<7, true> } }
 
 uint16_t Cpu::s_modRmInstLen[256] =
   { 2, 2, 2, 2, 2, 2, 4, 2, 2, 2, 2, 2, 2, 2, 4, 2,
@@ -28,6 +43,51 @@ uint16_t Cpu::s_modRmInstLen[256] =
     2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
     2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2 };
 
+// 80286 clock counts per opcode, register (mod 11) and memory operand forms. Taken
+// branches are assumed, REP iterations, multiply / divide and shift counts are
+// charged by the instructions themselves.
+const uint8_t Cpu::s_opcodeCycles[2][256] =
+  { {  2,  2,  2,  2,  3,  3,  3,  5,  2,  2,  2,  2,  3,  3,  3,  2,
+       2,  2,  2,  2,  3,  3,  3,  5,  2,  2,  2,  2,  3,  3,  3,  5,
+       2,  2,  2,  2,  3,  3,  0,  3,  2,  2,  2,  2,  3,  3,  0,  3,
+       2,  2,  2,  2,  3,  3,  0,  3,  2,  2,  2,  2,  3,  3,  0,  3,
+       2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,
+       3,  3,  3,  3,  3,  3,  3,  3,  5,  5,  5,  5,  5,  5,  5,  5,
+      17, 19, 13,  2,  0,  0,  0,  0,  3, 21,  3, 21,  5,  5,  5,  5,
+       7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,
+       3,  3,  3,  3,  2,  2,  3,  3,  2,  2,  2,  2,  2,  3,  2,  5,
+       3,  3,  3,  3,  3,  3,  3,  3,  2,  2, 13,  3,  3,  5,  2,  2,
+       5,  5,  3,  3,  5,  5,  8,  8,  3,  3,  3,  3,  5,  5,  7,  7,
+       2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,
+       5,  5, 11, 11,  7,  7,  2,  2, 11,  5, 15, 15, 23, 23,  4, 17,
+       2,  2,  5,  5, 16, 14,  3,  5,  2,  2,  2,  2,  2,  2,  2,  2,
+       8,  8,  8,  8,  5,  5,  3,  3,  7,  7, 11,  7,  5,  5,  3,  3,
+       0,  2,  5,  5,  2,  2,  3,  3,  2,  2,  2,  2,  2,  2,  2,  2 },
+    {  7,  7,  7,  7,  3,  3,  3,  5,  7,  7,  7,  7,  3,  3,  3,  2,
+       7,  7,  7,  7,  3,  3,  3,  5,  7,  7,  7,  7,  3,  3,  3,  5,
+       7,  7,  7,  7,  3,  3,  0,  3,  7,  7,  7,  7,  3,  3,  0,  3,
+       7,  7,  7,  7,  3,  3,  0,  3,  7,  7,  6,  6,  3,  3,  0,  3,
+       2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,
+       3,  3,  3,  3,  3,  3,  3,  3,  5,  5,  5,  5,  5,  5,  5,  5,
+      17, 19, 13,  2,  0,  0,  0,  0,  3, 24,  3, 24,  5,  5,  5,  5,
+       7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,  7,
+       7,  7,  7,  7,  6,  6,  5,  5,  3,  3,  5,  5,  3,  3,  5,  5,
+       3,  3,  3,  3,  3,  3,  3,  3,  2,  2, 13,  3,  3,  5,  2,  2,
+       5,  5,  3,  3,  5,  5,  8,  8,  3,  3,  3,  3,  5,  5,  7,  7,
+       2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,  2,
+       8,  8, 11, 11,  7,  7,  3,  3, 11,  5, 15, 15, 23, 23,  4, 17,
+       7,  7,  8,  8, 16, 14,  3,  5,  2,  2,  2,  2,  2,  2,  2,  2,
+       8,  8,  8,  8,  5,  5,  3,  3,  7,  7, 11,  7,  5,  5,  3,  3,
+       0,  2,  5,  5,  2,  2,  7,  7,  2,  2,  2,  2,  2,  2,  7,  7 } };
+
+// cycles per iteration of rep movs / cmps / stos / lods / scas, by low opcode nibble
+const uint8_t Cpu::s_repCycles[16] =
+  { 0, 0, 0, 0, 4, 4, 9, 9, 0, 0, 3, 3, 4, 4, 8, 8 };
+
+// cycles per iteration of rep ins / outs, opcodes 0x6c - 0x6f
+const uint8_t Cpu::s_repIoCycles[4] =
+  { 4, 4, 4, 4 };
+
 // constructor & destructor
 Cpu::Cpu(Memory& memory)
     : m_memory   (memory.GetMem())
@@ -39,12 +99,91 @@ Cpu::Cpu(Memory& memory)
         m_register[n] = 0;
     }
 
+    for(int n = 0; n < 8; n++)
+    {
+        m_registerHigh[n] = 0;
+    }
+
     m_register[Register::FLAG] = Flag::IF_mask | Flag::Always1_mask;
+    m_386Enabled               = false;
 
     m_result  = 0;
     m_auxbits = 0;
+    m_lazyOp  = LazyOp::None;
+    m_lazyOperand1 = 0;
+    m_lazyOperand2 = 0;
     m_instructionCnt = 0;
+    m_cycleCnt = 0;
     m_disasmCnt = 0;
+
+    m_blockCacheEnabled = false;
+    m_codeStart         = 0;
+    m_codeLength        = 0;
+    m_codeWritten       = false;
+    m_bus               = nullptr;
+    m_profiler          = nullptr;
+    m_sampler           = nullptr;
+    m_tracer            = nullptr;
+
+    m_halted               = false;
+    m_idle                 = false;
+    m_idleDetectionEnabled = false;
+    m_pollValue            = 0;
+    m_pollCnt              = 0;
+    m_pollCount            = 0;
+    m_pollArmed            = false;
+    m_pollStored           = false;
+
+    std::fill(m_pollRegs, m_pollRegs + Register::IP + 1, 0);
+    std::fill(m_pollRegsHigh, m_pollRegsHigh + 8, 0);
+
+    for(int n = 0; n < PageCount; n++)
+    {
+        m_pageRegion[n]  = -1;
+        m_pageWatched[n] = false;
+        UpdatePage(n);
+    }
+
+    // RegionRead() / RegionWrite() bypass these when there is a bus
+    m_vgaRegion = m_regions.size();
+
+    MapMemory(0xa0000, 0x20000,
+        [this](uint32_t addr) { return onVgaMemRead(addr); },
+        [this](uint32_t addr, uint8_t value) { onVgaMemWrite(addr, value); });
+
+    MapMemoryBlock(0xa0000,
+        [this](uint32_t addr, const uint8_t* data, uint32_t count)
+        {
+            if (m_bus)
+            {
+                m_bus->VgaMemWriteBlock(addr, data, count);
+            }
+            else if (onVgaMemWriteBlock)
+            {
+                onVgaMemWriteBlock(addr, data, count);
+            }
+            else
+            {
+                for(uint32_t n = 0; n < count; n++)
+                    onVgaMemWrite(addr + n, data[n]);
+            }
+        },
+        [this](uint32_t addr, uint8_t value, uint32_t count)
+        {
+            if (m_bus)
+            {
+                m_bus->VgaMemFillBlock(addr, value, count);
+            }
+            else if (onVgaMemFillBlock)
+            {
+                onVgaMemFillBlock(addr, value, count);
+            }
+            else
+            {
+                for(uint32_t n = 0; n < count; n++)
+                    onVgaMemWrite(addr + n, value);
+            }
+        });
 }
 
 Cpu::~Cpu()
@@ -171,16 +310,87 @@ Memory& Cpu::GetMem()
 
 bool Cpu::Run(int nCycles)
 {
+    // left the wait loop, stores can take the direct mapping again
+    if (m_pollArmed && m_instructionCnt - m_pollCnt > PollLoopLength)
+        ArmPollStores(false);
+
+    // a halted cpu only wakes up on an interrupt
+    m_idle = m_halted;
+
+    if (m_halted)
+        return true;
+
     m_state            = 0;
     m_segmentBase      = m_register[Register::DS] * 16;
     m_stackSegmentBase = m_register[Register::SS] * 16;
 
-    for(int n = 0; n < nCycles; n++)
+    // the last instruction may run past the budget, e.g. a long rep movs
+    std::size_t cycleLimit = m_cycleCnt + nCycles;
+
+    while(m_cycleCnt < cycleLimit)
     {
-        ExecuteInstruction();
+        if (m_sampler)
+        {
+            m_sampler->Publish(m_register[Register::CS], m_register[Register::IP],
+                (m_profiler || m_tracer) ? SamplingProfiler::Interpreter :
+                m_blockCacheEnabled ? SamplingProfiler::BlockCache :
+#ifdef X86EMU_THREADED_DISPATCH
+                SamplingProfiler::Threaded);
+#else
+                SamplingProfiler::Interpreter);
+#endif
+        }
 
-        if ((m_state & State::InvalidOp) || (m_state & State::Finished))
-            return false;
+        if (m_profiler || m_tracer)
+        {
+            if (m_profiler)
+                m_profiler->Record(m_register[Register::CS], m_register[Register::IP]);
+
+            if (m_tracer)
+            {
+                // flags as pushf would see them
+                RecalcFlags();
+                m_tracer->Record(m_register[Register::CS], m_register[Register::IP],
+                    m_memory + m_register[Register::CS] * 16 + m_register[Register::IP], m_register, m_registerHigh);
+            }
+
+            m_instructionCnt++;
+            ExecuteInstruction();
+        }
+        else if (m_blockCacheEnabled)
+        {
+            ExecuteBlock(FetchBlock(), cycleLimit);
+        }
+        else
+        {
+#ifdef X86EMU_THREADED_DISPATCH
+            uint8_t* ip = m_memory + m_register[Register::CS] * 16 + m_register[Register::IP];
+
+            m_threadedLimit = std::min<std::size_t>(cycleLimit, m_cycleCnt + MaxThreadedChain);
+            (this->*s_threadedTable[*ip])(ip + 1);
+#else
+            m_instructionCnt++;
+            ExecuteInstruction();
+#endif
+        }
+
+        if (m_state)
+        {
+            if ((m_state & State::InvalidOp) || (m_state & State::Finished))
+                return false;
+
+            if (m_state & (State::Halted | State::Idle))
+            {
+                m_halted = (m_state & State::Halted) != 0;
+                m_idle   = true;
+                break;
+            }
+        }
+    }
+
+    if (m_sampler)
+    {
+        m_sampler->Publish(m_register[Register::CS], m_register[Register::IP], m_idle ? SamplingProfiler::Idle : SamplingProfiler::Host);
     }
 
     return true;
@@ -191,8 +401,136 @@ void Cpu::Stop()
     m_state |= State::Finished;
 }
 
+void Cpu::SetBus(Bus* bus)
+{
+    m_bus = bus;
+}
+
+void Cpu::SetInterruptHandler(uint8_t intNo, std::function<void ()> handler)
+{
+    uint8_t* stub = m_memory + HleStubSeg * 16 + (HleStubAddr(intNo) & 0xffff);
+
+    m_interruptHandler[intNo] = handler;
+
+    if (handler)
+    {
+        // reached by programs chaining to the vector they replaced; retf 2 keeps the
+        // flags the handler returns its status in
+        stub[0] = 0xf1;
+        stub[1] = intNo;
+        stub[2] = 0xca;
+        stub[3] = 0x02;
+        stub[4] = 0x00;
+
+        reinterpret_cast<uint32_t *>(m_memory)[intNo] = HleStubAddr(intNo);
+    }
+}
+
+void Cpu::SetProfiler(Profiler* profiler)
+{
+    m_profiler = profiler;
+}
+
+void Cpu::SetSamplingProfiler(SamplingProfiler* sampler)
+{
+    m_sampler = sampler;
+}
+
+void Cpu::SetTracer(Tracer* tracer)
+{
+    m_tracer = tracer;
+}
+
+void Cpu::Set386Enabled(bool enabled)
+{
+    m_386Enabled = enabled;
+}
+
+void Cpu::SetBlockCacheEnabled(bool enabled)
+{
+    if (enabled && m_blockCache.empty())
+    {
+        m_blockCache.resize(BlockCacheSize);
+
+        for(auto& block : m_blockCache)
+        {
+            block.linearAddr = ~0u;
+            block.native     = nullptr;
+        }
+    }
+
+    m_blockCacheEnabled = enabled;
+}
+
+bool Cpu::IsBlockCacheEnabled()
+{
+    return m_blockCacheEnabled;
+}
+
+std::size_t Cpu::GetInstructionCount()
+{
+    return m_instructionCnt;
+}
+
+std::size_t Cpu::GetCycleCount()
+{
+    return m_cycleCnt;
+}
+
+void Cpu::SetIdleDetectionEnabled(bool enabled)
+{
+    // reads of the tick counter page go through PageLoad16() / PageLoad8() while enabled
+    m_idleDetectionEnabled = enabled;
+    m_pollCount            = 0;
+
+    if (m_pollArmed)
+        ArmPollStores(false);
+
+    UpdatePage(TickCounterAddr >> PageShift);
+}
+
+bool Cpu::IsIdle()
+{
+    return m_idle;
+}
+
+void Cpu::MapMemory(uint32_t linearAddr, uint32_t size, std::function<uint8_t (uint32_t addr)> onRead, std::function<void (uint32_t addr, uint8_t value)> onWrite)
+{
+    int region = m_regions.size();
+
+    m_regions.push_back({ linearAddr, onRead, onWrite, nullptr, nullptr });
+
+    for(std::size_t page = linearAddr >> PageShift; page < ((linearAddr + size + PageSize - 1) >> PageShift) && page < PageCount; page++)
+    {
+        m_pageRegion[page] = region;
+        UpdatePage(page);
+    }
+}
+
+void Cpu::MapMemoryBlock(uint32_t linearAddr, std::function<void (uint32_t addr, const uint8_t* data, uint32_t count)> onWriteBlock, std::function<void (uint32_t addr, uint8_t value, uint32_t count)> onFillBlock)
+{
+    int region = m_pageRegion[linearAddr >> PageShift];
+
+    if (region >= 0)
+    {
+        m_regions[region].onWriteBlock = onWriteBlock;
+        m_regions[region].onFillBlock  = onFillBlock;
+    }
+}
+
+void Cpu::WatchMemory(uint32_t linearAddr, uint32_t size, bool enable)
+{
+    for(std::size_t page = linearAddr >> PageShift; page < ((linearAddr + size + PageSize - 1) >> PageShift) && page < PageCount; page++)
+    {
+        m_pageWatched[page] = enable;
+        UpdatePage(page);
+    }
+}
+
 void Cpu::Interrupt(int num)
 {
+    m_halted = false;
+
     RecalcFlags();
     Push16(m_register[Register::FLAG]);
     Push16(m_register[Register::CS]);
@@ -213,6 +551,8 @@ bool Cpu::HardwareInterrupt(int num)
     if ((m_register[Register::FLAG] & Flag::IF_mask) == 0)
         return false;
 
+    m_halted = false;
+
     RecalcFlags();
     Push16(m_register[Register::FLAG]);
     Push16(m_register[Register::CS]);
@@ -227,14 +567,37 @@ bool Cpu::HardwareInterrupt(int num)
 }
 
 // private methods
+void Cpu::CallInterruptHandler(uint8_t intNo)
+{
+    if (m_sampler)
+    {
+        // ah selects the function of int 21h / int 10h & co.
+        m_sampler->EnterInterrupt(intNo, m_register[Register::AX] >> 8);
+        m_interruptHandler[intNo]();
+        m_sampler->LeaveInterrupt();
+    }
+    else
+    {
+        m_interruptHandler[intNo]();
+    }
+}
+
 uint32_t Cpu::PortRead(uint16_t port, int size)
 {
-    return onPortRead(port, size);
+    uint32_t value = m_bus ? m_bus->PortRead(port, size) : onPortRead(port, size);
+
+    if (m_idleDetectionEnabled && port == InputStatusPort)
+        DetectPollLoop(value);
+
+    return value;
 }
 
 void Cpu::PortWrite(uint16_t port, int size, uint32_t value)
 {
-    onPortWrite(port, size, value);
+    if (m_bus)
+        m_bus->PortWrite(port, size, value);
+    else
+        onPortWrite(port, size, value);
 }
 
 inline uint16_t* Cpu::Reg16(uint8_t modrm)
@@ -249,7 +612,7 @@ inline uint8_t* Cpu::Reg8(uint8_t modrm)
 
 inline uint16_t* Cpu::SReg(uint8_t modrm)
 {
-    return &m_register[Register::ES + ((modrm >> 3) & 0x07)];
+    return &m_register[Register::ES + ((modrm >> 3) & 0x03)];
 }
 
 inline uint16_t Cpu::Disp16(uint8_t* ip)
@@ -267,98 +630,273 @@ inline uint16_t Cpu::Imm16(uint8_t* ip)
     return *reinterpret_cast<uint16_t *>(ip);
 }
 
+inline uint32_t Cpu::Imm32(uint8_t* ip)
+{
+    return *reinterpret_cast<uint32_t *>(ip);
+}
+
+inline uint32_t Cpu::GetRegister32(int reg)
+{
+    return m_register[reg] | (static_cast<uint32_t>(m_registerHigh[reg]) << 16);
+}
+
+inline void Cpu::SetRegister32(int reg, uint32_t value)
+{
+    m_register[reg]     = value;
+    m_registerHigh[reg] = value >> 16;
+}
+
 inline uint32_t Cpu::Load32(std::size_t linearAddr)
 {
-    // printf("load %08lx val 0x%08x\n",
-    //     linearAddr, *reinterpret_cast<uint32_t *>(m_memory + linearAddr));
+    uint8_t* base = m_readMap[linearAddr >> PageShift];
+
+    if (base)
+        return *reinterpret_cast<uint32_t *>(base + linearAddr);
 
-    return *reinterpret_cast<uint32_t *>(m_memory + linearAddr);
+    return PageLoad16(linearAddr) | (static_cast<uint32_t>(PageLoad16(linearAddr + 2)) << 16);
 }
 
 inline uint16_t Cpu::Load16(std::size_t linearAddr)
 {
-    if (linearAddr >= 0x400 && linearAddr <= 0x500 && linearAddr >= 0xc000)
-    {
-        if (linearAddr != 0x46c && linearAddr != 0x471 && linearAddr != 0x46e)
-        {
-            printf("load %08lx val 0x%04x\n",
-                linearAddr, *reinterpret_cast<uint16_t *>(m_memory + linearAddr));
-        }
-    }
+    uint8_t* base = m_readMap[linearAddr >> PageShift];
 
-    if ((linearAddr & 0xfe0000) == 0xa0000)
-    {
-        linearAddr -= 0xa0000;
-        return onVgaMemRead(linearAddr) + (static_cast<uint16_t>(onVgaMemRead(linearAddr + 1)) << 8);
-    }
-    else
-    {
-        return *reinterpret_cast<uint16_t *>(m_memory + linearAddr);
-    }
+    if (base)
+        return *reinterpret_cast<uint16_t *>(base + linearAddr);
+
+    return PageLoad16(linearAddr);
 }
 
 inline uint8_t Cpu::Load8(std::size_t linearAddr)
 {
-    if (linearAddr >= 0x400 && linearAddr <= 0x500 && linearAddr >= 0xc000)
-    {
-        if (linearAddr != 0x46c && linearAddr != 0x471 && linearAddr != 0x44a && linearAddr != 0x484 &&
-            linearAddr != 0x450 && linearAddr != 0x451 && linearAddr != 0x46e)
-        {
-            printf("load %08lx val 0x%02x\n",
-                linearAddr, *reinterpret_cast<uint8_t *>(m_memory + linearAddr));
-        }
-    }
+    uint8_t* base = m_readMap[linearAddr >> PageShift];
+
+    if (base)
+        return base[linearAddr];
+
+    return PageLoad8(linearAddr);
+}
+
+inline void Cpu::Store32(std::size_t linearAddr, uint32_t value)
+{
+    uint8_t* base = m_writeMap[linearAddr >> PageShift];
+
+    if (static_cast<uint32_t>(linearAddr) - m_codeStart < m_codeLength)
+        m_codeWritten = true;
 
-    if ((linearAddr & 0xfe0000) == 0xa0000)
+    if (base)
     {
-        return onVgaMemRead(linearAddr - 0xa0000);
+        *reinterpret_cast<uint32_t *>(base + linearAddr) = value;
     }
     else
     {
-        return *reinterpret_cast<uint8_t *>(m_memory + linearAddr);
+        PageStore16(linearAddr, value);
+        PageStore16(linearAddr + 2, value >> 16);
     }
 }
 
 inline void Cpu::Store16(std::size_t linearAddr, uint16_t value)
 {
-    if (linearAddr <= 0x500)
+    uint8_t* base = m_writeMap[linearAddr >> PageShift];
+
+    if (static_cast<uint32_t>(linearAddr) - m_codeStart < m_codeLength)
+        m_codeWritten = true;
+
+    if (base)
+        *reinterpret_cast<uint16_t *>(base + linearAddr) = value;
+    else
+        PageStore16(linearAddr, value);
+}
+
+inline void Cpu::Store8(std::size_t linearAddr, uint8_t value)
+{
+    uint8_t* base = m_writeMap[linearAddr >> PageShift];
+
+    if (static_cast<uint32_t>(linearAddr) - m_codeStart < m_codeLength)
+        m_codeWritten = true;
+
+    if (base)
+        base[linearAddr] = value;
+    else
+        PageStore8(linearAddr, value);
+}
+
+// Accesses to pages without a direct mapping - memory mapped devices and watched pages
+inline uint8_t Cpu::RegionRead(int region, uint32_t addr)
+{
+    if (region == m_vgaRegion && m_bus)
+        return m_bus->VgaMemRead(addr);
+
+    return m_regions[region].onRead(addr);
+}
+
+inline void Cpu::RegionWrite(int region, uint32_t addr, uint8_t value)
+{
+    if (region == m_vgaRegion && m_bus)
+        m_bus->VgaMemWrite(addr, value);
+    else
+        m_regions[region].onWrite(addr, value);
+}
+
+uint16_t Cpu::PageLoad16(std::size_t linearAddr)
+{
+    std::size_t page = linearAddr >> PageShift;
+
+    if (m_pageRegion[page] >= 0)
     {
-        if (linearAddr != 0x46c)
-        {
-            printf("store %08lx val 0x%04x (was 0x%04x)\n",
-                linearAddr, value, *reinterpret_cast<uint16_t *>(m_memory + linearAddr));
-        }
+        int      region = m_pageRegion[page];
+        uint32_t addr   = linearAddr - m_regions[region].base;
+
+        return RegionRead(region, addr) + (static_cast<uint16_t>(RegionRead(region, addr + 1)) << 8);
     }
 
-    if ((linearAddr & 0xfe0000) == 0xa0000)
+    uint16_t value = *reinterpret_cast<uint16_t *>(m_memory + linearAddr);
+
+    if (m_idleDetectionEnabled && linearAddr + 2 > TickCounterAddr && linearAddr < TickCounterAddr + 4)
+        DetectPollLoop(*reinterpret_cast<uint32_t *>(m_memory + TickCounterAddr));
+
+    if (onMemWatch && m_pageWatched[page])
+        onMemWatch(linearAddr, 2, value, false);
+
+    return value;
+}
+
+uint8_t Cpu::PageLoad8(std::size_t linearAddr)
+{
+    std::size_t page = linearAddr >> PageShift;
+
+    if (m_pageRegion[page] >= 0)
     {
-        uint32_t addr = linearAddr - 0xa0000;
+        int region = m_pageRegion[page];
 
-        onVgaMemWrite(addr, value & 0xff);
-        onVgaMemWrite(addr + 1, value >> 8);
+        return RegionRead(region, linearAddr - m_regions[region].base);
     }
-    else
+
+    uint8_t value = m_memory[linearAddr];
+
+    if (m_idleDetectionEnabled && linearAddr >= TickCounterAddr && linearAddr < TickCounterAddr + 4)
+        DetectPollLoop(*reinterpret_cast<uint32_t *>(m_memory + TickCounterAddr));
+
+    if (onMemWatch && m_pageWatched[page])
+        onMemWatch(linearAddr, 1, value, false);
+
+    return value;
+}
+
+void Cpu::PageStore16(std::size_t linearAddr, uint16_t value)
+{
+    std::size_t page = linearAddr >> PageShift;
+
+    m_pollStored = true;
+
+    if (m_pageRegion[page] >= 0)
     {
-        *reinterpret_cast<uint16_t *>(m_memory + linearAddr) = value;
+        int      region = m_pageRegion[page];
+        uint32_t addr   = linearAddr - m_regions[region].base;
+
+        RegionWrite(region, addr, value & 0xff);
+        RegionWrite(region, addr + 1, value >> 8);
+        return;
     }
+
+    // watch hook is called before the store, so it can still see the old value
+    if (onMemWatch)
+        onMemWatch(linearAddr, 2, value, true);
+
+    *reinterpret_cast<uint16_t *>(m_memory + linearAddr) = value;
 }
 
-inline void Cpu::Store8(std::size_t linearAddr, uint8_t value)
+void Cpu::PageStore8(std::size_t linearAddr, uint8_t value)
 {
-    if (linearAddr <= 0x500)
+    std::size_t page = linearAddr >> PageShift;
+
+    m_pollStored = true;
+
+    if (m_pageRegion[page] >= 0)
     {
-        printf("store %08lx val 0x%02x (was 0x%02x)\n",
-            linearAddr, value, *reinterpret_cast<uint8_t *>(m_memory + linearAddr));
+        int region = m_pageRegion[page];
+
+        RegionWrite(region, linearAddr - m_regions[region].base, value);
+        return;
     }
 
-    if ((linearAddr & 0xfe0000) == 0xa0000)
+    if (onMemWatch)
+        onMemWatch(linearAddr, 1, value, true);
+
+    m_memory[linearAddr] = value;
+}
+
+void Cpu::UpdatePage(std::size_t page)
+{
+    bool direct   = m_pageRegion[page] < 0 && !m_pageWatched[page];
+    bool tickWait = m_idleDetectionEnabled && page == (TickCounterAddr >> PageShift);
+
+    m_readMap[page]  = direct && !tickWait ? m_memory : nullptr;
+    m_writeMap[page] = direct && !m_pollArmed ? m_memory : nullptr;
+}
+
+void Cpu::DetectPollLoop(uint32_t value)
+{
+    // The same instruction reading an unchanged tick count / input status again within
+    // a few instructions, with no register (32-bit halves included) changed and nothing
+    // stored since the last read, is a loop waiting for the timer interrupt or the next
+    // retrace edge - nothing it executes until then matters. Loops counting between
+    // ticks (delay calibration), in a register or in memory, keep running.
+    std::size_t cnt  = m_instructionCnt;
+    bool        same = value == m_pollValue && cnt - m_pollCnt <= PollLoopLength &&
+        ::memcmp(m_pollRegs, m_register, sizeof(m_pollRegs)) == 0 &&
+        ::memcmp(m_pollRegsHigh, m_registerHigh, sizeof(m_pollRegsHigh)) == 0;
+
+    // stores are only seen while armed, a poll before that can't tell
+    if (same && m_pollArmed && !m_pollStored)
     {
-        onVgaMemWrite(linearAddr - 0xa0000, value);
+        if (++m_pollCount >= PollLoopCount && (m_register[Register::FLAG] & Flag::IF_mask))
+            m_state |= State::Idle;
     }
     else
     {
-        *reinterpret_cast<uint8_t *>(m_memory + linearAddr) = value;
+        m_pollCount = 0;
     }
+
+    if (same != m_pollArmed)
+        ArmPollStores(same);
+
+    ::memcpy(m_pollRegs, m_register, sizeof(m_pollRegs));
+    ::memcpy(m_pollRegsHigh, m_registerHigh, sizeof(m_pollRegsHigh));
+    m_pollValue  = value;
+    m_pollCnt    = cnt;
+    m_pollStored = false;
+}
+
+// Takes the direct mapping away from every page while a wait loop candidate runs, so
+// DetectPollLoop() learns about stores made by the interpreter, rep bulk copies and the
+// jit alike
+void Cpu::ArmPollStores(bool armed)
+{
+    m_pollArmed  = armed;
+    m_pollStored = false;
+
+    for(int n = 0; n < PageCount; n++)
+        UpdatePage(n);
+}
+
+uint16_t Cpu::ReadMem16(std::size_t linearAddr)
+{
+    return Load16(linearAddr);
+}
+
+uint8_t Cpu::ReadMem8(std::size_t linearAddr)
+{
+    return Load8(linearAddr);
+}
+
+void Cpu::WriteMem16(std::size_t linearAddr, uint16_t value)
+{
+    Store16(linearAddr, value);
+}
+
+void Cpu::WriteMem8(std::size_t linearAddr, uint8_t value)
+{
+    Store8(linearAddr, value);
 }
 
 inline void Cpu::Push16(uint16_t value)
@@ -375,13 +913,31 @@ inline uint16_t Cpu::Pop16()
     return value;
 }
 
+inline void Cpu::Push32(uint32_t value)
+{
+    m_register[Register::SP] -= 4;
+    Store32(m_register[Register::SS] * 16 + m_register[Register::SP], value);
+}
+
+inline uint32_t Cpu::Pop32()
+{
+    uint32_t value = Load32(m_register[Register::SS] * 16 + m_register[Register::SP]);
+    m_register[Register::SP] += 4;
+
+    return value;
+}
+
 inline bool Cpu::GetCF()
 {
+    ResolveFlags();
+
     return (static_cast<uint32_t>(m_auxbits) >> Aux::CF_bit) & 1;
 }
 
 inline bool Cpu::GetPF()
 {
+    ResolveFlags();
+
     int tmp;
 
     tmp = m_result & 0xff;
@@ -393,6 +949,8 @@ inline bool Cpu::GetPF()
 
 inline bool Cpu::GetAF()
 {
+    ResolveFlags();
+
     return (m_auxbits >> Aux::AF_bit) & 1;
 }
 
@@ -403,16 +961,22 @@ inline bool Cpu::GetZF()
 
 inline bool Cpu::GetSF()
 {
+    ResolveFlags();
+
     return (static_cast<uint32_t>(m_result) >> 31) ^ (m_auxbits & Aux::SFD_mask);
 }
 
 inline bool Cpu::GetOF()
 {
-    return ((m_auxbits + (1 << Aux::PO_bit)) >> Aux::CF_bit) & 1;
+    ResolveFlags();
+
+    return ((static_cast<uint32_t>(m_auxbits) + (1 << Aux::PO_bit)) >> Aux::CF_bit) & 1;
 }
 
 inline void Cpu::SetOF_CF(bool of, bool cf)
 {
+    ResolveFlags();
+
     int po = of ^ cf;
 
     m_auxbits &= ~(Aux::PO_mask | Aux::CF_mask);
@@ -426,6 +990,8 @@ inline void Cpu::SetCF(bool val)
 
 inline void Cpu::SetPF(bool val)
 {
+    ResolveFlags();
+
     int pdb = (m_result & 0xff) ^ (!val);
 
     m_auxbits &= ~Aux::PDB_mask;
@@ -434,12 +1000,16 @@ inline void Cpu::SetPF(bool val)
 
 inline void Cpu::SetAF(bool val)
 {
+    ResolveFlags();
+
     m_auxbits &= ~Aux::AF_mask;
     m_auxbits |= val << Aux::AF_bit;
 }
 
 inline void Cpu::SetZF(bool val)
 {
+    ResolveFlags();
+
     if (val)
     {
         m_auxbits ^= (m_result >> 31) & 1;
@@ -464,46 +1034,198 @@ inline void Cpu::SetOF(bool val)
 
 inline void Cpu::SetSubFlags16(uint16_t op1, uint16_t op2, uint16_t result)
 {
-    uint16_t carries = ((~op1) & op2) | (((~op1) ^ op2) & result);
-
-    m_result  = static_cast<short>(result);
-    m_auxbits = (carries << 16) | (carries & Aux::AF_mask);
+    m_result       = static_cast<short>(result);
+    m_lazyOp       = LazyOp::Sub16;
+    m_lazyOperand1 = op1;
+    m_lazyOperand2 = op2;
 }
 
 inline void Cpu::SetSubFlags8(uint8_t op1, uint8_t op2, uint8_t result)
 {
-    uint8_t carries = ((~op1) & op2) | (((~op1) ^ op2) & result);
-
-    m_result  = static_cast<char>(result);
-    m_auxbits = (carries << 24) | (carries & Aux::AF_mask);
+    m_result       = static_cast<char>(result);
+    m_lazyOp       = LazyOp::Sub8;
+    m_lazyOperand1 = op1;
+    m_lazyOperand2 = op2;
 }
 
 inline void Cpu::SetAddFlags16(uint16_t op1, uint16_t op2, uint16_t result)
 {
-    uint16_t carries = (op1 & op2) | ((op1 | op2) & (~result));
-
-    m_result  = static_cast<short>(result);
-    m_auxbits = (carries << 16) | (carries & Aux::AF_mask);
+    m_result       = static_cast<short>(result);
+    m_lazyOp       = LazyOp::Add16;
+    m_lazyOperand1 = op1;
+    m_lazyOperand2 = op2;
 }
 
 inline void Cpu::SetAddFlags8(uint8_t op1, uint8_t op2, uint8_t result)
 {
-    uint8_t carries = (op1 & op2) | ((op1 | op2) & (~result));
-
-    m_result  = static_cast<char>(result);
-    m_auxbits = (carries << 24) | (carries & Aux::AF_mask);
+    m_result       = static_cast<char>(result);
+    m_lazyOp       = LazyOp::Add8;
+    m_lazyOperand1 = op1;
+    m_lazyOperand2 = op2;
 }
 
 inline void Cpu::SetLogicFlags16(uint16_t result)
 {
-    m_result  = static_cast<short>(result);
-    m_auxbits = 0;
+    m_result = static_cast<short>(result);
+    m_lazyOp = LazyOp::Logic;
 }
 
 inline void Cpu::SetLogicFlags8(uint8_t result)
 {
-    m_result  = static_cast<char>(result);
-    m_auxbits = 0;
+    m_result = static_cast<char>(result);
+    m_lazyOp = LazyOp::Logic;
+}
+
+// inc / dec leave CF alone, so it has to be captured before recording the operation
+inline void Cpu::SetIncFlags16(uint16_t op1, uint16_t result)
+{
+    bool cf = GetCF();
+
+    m_result       = static_cast<short>(result);
+    m_lazyOp       = LazyOp::Inc16;
+    m_lazyOperand1 = op1;
+    m_lazyOperand2 = cf;
+}
+
+inline void Cpu::SetIncFlags8(uint8_t op1, uint8_t result)
+{
+    bool cf = GetCF();
+
+    m_result       = static_cast<char>(result);
+    m_lazyOp       = LazyOp::Inc8;
+    m_lazyOperand1 = op1;
+    m_lazyOperand2 = cf;
+}
+
+inline void Cpu::SetDecFlags16(uint16_t op1, uint16_t result)
+{
+    bool cf = GetCF();
+
+    m_result       = static_cast<short>(result);
+    m_lazyOp       = LazyOp::Dec16;
+    m_lazyOperand1 = op1;
+    m_lazyOperand2 = cf;
+}
+
+inline void Cpu::SetDecFlags8(uint8_t op1, uint8_t result)
+{
+    bool cf = GetCF();
+
+    m_result       = static_cast<char>(result);
+    m_lazyOp       = LazyOp::Dec8;
+    m_lazyOperand1 = op1;
+    m_lazyOperand2 = cf;
+}
+
+inline void Cpu::SetSubFlags32(uint32_t op1, uint32_t op2, uint32_t result)
+{
+    m_result       = static_cast<int>(result);
+    m_lazyOp       = LazyOp::Sub32;
+    m_lazyOperand1 = op1;
+    m_lazyOperand2 = op2;
+}
+
+inline void Cpu::SetAddFlags32(uint32_t op1, uint32_t op2, uint32_t result)
+{
+    m_result       = static_cast<int>(result);
+    m_lazyOp       = LazyOp::Add32;
+    m_lazyOperand1 = op1;
+    m_lazyOperand2 = op2;
+}
+
+inline void Cpu::SetLogicFlags32(uint32_t result)
+{
+    m_result = static_cast<int>(result);
+    m_lazyOp = LazyOp::Logic;
+}
+
+inline void Cpu::SetIncFlags32(uint32_t op1, uint32_t result)
+{
+    bool cf = GetCF();
+
+    m_result       = static_cast<int>(result);
+    m_lazyOp       = LazyOp::Inc32;
+    m_lazyOperand1 = op1;
+    m_lazyOperand2 = cf;
+}
+
+inline void Cpu::SetDecFlags32(uint32_t op1, uint32_t result)
+{
+    bool cf = GetCF();
+
+    m_result       = static_cast<int>(result);
+    m_lazyOp       = LazyOp::Dec32;
+    m_lazyOperand1 = op1;
+    m_lazyOperand2 = cf;
+}
+
+inline void Cpu::ResolveFlags()
+{
+    if (m_lazyOp != LazyOp::None)
+        ResolveLazyFlags();
+}
+
+// Computes m_auxbits for the recorded operation. Only the operands are kept, m_result
+// is still the result of the operation - everything that writes m_result directly
+// resolves the flags first.
+void Cpu::ResolveLazyFlags()
+{
+    uint32_t op1    = m_lazyOperand1;
+    uint32_t op2    = m_lazyOperand2;
+    uint32_t result = m_result;
+    uint32_t carries;
+
+    switch(m_lazyOp)
+    {
+        case LazyOp::Add16: case LazyOp::Add8: case LazyOp::Add32:
+        case LazyOp::Inc16: case LazyOp::Inc8: case LazyOp::Inc32:
+            if (m_lazyOp >= LazyOp::Inc16)
+                op2 = 1;
+
+            carries = (op1 & op2) | ((op1 | op2) & (~result));
+            break;
+
+        case LazyOp::Sub16: case LazyOp::Sub8: case LazyOp::Sub32:
+        case LazyOp::Dec16: case LazyOp::Dec8: case LazyOp::Dec32:
+            if (m_lazyOp >= LazyOp::Inc16)
+                op2 = 1;
+
+            carries = ((~op1) & op2) | (((~op1) ^ op2) & result);
+            break;
+
+        default:
+            m_auxbits = 0;
+            m_lazyOp  = LazyOp::None;
+            return;
+    }
+
+    switch(m_lazyOp)
+    {
+        case LazyOp::Add16: case LazyOp::Sub16: case LazyOp::Inc16: case LazyOp::Dec16:
+            m_auxbits = ((carries & 0xffff) << 16) | (carries & Aux::AF_mask);
+            break;
+
+        case LazyOp::Add32: case LazyOp::Sub32: case LazyOp::Inc32: case LazyOp::Dec32:
+            // carries out of bits 31 and 30 are CF and PO already
+            m_auxbits = carries & (Aux::CF_mask | Aux::PO_mask | Aux::AF_mask);
+            break;
+
+        default:
+            m_auxbits = ((carries & 0xff) << 24) | (carries & Aux::AF_mask);
+            break;
+    }
+
+    if (m_lazyOp >= LazyOp::Inc16)
+    {
+        // put back the carry flag from before the operation, keeping OF
+        uint32_t cf = m_lazyOperand2;
+        uint32_t of = ((m_auxbits + (1 << Aux::PO_bit)) >> Aux::CF_bit) & 1;
+
+        m_auxbits &= ~(Aux::PO_mask | Aux::CF_mask);
+        m_auxbits |= (cf << Aux::CF_bit) | ((of ^ cf) << Aux::PO_bit);
+    }
+
+    m_lazyOp = LazyOp::None;
 }
 
 void Cpu::RecalcFlags()
@@ -531,6 +1253,7 @@ void Cpu::RestoreLazyFlags()
 
     bool po = of ^ cf;
 
+    m_lazyOp = LazyOp::None;
     m_result = (!zf) << 8;
     m_auxbits =
         (cf << Aux::CF_bit) |
@@ -540,585 +1263,199 @@ void Cpu::RestoreLazyFlags()
         sf;
 }
 
+// offset of the memory operand of the ModR/M byte at 'ip'
+inline uint16_t Cpu::ModRmOffset(uint8_t *ip)
+{
+    const ModRmEa& ea = ModRmEa::s_table[*ip];
+
+    return m_register[ea.base] + m_register[ea.index] + ModRmDisp(ea, ip);
+}
+
+// linear address of the memory operand of the ModR/M byte at 'ip'
+inline std::size_t Cpu::ModRmAddr(uint8_t *ip)
+{
+    const ModRmEa& ea = ModRmEa::s_table[*ip];
+
+    return (ea.stackSegment ? m_stackSegmentBase : m_segmentBase) +
+        static_cast<uint16_t>(m_register[ea.base] + m_register[ea.index] + ModRmDisp(ea, ip));
+}
+
 inline void Cpu::ModRmLoadEa(uint8_t *ip)
 {
-    uint8_t  modRm = *ip++;
-    uint16_t *reg  = Reg16(modRm);
-
-    switch(modRm)
-    {
-        // mod 00
-        ModRm_Case(0x00): *reg = m_register[Register::BX] + m_register[Register::SI];              break;
-        ModRm_Case(0x01): *reg = m_register[Register::BX] + m_register[Register::DI];              break;
-        ModRm_Case(0x02): *reg = m_register[Register::BP] + m_register[Register::SI];              break;
-        ModRm_Case(0x03): *reg = m_register[Register::BP] + m_register[Register::DI];              break;
-        ModRm_Case(0x04): *reg = m_register[Register::SI];                                         break;
-        ModRm_Case(0x05): *reg = m_register[Register::DI];                                         break;
-        ModRm_Case(0x06): *reg = Disp16(ip);                                                       break;
-        ModRm_Case(0x07): *reg = m_register[Register::BX];                                         break;
-        // mod 01
-        ModRm_Case(0x40): *reg = m_register[Register::BX] + m_register[Register::SI] + Disp8(ip);  break;
-        ModRm_Case(0x41): *reg = m_register[Register::BX] + m_register[Register::DI] + Disp8(ip);  break;
-        ModRm_Case(0x42): *reg = m_register[Register::BP] + m_register[Register::SI] + Disp8(ip);  break;
-        ModRm_Case(0x43): *reg = m_register[Register::BP] + m_register[Register::DI] + Disp8(ip);  break;
-        ModRm_Case(0x44): *reg = m_register[Register::SI]                            + Disp8(ip);  break;
-        ModRm_Case(0x45): *reg = m_register[Register::DI]                            + Disp8(ip);  break;
-        ModRm_Case(0x46): *reg = m_register[Register::BP]                            + Disp8(ip);  break;
-        ModRm_Case(0x47): *reg = m_register[Register::BX]                            + Disp8(ip);  break;
-        // mod 10
-        ModRm_Case(0x80): *reg = m_register[Register::BX] + m_register[Register::SI] + Disp16(ip); break;
-        ModRm_Case(0x81): *reg = m_register[Register::BX] + m_register[Register::DI] + Disp16(ip); break;
-        ModRm_Case(0x82): *reg = m_register[Register::BP] + m_register[Register::SI] + Disp16(ip); break;
-        ModRm_Case(0x83): *reg = m_register[Register::BP] + m_register[Register::DI] + Disp16(ip); break;
-        ModRm_Case(0x84): *reg = m_register[Register::SI]                            + Disp16(ip); break;
-        ModRm_Case(0x85): *reg = m_register[Register::DI]                            + Disp16(ip); break;
-        ModRm_Case(0x86): *reg = m_register[Register::BP]                            + Disp16(ip); break;
-        ModRm_Case(0x87): *reg = m_register[Register::BX]                            + Disp16(ip); break;
-        // mod 11
-        ModRm_Case(0xc0):
-        ModRm_Case(0xc1):
-        ModRm_Case(0xc2):
-        ModRm_Case(0xc3):
-        ModRm_Case(0xc4):
-        ModRm_Case(0xc5):
-        ModRm_Case(0xc6):
-        ModRm_Case(0xc7): m_state |= State::InvalidOp; break;
+    if (*ip >= 0xc0)
+    {
+        m_state |= State::InvalidOp;
+        return;
     }
+
+    *Reg16(*ip) = ModRmOffset(ip);
 }
 
-inline uint32_t Cpu::ModRmLoad32(uint8_t *ip)
+// segment:offset pointer, memory operands only
+inline uint32_t Cpu::ModRmLoadFar(uint8_t *ip)
 {
-    uint8_t modRm = *ip++;
-
-    switch(modRm)
-    {
-        // mod 00
-        ModRm_Case(0x00): return Load32(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI]));
-        ModRm_Case(0x01): return Load32(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI]));
-        ModRm_Case(0x02): return Load32(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI]));
-        ModRm_Case(0x03): return Load32(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI]));
-        ModRm_Case(0x04): return Load32(m_segmentBase      + m_register[Register::SI]);
-        ModRm_Case(0x05): return Load32(m_segmentBase      + m_register[Register::DI]);
-        ModRm_Case(0x06): return Load32(m_segmentBase      + Disp16(ip));
-        ModRm_Case(0x07): return Load32(m_segmentBase      + m_register[Register::BX]);
-        // mod 01
-        ModRm_Case(0x40): return Load32(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI] + Disp8(ip)));
-        ModRm_Case(0x41): return Load32(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI] + Disp8(ip)));
-        ModRm_Case(0x42): return Load32(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI] + Disp8(ip)));
-        ModRm_Case(0x43): return Load32(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI] + Disp8(ip)));
-        ModRm_Case(0x44): return Load32(m_segmentBase      + AddrClamp16(m_register[Register::SI]                            + Disp8(ip)));
-        ModRm_Case(0x45): return Load32(m_segmentBase      + AddrClamp16(m_register[Register::DI]                            + Disp8(ip)));
-        ModRm_Case(0x46): return Load32(m_stackSegmentBase + AddrClamp16(m_register[Register::BP]                            + Disp8(ip)));
-        ModRm_Case(0x47): return Load32(m_segmentBase      + AddrClamp16(m_register[Register::BX]                            + Disp8(ip)));
-        // mod 10
-        ModRm_Case(0x80): return Load32(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI] + Disp16(ip)));
-        ModRm_Case(0x81): return Load32(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI] + Disp16(ip)));
-        ModRm_Case(0x82): return Load32(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI] + Disp16(ip)));
-        ModRm_Case(0x83): return Load32(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI] + Disp16(ip)));
-        ModRm_Case(0x84): return Load32(m_segmentBase      + AddrClamp16(m_register[Register::SI]                            + Disp16(ip)));
-        ModRm_Case(0x85): return Load32(m_segmentBase      + AddrClamp16(m_register[Register::DI]                            + Disp16(ip)));
-        ModRm_Case(0x86): return Load32(m_stackSegmentBase + AddrClamp16(m_register[Register::BP]                            + Disp16(ip)));
-        ModRm_Case(0x87): return Load32(m_segmentBase      + AddrClamp16(m_register[Register::BX]                            + Disp16(ip)));
-        // mod 11
-        ModRm_Case(0xc0):
-        ModRm_Case(0xc1):
-        ModRm_Case(0xc2):
-        ModRm_Case(0xc3):
-        ModRm_Case(0xc4):
-        ModRm_Case(0xc5):
-        ModRm_Case(0xc6):
-        ModRm_Case(0xc7): m_state |= State::InvalidOp; break;
+    if (*ip >= 0xc0)
+    {
+        m_state |= State::InvalidOp;
+        return 0;
     }
 
-    return 0;
+    return Load32(ModRmAddr(ip));
+}
+
+inline uint32_t Cpu::ModRmLoad32(uint8_t *ip)
+{
+    if (*ip >= 0xc0)
+        return GetRegister32(*ip & 0x07);
+
+    return Load32(ModRmAddr(ip));
 }
 
 inline uint16_t Cpu::ModRmLoad16(uint8_t *ip)
 {
-    uint8_t modRm = *ip++;
-
-    switch(modRm)
-    {
-        // mod 00
-        ModRm_Case(0x00): return Load16(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI]));
-        ModRm_Case(0x01): return Load16(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI]));
-        ModRm_Case(0x02): return Load16(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI]));
-        ModRm_Case(0x03): return Load16(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI]));
-        ModRm_Case(0x04): return Load16(m_segmentBase      + m_register[Register::SI]);
-        ModRm_Case(0x05): return Load16(m_segmentBase      + m_register[Register::DI]);
-        ModRm_Case(0x06): return Load16(m_segmentBase      + Disp16(ip));
-        ModRm_Case(0x07): return Load16(m_segmentBase      + m_register[Register::BX]);
-        // mod 01
-        ModRm_Case(0x40): return Load16(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI] + Disp8(ip)));
-        ModRm_Case(0x41): return Load16(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI] + Disp8(ip)));
-        ModRm_Case(0x42): return Load16(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI] + Disp8(ip)));
-        ModRm_Case(0x43): return Load16(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI] + Disp8(ip)));
-        ModRm_Case(0x44): return Load16(m_segmentBase      + AddrClamp16(m_register[Register::SI]                            + Disp8(ip)));
-        ModRm_Case(0x45): return Load16(m_segmentBase      + AddrClamp16(m_register[Register::DI]                            + Disp8(ip)));
-        ModRm_Case(0x46): return Load16(m_stackSegmentBase + AddrClamp16(m_register[Register::BP]                            + Disp8(ip)));
-        ModRm_Case(0x47): return Load16(m_segmentBase      + AddrClamp16(m_register[Register::BX]                            + Disp8(ip)));
-        // mod 10
-        ModRm_Case(0x80): return Load16(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI] + Disp16(ip)));
-        ModRm_Case(0x81): return Load16(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI] + Disp16(ip)));
-        ModRm_Case(0x82): return Load16(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI] + Disp16(ip)));
-        ModRm_Case(0x83): return Load16(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI] + Disp16(ip)));
-        ModRm_Case(0x84): return Load16(m_segmentBase      + AddrClamp16(m_register[Register::SI]                            + Disp16(ip)));
-        ModRm_Case(0x85): return Load16(m_segmentBase      + AddrClamp16(m_register[Register::DI]                            + Disp16(ip)));
-        ModRm_Case(0x86): return Load16(m_stackSegmentBase + AddrClamp16(m_register[Register::BP]                            + Disp16(ip)));
-        ModRm_Case(0x87): return Load16(m_segmentBase      + AddrClamp16(m_register[Register::BX]                            + Disp16(ip)));
-        // mod 11
-        ModRm_Case(0xc0): return m_register[0];
-        ModRm_Case(0xc1): return m_register[1];
-        ModRm_Case(0xc2): return m_register[2];
-        ModRm_Case(0xc3): return m_register[3];
-        ModRm_Case(0xc4): return m_register[4];
-        ModRm_Case(0xc5): return m_register[5];
-        ModRm_Case(0xc6): return m_register[6];
-        ModRm_Case(0xc7): return m_register[7];
-    }
+    if (*ip >= 0xc0)
+        return m_register[*ip & 0x07];
 
-    return 0;
+    return Load16(ModRmAddr(ip));
 }
 
 inline uint8_t Cpu::ModRmLoad8(uint8_t *ip)
 {
-    uint8_t modRm = *ip++;
-
-    switch(modRm)
-    {
-        // mod 00
-        ModRm_Case(0x00): return Load8(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI]));
-        ModRm_Case(0x01): return Load8(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI]));
-        ModRm_Case(0x02): return Load8(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI]));
-        ModRm_Case(0x03): return Load8(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI]));
-        ModRm_Case(0x04): return Load8(m_segmentBase      + m_register[Register::SI]);
-        ModRm_Case(0x05): return Load8(m_segmentBase      + m_register[Register::DI]);
-        ModRm_Case(0x06): return Load8(m_segmentBase      + Disp16(ip));
-        ModRm_Case(0x07): return Load8(m_segmentBase      + m_register[Register::BX]);
-        // mod 01
-        ModRm_Case(0x40): return Load8(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI] + Disp8(ip)));
-        ModRm_Case(0x41): return Load8(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI] + Disp8(ip)));
-        ModRm_Case(0x42): return Load8(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI] + Disp8(ip)));
-        ModRm_Case(0x43): return Load8(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI] + Disp8(ip)));
-        ModRm_Case(0x44): return Load8(m_segmentBase      + AddrClamp16(m_register[Register::SI]                            + Disp8(ip)));
-        ModRm_Case(0x45): return Load8(m_segmentBase      + AddrClamp16(m_register[Register::DI]                            + Disp8(ip)));
-        ModRm_Case(0x46): return Load8(m_stackSegmentBase + AddrClamp16(m_register[Register::BP]                            + Disp8(ip)));
-        ModRm_Case(0x47): return Load8(m_segmentBase      + AddrClamp16(m_register[Register::BX]                            + Disp8(ip)));
-        // mod 10
-        ModRm_Case(0x80): return Load8(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI] + Disp16(ip)));
-        ModRm_Case(0x81): return Load8(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI] + Disp16(ip)));
-        ModRm_Case(0x82): return Load8(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI] + Disp16(ip)));
-        ModRm_Case(0x83): return Load8(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI] + Disp16(ip)));
-        ModRm_Case(0x84): return Load8(m_segmentBase      + AddrClamp16(m_register[Register::SI]                            + Disp16(ip)));
-        ModRm_Case(0x85): return Load8(m_segmentBase      + AddrClamp16(m_register[Register::DI]                            + Disp16(ip)));
-        ModRm_Case(0x86): return Load8(m_stackSegmentBase + AddrClamp16(m_register[Register::BP]                            + Disp16(ip)));
-        ModRm_Case(0x87): return Load8(m_segmentBase      + AddrClamp16(m_register[Register::BX]                            + Disp16(ip)));
-        // mod 11
-        ModRm_Case(0xc0): return m_register[0];
-        ModRm_Case(0xc1): return m_register[1];
-        ModRm_Case(0xc2): return m_register[2];
-        ModRm_Case(0xc3): return m_register[3];
-        ModRm_Case(0xc4): return m_register[0] >> 8;
-        ModRm_Case(0xc5): return m_register[1] >> 8;
-        ModRm_Case(0xc6): return m_register[2] >> 8;
-        ModRm_Case(0xc7): return m_register[3] >> 8;
+    if (*ip >= 0xc0)
+        return *Reg8(*ip << 3);
+
+    return Load8(ModRmAddr(ip));
+}
+
+inline void Cpu::ModRmStore32(uint8_t *ip, uint32_t value)
+{
+    if (*ip >= 0xc0)
+    {
+        SetRegister32(*ip & 0x07, value);
+        return;
     }
 
-    return 0;
+    Store32(ModRmAddr(ip), value);
 }
 
 inline void Cpu::ModRmStore16(uint8_t *ip, uint16_t value)
 {
-    uint8_t modRm = *ip++;
-
-    switch(modRm)
-    {
-        // mod 00
-        ModRm_Case(0x00): Store16(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI]), value); break;
-        ModRm_Case(0x01): Store16(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI]), value); break;
-        ModRm_Case(0x02): Store16(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI]), value); break;
-        ModRm_Case(0x03): Store16(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI]), value); break;
-        ModRm_Case(0x04): Store16(m_segmentBase      + m_register[Register::SI], value);                                         break;
-        ModRm_Case(0x05): Store16(m_segmentBase      + m_register[Register::DI], value);                                         break;
-        ModRm_Case(0x06): Store16(m_segmentBase      + Disp16(ip)              , value);                                         break;
-        ModRm_Case(0x07): Store16(m_segmentBase      + m_register[Register::BX], value);                                         break;
-        // mod 01
-        ModRm_Case(0x40): Store16(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI] + Disp8(ip)), value);  break;
-        ModRm_Case(0x41): Store16(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI] + Disp8(ip)), value);  break;
-        ModRm_Case(0x42): Store16(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI] + Disp8(ip)), value);  break;
-        ModRm_Case(0x43): Store16(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI] + Disp8(ip)), value);  break;
-        ModRm_Case(0x44): Store16(m_segmentBase      + AddrClamp16(m_register[Register::SI]                            + Disp8(ip)), value);  break;
-        ModRm_Case(0x45): Store16(m_segmentBase      + AddrClamp16(m_register[Register::DI]                            + Disp8(ip)), value);  break;
-        ModRm_Case(0x46): Store16(m_stackSegmentBase + AddrClamp16(m_register[Register::BP]                            + Disp8(ip)), value);  break;
-        ModRm_Case(0x47): Store16(m_segmentBase      + AddrClamp16(m_register[Register::BX]                            + Disp8(ip)), value);  break;
-        // mod 10
-        ModRm_Case(0x80): Store16(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI] + Disp16(ip)), value); break;
-        ModRm_Case(0x81): Store16(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI] + Disp16(ip)), value); break;
-        ModRm_Case(0x82): Store16(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI] + Disp16(ip)), value); break;
-        ModRm_Case(0x83): Store16(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI] + Disp16(ip)), value); break;
-        ModRm_Case(0x84): Store16(m_segmentBase      + AddrClamp16(m_register[Register::SI]                            + Disp16(ip)), value); break;
-        ModRm_Case(0x85): Store16(m_segmentBase      + AddrClamp16(m_register[Register::DI]                            + Disp16(ip)), value); break;
-        ModRm_Case(0x86): Store16(m_stackSegmentBase + AddrClamp16(m_register[Register::BP]                            + Disp16(ip)), value); break;
-        ModRm_Case(0x87): Store16(m_segmentBase      + AddrClamp16(m_register[Register::BX]                            + Disp16(ip)), value); break;
-        // mod 11
-        ModRm_Case(0xc0): m_register[0] = value; break;
-        ModRm_Case(0xc1): m_register[1] = value; break;
-        ModRm_Case(0xc2): m_register[2] = value; break;
-        ModRm_Case(0xc3): m_register[3] = value; break;
-        ModRm_Case(0xc4): m_register[4] = value; break;
-        ModRm_Case(0xc5): m_register[5] = value; break;
-        ModRm_Case(0xc6): m_register[6] = value; break;
-        ModRm_Case(0xc7): m_register[7] = value; break;
+    if (*ip >= 0xc0)
+    {
+        m_register[*ip & 0x07] = value;
+        return;
     }
+
+    Store16(ModRmAddr(ip), value);
 }
 
 inline void Cpu::ModRmStore8(uint8_t *ip, uint8_t value)
 {
-    uint8_t modRm = *ip++;
-
-    switch(modRm)
-    {
-        // mod 00
-        ModRm_Case(0x00): Store8(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI]), value); break;
-        ModRm_Case(0x01): Store8(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI]), value); break;
-        ModRm_Case(0x02): Store8(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI]), value); break;
-        ModRm_Case(0x03): Store8(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI]), value); break;
-        ModRm_Case(0x04): Store8(m_segmentBase      + m_register[Register::SI], value);                                         break;
-        ModRm_Case(0x05): Store8(m_segmentBase      + m_register[Register::DI], value);                                         break;
-        ModRm_Case(0x06): Store8(m_segmentBase      + Disp16(ip)              , value);                                         break;
-        ModRm_Case(0x07): Store8(m_segmentBase      + m_register[Register::BX], value);                                         break;
-        // mod 01
-        ModRm_Case(0x40): Store8(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI] + Disp8(ip)), value);  break;
-        ModRm_Case(0x41): Store8(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI] + Disp8(ip)), value);  break;
-        ModRm_Case(0x42): Store8(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI] + Disp8(ip)), value);  break;
-        ModRm_Case(0x43): Store8(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI] + Disp8(ip)), value);  break;
-        ModRm_Case(0x44): Store8(m_segmentBase      + AddrClamp16(m_register[Register::SI]                            + Disp8(ip)), value);  break;
-        ModRm_Case(0x45): Store8(m_segmentBase      + AddrClamp16(m_register[Register::DI]                            + Disp8(ip)), value);  break;
-        ModRm_Case(0x46): Store8(m_stackSegmentBase + AddrClamp16(m_register[Register::BP]                            + Disp8(ip)), value);  break;
-        ModRm_Case(0x47): Store8(m_segmentBase      + AddrClamp16(m_register[Register::BX]                            + Disp8(ip)), value);  break;
-        // mod 10
-        ModRm_Case(0x80): Store8(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI] + Disp16(ip)), value); break;
-        ModRm_Case(0x81): Store8(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI] + Disp16(ip)), value); break;
-        ModRm_Case(0x82): Store8(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI] + Disp16(ip)), value); break;
-        ModRm_Case(0x83): Store8(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI] + Disp16(ip)), value); break;
-        ModRm_Case(0x84): Store8(m_segmentBase      + AddrClamp16(m_register[Register::SI]                            + Disp16(ip)), value); break;
-        ModRm_Case(0x85): Store8(m_segmentBase      + AddrClamp16(m_register[Register::DI]                            + Disp16(ip)), value); break;
-        ModRm_Case(0x86): Store8(m_stackSegmentBase + AddrClamp16(m_register[Register::BP]                            + Disp16(ip)), value); break;
-        ModRm_Case(0x87): Store8(m_segmentBase      + AddrClamp16(m_register[Register::BX]                            + Disp16(ip)), value); break;
-        // mod 11
-        ModRm_Case(0xc0): *reinterpret_cast<uint8_t *>(&m_register[0]) = value;       break;
-        ModRm_Case(0xc1): *reinterpret_cast<uint8_t *>(&m_register[1]) = value;       break;
-        ModRm_Case(0xc2): *reinterpret_cast<uint8_t *>(&m_register[2]) = value;       break;
-        ModRm_Case(0xc3): *reinterpret_cast<uint8_t *>(&m_register[3]) = value;       break;
-        ModRm_Case(0xc4): *(reinterpret_cast<uint8_t *>(&m_register[0]) + 1) = value; break;
-        ModRm_Case(0xc5): *(reinterpret_cast<uint8_t *>(&m_register[1]) + 1) = value; break;
-        ModRm_Case(0xc6): *(reinterpret_cast<uint8_t *>(&m_register[2]) + 1) = value; break;
-        ModRm_Case(0xc7): *(reinterpret_cast<uint8_t *>(&m_register[3]) + 1) = value; break;
+    if (*ip >= 0xc0)
+    {
+        *Reg8(*ip << 3) = value;
+        return;
     }
+
+    Store8(ModRmAddr(ip), value);
 }
 
 template<typename F>
 inline void Cpu::ModRmLoadOp16(uint8_t *ip, F&& f)  // op r16, r/m16
 {
-    std::size_t ea;
-    uint16_t    op1, op2, opResult;
-    uint8_t     modRm = *ip++;
-    uint16_t    *reg;
-
-    reg      = Reg16(modRm);
-    op1      = *reg;
-
-    switch(modRm)
-    {
-        // mod 00
-        ModRm_Case(0x00): op2 = Load16(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI]));              opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x01): op2 = Load16(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI]));              opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x02): op2 = Load16(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI]));              opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x03): op2 = Load16(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI]));              opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x04): op2 = Load16(m_segmentBase      + m_register[Register::SI]);                                                      opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x05): op2 = Load16(m_segmentBase      + m_register[Register::DI]);                                                      opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x06): op2 = Load16(m_segmentBase      + Disp16(ip));                                                                    opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x07): op2 = Load16(m_segmentBase      + m_register[Register::BX]);                                                      opResult = f(op1, op2); *reg = opResult; break;
-        // mod 01
-        ModRm_Case(0x40): op2 = Load16(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI] + Disp8(ip)));  opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x41): op2 = Load16(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI] + Disp8(ip)));  opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x42): op2 = Load16(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI] + Disp8(ip)));  opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x43): op2 = Load16(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI] + Disp8(ip)));  opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x44): op2 = Load16(m_segmentBase      + AddrClamp16(m_register[Register::SI]                            + Disp8(ip)));  opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x45): op2 = Load16(m_segmentBase      + AddrClamp16(m_register[Register::DI]                            + Disp8(ip)));  opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x46): op2 = Load16(m_stackSegmentBase + AddrClamp16(m_register[Register::BP]                            + Disp8(ip)));  opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x47): op2 = Load16(m_segmentBase      + AddrClamp16(m_register[Register::BX]                            + Disp8(ip)));  opResult = f(op1, op2); *reg = opResult; break;
-        // mod 10
-        ModRm_Case(0x80): op2 = Load16(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI] + Disp16(ip))); opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x81): op2 = Load16(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI] + Disp16(ip))); opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x82): op2 = Load16(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI] + Disp16(ip))); opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x83): op2 = Load16(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI] + Disp16(ip))); opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x84): op2 = Load16(m_segmentBase      + AddrClamp16(m_register[Register::SI]                            + Disp16(ip))); opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x85): op2 = Load16(m_segmentBase      + AddrClamp16(m_register[Register::DI]                            + Disp16(ip))); opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x86): op2 = Load16(m_stackSegmentBase + AddrClamp16(m_register[Register::BP]                            + Disp16(ip))); opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x87): op2 = Load16(m_segmentBase      + AddrClamp16(m_register[Register::BX]                            + Disp16(ip))); opResult = f(op1, op2); *reg = opResult; break;
-        // mod 11
-        ModRm_Case(0xc0): op2 = m_register[0]; opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0xc1): op2 = m_register[1]; opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0xc2): op2 = m_register[2]; opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0xc3): op2 = m_register[3]; opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0xc4): op2 = m_register[4]; opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0xc5): op2 = m_register[5]; opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0xc6): op2 = m_register[6]; opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0xc7): op2 = m_register[7]; opResult = f(op1, op2); *reg = opResult; break;
-    }
+    uint16_t *reg = Reg16(*ip);
+    uint16_t op2  = (*ip >= 0xc0) ? m_register[*ip & 0x07] : Load16(ModRmAddr(ip));
+
+    *reg = f(*reg, op2);
 }
 
 template<typename F>
 inline void Cpu::ModRmLoadOp8(uint8_t *ip, F&& f)   // op r8, r/m8
 {
-    std::size_t ea;
-    uint8_t     op1, op2, opResult;
-    uint8_t     modRm = *ip++;
-    uint8_t     *reg;
-
-    reg = Reg8(modRm);
-    op1 = *reg;
-
-    switch(modRm)
-    {
-        // mod 00
-        ModRm_Case(0x00): op2 = Load8(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI]));              opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x01): op2 = Load8(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI]));              opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x02): op2 = Load8(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI]));              opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x03): op2 = Load8(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI]));              opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x04): op2 = Load8(m_segmentBase      + m_register[Register::SI]);                                                      opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x05): op2 = Load8(m_segmentBase      + m_register[Register::DI]);                                                      opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x06): op2 = Load8(m_segmentBase      + Disp16(ip));                                                                    opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x07): op2 = Load8(m_segmentBase      + m_register[Register::BX]);                                                      opResult = f(op1, op2); *reg = opResult; break;
-        // mod 01
-        ModRm_Case(0x40): op2 = Load8(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI] + Disp8(ip)));  opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x41): op2 = Load8(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI] + Disp8(ip)));  opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x42): op2 = Load8(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI] + Disp8(ip)));  opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x43): op2 = Load8(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI] + Disp8(ip)));  opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x44): op2 = Load8(m_segmentBase      + AddrClamp16(m_register[Register::SI]                            + Disp8(ip)));  opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x45): op2 = Load8(m_segmentBase      + AddrClamp16(m_register[Register::DI]                            + Disp8(ip)));  opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x46): op2 = Load8(m_stackSegmentBase + AddrClamp16(m_register[Register::BP]                            + Disp8(ip)));  opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x47): op2 = Load8(m_segmentBase      + AddrClamp16(m_register[Register::BX]                            + Disp8(ip)));  opResult = f(op1, op2); *reg = opResult; break;
-        // mod 10
-        ModRm_Case(0x80): op2 = Load8(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI] + Disp16(ip))); opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x81): op2 = Load8(m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI] + Disp16(ip))); opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x82): op2 = Load8(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI] + Disp16(ip))); opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x83): op2 = Load8(m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI] + Disp16(ip))); opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x84): op2 = Load8(m_segmentBase      + AddrClamp16(m_register[Register::SI]                            + Disp16(ip))); opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x85): op2 = Load8(m_segmentBase      + AddrClamp16(m_register[Register::DI]                            + Disp16(ip))); opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x86): op2 = Load8(m_stackSegmentBase + AddrClamp16(m_register[Register::BP]                            + Disp16(ip))); opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0x87): op2 = Load8(m_segmentBase      + AddrClamp16(m_register[Register::BX]                            + Disp16(ip))); opResult = f(op1, op2); *reg = opResult; break;
-        // mod 11
-        ModRm_Case(0xc0): op2 = *reinterpret_cast<uint8_t *>(&m_register[0]);       opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0xc1): op2 = *reinterpret_cast<uint8_t *>(&m_register[1]);       opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0xc2): op2 = *reinterpret_cast<uint8_t *>(&m_register[2]);       opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0xc3): op2 = *reinterpret_cast<uint8_t *>(&m_register[3]);       opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0xc4): op2 = *(reinterpret_cast<uint8_t *>(&m_register[0]) + 1); opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0xc5): op2 = *(reinterpret_cast<uint8_t *>(&m_register[1]) + 1); opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0xc6): op2 = *(reinterpret_cast<uint8_t *>(&m_register[2]) + 1); opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0xc7): op2 = *(reinterpret_cast<uint8_t *>(&m_register[3]) + 1); opResult = f(op1, op2); *reg = opResult; break;
-    }
+    uint8_t *reg = Reg8(*ip);
+    uint8_t op2  = (*ip >= 0xc0) ? *Reg8(*ip << 3) : Load8(ModRmAddr(ip));
+
+    *reg = f(*reg, op2);
 }
 
 template<typename F>
 inline void Cpu::ModRmModifyOp16(uint8_t *ip, F&& f)    // op r/m16, r16
 {
-    std::size_t ea;
-    uint16_t    op1, op2, opResult;
-    uint8_t     modRm = *ip++;
-
-    op2 = *Reg16(modRm);
-
-    switch(modRm)
-    {
-        // mod 00
-        ModRm_Case(0x00): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI]);              op1 = Load16(ea); opResult = f(op1, op2); Store16(ea, opResult); break;
-        ModRm_Case(0x01): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI]);              op1 = Load16(ea); opResult = f(op1, op2); Store16(ea, opResult); break;
-        ModRm_Case(0x02): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI]);              op1 = Load16(ea); opResult = f(op1, op2); Store16(ea, opResult); break;
-        ModRm_Case(0x03): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI]);              op1 = Load16(ea); opResult = f(op1, op2); Store16(ea, opResult); break;
-        ModRm_Case(0x04): ea = m_segmentBase      + m_register[Register::SI];                                                      op1 = Load16(ea); opResult = f(op1, op2); Store16(ea, opResult); break;
-        ModRm_Case(0x05): ea = m_segmentBase      + m_register[Register::DI];                                                      op1 = Load16(ea); opResult = f(op1, op2); Store16(ea, opResult); break;
-        ModRm_Case(0x06): ea = m_segmentBase      + Disp16(ip);                                                                    op1 = Load16(ea); opResult = f(op1, op2); Store16(ea, opResult); break;
-        ModRm_Case(0x07): ea = m_segmentBase      + m_register[Register::BX];                                                      op1 = Load16(ea); opResult = f(op1, op2); Store16(ea, opResult); break;
-        // mod 01
-        ModRm_Case(0x40): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI] + Disp8(ip));  op1 = Load16(ea); opResult = f(op1, op2); Store16(ea, opResult); break;
-        ModRm_Case(0x41): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI] + Disp8(ip));  op1 = Load16(ea); opResult = f(op1, op2); Store16(ea, opResult); break;
-        ModRm_Case(0x42): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI] + Disp8(ip));  op1 = Load16(ea); opResult = f(op1, op2); Store16(ea, opResult); break;
-        ModRm_Case(0x43): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI] + Disp8(ip));  op1 = Load16(ea); opResult = f(op1, op2); Store16(ea, opResult); break;
-        ModRm_Case(0x44): ea = m_segmentBase      + AddrClamp16(m_register[Register::SI]                            + Disp8(ip));  op1 = Load16(ea); opResult = f(op1, op2); Store16(ea, opResult); break;
-        ModRm_Case(0x45): ea = m_segmentBase      + AddrClamp16(m_register[Register::DI]                            + Disp8(ip));  op1 = Load16(ea); opResult = f(op1, op2); Store16(ea, opResult); break;
-        ModRm_Case(0x46): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP]                            + Disp8(ip));  op1 = Load16(ea); opResult = f(op1, op2); Store16(ea, opResult); break;
-        ModRm_Case(0x47): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX]                            + Disp8(ip));  op1 = Load16(ea); opResult = f(op1, op2); Store16(ea, opResult); break;
-        // mod 10
-        ModRm_Case(0x80): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI] + Disp16(ip)); op1 = Load16(ea); opResult = f(op1, op2); Store16(ea, opResult); break;
-        ModRm_Case(0x81): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI] + Disp16(ip)); op1 = Load16(ea); opResult = f(op1, op2); Store16(ea, opResult); break;
-        ModRm_Case(0x82): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI] + Disp16(ip)); op1 = Load16(ea); opResult = f(op1, op2); Store16(ea, opResult); break;
-        ModRm_Case(0x83): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI] + Disp16(ip)); op1 = Load16(ea); opResult = f(op1, op2); Store16(ea, opResult); break;
-        ModRm_Case(0x84): ea = m_segmentBase      + AddrClamp16(m_register[Register::SI]                            + Disp16(ip)); op1 = Load16(ea); opResult = f(op1, op2); Store16(ea, opResult); break;
-        ModRm_Case(0x85): ea = m_segmentBase      + AddrClamp16(m_register[Register::DI]                            + Disp16(ip)); op1 = Load16(ea); opResult = f(op1, op2); Store16(ea, opResult); break;
-        ModRm_Case(0x86): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP]                            + Disp16(ip)); op1 = Load16(ea); opResult = f(op1, op2); Store16(ea, opResult); break;
-        ModRm_Case(0x87): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX]                            + Disp16(ip)); op1 = Load16(ea); opResult = f(op1, op2); Store16(ea, opResult); break;
-        // mod 11
-        ModRm_Case(0xc0): op1 = m_register[0]; opResult = f(op1, op2); m_register[0] = opResult; break;
-        ModRm_Case(0xc1): op1 = m_register[1]; opResult = f(op1, op2); m_register[1] = opResult; break;
-        ModRm_Case(0xc2): op1 = m_register[2]; opResult = f(op1, op2); m_register[2] = opResult; break;
-        ModRm_Case(0xc3): op1 = m_register[3]; opResult = f(op1, op2); m_register[3] = opResult; break;
-        ModRm_Case(0xc4): op1 = m_register[4]; opResult = f(op1, op2); m_register[4] = opResult; break;
-        ModRm_Case(0xc5): op1 = m_register[5]; opResult = f(op1, op2); m_register[5] = opResult; break;
-        ModRm_Case(0xc6): op1 = m_register[6]; opResult = f(op1, op2); m_register[6] = opResult; break;
-        ModRm_Case(0xc7): op1 = m_register[7]; opResult = f(op1, op2); m_register[7] = opResult; break;
+    uint16_t op2 = *Reg16(*ip);
+
+    if (*ip >= 0xc0)
+    {
+        uint16_t *reg = &m_register[*ip & 0x07];
+
+        *reg = f(*reg, op2);
+    }
+    else
+    {
+        std::size_t ea = ModRmAddr(ip);
+
+        Store16(ea, f(Load16(ea), op2));
     }
 }
 
 template<typename F>
 inline void Cpu::ModRmModifyOp8(uint8_t *ip, F&& f)     // op r/m8, r8
 {
-    std::size_t ea;
-    uint8_t     op1, op2, opResult;
-    uint8_t     modRm = *ip++;
-    uint8_t     *reg;
-
-    op2 = *Reg8(modRm);
-
-    switch(modRm)
-    {
-        // mod 00
-        ModRm_Case(0x00): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI]);              op1 = Load8(ea); opResult = f(op1, op2); Store8(ea, opResult); break;
-        ModRm_Case(0x01): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI]);              op1 = Load8(ea); opResult = f(op1, op2); Store8(ea, opResult); break;
-        ModRm_Case(0x02): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI]);              op1 = Load8(ea); opResult = f(op1, op2); Store8(ea, opResult); break;
-        ModRm_Case(0x03): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI]);              op1 = Load8(ea); opResult = f(op1, op2); Store8(ea, opResult); break;
-        ModRm_Case(0x04): ea = m_segmentBase      + m_register[Register::SI];                                                      op1 = Load8(ea); opResult = f(op1, op2); Store8(ea, opResult); break;
-        ModRm_Case(0x05): ea = m_segmentBase      + m_register[Register::DI];                                                      op1 = Load8(ea); opResult = f(op1, op2); Store8(ea, opResult); break;
-        ModRm_Case(0x06): ea = m_segmentBase      + Disp16(ip);                                                                    op1 = Load8(ea); opResult = f(op1, op2); Store8(ea, opResult); break;
-        ModRm_Case(0x07): ea = m_segmentBase      + m_register[Register::BX];                                                      op1 = Load8(ea); opResult = f(op1, op2); Store8(ea, opResult); break;
-        // mod 01
-        ModRm_Case(0x40): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI] + Disp8(ip));  op1 = Load8(ea); opResult = f(op1, op2); Store8(ea, opResult); break;
-        ModRm_Case(0x41): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI] + Disp8(ip));  op1 = Load8(ea); opResult = f(op1, op2); Store8(ea, opResult); break;
-        ModRm_Case(0x42): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI] + Disp8(ip));  op1 = Load8(ea); opResult = f(op1, op2); Store8(ea, opResult); break;
-        ModRm_Case(0x43): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI] + Disp8(ip));  op1 = Load8(ea); opResult = f(op1, op2); Store8(ea, opResult); break;
-        ModRm_Case(0x44): ea = m_segmentBase      + AddrClamp16(m_register[Register::SI]                            + Disp8(ip));  op1 = Load8(ea); opResult = f(op1, op2); Store8(ea, opResult); break;
-        ModRm_Case(0x45): ea = m_segmentBase      + AddrClamp16(m_register[Register::DI]                            + Disp8(ip));  op1 = Load8(ea); opResult = f(op1, op2); Store8(ea, opResult); break;
-        ModRm_Case(0x46): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP]                            + Disp8(ip));  op1 = Load8(ea); opResult = f(op1, op2); Store8(ea, opResult); break;
-        ModRm_Case(0x47): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX]                            + Disp8(ip));  op1 = Load8(ea); opResult = f(op1, op2); Store8(ea, opResult); break;
-        // mod 10
-        ModRm_Case(0x80): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI] + Disp16(ip)); op1 = Load8(ea); opResult = f(op1, op2); Store8(ea, opResult); break;
-        ModRm_Case(0x81): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI] + Disp16(ip)); op1 = Load8(ea); opResult = f(op1, op2); Store8(ea, opResult); break;
-        ModRm_Case(0x82): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI] + Disp16(ip)); op1 = Load8(ea); opResult = f(op1, op2); Store8(ea, opResult); break;
-        ModRm_Case(0x83): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI] + Disp16(ip)); op1 = Load8(ea); opResult = f(op1, op2); Store8(ea, opResult); break;
-        ModRm_Case(0x84): ea = m_segmentBase      + AddrClamp16(m_register[Register::SI]                            + Disp16(ip)); op1 = Load8(ea); opResult = f(op1, op2); Store8(ea, opResult); break;
-        ModRm_Case(0x85): ea = m_segmentBase      + AddrClamp16(m_register[Register::DI]                            + Disp16(ip)); op1 = Load8(ea); opResult = f(op1, op2); Store8(ea, opResult); break;
-        ModRm_Case(0x86): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP]                            + Disp16(ip)); op1 = Load8(ea); opResult = f(op1, op2); Store8(ea, opResult); break;
-        ModRm_Case(0x87): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX]                            + Disp16(ip)); op1 = Load8(ea); opResult = f(op1, op2); Store8(ea, opResult); break;
-        // mod 11
-        ModRm_Case(0xc0): reg = reinterpret_cast<uint8_t *>(&m_register[0]);     op1 = *reg; opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0xc1): reg = reinterpret_cast<uint8_t *>(&m_register[1]);     op1 = *reg; opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0xc2): reg = reinterpret_cast<uint8_t *>(&m_register[2]);     op1 = *reg; opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0xc3): reg = reinterpret_cast<uint8_t *>(&m_register[3]);     op1 = *reg; opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0xc4): reg = reinterpret_cast<uint8_t *>(&m_register[0]) + 1; op1 = *reg; opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0xc5): reg = reinterpret_cast<uint8_t *>(&m_register[1]) + 1; op1 = *reg; opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0xc6): reg = reinterpret_cast<uint8_t *>(&m_register[2]) + 1; op1 = *reg; opResult = f(op1, op2); *reg = opResult; break;
-        ModRm_Case(0xc7): reg = reinterpret_cast<uint8_t *>(&m_register[3]) + 1; op1 = *reg; opResult = f(op1, op2); *reg = opResult; break;
+    uint8_t op2 = *Reg8(*ip);
+
+    if (*ip >= 0xc0)
+    {
+        uint8_t *reg = Reg8(*ip << 3);
+
+        *reg = f(*reg, op2);
+    }
+    else
+    {
+        std::size_t ea = ModRmAddr(ip);
+
+        Store8(ea, f(Load8(ea), op2));
     }
 }
 
 template<typename F>
 inline void Cpu::ModRmModifyOpNoReg16(uint8_t *ip, F&& f)    // op r/m16
 {
-    std::size_t ea;
-    uint16_t    op, opResult;
-    uint8_t     modRm = *ip++;
-
-    switch(modRm)
-    {
-        // mod 00
-        ModRm_Case(0x00): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI]);              op = Load16(ea); opResult = f(op); Store16(ea, opResult); break;
-        ModRm_Case(0x01): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI]);              op = Load16(ea); opResult = f(op); Store16(ea, opResult); break;
-        ModRm_Case(0x02): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI]);              op = Load16(ea); opResult = f(op); Store16(ea, opResult); break;
-        ModRm_Case(0x03): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI]);              op = Load16(ea); opResult = f(op); Store16(ea, opResult); break;
-        ModRm_Case(0x04): ea = m_segmentBase      + m_register[Register::SI];                                                      op = Load16(ea); opResult = f(op); Store16(ea, opResult); break;
-        ModRm_Case(0x05): ea = m_segmentBase      + m_register[Register::DI];                                                      op = Load16(ea); opResult = f(op); Store16(ea, opResult); break;
-        ModRm_Case(0x06): ea = m_segmentBase      + Disp16(ip);                                                                    op = Load16(ea); opResult = f(op); Store16(ea, opResult); break;
-        ModRm_Case(0x07): ea = m_segmentBase      + m_register[Register::BX];                                                      op = Load16(ea); opResult = f(op); Store16(ea, opResult); break;
-        // mod 01
-        ModRm_Case(0x40): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI] + Disp8(ip));  op = Load16(ea); opResult = f(op); Store16(ea, opResult); break;
-        ModRm_Case(0x41): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI] + Disp8(ip));  op = Load16(ea); opResult = f(op); Store16(ea, opResult); break;
-        ModRm_Case(0x42): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI] + Disp8(ip));  op = Load16(ea); opResult = f(op); Store16(ea, opResult); break;
-        ModRm_Case(0x43): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI] + Disp8(ip));  op = Load16(ea); opResult = f(op); Store16(ea, opResult); break;
-        ModRm_Case(0x44): ea = m_segmentBase      + AddrClamp16(m_register[Register::SI]                            + Disp8(ip));  op = Load16(ea); opResult = f(op); Store16(ea, opResult); break;
-        ModRm_Case(0x45): ea = m_segmentBase      + AddrClamp16(m_register[Register::DI]                            + Disp8(ip));  op = Load16(ea); opResult = f(op); Store16(ea, opResult); break;
-        ModRm_Case(0x46): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP]                            + Disp8(ip));  op = Load16(ea); opResult = f(op); Store16(ea, opResult); break;
-        ModRm_Case(0x47): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX]                            + Disp8(ip));  op = Load16(ea); opResult = f(op); Store16(ea, opResult); break;
-        // mod 10
-        ModRm_Case(0x80): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI] + Disp16(ip)); op = Load16(ea); opResult = f(op); Store16(ea, opResult); break;
-        ModRm_Case(0x81): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI] + Disp16(ip)); op = Load16(ea); opResult = f(op); Store16(ea, opResult); break;
-        ModRm_Case(0x82): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI] + Disp16(ip)); op = Load16(ea); opResult = f(op); Store16(ea, opResult); break;
-        ModRm_Case(0x83): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI] + Disp16(ip)); op = Load16(ea); opResult = f(op); Store16(ea, opResult); break;
-        ModRm_Case(0x84): ea = m_segmentBase      + AddrClamp16(m_register[Register::SI]                            + Disp16(ip)); op = Load16(ea); opResult = f(op); Store16(ea, opResult); break;
-        ModRm_Case(0x85): ea = m_segmentBase      + AddrClamp16(m_register[Register::DI]                            + Disp16(ip)); op = Load16(ea); opResult = f(op); Store16(ea, opResult); break;
-        ModRm_Case(0x86): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP]                            + Disp16(ip)); op = Load16(ea); opResult = f(op); Store16(ea, opResult); break;
-        ModRm_Case(0x87): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX]                            + Disp16(ip)); op = Load16(ea); opResult = f(op); Store16(ea, opResult); break;
-        // mod 11
-        ModRm_Case(0xc0): op = m_register[0]; opResult = f(op); m_register[0] = opResult; break;
-        ModRm_Case(0xc1): op = m_register[1]; opResult = f(op); m_register[1] = opResult; break;
-        ModRm_Case(0xc2): op = m_register[2]; opResult = f(op); m_register[2] = opResult; break;
-        ModRm_Case(0xc3): op = m_register[3]; opResult = f(op); m_register[3] = opResult; break;
-        ModRm_Case(0xc4): op = m_register[4]; opResult = f(op); m_register[4] = opResult; break;
-        ModRm_Case(0xc5): op = m_register[5]; opResult = f(op); m_register[5] = opResult; break;
-        ModRm_Case(0xc6): op = m_register[6]; opResult = f(op); m_register[6] = opResult; break;
-        ModRm_Case(0xc7): op = m_register[7]; opResult = f(op); m_register[7] = opResult; break;
+    if (*ip >= 0xc0)
+    {
+        uint16_t *reg = &m_register[*ip & 0x07];
+
+        *reg = f(*reg);
+    }
+    else
+    {
+        std::size_t ea = ModRmAddr(ip);
+
+        Store16(ea, f(Load16(ea)));
     }
 }
 
 template<typename F>
 inline void Cpu::ModRmModifyOpNoReg8(uint8_t *ip, F&& f)    // op r/m8
 {
-    std::size_t ea;
-    uint8_t     op, opResult;
-    uint8_t     modRm = *ip++;
-    uint8_t     *reg;
-
-    switch(modRm)
-    {
-        // mod 00
-        ModRm_Case(0x00): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI]);              op = Load8(ea); opResult = f(op); Store8(ea, opResult); break;
-        ModRm_Case(0x01): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI]);              op = Load8(ea); opResult = f(op); Store8(ea, opResult); break;
-        ModRm_Case(0x02): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI]);              op = Load8(ea); opResult = f(op); Store8(ea, opResult); break;
-        ModRm_Case(0x03): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI]);              op = Load8(ea); opResult = f(op); Store8(ea, opResult); break;
-        ModRm_Case(0x04): ea = m_segmentBase      + m_register[Register::SI];                                                      op = Load8(ea); opResult = f(op); Store8(ea, opResult); break;
-        ModRm_Case(0x05): ea = m_segmentBase      + m_register[Register::DI];                                                      op = Load8(ea); opResult = f(op); Store8(ea, opResult); break;
-        ModRm_Case(0x06): ea = m_segmentBase      + Disp16(ip);                                                                    op = Load8(ea); opResult = f(op); Store8(ea, opResult); break;
-        ModRm_Case(0x07): ea = m_segmentBase      + m_register[Register::BX];                                                      op = Load8(ea); opResult = f(op); Store8(ea, opResult); break;
-        // mod 01
-        ModRm_Case(0x40): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI] + Disp8(ip));  op = Load8(ea); opResult = f(op); Store8(ea, opResult); break;
-        ModRm_Case(0x41): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI] + Disp8(ip));  op = Load8(ea); opResult = f(op); Store8(ea, opResult); break;
-        ModRm_Case(0x42): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI] + Disp8(ip));  op = Load8(ea); opResult = f(op); Store8(ea, opResult); break;
-        ModRm_Case(0x43): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI] + Disp8(ip));  op = Load8(ea); opResult = f(op); Store8(ea, opResult); break;
-        ModRm_Case(0x44): ea = m_segmentBase      + AddrClamp16(m_register[Register::SI]                            + Disp8(ip));  op = Load8(ea); opResult = f(op); Store8(ea, opResult); break;
-        ModRm_Case(0x45): ea = m_segmentBase      + AddrClamp16(m_register[Register::DI]                            + Disp8(ip));  op = Load8(ea); opResult = f(op); Store8(ea, opResult); break;
-        ModRm_Case(0x46): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP]                            + Disp8(ip));  op = Load8(ea); opResult = f(op); Store8(ea, opResult); break;
-        ModRm_Case(0x47): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX]                            + Disp8(ip));  op = Load8(ea); opResult = f(op); Store8(ea, opResult); break;
-        // mod 10
-        ModRm_Case(0x80): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::SI] + Disp16(ip)); op = Load8(ea); opResult = f(op); Store8(ea, opResult); break;
-        ModRm_Case(0x81): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX] + m_register[Register::DI] + Disp16(ip)); op = Load8(ea); opResult = f(op); Store8(ea, opResult); break;
-        ModRm_Case(0x82): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::SI] + Disp16(ip)); op = Load8(ea); opResult = f(op); Store8(ea, opResult); break;
-        ModRm_Case(0x83): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP] + m_register[Register::DI] + Disp16(ip)); op = Load8(ea); opResult = f(op); Store8(ea, opResult); break;
-        ModRm_Case(0x84): ea = m_segmentBase      + AddrClamp16(m_register[Register::SI]                            + Disp16(ip)); op = Load8(ea); opResult = f(op); Store8(ea, opResult); break;
-        ModRm_Case(0x85): ea = m_segmentBase      + AddrClamp16(m_register[Register::DI]                            + Disp16(ip)); op = Load8(ea); opResult = f(op); Store8(ea, opResult); break;
-        ModRm_Case(0x86): ea = m_stackSegmentBase + AddrClamp16(m_register[Register::BP]                            + Disp16(ip)); op = Load8(ea); opResult = f(op); Store8(ea, opResult); break;
-        ModRm_Case(0x87): ea = m_segmentBase      + AddrClamp16(m_register[Register::BX]                            + Disp16(ip)); op = Load8(ea); opResult = f(op); Store8(ea, opResult); break;
-        // mod 11
-        ModRm_Case(0xc0): reg = reinterpret_cast<uint8_t *>(&m_register[0]);     op = *reg; opResult = f(op); *reg = opResult; break;
-        ModRm_Case(0xc1): reg = reinterpret_cast<uint8_t *>(&m_register[1]);     op = *reg; opResult = f(op); *reg = opResult; break;
-        ModRm_Case(0xc2): reg = reinterpret_cast<uint8_t *>(&m_register[2]);     op = *reg; opResult = f(op); *reg = opResult; break;
-        ModRm_Case(0xc3): reg = reinterpret_cast<uint8_t *>(&m_register[3]);     op = *reg; opResult = f(op); *reg = opResult; break;
-        ModRm_Case(0xc4): reg = reinterpret_cast<uint8_t *>(&m_register[0]) + 1; op = *reg; opResult = f(op); *reg = opResult; break;
-        ModRm_Case(0xc5): reg = reinterpret_cast<uint8_t *>(&m_register[1]) + 1; op = *reg; opResult = f(op); *reg = opResult; break;
-        ModRm_Case(0xc6): reg = reinterpret_cast<uint8_t *>(&m_register[2]) + 1; op = *reg; opResult = f(op); *reg = opResult; break;
-        ModRm_Case(0xc7): reg = reinterpret_cast<uint8_t *>(&m_register[3]) + 1; op = *reg; opResult = f(op); *reg = opResult; break;
+    if (*ip >= 0xc0)
+    {
+        uint8_t *reg = Reg8(*ip << 3);
+
+        *reg = f(*reg);
+    }
+    else
+    {
+        std::size_t ea = ModRmAddr(ip);
+
+        Store8(ea, f(Load8(ea)));
     }
 }
 
+// ins / outs share their low nibble with lods / scas
+inline int Cpu::RepCycles(uint8_t opcode)
+{
+    return (opcode & 0xfc) == 0x6c ? s_repIoCycles[opcode & 0x03] : s_repCycles[opcode & 0x0f];
+}
+
 void Cpu::HandleREPNE(uint8_t opcode)
 {
     if (m_register[Register::CX] == 0)
@@ -1276,29 +1613,9 @@ void Cpu::HandleREP(uint8_t opcode)
     std::size_t esBase = m_register[Register::ES] * 16;
     short       delta  = (m_register[Register::FLAG] & Flag::DF_mask) ? -1 : 1;
 
-    if (opcode == 0xa4) // rep movsb
-    {
-        while(m_register[Register::CX] > 0)
-        {
-            Store8(esBase + m_register[Register::DI], Load8(dsBase + m_register[Register::SI]));
-
-            m_register[Register::SI] += delta;
-            m_register[Register::DI] += delta;
-            m_register[Register::CX]--;
-        }
-    }
-    else if (opcode == 0xa5) // rep movsw
+    if (opcode == 0xa4 || opcode == 0xa5) // rep movsb / rep movsw
     {
-        delta <<= 1;
-
-        while(m_register[Register::CX] > 0)
-        {
-            Store16(esBase + m_register[Register::DI], Load16(dsBase + m_register[Register::SI]));
-
-            m_register[Register::SI] += delta;
-            m_register[Register::DI] += delta;
-            m_register[Register::CX]--;
-        }
+        RepMovs((opcode == 0xa5) ? 2 : 1);
     }
     else if (opcode == 0xa6) // repe cmpsb
     {
@@ -1342,29 +1659,38 @@ void Cpu::HandleREP(uint8_t opcode)
 
         SetSubFlags16(op1, op2, diff);
     }
-    else if (opcode == 0xaa) // rep stosb
+    else if (opcode == 0xaa || opcode == 0xab) // rep stosb / rep stosw
     {
-        uint8_t byte = m_register[Register::AX];
-
-        while(m_register[Register::CX] > 0)
-        {
-            Store8(esBase + m_register[Register::DI], byte);
-
-            m_register[Register::DI] += delta;
-            m_register[Register::CX]--;
-        }
+        RepStos(m_register[Register::AX], (opcode == 0xab) ? 2 : 1);
     }
-    else if (opcode == 0xab) // rep stosw
+    else if (opcode == 0xac || opcode == 0xad) // rep lodsb / rep lodsw
     {
-        uint16_t word = m_register[Register::AX];
+        int size = (opcode == 0xad) ? 2 : 1;
 
-        delta <<= 1;
+        delta *= size;
 
         while(m_register[Register::CX] > 0)
         {
-            Store16(esBase + m_register[Register::DI], word);
+            // reads from RAM have no side effects, only the last element matters
+            int n = StringRun(m_readMap, dsBase, m_register[Register::SI], size, delta < 0, m_register[Register::CX]);
 
-            m_register[Register::DI] += delta;
+            if (n > 1)
+            {
+                m_register[Register::SI] += delta * (n - 1);
+                m_register[Register::CX] -= n - 1;
+            }
+
+            if (size == 2)
+            {
+                m_register[Register::AX] = Load16(dsBase + m_register[Register::SI]);
+            }
+            else
+            {
+                m_register[Register::AX] &= 0xff00;
+                m_register[Register::AX] |= Load8(dsBase + m_register[Register::SI]);
+            }
+
+            m_register[Register::SI] += delta;
             m_register[Register::CX]--;
         }
     }
@@ -1456,88 +1782,353 @@ void Cpu::HandleREP(uint8_t opcode)
     else
     {
         printf("Invalid sub opcode 0x%02x\n", opcode);
-        // ac rep lodsb
-        // ad rep lodsw
         m_state |= State::InvalidOp;
     }
 }
 
-void Cpu::Handle8xCommon(uint8_t* ip, uint16_t op2)
+// rep with operand / address size prefixes in front of the string instruction, e.g.
+// f3 66 a5 = rep movsd. 'ip' points past the rep prefix, returns the length of the rest.
+int Cpu::HandleREPSized(uint8_t* ip, bool repe, bool operand32)
 {
-    uint8_t modrm  = *ip;
-    uint8_t opcode = (modrm >> 3) & 0x07;
+    int length = 1;
 
-    switch(opcode)
+    for(; *ip == 0x66 || *ip == 0x67; ip++, length++)
     {
-        case 0: // add r/m16, imm16
-            ModRmModifyOpNoReg16(ip,
-                [this, op2](uint16_t op1)
-                {
-                    uint16_t result = op1 + op2;
-                    SetAddFlags16(op1, op2, result);
-                    return result;
-                });
-            break;
+        if (*ip == 0x66)
+            operand32 = true;
+        else if (!AddressSize32(ip + 1))
+            return length;
+    }
 
-        case 1: // or r/m16, imm16
-            ModRmModifyOpNoReg16(ip,
-                [this, op2](uint16_t op1)
-                {
-                    uint16_t result = op1 | op2;
-                    m_result = static_cast<short>(result);
-                    m_auxbits = 0;
-                    return result;
-                });
-            break;
+    uint8_t  opcode = *ip;
+    uint16_t count  = m_register[Register::CX];
 
-        case 2: // adc r/m16, imm16
-            ModRmModifyOpNoReg16(ip,
-                [this, op2](uint16_t op1)
-                {
-                    uint16_t result = op1 + op2 + static_cast<uint16_t>(GetCF());
-                    SetAddFlags16(op1, op2, result);
-                    return result;
-                });
-            break;
+    if (!operand32 || opcode == 0xa4 || opcode == 0xa6 || opcode == 0xaa || opcode == 0xac || opcode == 0xae)
+    {
+        if (repe)
+            HandleREP(opcode);
+        else
+            HandleREPNE(opcode);
+    }
+    else if (opcode == 0xa5) // rep movsd
+    {
+        RepMovs(4);
+    }
+    else if (opcode == 0xab) // rep stosd
+    {
+        RepStos(GetRegister32(Register::AX), 4);
+    }
+    else if (opcode == 0xa7 || opcode == 0xad || opcode == 0xaf) // repe / repne cmpsd, rep lodsd, repe / repne scasd
+    {
+        while(m_register[Register::CX] > 0)
+        {
+            StringOp32(opcode);
+            m_register[Register::CX]--;
 
-        case 3: // sbb r/m16, imm16
-            ModRmModifyOpNoReg16(ip,
-                [this, op2](uint16_t op1)
-                {
-                    uint16_t result = op1 - op2 - static_cast<uint16_t>(GetCF());
-                    SetSubFlags16(op1, op2, result);
-                    return result;
-                });
-            break;
+            if (opcode != 0xad && GetZF() != repe)
+                break;
+        }
+    }
+    else
+    {
+        printf("Invalid sub opcode 0x%02x\n", opcode);
+        m_state |= State::InvalidOp;
+    }
 
-        case 4: // and r/m16, imm16
-            ModRmModifyOpNoReg16(ip,
-                [this, op2](uint16_t op1)
-                {
-                    uint16_t result = op1 & op2;
-                    m_result = static_cast<short>(result);
-                    m_auxbits = 0;
-                    return result;
-                });
-            break;
+    m_cycleCnt += static_cast<uint16_t>(count - m_register[Register::CX]) * RepCycles(opcode);
 
-        case 5: // sub r/m16, imm16
-            ModRmModifyOpNoReg16(ip,
-                [this, op2](uint16_t op1)
-                {
-                    uint16_t result = op1 - op2;
-                    SetSubFlags16(op1, op2, result);
-                    return result;
-                });
-            break;
+    return length;
+}
+
+// rep movs with 'size' byte elements, whole runs of directly mapped memory are copied at once
+void Cpu::RepMovs(int size)
+{
+    std::size_t dsBase = m_segmentBase;
+    std::size_t esBase = m_register[Register::ES] * 16;
+    short       delta  = (m_register[Register::FLAG] & Flag::DF_mask) ? -size : size;
+
+    while(m_register[Register::CX] > 0)
+    {
+        int n = StringRun(m_readMap, dsBase, m_register[Register::SI], size, delta < 0, m_register[Register::CX]);
+        int m = StringRun(m_writeMap, esBase, m_register[Register::DI], size, delta < 0, n);
+
+        if (m > 0 && MoveRun(dsBase + m_register[Register::SI], esBase + m_register[Register::DI], size, delta < 0, m))
+        {
+            m_register[Register::SI] += delta * m;
+            m_register[Register::DI] += delta * m;
+            m_register[Register::CX] -= m;
+            continue;
+        }
+
+        // from RAM into a device taking whole blocks, e.g. a blit to video memory
+        int region = BlockRegion(esBase + m_register[Register::DI]);
+
+        if (n > 0 && region >= 0)
+        {
+            n = RegionRun(region, esBase, m_register[Register::DI], size, delta < 0, n);
+
+            if (n > 0)
+            {
+                std::size_t src = dsBase + m_register[Register::SI] - ((delta < 0) ? (n - 1) * size : 0);
+                std::size_t dst = esBase + m_register[Register::DI] - ((delta < 0) ? (n - 1) * size : 0);
+
+                m_regions[region].onWriteBlock(dst - m_regions[region].base, m_memory + src, n * size);
+
+                m_register[Register::SI] += delta * n;
+                m_register[Register::DI] += delta * n;
+                m_register[Register::CX] -= n;
+                continue;
+            }
+        }
+
+        if (size == 4)
+            Store32(esBase + m_register[Register::DI], Load32(dsBase + m_register[Register::SI]));
+        else if (size == 2)
+            Store16(esBase + m_register[Register::DI], Load16(dsBase + m_register[Register::SI]));
+        else
+            Store8(esBase + m_register[Register::DI], Load8(dsBase + m_register[Register::SI]));
+
+        m_register[Register::SI] += delta;
+        m_register[Register::DI] += delta;
+        m_register[Register::CX]--;
+    }
+}
+
+// rep stos of the low 'size' bytes of 'value', filling whole runs at once
+void Cpu::RepStos(uint32_t value, int size)
+{
+    std::size_t esBase = m_register[Register::ES] * 16;
+    short       delta  = (m_register[Register::FLAG] & Flag::DF_mask) ? -size : size;
+    uint8_t     pattern[512];
+
+    // element bytes repeated, a single byte when they are all the same
+    for(int i = 0; i < 512; i++)
+        pattern[i] = value >> ((i % size) * 8);
+
+    bool bytes = ::memcmp(pattern, pattern + 1, size - 1) == 0;
+
+    while(m_register[Register::CX] > 0)
+    {
+        int n = StringRun(m_writeMap, esBase, m_register[Register::DI], size, delta < 0, m_register[Register::CX]);
+
+        if (n > 0)
+        {
+            std::size_t start = esBase + m_register[Register::DI] - ((delta < 0) ? (n - 1) * size : 0);
+
+            if (bytes)
+            {
+                ::memset(m_memory + start, pattern[0], n * size);
+            }
+            else
+            {
+                for(int i = 0; i < n * size; i++)
+                    m_memory[start + i] = pattern[i % size];
+            }
+
+            m_register[Register::DI] += delta * n;
+            m_register[Register::CX] -= n;
+            continue;
+        }
+
+        int region = BlockRegion(esBase + m_register[Register::DI]);
+
+        if (region >= 0)
+            n = RegionRun(region, esBase, m_register[Register::DI], size, delta < 0, m_register[Register::CX]);
+
+        if (n > 0)
+        {
+            MemoryRegion& r     = m_regions[region];
+            std::size_t   start = esBase + m_register[Register::DI] - ((delta < 0) ? (n - 1) * size : 0);
+            uint32_t      addr  = start - r.base;
+
+            if (bytes)
+            {
+                r.onFillBlock(addr, pattern[0], n * size);
+            }
+            else
+            {
+                for(int offset = 0; offset < n * size; offset += 512)
+                    r.onWriteBlock(addr + offset, pattern, std::min(512, n * size - offset));
+            }
+
+            m_register[Register::DI] += delta * n;
+            m_register[Register::CX] -= n;
+            continue;
+        }
+
+        if (size == 4)
+            Store32(esBase + m_register[Register::DI], value);
+        else if (size == 2)
+            Store16(esBase + m_register[Register::DI], value);
+        else
+            Store8(esBase + m_register[Register::DI], value);
+
+        m_register[Register::DI] += delta;
+        m_register[Register::CX]--;
+    }
+}
+
+// Number of elements, at most 'count', a string operation can process from 'offset' on
+// without wrapping around the segment or touching a page that is not mapped directly in
+// 'map'. Such a run is one contiguous block of host memory.
+int Cpu::StringRun(uint8_t* const* map, std::size_t base, uint16_t offset, int size, bool down, int count)
+{
+    return PageRun(base, offset, size, down, count,
+        [map](std::size_t page) { return map[page] != nullptr; });
+}
+
+// Same for a run within one memory mapped region
+int Cpu::RegionRun(int region, std::size_t base, uint16_t offset, int size, bool down, int count)
+{
+    return PageRun(base, offset, size, down, count,
+        [this, region](std::size_t page) { return m_pageRegion[page] == region && !m_pageWatched[page]; });
+}
+
+template<typename PageCheck>
+int Cpu::PageRun(std::size_t base, uint16_t offset, int size, bool down, int count, PageCheck pageCheck)
+{
+    int n = down ? offset / size + 1 : (0xffff - offset) / size + 1;
+
+    if (n > count)
+        n = count;
+
+    std::size_t start = base + offset - (down ? (n - 1) * size : 0);
+    std::size_t end   = start + n * size;
+
+    // keep the part of the run on the near side of the first page that does not qualify
+    if (down)
+    {
+        for(int page = (end - 1) >> PageShift; page >= static_cast<int>(start >> PageShift); page--)
+        {
+            std::size_t pageEnd = static_cast<std::size_t>(page + 1) << PageShift;
+
+            if (!pageCheck(page))
+                return (end > pageEnd) ? (end - pageEnd) / size : 0;
+        }
+    }
+    else
+    {
+        for(std::size_t page = start >> PageShift; page <= ((end - 1) >> PageShift); page++)
+        {
+            std::size_t pageStart = page << PageShift;
+
+            if (!pageCheck(page))
+                return (pageStart > start) ? (pageStart - start) / size : 0;
+        }
+    }
+
+    return n;
+}
+
+// Region of the page at 'linearAddr' if it takes block writes, -1 otherwise
+int Cpu::BlockRegion(std::size_t linearAddr)
+{
+    int region = m_pageRegion[linearAddr >> PageShift];
+
+    if (region >= 0 && m_regions[region].onWriteBlock && m_regions[region].onFillBlock)
+        return region;
+
+    return -1;
+}
+
+// Copies a run of 'count' elements. When source and destination overlap in a way that
+// makes the element by element copy differ from memmove(), nothing is done and false is
+// returned.
+bool Cpu::MoveRun(std::size_t src, std::size_t dst, int size, bool down, int count)
+{
+    std::size_t length = count * size;
+
+    if (down)
+    {
+        src -= length - size;
+        dst -= length - size;
+
+        if (dst < src && dst + length > src)
+            return false;
+    }
+    else
+    {
+        if (dst > src && dst < src + length)
+            return false;
+    }
+
+    ::memmove(m_memory + dst, m_memory + src, length);
+    return true;
+}
+
+void Cpu::Handle8xCommon(uint8_t* ip, uint16_t op2)
+{
+    uint8_t modrm  = *ip;
+    uint8_t opcode = (modrm >> 3) & 0x07;
+
+    switch(opcode)
+    {
+        case 0: // add r/m16, imm16
+            ModRmModifyOpNoReg16(ip,
+                [this, op2](uint16_t op1)
+                {
+                    uint16_t result = op1 + op2;
+                    SetAddFlags16(op1, op2, result);
+                    return result;
+                });
+            break;
+
+        case 1: // or r/m16, imm16
+            ModRmModifyOpNoReg16(ip,
+                [this, op2](uint16_t op1)
+                {
+                    uint16_t result = op1 | op2;
+                    SetLogicFlags16(result);
+                    return result;
+                });
+            break;
+
+        case 2: // adc r/m16, imm16
+            ModRmModifyOpNoReg16(ip,
+                [this, op2](uint16_t op1)
+                {
+                    uint16_t result = op1 + op2 + static_cast<uint16_t>(GetCF());
+                    SetAddFlags16(op1, op2, result);
+                    return result;
+                });
+            break;
+
+        case 3: // sbb r/m16, imm16
+            ModRmModifyOpNoReg16(ip,
+                [this, op2](uint16_t op1)
+                {
+                    uint16_t result = op1 - op2 - static_cast<uint16_t>(GetCF());
+                    SetSubFlags16(op1, op2, result);
+                    return result;
+                });
+            break;
+
+        case 4: // and r/m16, imm16
+            ModRmModifyOpNoReg16(ip,
+                [this, op2](uint16_t op1)
+                {
+                    uint16_t result = op1 & op2;
+                    SetLogicFlags16(result);
+                    return result;
+                });
+            break;
+
+        case 5: // sub r/m16, imm16
+            ModRmModifyOpNoReg16(ip,
+                [this, op2](uint16_t op1)
+                {
+                    uint16_t result = op1 - op2;
+                    SetSubFlags16(op1, op2, result);
+                    return result;
+                });
+            break;
 
         case 6: // xor r/m16, imm16
             ModRmModifyOpNoReg16(ip,
                 [this, op2](uint16_t op1)
                 {
                     uint16_t result = op1 ^ op2;
-                    m_result = static_cast<short>(result);
-                    m_auxbits = 0;
+                    SetLogicFlags16(result);
                     return result;
                 });
             break;
@@ -1576,8 +2167,7 @@ void Cpu::Handle80h(uint8_t* ip)
                 [this, op2](uint8_t op1)
                 {
                     uint8_t result = op1 | op2;
-                    m_result = static_cast<char>(result);
-                    m_auxbits = 0;
+                    SetLogicFlags8(result);
                     return result;
                 });
             break;
@@ -1607,8 +2197,7 @@ void Cpu::Handle80h(uint8_t* ip)
                 [this, op2](uint8_t op1)
                 {
                     uint8_t result = op1 & op2;
-                    m_result = static_cast<char>(result);
-                    m_auxbits = 0;
+                    SetLogicFlags8(result);
                     return result;
                 });
             break;
@@ -1628,8 +2217,7 @@ void Cpu::Handle80h(uint8_t* ip)
                 [this, op2](uint8_t op1)
                 {
                     uint8_t result = op1 ^ op2;
-                    m_result = static_cast<char>(result);
-                    m_auxbits = 0;
+                    SetLogicFlags8(result);
                     return result;
                 });
             break;
@@ -1743,6 +2331,8 @@ void Cpu::HandleF6h(uint8_t* ip)
 
         case 4: // mul r/m8
             {
+                m_cycleCnt += MulCycles8;
+
                 uint16_t result = (m_register[Register::AX] & 0xff) * ModRmLoad8(ip);
 
                 if (result & 0xff00)
@@ -1760,6 +2350,8 @@ void Cpu::HandleF6h(uint8_t* ip)
 
         case 5: // imul r/m8
             {
+                m_cycleCnt += MulCycles8;
+
                 int16_t result = static_cast<char>(m_register[Register::AX] & 0xff) * static_cast<char>(ModRmLoad8(ip));
 
                 if (static_cast<char>(result) == result)
@@ -1777,6 +2369,8 @@ void Cpu::HandleF6h(uint8_t* ip)
 
         case 6: // div r/m8
         {
+            m_cycleCnt += DivCycles8;
+
             uint8_t src = ModRmLoad8(ip);
 
             if (src == 0)
@@ -1803,6 +2397,8 @@ void Cpu::HandleF6h(uint8_t* ip)
 
         case 7: // idiv r/m8
         {
+            m_cycleCnt += DivCycles8;
+
             char src = ModRmLoad8(ip);
 
             if (src == 0)
@@ -1871,6 +2467,8 @@ void Cpu::HandleF7h(uint8_t* ip)
 
         case 4: // mul r/m16
             {
+                m_cycleCnt += MulCycles16;
+
                 uint32_t result = m_register[Register::AX] * ModRmLoad16(ip);
 
                 if (result & 0xffff0000)
@@ -1889,6 +2487,8 @@ void Cpu::HandleF7h(uint8_t* ip)
 
         case 5: // imul r/m16
             {
+                m_cycleCnt += MulCycles16;
+
                 int32_t result = static_cast<short>(m_register[Register::AX]) * static_cast<short>(ModRmLoad16(ip));
 
                 if (static_cast<short>(result) == result)
@@ -1907,6 +2507,8 @@ void Cpu::HandleF7h(uint8_t* ip)
 
         case 6: // div r/m16
             {
+                m_cycleCnt += DivCycles16;
+
                 uint32_t src = ModRmLoad16(ip);
 
                 if (src == 0)
@@ -1934,6 +2536,8 @@ void Cpu::HandleF7h(uint8_t* ip)
 
         case 7: // idiv r/m16
             {
+                m_cycleCnt += DivCycles16;
+
                 short src = ModRmLoad16(ip);
 
                 if (src == 0)
@@ -1973,10 +2577,8 @@ void Cpu::HandleFEh(uint8_t* ip)
                 [this](uint8_t op)
                 {
                     uint8_t result = op + 1;
-                    bool oldCF = GetCF();
 
-                    SetAddFlags8(op, 1, result);
-                    SetCF(oldCF);
+                    SetIncFlags8(op, result);
 
                     return result;
                 });
@@ -1987,10 +2589,8 @@ void Cpu::HandleFEh(uint8_t* ip)
                 [this](uint8_t op)
                 {
                     uint8_t result = op - 1;
-                    bool oldCF = GetCF();
 
-                    SetSubFlags8(op, 1, result);
-                    SetCF(oldCF);
+                    SetDecFlags8(op, result);
 
                     return result;
                 });
@@ -2014,10 +2614,8 @@ void Cpu::HandleFFh(uint8_t* ip)
                 [this](uint16_t op)
                 {
                     uint16_t result = ++op;
-                    bool oldCF = GetCF();
 
-                    SetAddFlags16(op, 1, result);
-                    SetCF(oldCF);
+                    SetIncFlags16(op, result);
 
                     return result;
                 });
@@ -2028,10 +2626,8 @@ void Cpu::HandleFFh(uint8_t* ip)
                 [this](uint16_t op)
                 {
                     uint16_t result = --op;
-                    bool oldCF = GetCF();
 
-                    SetSubFlags16(op, 1, result);
-                    SetCF(oldCF);
+                    SetDecFlags16(op, result);
 
                     return result;
                 });
@@ -2044,7 +2640,7 @@ void Cpu::HandleFFh(uint8_t* ip)
 
         case 3: // call far r/m16
             {
-                uint32_t segmentOffset = ModRmLoad32(ip);
+                uint32_t segmentOffset = ModRmLoadFar(ip);
 
                 Push16(m_register[Register::CS]);
                 Push16(m_register[Register::IP]);
@@ -2060,7 +2656,7 @@ void Cpu::HandleFFh(uint8_t* ip)
 
         case 5: // jmp far r/m16
             {
-                uint32_t segmentOffset = ModRmLoad32(ip);
+                uint32_t segmentOffset = ModRmLoadFar(ip);
 
                 m_register[Register::CS] = segmentOffset >> 16;
                 m_register[Register::IP] = segmentOffset &  0xffff;
@@ -2454,743 +3050,761 @@ void Cpu::HandleShift8(uint8_t* ip, uint8_t shift)
     }
 }
 
-void Cpu::ExecuteInstruction()
+// 386 instructions
+//
+// The 0x66 operand size prefix turns the word forms of the ALU, MOV, stack and string
+// instructions into dword ones on eax .. edi. The upper register halves are kept apart
+// from m_register, so none of the 16-bit code needs to know about them. Addressing
+// stays 16-bit, a 0x67 address size prefix is only accepted where it makes no difference.
+
+// Checks a 0x67 prefix, 'ip' points past it. String instructions are fine as long as
+// ecx, esi and edi fit in 16 bits, anything else would need 32-bit effective addresses.
+bool Cpu::AddressSize32(uint8_t* ip)
 {
-    uint16_t opcode, length, offset, value;
-    uint16_t *reg;
-    uint8_t  *ip;
+    while(*ip == 0x66 || *ip == 0xf2 || *ip == 0xf3 || (*ip & 0xe7) == 0x26)
+        ip++;
 
-    RestartDecoding:
-    ip = m_memory + m_register[Register::CS] * 16 + m_register[Register::IP];
-    opcode = *ip++;
+    bool stringOp = (*ip >= 0xa4 && *ip <= 0xa7) || (*ip >= 0xaa && *ip <= 0xaf);
 
-    m_instructionCnt++;
+    if (!stringOp || (m_registerHigh[Register::CX] | m_registerHigh[Register::SI] | m_registerHigh[Register::DI]) != 0)
+    {
+        printf("Unhandled 32-bit address, opcode 0x%02x\n", *ip);
+        m_state |= State::InvalidOp;
+        return false;
+    }
 
-    // if (opcode == 0xcd)
-    // {
-    //     uint8_t func = m_register[Register::AX] >> 8;
-    //     if (*ip == 0x21 && func == 0x48 || func == 0x49)
-    //     {
-    //         m_disasmCnt = 8;
-    //         printf("---\n");
-    //     }
-    // }
+    return true;
+}
 
-    // bool disasm = true;
-    // if (disasm)
-    // if (m_disasmCnt > 0)
-    // {
-    //     m_disasmCnt--;
-    //     printf("AX %04x BX %04x CX %04x DX %04x SI %04x DI %04x SP %04x BP %04x CS %04x DS %04x ES %04x SS %04x ",
-    //         m_register[Register::AX],
-    //         m_register[Register::BX],
-    //         m_register[Register::CX],
-    //         m_register[Register::DX],
-    //         m_register[Register::SI],
-    //         m_register[Register::DI],
-    //         m_register[Register::SP],
-    //         m_register[Register::BP],
-    //         m_register[Register::CS],
-    //         m_register[Register::DS],
-    //         m_register[Register::ES],
-    //         m_register[Register::SS]);
-    //
-    //      printf("%s\n", Disasm(*this, m_rMemory).Process().c_str());
-    // }
+// 0x66 prefixed instruction, 'ip' points past the prefix
+void Cpu::HandleOperand32(uint8_t* ip)
+{
+    uint8_t opcode = *ip++;
 
     switch(opcode)
     {
-        case 0x00: // add r/m8, r8
-            ModRmModifyOp8(ip,
-                [this](uint8_t op1, uint8_t op2)
-                {
-                    uint8_t result = op1 + op2;
-                    SetAddFlags8(op1, op2, result);
-                    return result;
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            break;
-
-        case 0x01: // add r/m16, r16
-            ModRmModifyOp16(ip,
-                [this](uint16_t op1, uint16_t op2)
-                {
-                    uint16_t result = op1 + op2;
-                    SetAddFlags16(op1, op2, result);
-                    return result;
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            break;
-
-        case 0x02: // add r8, r/m8
-            ModRmLoadOp8(ip,
-                [this](uint8_t op1, uint8_t op2)
-                {
-                    uint8_t result = op1 + op2;
-                    SetAddFlags8(op1, op2, result);
-                    return result;
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            break;
+        case 0x26: case 0x2e: case 0x36: case 0x3e: // segment override following the prefix
+            m_segmentBase      = m_register[Register::ES + ((opcode >> 3) & 0x03)] * 16;
+            m_stackSegmentBase = m_segmentBase;
+            m_register[Register::IP] += 1;
+            m_state |= State::SegmentOverride;
+            HandleOperand32(ip);
+            return;
 
-        case 0x03: // add r16, r/m16
-            ModRmLoadOp16(ip,
-                [this](uint16_t op1, uint16_t op2)
-                {
-                    uint16_t result = op1 + op2;
-                    SetAddFlags16(op1, op2, result);
-                    return result;
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            break;
+        case 0x66:
+            m_register[Register::IP] += 1;
+            HandleOperand32(ip);
+            return;
 
-        case 0x04: // add al, imm8
+        case 0x67:
+            if (AddressSize32(ip))
             {
-                uint8_t op1 = m_register[Register::AX];
-                uint8_t op2 = *ip;
-                uint8_t result = op1 + op2;
+                m_register[Register::IP] += 1;
+                HandleOperand32(ip);
+            }
+            return;
 
-                SetAddFlags8(op1, op2, result);
-                m_register[Register::AX] = (m_register[Register::AX] & 0xff00) | result;
-                m_register[Register::IP] += 2;
-                break;
-            }
+        case 0xf2: case 0xf3:
+            m_register[Register::IP] += 2 + HandleREPSized(ip, opcode == 0xf3, true);
+            return;
 
-        case 0x05: // add ax, imm16
-            {
-                uint16_t op1 = m_register[Register::AX];
-                uint16_t op2 = *reinterpret_cast<uint16_t *>(ip);
-                uint16_t result = op1 + op2;
+        // the operand size does not matter, decoded again without the prefix
+        case 0x00: case 0x02: case 0x04: case 0x08: case 0x0a: case 0x0c:
+        case 0x10: case 0x12: case 0x14: case 0x18: case 0x1a: case 0x1c:
+        case 0x20: case 0x22: case 0x24: case 0x27: case 0x28: case 0x2a: case 0x2c: case 0x2f:
+        case 0x30: case 0x32: case 0x34: case 0x37: case 0x38: case 0x3a: case 0x3c: case 0x3f:
+        case 0x70: case 0x71: case 0x72: case 0x73: case 0x74: case 0x75: case 0x76: case 0x77:
+        case 0x78: case 0x79: case 0x7a: case 0x7b: case 0x7c: case 0x7d: case 0x7e: case 0x7f:
+        case 0x80: case 0x82: case 0x84: case 0x86: case 0x88: case 0x8a: case 0x8c: case 0x8e:
+        case 0x90: case 0x9e: case 0x9f:
+        case 0xa0: case 0xa2: case 0xa4: case 0xa6: case 0xa8: case 0xaa: case 0xac: case 0xae:
+        case 0xb0: case 0xb1: case 0xb2: case 0xb3: case 0xb4: case 0xb5: case 0xb6: case 0xb7:
+        case 0xc0: case 0xc6: case 0xd0: case 0xd2: case 0xd4: case 0xd5: case 0xd7:
+        case 0xe0: case 0xe1: case 0xe2: case 0xe3: case 0xe4: case 0xe6: case 0xeb: case 0xec: case 0xee:
+        case 0xf4: case 0xf5: case 0xf6: case 0xf8: case 0xf9: case 0xfa: case 0xfb: case 0xfc: case 0xfd: case 0xfe:
+            m_register[Register::IP] += 1;
+            m_state |= State::Prefix;
+            return;
+    }
 
-                SetAddFlags16(op1, op2, result);
-                m_register[Register::AX] = result;
-                m_register[Register::IP] += 3;
-                break;
-            }
+    m_cycleCnt += s_opcodeCycles[*ip < 0xc0][opcode];
 
-        case 0x06: // push es
-            Push16(m_register[Register::ES]);
-            m_register[Register::IP] += 1;
-            break;
+    uint8_t modrm  = *ip;
+    uint8_t reg    = (modrm >> 3) & 0x07;
+    int     length = 1 + s_modRmInstLen[modrm];     // prefix, opcode, ModR/M and displacement
 
-        case 0x07: // pop ds
-            m_register[Register::ES] = Pop16();
-            m_register[Register::IP] += 1;
-            break;
+    switch(opcode)
+    {
+        case 0x01: case 0x09: case 0x11: case 0x19: // alu r/m32, r32
+        case 0x21: case 0x29: case 0x31: case 0x39:
+            {
+                uint32_t result = Alu32(opcode >> 3, ModRmLoad32(ip), GetRegister32(reg));
 
-        case 0x08: // or r/m8, r8
-            ModRmModifyOp8(ip,
-                [this](uint8_t op1, uint8_t op2)
-                {
-                    uint8_t result = op1 | op2;
-                    m_result = static_cast<char>(result);
-                    m_auxbits = 0;
-                    return result;
+                if (opcode != 0x39)
+                    ModRmStore32(ip, result);
 
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
+                m_register[Register::IP] += length;
+            }
             break;
 
-        case 0x09: // or r/m16, r16
-            ModRmModifyOp16(ip,
-                [this](uint16_t op1, uint16_t op2)
-                {
-                    uint16_t result = op1 | op2;
-                    m_result = static_cast<short>(result);
-                    m_auxbits = 0;
-                    return result;
+        case 0x03: case 0x0b: case 0x13: case 0x1b: // alu r32, r/m32
+        case 0x23: case 0x2b: case 0x33: case 0x3b:
+            {
+                uint32_t result = Alu32(opcode >> 3, GetRegister32(reg), ModRmLoad32(ip));
 
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
+                if (opcode != 0x3b)
+                    SetRegister32(reg, result);
+
+                m_register[Register::IP] += length;
+            }
             break;
 
-        case 0x0a: // or r8, r/m8
-            ModRmLoadOp8(ip,
-                [this](uint8_t op1, uint8_t op2)
-                {
-                    uint8_t result = op1 | op2;
-                    m_result = static_cast<char>(result);
-                    m_auxbits = 0;
-                    return result;
+        case 0x05: case 0x0d: case 0x15: case 0x1d: // alu eax, imm32
+        case 0x25: case 0x2d: case 0x35: case 0x3d:
+            {
+                uint32_t result = Alu32(opcode >> 3, GetRegister32(Register::AX), Imm32(ip));
 
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            break;
+                if (opcode != 0x3d)
+                    SetRegister32(Register::AX, result);
 
-        case 0x0b: // or r16, r/m16
-            ModRmLoadOp16(ip,
-                [this](uint16_t op1, uint16_t op2)
-                {
-                    uint16_t result = op1 | op2;
-                    m_result = static_cast<short>(result);
-                    m_auxbits = 0;
-                    return result;
+                m_register[Register::IP] += 6;
+            }
+            break;
 
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
+        case 0x0f: // two-byte opcodes
+            Handle0Fh32(ip);
             break;
 
-        case 0x0c: // or al, imm8
+        case 0x40: case 0x41: case 0x42: case 0x43: // inc reg32
+        case 0x44: case 0x45: case 0x46: case 0x47:
             {
-                uint8_t op1 = m_register[Register::AX];
-                uint8_t op2 = *ip;
-                uint8_t result = op1 | op2;
+                uint32_t op1    = GetRegister32(opcode & 0x07);
+                uint32_t result = op1 + 1;
 
-                SetLogicFlags8(result);
-                m_register[Register::AX] = (m_register[Register::AX] & 0xff00) | result;
+                SetIncFlags32(op1, result);
+                SetRegister32(opcode & 0x07, result);
                 m_register[Register::IP] += 2;
-                break;
             }
+            break;
 
-        case 0x0d: // or ax, imm16
+        case 0x48: case 0x49: case 0x4a: case 0x4b: // dec reg32
+        case 0x4c: case 0x4d: case 0x4e: case 0x4f:
             {
-                uint16_t op1 = m_register[Register::AX];
-                uint16_t op2 = *reinterpret_cast<uint16_t *>(ip);
-                uint16_t result = op1 | op2;
+                uint32_t op1    = GetRegister32(opcode & 0x07);
+                uint32_t result = op1 - 1;
 
-                SetLogicFlags16(result);
-                m_register[Register::AX] = result;
+                SetDecFlags32(op1, result);
+                SetRegister32(opcode & 0x07, result);
+                m_register[Register::IP] += 2;
             }
-            m_register[Register::IP] += 3;
             break;
 
-        case 0x0e: // push cs
-            Push16(m_register[Register::CS]);
-            m_register[Register::IP] += 1;
+        case 0x50: case 0x51: case 0x52: case 0x53: // push reg32
+        case 0x54: case 0x55: case 0x56: case 0x57:
+            Push32(GetRegister32(opcode & 0x07));
+            m_register[Register::IP] += 2;
             break;
 
-//         case 0x0f: // two-byte opcodes
-//             break;
-
-        case 0x10: // adc r/m8, r8
-            ModRmModifyOp8(ip,
-                [this](uint8_t op1, uint8_t op2)
-                {
-                    uint8_t result = op1 + op2 + static_cast<uint8_t>(GetCF());
-                    SetAddFlags8(op1, op2, result);
-                    return result;
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
+        case 0x58: case 0x59: case 0x5a: case 0x5b: // pop reg32
+        case 0x5c: case 0x5d: case 0x5e: case 0x5f:
+            SetRegister32(opcode & 0x07, Pop32());
+            m_register[Register::IP] += 2;
             break;
 
-        case 0x11: // adc r/m16, r16
-            ModRmModifyOp16(ip,
-                [this](uint16_t op1, uint16_t op2)
-                {
-                    uint16_t result = op1 + op2 + static_cast<uint16_t>(GetCF());
-                    SetAddFlags16(op1, op2, result);
-                    return result;
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            break;
+        case 0x60: // pushad
+            {
+                uint32_t tmpSP = GetRegister32(Register::SP);
 
-        case 0x12: // adc r8, r/m8
-            ModRmLoadOp8(ip,
-                [this](uint8_t op1, uint8_t op2)
-                {
-                    uint8_t result = op1 + op2 + static_cast<uint8_t>(GetCF());
-                    SetAddFlags8(op1, op2, result);
-                    return result;
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            break;
+                for(int n = Register::AX; n <= Register::DI; n++)
+                    Push32((n == Register::SP) ? tmpSP : GetRegister32(n));
 
-        case 0x13: // adc r16, r/m16
-            ModRmLoadOp16(ip,
-                [this](uint16_t op1, uint16_t op2)
-                {
-                    uint16_t result = op1 + op2 + static_cast<uint16_t>(GetCF());
-                    SetAddFlags16(op1, op2, result);
-                    return result;
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
+                m_register[Register::IP] += 2;
+            }
             break;
 
-        case 0x14: // adc al, imm8
+        case 0x61: // popad
+            for(int n = Register::DI; n >= Register::AX; n--)
             {
-                uint8_t op1 = m_register[Register::AX];
-                uint8_t op2 = *ip;
-                uint8_t result = op1 + op2 + static_cast<uint8_t>(GetCF());
+                uint32_t value = Pop32();
 
-                SetAddFlags8(op1, op2, result);
-                m_register[Register::AX] = (m_register[Register::AX] & 0xff00) | result;
-                m_register[Register::IP] += 2;
-                break;
+                if (n != Register::SP)
+                    SetRegister32(n, value);
             }
 
-        case 0x15: // adc ax, imm16
-            {
-                uint16_t op1 = m_register[Register::AX];
-                uint16_t op2 = *reinterpret_cast<uint16_t *>(ip);
-                uint16_t result = op1 + op2 + static_cast<uint16_t>(GetCF());
+            m_register[Register::IP] += 2;
+            break;
 
-                SetAddFlags16(op1, op2, result);
-                m_register[Register::AX] = result;
-                m_register[Register::IP] += 3;
-                break;
+        case 0x68: // push imm32
+            Push32(Imm32(ip));
+            m_register[Register::IP] += 6;
+            break;
+
+        case 0x69: // imul r32, r/m32, imm32
+        case 0x6b: // imul r32, r/m32, imm8
+            {
+                uint8_t* imm    = ip + s_modRmInstLen[modrm] - 1;
+                int32_t  op2    = (opcode == 0x69) ? static_cast<int32_t>(Imm32(imm)) : static_cast<int8_t>(*imm);
+                int64_t  result = static_cast<int64_t>(static_cast<int32_t>(ModRmLoad32(ip))) * op2;
+                bool     of     = static_cast<int32_t>(result) != result;
+
+                SetOF_CF(of, of);
+                SetRegister32(reg, result);
+                m_register[Register::IP] += length + ((opcode == 0x69) ? 4 : 1);
             }
+            break;
 
-        case 0x16: // push ss
-            Push16(m_register[Register::SS]);
-            m_register[Register::IP] += 1;
+        case 0x6a: // push imm8
+            Push32(static_cast<int8_t>(*ip));
+            m_register[Register::IP] += 3;
             break;
 
-        case 0x17: // pop ss
-            m_register[Register::SS] = Pop16();
-            m_register[Register::IP] += 1;
-            m_stackSegmentBase = m_register[Register::SS] * 16;
+        case 0x81: // alu r/m32, imm32
+        case 0x83: // alu r/m32, imm8
+            {
+                uint8_t* imm    = ip + s_modRmInstLen[modrm] - 1;
+                uint32_t op2    = (opcode == 0x81) ? Imm32(imm) : static_cast<int8_t>(*imm);
+                uint32_t result = Alu32(reg, ModRmLoad32(ip), op2);
+
+                if (reg != AluOp::Cmp)
+                    ModRmStore32(ip, result);
+
+                m_register[Register::IP] += length + ((opcode == 0x81) ? 4 : 1);
+            }
             break;
 
-        case 0x18: // sbb r/m8, r8
-            ModRmModifyOp8(ip,
-                [this](uint8_t op1, uint8_t op2)
-                {
-                    uint8_t result = op1 - op2 - static_cast<uint8_t>(GetCF());
-                    SetSubFlags8(op1, op2, result);
-                    return result;
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
+        case 0x85: // test r/m32, r32
+            SetLogicFlags32(ModRmLoad32(ip) & GetRegister32(reg));
+            m_register[Register::IP] += length;
             break;
 
-        case 0x19: // sbb r/m16, r16
-            ModRmModifyOp16(ip,
-                [this](uint16_t op1, uint16_t op2)
-                {
-                    uint16_t result = op1 - op2 - static_cast<uint16_t>(GetCF());
-                    SetSubFlags16(op1, op2, result);
-                    return result;
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
+        case 0x87: // xchg r/m32, r32
+            {
+                uint32_t value = ModRmLoad32(ip);
+
+                ModRmStore32(ip, GetRegister32(reg));
+                SetRegister32(reg, value);
+                m_register[Register::IP] += length;
+            }
             break;
 
-        case 0x1a: // sbb r8, r/m8
-            ModRmLoadOp8(ip,
-                [this](uint8_t op1, uint8_t op2)
-                {
-                    uint8_t result = op1 - op2 - static_cast<uint8_t>(GetCF());
-                    SetSubFlags8(op1, op2, result);
-                    return result;
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
+        case 0x89: // mov r/m32, r32
+            ModRmStore32(ip, GetRegister32(reg));
+            m_register[Register::IP] += length;
             break;
 
-        case 0x1b: // sbb r16, r/m16
-            ModRmLoadOp16(ip,
-                [this](uint16_t op1, uint16_t op2)
-                {
-                    uint16_t result = op1 - op2 - static_cast<uint16_t>(GetCF());
-                    SetSubFlags16(op1, op2, result);
-                    return result;
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
+        case 0x8b: // mov r32, r/m32
+            SetRegister32(reg, ModRmLoad32(ip));
+            m_register[Register::IP] += length;
             break;
 
-        case 0x1c: // sbb al, imm8
+        case 0x8d: // lea r32, m
+            if (modrm >= 0xc0)
             {
-                uint8_t op1 = m_register[Register::AX];
-                uint8_t op2 = *ip;
-                uint8_t result = op1 - op2 - static_cast<uint8_t>(GetCF());
+                m_state |= State::InvalidOp;
+                break;
+            }
 
-                SetSubFlags8(op1, op2, result);
-                m_register[Register::AX] = (m_register[Register::AX] & 0xff00) | result;
-                m_register[Register::IP] += 2;
+            SetRegister32(reg, ModRmOffset(ip));
+            m_register[Register::IP] += length;
+            break;
+
+        case 0x8f: // pop r/m32
+            if (reg != 0)
+            {
+                m_state |= State::InvalidOp;
                 break;
             }
 
-        case 0x1d: // sbb ax, imm16
+            ModRmStore32(ip, Pop32());
+            m_register[Register::IP] += length;
+            break;
+
+        case 0x91: case 0x92: case 0x93: // xchg eax, reg32
+        case 0x94: case 0x95: case 0x96: case 0x97:
             {
-                uint16_t op1 = m_register[Register::AX];
-                uint16_t op2 = *reinterpret_cast<uint16_t *>(ip);
-                uint16_t result = op1 - op2 - static_cast<uint16_t>(GetCF());
+                uint32_t value = GetRegister32(opcode & 0x07);
 
-                SetSubFlags16(op1, op2, result);
-                m_register[Register::AX] = result;
-                m_register[Register::IP] += 3;
-                break;
+                SetRegister32(opcode & 0x07, GetRegister32(Register::AX));
+                SetRegister32(Register::AX, value);
+                m_register[Register::IP] += 2;
             }
+            break;
 
-        case 0x1e: // push ds
-            Push16(m_register[Register::DS]);
-            m_register[Register::IP] += 1;
+        case 0x98: // cwde
+            SetRegister32(Register::AX, static_cast<int16_t>(m_register[Register::AX]));
+            m_register[Register::IP] += 2;
             break;
 
-        case 0x1f: // pop ds
-            m_register[Register::DS] = Pop16();
-            m_register[Register::IP] += 1;
-            m_segmentBase = m_register[Register::DS] * 16;
+        case 0x99: // cdq
+            SetRegister32(Register::DX, static_cast<int32_t>(GetRegister32(Register::AX)) >> 31);
+            m_register[Register::IP] += 2;
             break;
 
-        case 0x20: // and r/m8, r8
-            ModRmModifyOp8(ip,
-                [this](uint8_t op1, uint8_t op2)
-                {
-                    uint8_t result = op1 & op2;
-                    SetLogicFlags8(result);
-                    return result;
+        case 0x9c: // pushfd
+            RecalcFlags();
+            Push32(m_register[Register::FLAG]);
+            m_register[Register::IP] += 2;
+            break;
 
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
+        case 0x9d: // popfd
+            m_register[Register::FLAG] = Pop32() & (m_386Enabled ? 0x7fff : 0x0fff);
+            m_register[Register::IP] += 2;
+            RestoreLazyFlags();
             break;
 
-        case 0x21: // and r/m16, r16
-            ModRmModifyOp16(ip,
-                [this](uint16_t op1, uint16_t op2)
-                {
-                    uint16_t result = op1 & op2;
-                    SetLogicFlags16(result);
-                    return result;
+        case 0xa1: // mov eax, [addr]
+            SetRegister32(Register::AX, Load32(m_segmentBase + Imm16(ip)));
+            m_register[Register::IP] += 4;
+            break;
 
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
+        case 0xa3: // mov [addr], eax
+            Store32(m_segmentBase + Imm16(ip), GetRegister32(Register::AX));
+            m_register[Register::IP] += 4;
             break;
 
-        case 0x22: // and r8, r/m8
-            ModRmLoadOp8(ip,
-                [this](uint8_t op1, uint8_t op2)
-                {
-                    uint8_t result = op1 & op2;
-                    SetLogicFlags8(result);
-                    return result;
+        case 0xa5: case 0xa7: case 0xab: case 0xad: case 0xaf: // movsd, cmpsd, stosd, lodsd, scasd
+            StringOp32(opcode);
+            m_register[Register::IP] += 2;
+            break;
 
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
+        case 0xa9: // test eax, imm32
+            SetLogicFlags32(GetRegister32(Register::AX) & Imm32(ip));
+            m_register[Register::IP] += 6;
             break;
 
-        case 0x23: // and r16, r/m16
-            ModRmLoadOp16(ip,
-                [this](uint16_t op1, uint16_t op2)
-                {
-                    uint16_t result = op1 & op2;
-                    SetLogicFlags16(result);
-                    return result;
+        case 0xb8: case 0xb9: case 0xba: case 0xbb: // mov reg32, imm32
+        case 0xbc: case 0xbd: case 0xbe: case 0xbf:
+            SetRegister32(opcode & 0x07, Imm32(ip));
+            m_register[Register::IP] += 6;
+            break;
 
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
+        case 0xc1: // shift r/m32, imm8
+            HandleShift32(ip, *(ip + s_modRmInstLen[modrm] - 1));
+            m_register[Register::IP] += length + 1;
             break;
 
-        case 0x24: // and al, imm8
+        case 0xc7: // mov r/m32, imm32
+            if (reg != 0)
             {
-                uint8_t op1 = m_register[Register::AX];
-                uint8_t op2 = *ip;
-                uint8_t result = op1 & op2;
-
-                SetLogicFlags8(result);
-                m_register[Register::AX] = (m_register[Register::AX] & 0xff00) | result;
-                m_register[Register::IP] += 2;
+                m_state |= State::InvalidOp;
                 break;
             }
 
-        case 0x25: // and ax, imm16
-            {
-                uint16_t op1 = m_register[Register::AX];
-                uint16_t op2 = *reinterpret_cast<uint16_t *>(ip);
-                uint16_t result = op1 & op2;
+            ModRmStore32(ip, Imm32(ip + s_modRmInstLen[modrm] - 1));
+            m_register[Register::IP] += length + 4;
+            break;
 
-                SetLogicFlags16(result);
-                m_register[Register::AX] = result;
-                m_register[Register::IP] += 3;
-                break;
-            }
+        case 0xd1: // shift r/m32, 1
+            HandleShift32(ip, 1);
+            m_register[Register::IP] += length;
+            break;
 
-        case 0x26: // prefix - ES override
-            m_segmentBase      = m_register[Register::ES] * 16;
-            m_stackSegmentBase = m_register[Register::ES] * 16;
-            m_register[Register::IP] += 1;
-            m_state |= State::SegmentOverride;
-            goto RestartDecoding;// continue;
+        case 0xd3: // shift r/m32, cl
+            HandleShift32(ip, m_register[Register::CX] & 0xff);
+            m_register[Register::IP] += length;
+            break;
 
-        case 0x27: // daa
-        {
-            uint8_t al = m_register[Register::AX] & 0xff;
-            uint8_t old_al = al;
+        case 0xf7:
+            HandleF7h32(ip);
+            m_register[Register::IP] += length;
+            break;
 
-            if ((al & 0xf) > 9 || GetAF())
+        case 0xff:
+            if (reg == 0 || reg == 1) // inc / dec r/m32
             {
-                al += 6;
-                SetAF(1);
-            }
+                uint32_t op1    = ModRmLoad32(ip);
+                uint32_t result = (reg == 0) ? op1 + 1 : op1 - 1;
 
-            if (old_al > 0x99 || GetCF())
+                if (reg == 0)
+                    SetIncFlags32(op1, result);
+                else
+                    SetDecFlags32(op1, result);
+
+                ModRmStore32(ip, result);
+            }
+            else if (reg == 6) // push r/m32
+            {
+                Push32(ModRmLoad32(ip));
+            }
+            else
             {
-                al += 0x60;
-                SetCF(1);
+                m_state |= State::InvalidOp;
+                break;
             }
 
-            m_result = static_cast<char>(al);
-            m_register[Register::AX] &= 0xff;
-            m_register[Register::AX] |= al;
-            m_register[Register::IP] += 1;
+            m_register[Register::IP] += length;
             break;
-        }
 
-        case 0x28: // sub r/m8, r8
-            ModRmModifyOp8(ip,
-                [this](uint8_t op1, uint8_t op2)
-                {
-                    uint8_t result = op1 - op2;
-                    SetSubFlags8(op1, op2, result);
-                    return result;
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
+        default:
+            printf("Unhandled 32-bit operand opcode 0x%02x\n", opcode);
+            m_state |= State::InvalidOp;
             break;
+    }
+}
 
-        case 0x29: // sub r/m16, r16
-            ModRmModifyOp16(ip,
-                [this](uint16_t op1, uint16_t op2)
-                {
-                    uint16_t result = op1 - op2;
-                    SetSubFlags16(op1, op2, result);
-                    return result;
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            break;
+// 0x66 0x0f prefixed instruction, 'ip' points at the second opcode byte
+void Cpu::Handle0Fh32(uint8_t* ip)
+{
+    uint8_t opcode = *ip++;
+    uint8_t modrm  = *ip;
+    uint8_t reg    = (modrm >> 3) & 0x07;
+    int     length = 2 + s_modRmInstLen[modrm];
 
-        case 0x2a: // sub r8, r/m8
-            ModRmLoadOp8(ip,
-                [this](uint8_t op1, uint8_t op2)
-                {
-                    uint8_t result = op1 - op2;
-                    SetSubFlags8(op1, op2, result);
-                    return result;
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            break;
+    switch(opcode)
+    {
+        case 0xa4: // shld r/m32, r32, imm8
+        case 0xa5: // shld r/m32, r32, cl
+        case 0xac: // shrd r/m32, r32, imm8
+        case 0xad: // shrd r/m32, r32, cl
+            {
+                bool    imm   = (opcode & 1) == 0;
+                uint8_t shift = (imm ? *(ip + s_modRmInstLen[modrm] - 1) : m_register[Register::CX]) & 0x1f;
 
-        case 0x2b: // sub r16, r/m16
-            ModRmLoadOp16(ip,
-                [this](uint16_t op1, uint16_t op2)
+                if (shift != 0)
                 {
-                    uint16_t result = op1 - op2;
-                    SetSubFlags16(op1, op2, result);
-                    return result;
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            break;
+                    uint64_t op1 = ModRmLoad32(ip);
+                    uint64_t op2 = GetRegister32(reg);
+                    uint32_t result;
+                    bool     cf;
 
-        case 0x2c: // sub al, imm8
-            {
-                uint8_t op1 = m_register[Register::AX];
-                uint8_t op2 = *ip;
-                uint8_t result = op1 - op2;
+                    if (opcode < 0xac)
+                    {
+                        result = (((op1 << 32) | op2) << shift) >> 32;
+                        cf     = (op1 >> (32 - shift)) & 1;
+                    }
+                    else
+                    {
+                        result = ((op2 << 32) | op1) >> shift;
+                        cf     = (op1 >> (shift - 1)) & 1;
+                    }
 
-                SetSubFlags8(op1, op2, result);
-                m_register[Register::AX] = (m_register[Register::AX] & 0xff00) | result;
-                m_register[Register::IP] += 2;
-                break;
+                    SetLogicFlags32(result);
+                    SetOF_CF(((result ^ op1) >> 31) & 1, cf);
+                    ModRmStore32(ip, result);
+                }
+
+                m_register[Register::IP] += length + (imm ? 1 : 0);
             }
+            break;
 
-        case 0x2d: // sub ax, imm16
+        case 0xaf: // imul r32, r/m32
             {
-                uint16_t op1 = m_register[Register::AX];
-                uint16_t op2 = *reinterpret_cast<uint16_t *>(ip);
-                uint16_t result = op1 - op2;
+                m_cycleCnt += MulCycles16;
 
-                SetSubFlags16(op1, op2, result);
-                m_register[Register::AX] = result;
+                int64_t result = static_cast<int64_t>(static_cast<int32_t>(GetRegister32(reg))) * static_cast<int32_t>(ModRmLoad32(ip));
+                bool    of     = static_cast<int32_t>(result) != result;
+
+                SetOF_CF(of, of);
+                SetRegister32(reg, result);
+                m_register[Register::IP] += length;
             }
-            m_register[Register::IP] += 3;
             break;
 
-        case 0x2e: // prefix - CS override
-            m_segmentBase      = m_register[Register::CS] * 16;
-            m_stackSegmentBase = m_register[Register::CS] * 16;
-            m_register[Register::IP] += 1;
-            m_state |= State::SegmentOverride;
-            goto RestartDecoding;// continue;
+        case 0xb6: // movzx r32, r/m8
+            SetRegister32(reg, ModRmLoad8(ip));
+            m_register[Register::IP] += length;
+            break;
 
-        case 0x2f: // das
-        {
-            uint8_t al = m_register[Register::AX] & 0xff;
-            uint8_t old_al = al;
+        case 0xb7: // movzx r32, r/m16
+            SetRegister32(reg, ModRmLoad16(ip));
+            m_register[Register::IP] += length;
+            break;
 
-            if ((al & 0xf) > 9 || GetAF())
-            {
-                al -= 6;
-                SetAF(1);
-            }
-
-            if (old_al > 0x99 || GetCF())
-            {
-                al -= 0x60;
-                SetCF(1);
-            }
-
-            m_result = static_cast<char>(al);
-            m_register[Register::AX] &= 0xff;
-            m_register[Register::AX] |= al;
-            m_register[Register::IP] += 1;
+        case 0xbe: // movsx r32, r/m8
+            SetRegister32(reg, static_cast<int8_t>(ModRmLoad8(ip)));
+            m_register[Register::IP] += length;
             break;
-        }
-        case 0x30: // xor r/m8, r8
-            ModRmModifyOp8(ip,
-                [this](uint8_t op1, uint8_t op2)
-                {
-                    uint8_t result = op1 ^ op2;
-                    m_result = static_cast<char>(result);
-                    m_auxbits = 0;
-                    return result;
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
+
+        case 0xbf: // movsx r32, r/m16
+            SetRegister32(reg, static_cast<int16_t>(ModRmLoad16(ip)));
+            m_register[Register::IP] += length;
             break;
 
-        case 0x31: // xor r/m16, r16
-            ModRmModifyOp16(ip,
-                [this](uint16_t op1, uint16_t op2)
-                {
-                    uint16_t result = op1 ^ op2;
-                    m_result = static_cast<short>(result);
-                    m_auxbits = 0;
-                    return result;
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
+        default:
+            printf("Unhandled 32-bit operand opcode 0x0f 0x%02x\n", opcode);
+            m_state |= State::InvalidOp;
             break;
+    }
+}
 
-        case 0x32: // xor r8, r/m8
-            ModRmLoadOp8(ip,
-                [this](uint8_t op1, uint8_t op2)
-                {
-                    uint8_t result = op1 ^ op2;
-                    m_result = static_cast<char>(result);
-                    m_auxbits = 0;
-                    return result;
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
+void Cpu::HandleF7h32(uint8_t* ip)
+{
+    uint8_t modrm  = *ip;
+    uint8_t opcode = (modrm >> 3) & 0x07;
+
+    switch(opcode)
+    {
+        case 0: // test r/m32, imm32
+        case 1:
+            SetLogicFlags32(ModRmLoad32(ip) & Imm32(ip + s_modRmInstLen[modrm] - 1));
+            m_register[Register::IP] += 4;
             break;
 
-        case 0x33: // xor r16, r/m16
-            ModRmLoadOp16(ip,
-                [this](uint16_t op1, uint16_t op2)
-                {
-                    uint16_t result = op1 ^ op2;
-                    m_result = static_cast<short>(result);
-                    m_auxbits = 0;
-                    return result;
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
+        case 2: // not r/m32
+            ModRmStore32(ip, ~ModRmLoad32(ip));
             break;
 
-        case 0x34: // xor al, imm8
+        case 3: // neg r/m32
             {
-                uint8_t op1 = m_register[Register::AX];
-                uint8_t op2 = *ip;
-                uint8_t result = op1 ^ op2;
+                uint32_t op     = ModRmLoad32(ip);
+                uint32_t result = -op;
 
-                SetLogicFlags8(result);
-                m_register[Register::AX] = (m_register[Register::AX] & 0xff00) | result;
-                m_register[Register::IP] += 2;
-                break;
+                SetSubFlags32(0, op, result);
+                ModRmStore32(ip, result);
             }
+            break;
 
-        case 0x35: // xor ax, imm16
+        case 4: // mul r/m32
             {
-                uint16_t op1 = m_register[Register::AX];
-                uint16_t op2 = *reinterpret_cast<uint16_t *>(ip);
-                uint16_t result = op1 ^ op2;
+                m_cycleCnt += MulCycles16;
 
-                SetLogicFlags16(result);
-                m_register[Register::AX] = result;
-                m_register[Register::IP] += 3;
-                break;
+                uint64_t result = static_cast<uint64_t>(GetRegister32(Register::AX)) * ModRmLoad32(ip);
+                bool     of     = (result >> 32) != 0;
+
+                SetOF_CF(of, of);
+                SetRegister32(Register::DX, result >> 32);
+                SetRegister32(Register::AX, result);
             }
+            break;
 
-        case 0x36: // prefix - SS override
-            m_segmentBase      = m_register[Register::SS] * 16;
-            m_stackSegmentBase = m_register[Register::SS] * 16;
-            m_register[Register::IP] += 1;
-            m_state |= State::SegmentOverride;
-            goto RestartDecoding;
+        case 5: // imul r/m32
+            {
+                m_cycleCnt += MulCycles16;
 
-//         case 0x37: // aaa
-//             break;
+                int64_t result = static_cast<int64_t>(static_cast<int32_t>(GetRegister32(Register::AX))) * static_cast<int32_t>(ModRmLoad32(ip));
+                bool    of     = static_cast<int32_t>(result) != result;
+
+                SetOF_CF(of, of);
+                SetRegister32(Register::DX, static_cast<uint64_t>(result) >> 32);
+                SetRegister32(Register::AX, result);
+            }
+            break;
 
-        case 0x38: // cmp r/m8, r8
+        case 6: // div r/m32
             {
-                uint8_t op1  = ModRmLoad8(ip);
-                uint8_t op2  = *Reg8(*ip);
-                uint8_t diff = op1 - op2;
+                m_cycleCnt += DivCycles16;
 
-                SetSubFlags8(op1, op2, diff);
+                uint64_t src = ModRmLoad32(ip);
 
-                m_register[Register::IP] += s_modRmInstLen[*ip];
-                break;
+                if (src == 0)
+                {
+                    printf("Divide by zero\n");
+                    m_state |= State::InvalidOp;
+                    break;
+                }
+
+                uint64_t val    = (static_cast<uint64_t>(GetRegister32(Register::DX)) << 32) | GetRegister32(Register::AX);
+                uint64_t result = val / src;
+
+                if (result > 0xffffffff)
+                {
+                    printf("Divide error\n");
+                    m_state |= State::InvalidOp;
+                    break;
+                }
+
+                SetRegister32(Register::AX, result);
+                SetRegister32(Register::DX, val % src);
             }
+            break;
 
-        case 0x39: // cmp r/m16, r16
+        case 7: // idiv r/m32
             {
-                uint16_t op1  = ModRmLoad16(ip);
-                uint16_t op2  = *Reg16(*ip);
-                uint16_t diff = op1 - op2;
+                m_cycleCnt += DivCycles16;
 
-                SetSubFlags16(op1, op2, diff);
+                int64_t src = static_cast<int32_t>(ModRmLoad32(ip));
 
-                m_register[Register::IP] += s_modRmInstLen[*ip];
-                break;
+                if (src == 0)
+                {
+                    printf("Divide by zero\n");
+                    m_state |= State::InvalidOp;
+                    break;
+                }
+
+                int64_t val = static_cast<int64_t>((static_cast<uint64_t>(GetRegister32(Register::DX)) << 32) | GetRegister32(Register::AX));
+
+                if (val == INT64_MIN && src == -1)
+                {
+                    printf("Divide error\n");
+                    m_state |= State::InvalidOp;
+                    break;
+                }
+
+                int64_t result = val / src;
+
+                if (result > INT32_MAX || result < INT32_MIN)
+                {
+                    printf("Divide error\n");
+                    m_state |= State::InvalidOp;
+                    break;
+                }
+
+                SetRegister32(Register::AX, result);
+                SetRegister32(Register::DX, val % src);
             }
+            break;
+    }
+}
 
-        case 0x3a: // cmp r8, r/m8
-            {
-                uint8_t op1  = *Reg8(*ip);
-                uint8_t op2  = ModRmLoad8(ip);
-                uint8_t diff = op1 - op2;
+void Cpu::HandleShift32(uint8_t* ip, uint8_t shift)
+{
+    uint8_t modrm  = *ip;
+    uint8_t opcode = (modrm >> 3) & 0x07;
 
-                SetSubFlags8(op1, op2, diff);
+    shift &= 0x1f;
 
-                m_register[Register::IP] += s_modRmInstLen[*ip];
-                break;
+    if (shift == 0)
+        return;
+
+    uint32_t op = ModRmLoad32(ip);
+    uint32_t result;
+    bool     of, cf;
+
+    switch(opcode)
+    {
+        case 0: // rol r/m32, x
+            result = (op << shift) | (op >> (32 - shift));
+            cf     = result & 1;
+            of     = cf ^ (result >> 31);
+            break;
+
+        case 1: // ror r/m32, x
+            result = (op >> shift) | (op << (32 - shift));
+            cf     = result >> 31;
+            of     = cf ^ ((result >> 30) & 1);
+            break;
+
+        case 2: // rcl r/m32, x
+            {
+                uint64_t value = (static_cast<uint64_t>(GetCF()) << 32) | op;
+
+                value  = (value << shift) | (value >> (33 - shift));
+                result = value;
+                cf     = (value >> 32) & 1;
+                of     = cf ^ (result >> 31);
             }
+            break;
 
-        case 0x3b: // cmp r16, r/m16
+        case 3: // rcr r/m32, x
             {
-                uint16_t op1  = *Reg16(*ip);
-                uint16_t op2  = ModRmLoad16(ip);
-                uint16_t diff = op1 - op2;
+                uint64_t value = (static_cast<uint64_t>(GetCF()) << 32) | op;
 
-                SetSubFlags16(op1, op2, diff);
-                m_register[Register::IP] += s_modRmInstLen[*ip];
-                break;
+                of     = GetCF() ^ (op >> 31);
+                value  = (value >> shift) | (value << (33 - shift));
+                result = value;
+                cf     = (value >> 32) & 1;
             }
+            break;
+
+        case 6: // sal r/m32, x
+        case 4: // shl r/m32, x
+            result = op << shift;
+            cf     = (op >> (32 - shift)) & 1;
+            of     = cf ^ (result >> 31);
+            break;
+
+        case 5: // shr r/m32, x
+            result = op >> shift;
+            cf     = (op >> (shift - 1)) & 1;
+            of     = (((result << 1) ^ result) >> 31) & 1;
+            break;
 
-        case 0x3c: // cmp al, imm8
+        default: // sar r/m32, x
+            result = static_cast<int32_t>(op) >> shift;
+            cf     = (static_cast<int32_t>(op) >> (shift - 1)) & 1;
+            of     = false;
+            break;
+    }
+
+    // rotates leave SF, ZF and PF alone
+    if (opcode >= 4)
+        SetLogicFlags32(result);
+
+    SetOF_CF(of, cf);
+    ModRmStore32(ip, result);
+}
+
+// one element of movsd / cmpsd / stosd / lodsd / scasd
+void Cpu::StringOp32(uint8_t opcode)
+{
+    std::size_t esBase = m_register[Register::ES] * 16;
+    short       delta  = (m_register[Register::FLAG] & Flag::DF_mask) ? -4 : 4;
+
+    switch(opcode)
+    {
+        case 0xa5: // movsd
+            Store32(esBase + m_register[Register::DI], Load32(m_segmentBase + m_register[Register::SI]));
+            m_register[Register::SI] += delta;
+            m_register[Register::DI] += delta;
+            break;
+
+        case 0xa7: // cmpsd
             {
-                uint8_t op1  = m_register[Register::AX];
-                uint8_t op2  = *ip;
-                uint8_t diff = op1 - op2;
+                uint32_t op1 = Load32(m_segmentBase + m_register[Register::SI]);
+                uint32_t op2 = Load32(esBase + m_register[Register::DI]);
 
-                SetSubFlags8(op1, op2, diff);
-                m_register[Register::IP] += 2;
-                break;
+                SetSubFlags32(op1, op2, op1 - op2);
+                m_register[Register::SI] += delta;
+                m_register[Register::DI] += delta;
             }
+            break;
+
+        case 0xab: // stosd
+            Store32(esBase + m_register[Register::DI], GetRegister32(Register::AX));
+            m_register[Register::DI] += delta;
+            break;
+
+        case 0xad: // lodsd
+            SetRegister32(Register::AX, Load32(m_segmentBase + m_register[Register::SI]));
+            m_register[Register::SI] += delta;
+            break;
 
-        case 0x3d: // cmp ax, imm16
+        case 0xaf: // scasd
             {
-                uint16_t op1  = m_register[Register::AX];
-                uint16_t op2  = Imm16(ip);
-                uint16_t diff = op1 - op2;
+                uint32_t op1 = GetRegister32(Register::AX);
+                uint32_t op2 = Load32(esBase + m_register[Register::DI]);
 
-                SetSubFlags16(op1, op2, diff);
-                m_register[Register::IP] += 3;
-                break;
+                SetSubFlags32(op1, op2, op1 - op2);
+                m_register[Register::DI] += delta;
             }
+            break;
+    }
+}
 
-        case 0x3e: // prefix - DS override
-            m_segmentBase      = m_register[Register::DS] * 16;
-            m_stackSegmentBase = m_register[Register::DS] * 16;
-            m_register[Register::IP] += 1;
-            m_state |= State::SegmentOverride;
-            goto RestartDecoding;
+uint32_t Cpu::Alu32(int op, uint32_t op1, uint32_t op2)
+{
+    uint32_t result = 0;
 
-//         case 0x3f: // aas
-//             break;
+    switch(op & 0x07)
+    {
+        case AluOp::Add: result = op1 + op2; SetAddFlags32(op1, op2, result); break;
+        case AluOp::Or:  result = op1 | op2; SetLogicFlags32(result); break;
+        case AluOp::Adc: result = op1 + op2 + static_cast<uint32_t>(GetCF()); SetAddFlags32(op1, op2, result); break;
+        case AluOp::Sbb: result = op1 - op2 - static_cast<uint32_t>(GetCF()); SetSubFlags32(op1, op2, result); break;
+        case AluOp::And: result = op1 & op2; SetLogicFlags32(result); break;
+        case AluOp::Sub: result = op1 - op2; SetSubFlags32(op1, op2, result); break;
+        case AluOp::Xor: result = op1 ^ op2; SetLogicFlags32(result); break;
+        case AluOp::Cmp: result = op1 - op2; SetSubFlags32(op1, op2, result); break;
+    }
+
+    return result;
+}
+
+template<int Opcode>
+inline void Cpu::ExecuteOpcode(uint8_t* ip)
+{
+    uint16_t opcode = Opcode;
+    uint16_t *reg;
 
+    switch(Opcode)
+    {
         case 0x40: case 0x41: case 0x42: case 0x43: // inc reg16
         case 0x44: case 0x45: case 0x46: case 0x47:
             {
                 uint16_t op1 = m_register[opcode - 0x40];
                 uint16_t result = ++m_register[opcode - 0x40];
-                bool oldCF = GetCF();
 
-                SetAddFlags16(op1, 1, result);
-                SetCF(oldCF);
+                SetIncFlags16(op1, result);
 
                 m_register[Register::IP] += 1;
                 break;
@@ -3201,10 +3815,8 @@ void Cpu::ExecuteInstruction()
             {
                 uint16_t op1 = m_register[opcode - 0x48];
                 uint16_t result = --m_register[opcode - 0x48];
-                bool oldCF = GetCF();
 
-                SetSubFlags16(op1, 1, result);
-                SetCF(oldCF);
+                SetDecFlags16(op1, result);
 
                 m_register[Register::IP] += 1;
                 break;
@@ -3222,921 +3834,3258 @@ void Cpu::ExecuteInstruction()
             m_register[Register::IP] += 1;
             break;
 
-        case 0x60: // pusha
-            {
-                uint16_t tmpSP = m_register[Register::SP];
+        case 0x90: case 0x91: case 0x92: case 0x93:
+        case 0x94: case 0x95: case 0x96: case 0x97:
+            std::swap(m_register[Register::AX], m_register[opcode - 0x90]);
+            m_register[Register::IP] += 1;
+            break;
 
-                Push16(m_register[Register::AX]);
-                Push16(m_register[Register::CX]);
-                Push16(m_register[Register::DX]);
-                Push16(m_register[Register::BX]);
-                Push16(tmpSP);
-                Push16(m_register[Register::BP]);
-                Push16(m_register[Register::SI]);
-                Push16(m_register[Register::DI]);
+        case 0xb0: case 0xb1: case 0xb2: case 0xb3: // mov reg8, imm8 (reg8 = al, cl, dl, bl)
+            reg  = &m_register[opcode - 0xb0];
+            *reg = (*reg & 0xff00) | *ip;
+            m_register[Register::IP] += 2;
+            break;
 
-                m_register[Register::IP] += 1;
-                break;
-            }
+        case 0xb4: case 0xb5: case 0xb6: case 0xb7: // mov reg8, imm8 (reg8 = ah, ch, dh, bh)
+            reg = &m_register[opcode - 0xb4];
+            *reg = (*reg & 0x00ff) | (*ip << 8);
+            m_register[Register::IP] += 2;
+            break;
 
-        case 0x61: // popa
-            {
-                m_register[Register::DI] = Pop16();
-                m_register[Register::SI] = Pop16();
-                m_register[Register::BP] = Pop16();
-                Pop16();
-                m_register[Register::BX] = Pop16();
-                m_register[Register::DX] = Pop16();
-                m_register[Register::CX] = Pop16();
-                m_register[Register::AX] = Pop16();
+        case 0xb8: case 0xb9: case 0xba: case 0xbb: // mov reg16, imm16
+        case 0xbc: case 0xbd: case 0xbe: case 0xbf:
+            m_register[opcode - 0xb8] = Imm16(ip);
+            m_register[Register::IP] += 3;
+            break;
 
-                m_register[Register::IP] += 1;
-                break;
-            }
+        default:
+            m_state |= State::InvalidOp;
+            break;
+    }
+}
 
-//         case 0x62: // bound
-//             break;
+// add r/m8, r8
+template<>
+inline void Cpu::ExecuteOpcode<0x00>(uint8_t* ip)
+{
+    ModRmModifyOp8(ip,
+        [this](uint8_t op1, uint8_t op2)
+        {
+            uint8_t result = op1 + op2;
+            SetAddFlags8(op1, op2, result);
+            return result;
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
 
-//         case 0x63: // arpl
-//             break;
+// add r/m16, r16
+template<>
+inline void Cpu::ExecuteOpcode<0x01>(uint8_t* ip)
+{
+    ModRmModifyOp16(ip,
+        [this](uint16_t op1, uint16_t op2)
+        {
+            uint16_t result = op1 + op2;
+            SetAddFlags16(op1, op2, result);
+            return result;
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
 
-//         case 0x64: // prefix - FS override
-//             break;
+// add r8, r/m8
+template<>
+inline void Cpu::ExecuteOpcode<0x02>(uint8_t* ip)
+{
+    ModRmLoadOp8(ip,
+        [this](uint8_t op1, uint8_t op2)
+        {
+            uint8_t result = op1 + op2;
+            SetAddFlags8(op1, op2, result);
+            return result;
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
 
-//         case 0x65: // prefix - GS override
-//             break;
+// add r16, r/m16
+template<>
+inline void Cpu::ExecuteOpcode<0x03>(uint8_t* ip)
+{
+    ModRmLoadOp16(ip,
+        [this](uint16_t op1, uint16_t op2)
+        {
+            uint16_t result = op1 + op2;
+            SetAddFlags16(op1, op2, result);
+            return result;
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
 
-//         case 0x66: // prefix - operand size
-//             break;
+// add al, imm8
+template<>
+inline void Cpu::ExecuteOpcode<0x04>(uint8_t* ip)
+{
+    uint8_t op1 = m_register[Register::AX];
+    uint8_t op2 = *ip;
+    uint8_t result = op1 + op2;
 
-//         case 0x67: // prefix - address size
-//             break;
+    SetAddFlags8(op1, op2, result);
+    m_register[Register::AX] = (m_register[Register::AX] & 0xff00) | result;
+    m_register[Register::IP] += 2;
+}
 
-        case 0x68: // push imm16
-            Push16(Imm16(ip));
-            m_register[Register::IP] += 3;
-            break;
+// add ax, imm16
+template<>
+inline void Cpu::ExecuteOpcode<0x05>(uint8_t* ip)
+{
+    uint16_t op1 = m_register[Register::AX];
+    uint16_t op2 = *reinterpret_cast<uint16_t *>(ip);
+    uint16_t result = op1 + op2;
 
-//         case 0x69: // imul r16, r/m16, imm16
-//             break;
+    SetAddFlags16(op1, op2, result);
+    m_register[Register::AX] = result;
+    m_register[Register::IP] += 3;
+}
 
-        case 0x6a: // push imm8
-            Push16(*ip);
-            m_register[Register::IP] += 2;
-            break;
+// push es
+template<>
+inline void Cpu::ExecuteOpcode<0x06>(uint8_t* ip)
+{
+    Push16(m_register[Register::ES]);
+    m_register[Register::IP] += 1;
+}
 
-        case 0x6b: // imul r16, r/m16, imm8
-            {
-                int32_t result = static_cast<short>(ModRmLoad16(ip)) * static_cast<char>(*(ip + s_modRmInstLen[*ip] -1));
+// pop ds
+template<>
+inline void Cpu::ExecuteOpcode<0x07>(uint8_t* ip)
+{
+    m_register[Register::ES] = Pop16();
+    m_register[Register::IP] += 1;
+}
 
-                if (static_cast<short>(result) == result)
-                {
-                    SetOF_CF(false, false);
-                }
-                else
-                {
-                    SetOF_CF(true, true);
-                }
+// or r/m8, r8
+template<>
+inline void Cpu::ExecuteOpcode<0x08>(uint8_t* ip)
+{
+    ModRmModifyOp8(ip,
+        [this](uint8_t op1, uint8_t op2)
+        {
+            uint8_t result = op1 | op2;
+            SetLogicFlags8(result);
+            return result;
 
-                *Reg16(*ip) = result & 0xffff;
-                m_register[Register::IP] += s_modRmInstLen[*ip] + 1;
-                break;
-            }
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
 
-//         case 0x6c: // insb
+// or r/m16, r16
+template<>
+inline void Cpu::ExecuteOpcode<0x09>(uint8_t* ip)
+{
+    ModRmModifyOp16(ip,
+        [this](uint16_t op1, uint16_t op2)
+        {
+            uint16_t result = op1 | op2;
+            SetLogicFlags16(result);
+            return result;
+
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// or r8, r/m8
+template<>
+inline void Cpu::ExecuteOpcode<0x0a>(uint8_t* ip)
+{
+    ModRmLoadOp8(ip,
+        [this](uint8_t op1, uint8_t op2)
+        {
+            uint8_t result = op1 | op2;
+            SetLogicFlags8(result);
+            return result;
+
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// or r16, r/m16
+template<>
+inline void Cpu::ExecuteOpcode<0x0b>(uint8_t* ip)
+{
+    ModRmLoadOp16(ip,
+        [this](uint16_t op1, uint16_t op2)
+        {
+            uint16_t result = op1 | op2;
+            SetLogicFlags16(result);
+            return result;
+
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// or al, imm8
+template<>
+inline void Cpu::ExecuteOpcode<0x0c>(uint8_t* ip)
+{
+    uint8_t op1 = m_register[Register::AX];
+    uint8_t op2 = *ip;
+    uint8_t result = op1 | op2;
+
+    SetLogicFlags8(result);
+    m_register[Register::AX] = (m_register[Register::AX] & 0xff00) | result;
+    m_register[Register::IP] += 2;
+}
+
+// or ax, imm16
+template<>
+inline void Cpu::ExecuteOpcode<0x0d>(uint8_t* ip)
+{
+    {
+        uint16_t op1 = m_register[Register::AX];
+        uint16_t op2 = *reinterpret_cast<uint16_t *>(ip);
+        uint16_t result = op1 | op2;
+
+        SetLogicFlags16(result);
+        m_register[Register::AX] = result;
+    }
+    m_register[Register::IP] += 3;
+}
+
+// push cs
+template<>
+inline void Cpu::ExecuteOpcode<0x0e>(uint8_t* ip)
+{
+    Push16(m_register[Register::CS]);
+    m_register[Register::IP] += 1;
+}
+
+//         case 0x0f: // two-byte opcodes
 //             break;
 
-//         case 0x6d: // insw
+// adc r/m8, r8
+template<>
+inline void Cpu::ExecuteOpcode<0x10>(uint8_t* ip)
+{
+    ModRmModifyOp8(ip,
+        [this](uint8_t op1, uint8_t op2)
+        {
+            uint8_t result = op1 + op2 + static_cast<uint8_t>(GetCF());
+            SetAddFlags8(op1, op2, result);
+            return result;
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// adc r/m16, r16
+template<>
+inline void Cpu::ExecuteOpcode<0x11>(uint8_t* ip)
+{
+    ModRmModifyOp16(ip,
+        [this](uint16_t op1, uint16_t op2)
+        {
+            uint16_t result = op1 + op2 + static_cast<uint16_t>(GetCF());
+            SetAddFlags16(op1, op2, result);
+            return result;
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// adc r8, r/m8
+template<>
+inline void Cpu::ExecuteOpcode<0x12>(uint8_t* ip)
+{
+    ModRmLoadOp8(ip,
+        [this](uint8_t op1, uint8_t op2)
+        {
+            uint8_t result = op1 + op2 + static_cast<uint8_t>(GetCF());
+            SetAddFlags8(op1, op2, result);
+            return result;
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// adc r16, r/m16
+template<>
+inline void Cpu::ExecuteOpcode<0x13>(uint8_t* ip)
+{
+    ModRmLoadOp16(ip,
+        [this](uint16_t op1, uint16_t op2)
+        {
+            uint16_t result = op1 + op2 + static_cast<uint16_t>(GetCF());
+            SetAddFlags16(op1, op2, result);
+            return result;
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// adc al, imm8
+template<>
+inline void Cpu::ExecuteOpcode<0x14>(uint8_t* ip)
+{
+    uint8_t op1 = m_register[Register::AX];
+    uint8_t op2 = *ip;
+    uint8_t result = op1 + op2 + static_cast<uint8_t>(GetCF());
+
+    SetAddFlags8(op1, op2, result);
+    m_register[Register::AX] = (m_register[Register::AX] & 0xff00) | result;
+    m_register[Register::IP] += 2;
+}
+
+// adc ax, imm16
+template<>
+inline void Cpu::ExecuteOpcode<0x15>(uint8_t* ip)
+{
+    uint16_t op1 = m_register[Register::AX];
+    uint16_t op2 = *reinterpret_cast<uint16_t *>(ip);
+    uint16_t result = op1 + op2 + static_cast<uint16_t>(GetCF());
+
+    SetAddFlags16(op1, op2, result);
+    m_register[Register::AX] = result;
+    m_register[Register::IP] += 3;
+}
+
+// push ss
+template<>
+inline void Cpu::ExecuteOpcode<0x16>(uint8_t* ip)
+{
+    Push16(m_register[Register::SS]);
+    m_register[Register::IP] += 1;
+}
+
+// pop ss
+template<>
+inline void Cpu::ExecuteOpcode<0x17>(uint8_t* ip)
+{
+    m_register[Register::SS] = Pop16();
+    m_register[Register::IP] += 1;
+    m_stackSegmentBase = m_register[Register::SS] * 16;
+}
+
+// sbb r/m8, r8
+template<>
+inline void Cpu::ExecuteOpcode<0x18>(uint8_t* ip)
+{
+    ModRmModifyOp8(ip,
+        [this](uint8_t op1, uint8_t op2)
+        {
+            uint8_t result = op1 - op2 - static_cast<uint8_t>(GetCF());
+            SetSubFlags8(op1, op2, result);
+            return result;
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// sbb r/m16, r16
+template<>
+inline void Cpu::ExecuteOpcode<0x19>(uint8_t* ip)
+{
+    ModRmModifyOp16(ip,
+        [this](uint16_t op1, uint16_t op2)
+        {
+            uint16_t result = op1 - op2 - static_cast<uint16_t>(GetCF());
+            SetSubFlags16(op1, op2, result);
+            return result;
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// sbb r8, r/m8
+template<>
+inline void Cpu::ExecuteOpcode<0x1a>(uint8_t* ip)
+{
+    ModRmLoadOp8(ip,
+        [this](uint8_t op1, uint8_t op2)
+        {
+            uint8_t result = op1 - op2 - static_cast<uint8_t>(GetCF());
+            SetSubFlags8(op1, op2, result);
+            return result;
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// sbb r16, r/m16
+template<>
+inline void Cpu::ExecuteOpcode<0x1b>(uint8_t* ip)
+{
+    ModRmLoadOp16(ip,
+        [this](uint16_t op1, uint16_t op2)
+        {
+            uint16_t result = op1 - op2 - static_cast<uint16_t>(GetCF());
+            SetSubFlags16(op1, op2, result);
+            return result;
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// sbb al, imm8
+template<>
+inline void Cpu::ExecuteOpcode<0x1c>(uint8_t* ip)
+{
+    uint8_t op1 = m_register[Register::AX];
+    uint8_t op2 = *ip;
+    uint8_t result = op1 - op2 - static_cast<uint8_t>(GetCF());
+
+    SetSubFlags8(op1, op2, result);
+    m_register[Register::AX] = (m_register[Register::AX] & 0xff00) | result;
+    m_register[Register::IP] += 2;
+}
+
+// sbb ax, imm16
+template<>
+inline void Cpu::ExecuteOpcode<0x1d>(uint8_t* ip)
+{
+    uint16_t op1 = m_register[Register::AX];
+    uint16_t op2 = *reinterpret_cast<uint16_t *>(ip);
+    uint16_t result = op1 - op2 - static_cast<uint16_t>(GetCF());
+
+    SetSubFlags16(op1, op2, result);
+    m_register[Register::AX] = result;
+    m_register[Register::IP] += 3;
+}
+
+// push ds
+template<>
+inline void Cpu::ExecuteOpcode<0x1e>(uint8_t* ip)
+{
+    Push16(m_register[Register::DS]);
+    m_register[Register::IP] += 1;
+}
+
+// pop ds
+template<>
+inline void Cpu::ExecuteOpcode<0x1f>(uint8_t* ip)
+{
+    m_register[Register::DS] = Pop16();
+    m_register[Register::IP] += 1;
+    m_segmentBase = m_register[Register::DS] * 16;
+}
+
+// and r/m8, r8
+template<>
+inline void Cpu::ExecuteOpcode<0x20>(uint8_t* ip)
+{
+    ModRmModifyOp8(ip,
+        [this](uint8_t op1, uint8_t op2)
+        {
+            uint8_t result = op1 & op2;
+            SetLogicFlags8(result);
+            return result;
+
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// and r/m16, r16
+template<>
+inline void Cpu::ExecuteOpcode<0x21>(uint8_t* ip)
+{
+    ModRmModifyOp16(ip,
+        [this](uint16_t op1, uint16_t op2)
+        {
+            uint16_t result = op1 & op2;
+            SetLogicFlags16(result);
+            return result;
+
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// and r8, r/m8
+template<>
+inline void Cpu::ExecuteOpcode<0x22>(uint8_t* ip)
+{
+    ModRmLoadOp8(ip,
+        [this](uint8_t op1, uint8_t op2)
+        {
+            uint8_t result = op1 & op2;
+            SetLogicFlags8(result);
+            return result;
+
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// and r16, r/m16
+template<>
+inline void Cpu::ExecuteOpcode<0x23>(uint8_t* ip)
+{
+    ModRmLoadOp16(ip,
+        [this](uint16_t op1, uint16_t op2)
+        {
+            uint16_t result = op1 & op2;
+            SetLogicFlags16(result);
+            return result;
+
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// and al, imm8
+template<>
+inline void Cpu::ExecuteOpcode<0x24>(uint8_t* ip)
+{
+    uint8_t op1 = m_register[Register::AX];
+    uint8_t op2 = *ip;
+    uint8_t result = op1 & op2;
+
+    SetLogicFlags8(result);
+    m_register[Register::AX] = (m_register[Register::AX] & 0xff00) | result;
+    m_register[Register::IP] += 2;
+}
+
+// and ax, imm16
+template<>
+inline void Cpu::ExecuteOpcode<0x25>(uint8_t* ip)
+{
+    uint16_t op1 = m_register[Register::AX];
+    uint16_t op2 = *reinterpret_cast<uint16_t *>(ip);
+    uint16_t result = op1 & op2;
+
+    SetLogicFlags16(result);
+    m_register[Register::AX] = result;
+    m_register[Register::IP] += 3;
+}
+
+// prefix - ES override
+template<>
+inline void Cpu::ExecuteOpcode<0x26>(uint8_t* ip)
+{
+    m_segmentBase      = m_register[Register::ES] * 16;
+    m_stackSegmentBase = m_register[Register::ES] * 16;
+    m_register[Register::IP] += 1;
+    m_state |= State::SegmentOverride;
+    m_state |= State::Prefix;
+}
+
+// daa
+template<>
+inline void Cpu::ExecuteOpcode<0x27>(uint8_t* ip)
+{
+    uint8_t al = m_register[Register::AX] & 0xff;
+    uint8_t old_al = al;
+
+    if ((al & 0xf) > 9 || GetAF())
+    {
+        al += 6;
+        SetAF(1);
+    }
+
+    if (old_al > 0x99 || GetCF())
+    {
+        al += 0x60;
+        SetCF(1);
+    }
+
+    m_result = static_cast<char>(al);
+    m_register[Register::AX] &= 0xff;
+    m_register[Register::AX] |= al;
+    m_register[Register::IP] += 1;
+}
+
+// sub r/m8, r8
+template<>
+inline void Cpu::ExecuteOpcode<0x28>(uint8_t* ip)
+{
+    ModRmModifyOp8(ip,
+        [this](uint8_t op1, uint8_t op2)
+        {
+            uint8_t result = op1 - op2;
+            SetSubFlags8(op1, op2, result);
+            return result;
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// sub r/m16, r16
+template<>
+inline void Cpu::ExecuteOpcode<0x29>(uint8_t* ip)
+{
+    ModRmModifyOp16(ip,
+        [this](uint16_t op1, uint16_t op2)
+        {
+            uint16_t result = op1 - op2;
+            SetSubFlags16(op1, op2, result);
+            return result;
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// sub r8, r/m8
+template<>
+inline void Cpu::ExecuteOpcode<0x2a>(uint8_t* ip)
+{
+    ModRmLoadOp8(ip,
+        [this](uint8_t op1, uint8_t op2)
+        {
+            uint8_t result = op1 - op2;
+            SetSubFlags8(op1, op2, result);
+            return result;
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// sub r16, r/m16
+template<>
+inline void Cpu::ExecuteOpcode<0x2b>(uint8_t* ip)
+{
+    ModRmLoadOp16(ip,
+        [this](uint16_t op1, uint16_t op2)
+        {
+            uint16_t result = op1 - op2;
+            SetSubFlags16(op1, op2, result);
+            return result;
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// sub al, imm8
+template<>
+inline void Cpu::ExecuteOpcode<0x2c>(uint8_t* ip)
+{
+    uint8_t op1 = m_register[Register::AX];
+    uint8_t op2 = *ip;
+    uint8_t result = op1 - op2;
+
+    SetSubFlags8(op1, op2, result);
+    m_register[Register::AX] = (m_register[Register::AX] & 0xff00) | result;
+    m_register[Register::IP] += 2;
+}
+
+// sub ax, imm16
+template<>
+inline void Cpu::ExecuteOpcode<0x2d>(uint8_t* ip)
+{
+    {
+        uint16_t op1 = m_register[Register::AX];
+        uint16_t op2 = *reinterpret_cast<uint16_t *>(ip);
+        uint16_t result = op1 - op2;
+
+        SetSubFlags16(op1, op2, result);
+        m_register[Register::AX] = result;
+    }
+    m_register[Register::IP] += 3;
+}
+
+// prefix - CS override
+template<>
+inline void Cpu::ExecuteOpcode<0x2e>(uint8_t* ip)
+{
+    m_segmentBase      = m_register[Register::CS] * 16;
+    m_stackSegmentBase = m_register[Register::CS] * 16;
+    m_register[Register::IP] += 1;
+    m_state |= State::SegmentOverride;
+    m_state |= State::Prefix;
+}
+
+// das
+template<>
+inline void Cpu::ExecuteOpcode<0x2f>(uint8_t* ip)
+{
+    uint8_t al = m_register[Register::AX] & 0xff;
+    uint8_t old_al = al;
+
+    if ((al & 0xf) > 9 || GetAF())
+    {
+        al -= 6;
+        SetAF(1);
+    }
+
+    if (old_al > 0x99 || GetCF())
+    {
+        al -= 0x60;
+        SetCF(1);
+    }
+
+    m_result = static_cast<char>(al);
+    m_register[Register::AX] &= 0xff;
+    m_register[Register::AX] |= al;
+    m_register[Register::IP] += 1;
+}
+
+// xor r/m8, r8
+template<>
+inline void Cpu::ExecuteOpcode<0x30>(uint8_t* ip)
+{
+    ModRmModifyOp8(ip,
+        [this](uint8_t op1, uint8_t op2)
+        {
+            uint8_t result = op1 ^ op2;
+            SetLogicFlags8(result);
+            return result;
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// xor r/m16, r16
+template<>
+inline void Cpu::ExecuteOpcode<0x31>(uint8_t* ip)
+{
+    ModRmModifyOp16(ip,
+        [this](uint16_t op1, uint16_t op2)
+        {
+            uint16_t result = op1 ^ op2;
+            SetLogicFlags16(result);
+            return result;
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// xor r8, r/m8
+template<>
+inline void Cpu::ExecuteOpcode<0x32>(uint8_t* ip)
+{
+    ModRmLoadOp8(ip,
+        [this](uint8_t op1, uint8_t op2)
+        {
+            uint8_t result = op1 ^ op2;
+            SetLogicFlags8(result);
+            return result;
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// xor r16, r/m16
+template<>
+inline void Cpu::ExecuteOpcode<0x33>(uint8_t* ip)
+{
+    ModRmLoadOp16(ip,
+        [this](uint16_t op1, uint16_t op2)
+        {
+            uint16_t result = op1 ^ op2;
+            SetLogicFlags16(result);
+            return result;
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// xor al, imm8
+template<>
+inline void Cpu::ExecuteOpcode<0x34>(uint8_t* ip)
+{
+    uint8_t op1 = m_register[Register::AX];
+    uint8_t op2 = *ip;
+    uint8_t result = op1 ^ op2;
+
+    SetLogicFlags8(result);
+    m_register[Register::AX] = (m_register[Register::AX] & 0xff00) | result;
+    m_register[Register::IP] += 2;
+}
+
+// xor ax, imm16
+template<>
+inline void Cpu::ExecuteOpcode<0x35>(uint8_t* ip)
+{
+    uint16_t op1 = m_register[Register::AX];
+    uint16_t op2 = *reinterpret_cast<uint16_t *>(ip);
+    uint16_t result = op1 ^ op2;
+
+    SetLogicFlags16(result);
+    m_register[Register::AX] = result;
+    m_register[Register::IP] += 3;
+}
+
+// prefix - SS override
+template<>
+inline void Cpu::ExecuteOpcode<0x36>(uint8_t* ip)
+{
+    m_segmentBase      = m_register[Register::SS] * 16;
+    m_stackSegmentBase = m_register[Register::SS] * 16;
+    m_register[Register::IP] += 1;
+    m_state |= State::SegmentOverride;
+    m_state |= State::Prefix;
+}
+
+//         case 0x37: // aaa
 //             break;
 
-        case 0x6e: // outsb
-            PortWrite(m_register[Register::DX], 1, Load8(m_segmentBase + m_register[Register::SI]));
-            m_register[Register::SI] += (m_register[Register::FLAG] & Flag::DF_mask) ? -1 : 1;
-            m_register[Register::IP] += 1;
-            break;
+// cmp r/m8, r8
+template<>
+inline void Cpu::ExecuteOpcode<0x38>(uint8_t* ip)
+{
+    uint8_t op1  = ModRmLoad8(ip);
+    uint8_t op2  = *Reg8(*ip);
+    uint8_t diff = op1 - op2;
 
-//         case 0x6f: // outsw
+    SetSubFlags8(op1, op2, diff);
+
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// cmp r/m16, r16
+template<>
+inline void Cpu::ExecuteOpcode<0x39>(uint8_t* ip)
+{
+    uint16_t op1  = ModRmLoad16(ip);
+    uint16_t op2  = *Reg16(*ip);
+    uint16_t diff = op1 - op2;
+
+    SetSubFlags16(op1, op2, diff);
+
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// cmp r8, r/m8
+template<>
+inline void Cpu::ExecuteOpcode<0x3a>(uint8_t* ip)
+{
+    uint8_t op1  = *Reg8(*ip);
+    uint8_t op2  = ModRmLoad8(ip);
+    uint8_t diff = op1 - op2;
+
+    SetSubFlags8(op1, op2, diff);
+
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// cmp r16, r/m16
+template<>
+inline void Cpu::ExecuteOpcode<0x3b>(uint8_t* ip)
+{
+    uint16_t op1  = *Reg16(*ip);
+    uint16_t op2  = ModRmLoad16(ip);
+    uint16_t diff = op1 - op2;
+
+    SetSubFlags16(op1, op2, diff);
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// cmp al, imm8
+template<>
+inline void Cpu::ExecuteOpcode<0x3c>(uint8_t* ip)
+{
+    uint8_t op1  = m_register[Register::AX];
+    uint8_t op2  = *ip;
+    uint8_t diff = op1 - op2;
+
+    SetSubFlags8(op1, op2, diff);
+    m_register[Register::IP] += 2;
+}
+
+// cmp ax, imm16
+template<>
+inline void Cpu::ExecuteOpcode<0x3d>(uint8_t* ip)
+{
+    uint16_t op1  = m_register[Register::AX];
+    uint16_t op2  = Imm16(ip);
+    uint16_t diff = op1 - op2;
+
+    SetSubFlags16(op1, op2, diff);
+    m_register[Register::IP] += 3;
+}
+
+// prefix - DS override
+template<>
+inline void Cpu::ExecuteOpcode<0x3e>(uint8_t* ip)
+{
+    m_segmentBase      = m_register[Register::DS] * 16;
+    m_stackSegmentBase = m_register[Register::DS] * 16;
+    m_register[Register::IP] += 1;
+    m_state |= State::SegmentOverride;
+    m_state |= State::Prefix;
+}
+
+//         case 0x3f: // aas
 //             break;
 
-        case 0x70: // jo rel8
-            offset = Disp8(ip);
-            m_register[Register::IP] += 2;
-            if (GetOF())
-                m_register[Register::IP] += offset;
-            break;
+// pusha
+template<>
+inline void Cpu::ExecuteOpcode<0x60>(uint8_t* ip)
+{
+    uint16_t tmpSP = m_register[Register::SP];
+
+    Push16(m_register[Register::AX]);
+    Push16(m_register[Register::CX]);
+    Push16(m_register[Register::DX]);
+    Push16(m_register[Register::BX]);
+    Push16(tmpSP);
+    Push16(m_register[Register::BP]);
+    Push16(m_register[Register::SI]);
+    Push16(m_register[Register::DI]);
+
+    m_register[Register::IP] += 1;
+}
 
-        case 0x71: // jno rel8
-            offset = Disp8(ip);
-            m_register[Register::IP] += 2;
-            if (!GetOF())
-                m_register[Register::IP] += offset;
-            break;
+// popa
+template<>
+inline void Cpu::ExecuteOpcode<0x61>(uint8_t* ip)
+{
+    m_register[Register::DI] = Pop16();
+    m_register[Register::SI] = Pop16();
+    m_register[Register::BP] = Pop16();
+    Pop16();
+    m_register[Register::BX] = Pop16();
+    m_register[Register::DX] = Pop16();
+    m_register[Register::CX] = Pop16();
+    m_register[Register::AX] = Pop16();
+
+    m_register[Register::IP] += 1;
+}
 
-        case 0x72: // jb rel8
-            offset = Disp8(ip);
-            m_register[Register::IP] += 2;
-            if (GetCF())
-                m_register[Register::IP] += offset;
-            break;
+//         case 0x62: // bound
+//             break;
+//         case 0x63: // arpl
+//             break;
+//         case 0x64: // prefix - FS override
+//             break;
+//         case 0x65: // prefix - GS override
+//             break;
+// prefix - operand size
+template<>
+inline void Cpu::ExecuteOpcode<0x66>(uint8_t* ip)
+{
+    HandleOperand32(ip);
+}
+
+// prefix - address size
+template<>
+inline void Cpu::ExecuteOpcode<0x67>(uint8_t* ip)
+{
+    if (AddressSize32(ip))
+    {
+        m_register[Register::IP] += 1;
+        m_state |= State::Prefix;
+    }
+}
+
+// push imm16
+template<>
+inline void Cpu::ExecuteOpcode<0x68>(uint8_t* ip)
+{
+    Push16(Imm16(ip));
+    m_register[Register::IP] += 3;
+}
+
+//         case 0x69: // imul r16, r/m16, imm16
+//             break;
+
+// push imm8
+template<>
+inline void Cpu::ExecuteOpcode<0x6a>(uint8_t* ip)
+{
+    Push16(*ip);
+    m_register[Register::IP] += 2;
+}
+
+// imul r16, r/m16, imm8
+template<>
+inline void Cpu::ExecuteOpcode<0x6b>(uint8_t* ip)
+{
+    int32_t result = static_cast<short>(ModRmLoad16(ip)) * static_cast<char>(*(ip + s_modRmInstLen[*ip] -1));
+
+    if (static_cast<short>(result) == result)
+    {
+        SetOF_CF(false, false);
+    }
+    else
+    {
+        SetOF_CF(true, true);
+    }
+
+    *Reg16(*ip) = result & 0xffff;
+    m_register[Register::IP] += s_modRmInstLen[*ip] + 1;
+}
+
+//         case 0x6c: // insb
+//             break;
+//         case 0x6d: // insw
+//             break;
+
+// outsb
+template<>
+inline void Cpu::ExecuteOpcode<0x6e>(uint8_t* ip)
+{
+    PortWrite(m_register[Register::DX], 1, Load8(m_segmentBase + m_register[Register::SI]));
+    m_register[Register::SI] += (m_register[Register::FLAG] & Flag::DF_mask) ? -1 : 1;
+    m_register[Register::IP] += 1;
+}
+
+//         case 0x6f: // outsw
+//             break;
+
+// jo rel8
+template<>
+inline void Cpu::ExecuteOpcode<0x70>(uint8_t* ip)
+{
+    uint16_t offset;
+
+    offset = Disp8(ip);
+    m_register[Register::IP] += 2;
+    if (GetOF())
+        m_register[Register::IP] += offset;
+}
+
+// jno rel8
+template<>
+inline void Cpu::ExecuteOpcode<0x71>(uint8_t* ip)
+{
+    uint16_t offset;
+
+    offset = Disp8(ip);
+    m_register[Register::IP] += 2;
+    if (!GetOF())
+        m_register[Register::IP] += offset;
+}
+
+// jb rel8
+template<>
+inline void Cpu::ExecuteOpcode<0x72>(uint8_t* ip)
+{
+    uint16_t offset;
+
+    offset = Disp8(ip);
+    m_register[Register::IP] += 2;
+    if (GetCF())
+        m_register[Register::IP] += offset;
+}
+
+// jnb rel8
+template<>
+inline void Cpu::ExecuteOpcode<0x73>(uint8_t* ip)
+{
+    uint16_t offset;
+
+    offset = Disp8(ip);
+    m_register[Register::IP] += 2;
+    if (!GetCF())
+        m_register[Register::IP] += offset;
+}
+
+// je rel8
+template<>
+inline void Cpu::ExecuteOpcode<0x74>(uint8_t* ip)
+{
+    uint16_t offset;
+
+    offset = Disp8(ip);
+    m_register[Register::IP] += 2;
+    if (GetZF())
+        m_register[Register::IP] += offset;
+}
+
+// jne rel8
+template<>
+inline void Cpu::ExecuteOpcode<0x75>(uint8_t* ip)
+{
+    uint16_t offset;
+
+    offset = Disp8(ip);
+    m_register[Register::IP] += 2;
+    if (!GetZF())
+        m_register[Register::IP] += offset;
+}
+
+// jbe / jna rel8
+template<>
+inline void Cpu::ExecuteOpcode<0x76>(uint8_t* ip)
+{
+    uint16_t offset;
+
+    offset = Disp8(ip);
+    m_register[Register::IP] += 2;
+    if (GetCF() || GetZF())
+        m_register[Register::IP] += offset;
+}
+
+// jnbe / ja rel8
+template<>
+inline void Cpu::ExecuteOpcode<0x77>(uint8_t* ip)
+{
+    uint16_t offset;
+
+    offset = Disp8(ip);
+    m_register[Register::IP] += 2;
+    if (!GetCF() && !GetZF())
+        m_register[Register::IP] += offset;
+}
+
+// js rel8
+template<>
+inline void Cpu::ExecuteOpcode<0x78>(uint8_t* ip)
+{
+    uint16_t offset;
+
+    offset = Disp8(ip);
+    m_register[Register::IP] += 2;
+    if (GetSF())
+        m_register[Register::IP] += offset;
+}
+
+// jns rel8
+template<>
+inline void Cpu::ExecuteOpcode<0x79>(uint8_t* ip)
+{
+    uint16_t offset;
+
+    offset = Disp8(ip);
+    m_register[Register::IP] += 2;
+    if (!GetSF())
+        m_register[Register::IP] += offset;
+}
+
+// jp rel8
+template<>
+inline void Cpu::ExecuteOpcode<0x7a>(uint8_t* ip)
+{
+    uint16_t offset;
+
+    offset = Disp8(ip);
+    m_register[Register::IP] += 2;
+    if (GetPF())
+        m_register[Register::IP] += offset;
+}
+
+// jnp rel8
+template<>
+inline void Cpu::ExecuteOpcode<0x7b>(uint8_t* ip)
+{
+    uint16_t offset;
+
+    offset = Disp8(ip);
+    m_register[Register::IP] += 2;
+    if (!GetPF())
+        m_register[Register::IP] += offset;
+}
+
+// jl rel8
+template<>
+inline void Cpu::ExecuteOpcode<0x7c>(uint8_t* ip)
+{
+    uint16_t offset;
+
+    offset = Disp8(ip);
+    m_register[Register::IP] += 2;
+    if (GetSF() != GetOF())
+        m_register[Register::IP] += offset;
+}
+
+// jnl rel8
+template<>
+inline void Cpu::ExecuteOpcode<0x7d>(uint8_t* ip)
+{
+    uint16_t offset;
+
+    offset = Disp8(ip);
+    m_register[Register::IP] += 2;
+    if (GetSF() == GetOF())
+        m_register[Register::IP] += offset;
+}
+
+// jle rel8
+template<>
+inline void Cpu::ExecuteOpcode<0x7e>(uint8_t* ip)
+{
+    uint16_t offset;
+
+    offset = Disp8(ip);
+    m_register[Register::IP] += 2;
+    if (GetZF() || (GetSF() != GetOF()))
+        m_register[Register::IP] += offset;
+}
+
+// jg rel8
+template<>
+inline void Cpu::ExecuteOpcode<0x7f>(uint8_t* ip)
+{
+    uint16_t offset;
+
+    offset = Disp8(ip);
+    m_register[Register::IP] += 2;
+    if (!GetZF() && (GetSF() == GetOF()))
+        m_register[Register::IP] += offset;
+}
+
+template<>
+inline void Cpu::ExecuteOpcode<0x80>(uint8_t* ip)
+{
+    Handle80h(ip);
+    m_register[Register::IP] += s_modRmInstLen[*ip] + 1;
+}
+
+template<>
+inline void Cpu::ExecuteOpcode<0x81>(uint8_t* ip)
+{
+    Handle81h(ip);
+    m_register[Register::IP] += s_modRmInstLen[*ip] + 2;
+}
+
+template<>
+inline void Cpu::ExecuteOpcode<0x82>(uint8_t* ip)
+{
+    Handle80h(ip);
+    m_register[Register::IP] += s_modRmInstLen[*ip] + 1;
+}
+
+template<>
+inline void Cpu::ExecuteOpcode<0x83>(uint8_t* ip)
+{
+    Handle83h(ip);
+    m_register[Register::IP] += s_modRmInstLen[*ip] + 1;
+}
+
+// test r/m8, r8
+template<>
+inline void Cpu::ExecuteOpcode<0x84>(uint8_t* ip)
+{
+    uint8_t op1    = ModRmLoad8(ip);
+    uint8_t op2    = *Reg8(*ip);
+    uint8_t result = op1 & op2;
+
+    SetLogicFlags8(result);
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// test r/m16, r16
+template<>
+inline void Cpu::ExecuteOpcode<0x85>(uint8_t* ip)
+{
+    {
+        uint16_t op1    = ModRmLoad16(ip);
+        uint16_t op2    = *Reg16(*ip);
+        uint16_t result = op1 & op2;
+
+        SetLogicFlags16(result);
+    }
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// xchg r/m8, r8
+template<>
+inline void Cpu::ExecuteOpcode<0x86>(uint8_t* ip)
+{
+    ModRmModifyOp8(ip,
+        [this, ip](uint8_t op1, uint8_t op2)
+        {
+            *Reg8(*ip) = op1;
+            return op2;
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// xchg r/m16, r16
+template<>
+inline void Cpu::ExecuteOpcode<0x87>(uint8_t* ip)
+{
+    ModRmModifyOp16(ip,
+        [this, ip](uint16_t op1, uint16_t op2)
+        {
+            *Reg16(*ip) = op1;
+            return op2;
+        });
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// mov r/m8, r8
+template<>
+inline void Cpu::ExecuteOpcode<0x88>(uint8_t* ip)
+{
+    ModRmStore8(ip, *Reg8(*ip));
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// mov r/m16, r16
+template<>
+inline void Cpu::ExecuteOpcode<0x89>(uint8_t* ip)
+{
+    ModRmStore16(ip, *Reg16(*ip));
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// mov r8, r/m8
+template<>
+inline void Cpu::ExecuteOpcode<0x8a>(uint8_t* ip)
+{
+    *Reg8(*ip) = ModRmLoad8(ip);
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// mov r16, r/m16
+template<>
+inline void Cpu::ExecuteOpcode<0x8b>(uint8_t* ip)
+{
+    *Reg16(*ip) = ModRmLoad16(ip);
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// mov r/m16, Sreg
+template<>
+inline void Cpu::ExecuteOpcode<0x8c>(uint8_t* ip)
+{
+    ModRmStore16(ip, *SReg(*ip));
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// lea r16, m16
+template<>
+inline void Cpu::ExecuteOpcode<0x8d>(uint8_t* ip)
+{
+    ModRmLoadEa(ip);
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// mov Sreg, r/m16
+template<>
+inline void Cpu::ExecuteOpcode<0x8e>(uint8_t* ip)
+{
+    *SReg(*ip) = ModRmLoad16(ip);
+    m_segmentBase      = m_register[Register::DS] * 16;
+    m_stackSegmentBase = m_register[Register::SS] * 16;
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+template<>
+inline void Cpu::ExecuteOpcode<0x8f>(uint8_t* ip)
+{
+    Handle8Fh(ip);
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// cbw
+template<>
+inline void Cpu::ExecuteOpcode<0x98>(uint8_t* ip)
+{
+    m_register[Register::AX] = static_cast<char>(m_register[Register::AX]);
+    m_register[Register::IP] += 1;
+}
+
+// cwd
+template<>
+inline void Cpu::ExecuteOpcode<0x99>(uint8_t* ip)
+{
+    m_register[Register::DX] = static_cast<short>(m_register[Register::AX]) >> 15;
+    m_register[Register::IP] += 1;
+}
+
+// call far ptr16:16
+template<>
+inline void Cpu::ExecuteOpcode<0x9a>(uint8_t* ip)
+{
+    m_register[Register::IP] += 5;
+    Push16(m_register[Register::CS]);
+    Push16(m_register[Register::IP]);
+    m_register[Register::CS] = Imm16(ip + 2);
+    m_register[Register::IP] = Imm16(ip);
+}
+
+//         case 0x9b: // fwait
+//             break;
+
+// pushf
+template<>
+inline void Cpu::ExecuteOpcode<0x9c>(uint8_t* ip)
+{
+    RecalcFlags();
+    Push16(m_register[Register::FLAG]);
+    m_register[Register::IP] += 1;
+}
+
+// popf
+template<>
+inline void Cpu::ExecuteOpcode<0x9d>(uint8_t* ip)
+{
+    //m_register[Register::FLAG] = (Pop16() & ~Flag::Always0_mask) | Flag::Always1_mask;
+    //m_register[Register::FLAG] = (Pop16() & 0x0fff) | Flag::Always1_mask;   // 8086
+    m_register[Register::FLAG] = Pop16() & (m_386Enabled ? 0x7fff : 0x0fff);   // 286 clears IOPL / NT in real mode
+    m_register[Register::IP] += 1;
+    RestoreLazyFlags();
+}
+
+// sahf
+template<>
+inline void Cpu::ExecuteOpcode<0x9e>(uint8_t* ip)
+{
+    m_register[Register::FLAG] &= 0xff00;
+    m_register[Register::FLAG] |= ((m_register[Register::AX] >> 8) & 0xd7) | 2;
+    m_register[Register::IP] += 1;
+    RestoreLazyFlags();
+}
+
+// lahf
+template<>
+inline void Cpu::ExecuteOpcode<0x9f>(uint8_t* ip)
+{
+    RecalcFlags();
+    m_register[Register::AX] &= 0x00ff;
+    m_register[Register::AX] |= ((m_register[Register::FLAG] << 8) & 0xd7) | 2;
+    m_register[Register::IP] += 1;
+}
+
+// mov al, moffs8
+template<>
+inline void Cpu::ExecuteOpcode<0xa0>(uint8_t* ip)
+{
+    m_register[Register::AX] = (m_register[Register::AX] & 0xff00) | Load8(m_segmentBase + Disp16(ip));
+    m_register[Register::IP] += 3;
+}
+
+// mov ax, moffs16
+template<>
+inline void Cpu::ExecuteOpcode<0xa1>(uint8_t* ip)
+{
+    m_register[Register::AX] = Load16(m_segmentBase + Disp16(ip));
+    m_register[Register::IP] += 3;
+}
+
+// mov moffs8, al
+template<>
+inline void Cpu::ExecuteOpcode<0xa2>(uint8_t* ip)
+{
+    Store8(m_segmentBase + Disp16(ip), m_register[Register::AX]);
+    m_register[Register::IP] += 3;
+}
+
+// mov moffs16, ax
+template<>
+inline void Cpu::ExecuteOpcode<0xa3>(uint8_t* ip)
+{
+    Store16(m_segmentBase + Disp16(ip), m_register[Register::AX]);
+    m_register[Register::IP] += 3;
+}
+
+// movsb
+template<>
+inline void Cpu::ExecuteOpcode<0xa4>(uint8_t* ip)
+{
+    Store8(m_register[Register::ES] * 16 + m_register[Register::DI],
+        Load8(m_segmentBase + m_register[Register::SI]));
+
+    short delta = (m_register[Register::FLAG] & Flag::DF_mask) ? -1 : 1;
+
+    m_register[Register::SI] += delta;
+    m_register[Register::DI] += delta;
+    m_register[Register::IP] += 1;
+}
+
+// movsw
+template<>
+inline void Cpu::ExecuteOpcode<0xa5>(uint8_t* ip)
+{
+    Store16(m_register[Register::ES] * 16 + m_register[Register::DI],
+        Load16(m_segmentBase + m_register[Register::SI]));
+
+    short delta = (m_register[Register::FLAG] & Flag::DF_mask) ? -2 : 2;
+
+    m_register[Register::SI] += delta;
+    m_register[Register::DI] += delta;
+    m_register[Register::IP] += 1;
+}
+
+// cmpsb
+template<>
+inline void Cpu::ExecuteOpcode<0xa6>(uint8_t* ip)
+{
+    uint8_t op1  = Load8(m_segmentBase + m_register[Register::SI]);
+    uint8_t op2  = Load8(m_register[Register::ES] * 16 + m_register[Register::DI]);
+    uint8_t diff = op1 - op2;
+
+    SetSubFlags8(op1, op2, diff);
+
+    short delta = (m_register[Register::FLAG] & Flag::DF_mask) ? -1 : 1;
+
+    m_register[Register::SI] += delta;
+    m_register[Register::DI] += delta;
+    m_register[Register::IP] += 1;
+}
+
+// cmpsw
+template<>
+inline void Cpu::ExecuteOpcode<0xa7>(uint8_t* ip)
+{
+    uint16_t op1  = Load16(m_segmentBase + m_register[Register::SI]);
+    uint16_t op2  = Load16(m_register[Register::ES] * 16 + m_register[Register::DI]);
+    uint16_t diff = op1 - op2;
+
+    SetSubFlags16(op1, op2, diff);
+
+    short delta = (m_register[Register::FLAG] & Flag::DF_mask) ? -2 : 2;
+
+    m_register[Register::SI] += delta;
+    m_register[Register::DI] += delta;
+    m_register[Register::IP] += 1;
+}
+
+// test al, imm8
+template<>
+inline void Cpu::ExecuteOpcode<0xa8>(uint8_t* ip)
+{
+    SetLogicFlags8(m_register[Register::AX] & *ip);
+    m_register[Register::IP] += 2;
+}
+
+// test ax, imm16
+template<>
+inline void Cpu::ExecuteOpcode<0xa9>(uint8_t* ip)
+{
+    SetLogicFlags16(m_register[Register::AX] & Imm16(ip));
+    m_register[Register::IP] += 3;
+}
+
+// stosb
+template<>
+inline void Cpu::ExecuteOpcode<0xaa>(uint8_t* ip)
+{
+    Store8(m_register[Register::ES] * 16 + m_register[Register::DI], m_register[Register::AX]);
+    m_register[Register::DI] += (m_register[Register::FLAG] & Flag::DF_mask) ? -1 : 1;
+    m_register[Register::IP] += 1;
+}
+
+// stosw
+template<>
+inline void Cpu::ExecuteOpcode<0xab>(uint8_t* ip)
+{
+    Store16(m_register[Register::ES] * 16 + m_register[Register::DI], m_register[Register::AX]);
+    m_register[Register::DI] += (m_register[Register::FLAG] & Flag::DF_mask) ? -2 : 2;
+    m_register[Register::IP] += 1;
+}
+
+// lodsb
+template<>
+inline void Cpu::ExecuteOpcode<0xac>(uint8_t* ip)
+{
+    m_register[Register::AX] =
+        (m_register[Register::AX] & 0xff00) | Load8(m_segmentBase + m_register[Register::SI]);
+    m_register[Register::SI] += (m_register[Register::FLAG] & Flag::DF_mask) ? -1 : 1;
+    m_register[Register::IP] += 1;
+}
+
+// lodsw
+template<>
+inline void Cpu::ExecuteOpcode<0xad>(uint8_t* ip)
+{
+    m_register[Register::AX] = Load16(m_segmentBase + m_register[Register::SI]);
+    m_register[Register::SI] += (m_register[Register::FLAG] & Flag::DF_mask) ? -2 : 2;
+    m_register[Register::IP] += 1;
+}
+
+// scasb
+template<>
+inline void Cpu::ExecuteOpcode<0xae>(uint8_t* ip)
+{
+    uint8_t op1  = m_register[Register::AX] & 0xff;
+    uint8_t op2  = Load8(m_register[Register::ES] * 16 + m_register[Register::DI]);
+    uint8_t diff = op1 - op2;
+
+    SetSubFlags8(op1, op2, diff);
+
+    m_register[Register::DI] += (m_register[Register::FLAG] & Flag::DF_mask) ? -1 : 1;
+    m_register[Register::IP] += 1;
+}
+
+// scasw
+template<>
+inline void Cpu::ExecuteOpcode<0xaf>(uint8_t* ip)
+{
+    uint16_t op1  = m_register[Register::AX];
+    uint16_t op2  = Load16(m_register[Register::ES] * 16 + m_register[Register::DI]);
+    uint16_t diff = op1 - op2;
+
+    SetSubFlags16(op1, op2, diff);
+
+    m_register[Register::DI] += (m_register[Register::FLAG] & Flag::DF_mask) ? -2 : 2;
+    m_register[Register::IP] += 1;
+}
+
+// shift8 imm8
+template<>
+inline void Cpu::ExecuteOpcode<0xc0>(uint8_t* ip)
+{
+    m_cycleCnt += *(ip + s_modRmInstLen[*ip] - 1) & 0x1f;
+    HandleShift8(ip, *(ip + s_modRmInstLen[*ip] - 1));
+    m_register[Register::IP] += s_modRmInstLen[*ip] + 1;
+}
+
+// shift16 imm8
+template<>
+inline void Cpu::ExecuteOpcode<0xc1>(uint8_t* ip)
+{
+    m_cycleCnt += *(ip + s_modRmInstLen[*ip] - 1) & 0x1f;
+    HandleShift16(ip, *(ip + s_modRmInstLen[*ip] - 1));
+    m_register[Register::IP] += s_modRmInstLen[*ip] + 1;
+}
+
+// ret imm16
+template<>
+inline void Cpu::ExecuteOpcode<0xc2>(uint8_t* ip)
+{
+    m_register[Register::IP] = Pop16();
+    m_register[Register::SP] += Imm16(ip);
+}
+
+// ret
+template<>
+inline void Cpu::ExecuteOpcode<0xc3>(uint8_t* ip)
+{
+    m_register[Register::IP] = Pop16();
+}
+
+// les r16, m16:m16
+template<>
+inline void Cpu::ExecuteOpcode<0xc4>(uint8_t* ip)
+{
+    uint32_t segmentOffset = ModRmLoadFar(ip);
+
+    *Reg16(*ip) = segmentOffset &  0xffff;
+    m_register[Register::ES] = segmentOffset >> 16;
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// lds r16, m16:m16
+template<>
+inline void Cpu::ExecuteOpcode<0xc5>(uint8_t* ip)
+{
+    uint32_t segmentOffset = ModRmLoadFar(ip);
+
+    *Reg16(*ip) = segmentOffset &  0xffff;
+    m_register[Register::DS] = segmentOffset >> 16;
+    m_segmentBase = m_register[Register::DS] * 16;
+
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+template<>
+inline void Cpu::ExecuteOpcode<0xc6>(uint8_t* ip)
+{
+    HandleC6h(ip);
+    m_register[Register::IP] += s_modRmInstLen[*ip] + 1;
+}
+
+template<>
+inline void Cpu::ExecuteOpcode<0xc7>(uint8_t* ip)
+{
+    HandleC7h(ip);
+    m_register[Register::IP] += s_modRmInstLen[*ip] + 2;
+}
+
+// enter
+template<>
+inline void Cpu::ExecuteOpcode<0xc8>(uint8_t* ip)
+{
+    uint16_t allocSize = Imm16(ip);
+    uint16_t nesting = *(ip + 2) & 0x1f;
+
+    Push16(m_register[Register::BP]);
+    uint16_t frameTemp = m_register[Register::SP];
+
+    if (nesting > 0)
+    {
+        for(int n = 1; n < nesting; n++)
+        {
+            m_register[Register::BP] -= 2;
+            Push16(m_register[Register::BP]);
+        }
+
+        Push16(frameTemp);
+    }
+
+    m_register[Register::BP] = frameTemp;
+    m_register[Register::SP] -= allocSize;
+    m_register[Register::IP] += 4;
+}
+
+// leave
+template<>
+inline void Cpu::ExecuteOpcode<0xc9>(uint8_t* ip)
+{
+    m_register[Register::SP] = m_register[Register::BP];
+    m_register[Register::BP] = Pop16();
+    m_register[Register::IP] += 1;
+}
+
+// retf imm16
+template<>
+inline void Cpu::ExecuteOpcode<0xca>(uint8_t* ip)
+{
+    m_register[Register::IP] = Pop16();
+    m_register[Register::CS] = Pop16();
+    m_register[Register::SP] += Imm16(ip);
+}
+
+// retf
+template<>
+inline void Cpu::ExecuteOpcode<0xcb>(uint8_t* ip)
+{
+    m_register[Register::IP] = Pop16();
+    m_register[Register::CS] = Pop16();
+}
+
+// int 3
+template<>
+inline void Cpu::ExecuteOpcode<0xcc>(uint8_t* ip)
+{
+    RecalcFlags();
+    Push16(m_register[Register::FLAG]);
+    Push16(m_register[Register::CS]);
+    Push16(m_register[Register::IP]);
+
+    SetAF(0);
+    m_register[Register::FLAG] &= Flag::TF_mask;
+    m_register[Register::FLAG] &= Flag::IF_mask;
+
+    m_register[Register::CS] = Load16(3 * 4 + 2);
+    m_register[Register::IP] = Load16(3 * 4);
+
+    if (m_register[Register::CS] == 0 && m_register[Register::IP] == 0)
+    {
+        printf("Empty int vector\n");
+        m_state |= State::InvalidOp;
+    }
+}
+
+// int imm8
+template<>
+inline void Cpu::ExecuteOpcode<0xcd>(uint8_t* ip)
+{
+    uint8_t intNo = *ip;
+
+    m_register[Register::IP] += 2;
+
+    if (m_interruptHandler[intNo] &&
+        reinterpret_cast<uint32_t *>(m_memory)[intNo] == HleStubAddr(intNo))
+    {
+        CallInterruptHandler(intNo);
+    }
+    else if (onInterrupt)
+    {
+        onInterrupt(intNo);
+    }
+    else
+    {
+        Interrupt(intNo);
+    }
+}
+
+//         case 0xce: // into
+//             break;
+
+// iret
+template<>
+inline void Cpu::ExecuteOpcode<0xcf>(uint8_t* ip)
+{
+    m_register[Register::IP] = Pop16();
+    m_register[Register::CS] = Pop16();
+    m_register[Register::FLAG] = Pop16();
+    RestoreLazyFlags();
+}
+
+// shift r/m8, 1
+template<>
+inline void Cpu::ExecuteOpcode<0xd0>(uint8_t* ip)
+{
+    HandleShift8(ip, 1);
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// shift r/m16, 1
+template<>
+inline void Cpu::ExecuteOpcode<0xd1>(uint8_t* ip)
+{
+    HandleShift16(ip, 1);
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// shift r/m8, cl
+template<>
+inline void Cpu::ExecuteOpcode<0xd2>(uint8_t* ip)
+{
+    m_cycleCnt += m_register[Register::CX] & 0x1f;
+    HandleShift8(ip, m_register[Register::CX]);
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// shift r/m16, cl
+template<>
+inline void Cpu::ExecuteOpcode<0xd3>(uint8_t* ip)
+{
+    m_cycleCnt += m_register[Register::CX] & 0x1f;
+    HandleShift16(ip, m_register[Register::CX]);
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// aam
+template<>
+inline void Cpu::ExecuteOpcode<0xd4>(uint8_t* ip)
+{
+    uint8_t op1 = m_register[Register::AX] & 0xff;
+    uint8_t op2 = *ip;
+
+    m_register[Register::AX] = ((op1 / op2) << 8) | (op1 % op2);
+    m_result = m_register[Register::AX] & 0xff;
+    m_lazyOp = LazyOp::Logic;
+
+    m_register[Register::IP] += 2;
+}
+
+//         case 0xd5: // aad
+//             break;
+//         case 0xd6: // salc
+//             break;
+
+// xlatb
+template<>
+inline void Cpu::ExecuteOpcode<0xd7>(uint8_t* ip)
+{
+    uint8_t value =
+        Load8(m_segmentBase + m_register[Register::BX] + (m_register[Register::AX] & 0xff));
+
+    m_register[Register::AX] = (m_register[Register::AX] & 0xff00) | value;
+    m_register[Register::IP] += 1;
+}
+
+//         case 0xd8: case 0xd9: case 0xda: case 0xdb:
+//         case 0xdc: case 0xdd: case 0xde: case 0xdf: // fpu
+//             break;
+
+// loopnz rel8
+template<>
+inline void Cpu::ExecuteOpcode<0xe0>(uint8_t* ip)
+{
+    m_register[Register::CX] -= 1;
+    m_register[Register::IP] += 2;
+    if (m_register[Register::CX] != 0 && GetZF() == false)
+    {
+        m_register[Register::IP] += Disp8(ip);
+    }
+}
+
+// loopz rel8
+template<>
+inline void Cpu::ExecuteOpcode<0xe1>(uint8_t* ip)
+{
+    m_register[Register::CX] -= 1;
+    m_register[Register::IP] += 2;
+    if (m_register[Register::CX] != 0 && GetZF() == true)
+    {
+        m_register[Register::IP] += Disp8(ip);
+    }
+}
+
+// loop rel8
+template<>
+inline void Cpu::ExecuteOpcode<0xe2>(uint8_t* ip)
+{
+    m_register[Register::CX] -= 1;
+    m_register[Register::IP] += 2;
+    if (m_register[Register::CX] != 0)
+    {
+        m_register[Register::IP] += Disp8(ip);
+    }
+}
+
+// jcxz rel8
+template<>
+inline void Cpu::ExecuteOpcode<0xe3>(uint8_t* ip)
+{
+    uint16_t offset;
+
+    offset = Disp8(ip);
+    m_register[Register::IP] += 2;
+    if (m_register[Register::CX] == 0)
+        m_register[Register::IP] += offset;
+}
+
+// in al, imm8
+template<>
+inline void Cpu::ExecuteOpcode<0xe4>(uint8_t* ip)
+{
+    m_register[Register::AX] =
+        (m_register[Register::AX] & 0xff00) | (PortRead(*ip, 1) & 0xff);
+    m_register[Register::IP] += 2;
+}
+
+// in ax, imm8
+template<>
+inline void Cpu::ExecuteOpcode<0xe5>(uint8_t* ip)
+{
+    m_register[Register::AX] = PortRead(*ip, 2);
+    m_register[Register::IP] += 2;
+}
+
+// out imm8, al
+template<>
+inline void Cpu::ExecuteOpcode<0xe6>(uint8_t* ip)
+{
+    PortWrite(*ip, 1, m_register[Register::AX] & 0x00ff);
+    m_register[Register::IP] += 2;
+}
+
+// out imm8, ax
+template<>
+inline void Cpu::ExecuteOpcode<0xe7>(uint8_t* ip)
+{
+    PortWrite(*ip, 2, m_register[Register::AX]);
+    m_register[Register::IP] += 2;
+}
+
+// call rel16
+template<>
+inline void Cpu::ExecuteOpcode<0xe8>(uint8_t* ip)
+{
+    uint16_t offset;
+
+    offset = Disp16(ip);
+    m_register[Register::IP] += 3;
+    Push16(m_register[Register::IP]);
+    m_register[Register::IP] += offset;
+}
+
+// jmp rel16
+template<>
+inline void Cpu::ExecuteOpcode<0xe9>(uint8_t* ip)
+{
+    uint16_t offset;
+
+    offset = Disp16(ip);
+    m_register[Register::IP] += offset + 3;
+}
+
+// jmp far ptr16:16
+template<>
+inline void Cpu::ExecuteOpcode<0xea>(uint8_t* ip)
+{
+    m_register[Register::IP] += 5;
+    m_register[Register::CS] = Imm16(ip + 2);
+    m_register[Register::IP] = Imm16(ip);
+}
+
+// jmp rel8
+template<>
+inline void Cpu::ExecuteOpcode<0xeb>(uint8_t* ip)
+{
+    uint16_t offset;
+
+    offset = Disp8(ip);
+    m_register[Register::IP] += offset + 2;
+}
+
+// in al, dx
+template<>
+inline void Cpu::ExecuteOpcode<0xec>(uint8_t* ip)
+{
+    m_register[Register::AX] =
+        (m_register[Register::AX] & 0xff00) | (PortRead(m_register[Register::DX], 1) & 0xff);
+    m_register[Register::IP] += 1;
+}
+
+// in ax, dx
+template<>
+inline void Cpu::ExecuteOpcode<0xed>(uint8_t* ip)
+{
+    m_register[Register::AX] = PortRead(m_register[Register::DX], 2);
+    m_register[Register::IP] += 1;
+}
+
+// out dx, al
+template<>
+inline void Cpu::ExecuteOpcode<0xee>(uint8_t* ip)
+{
+    PortWrite(m_register[Register::DX], 1, m_register[Register::AX] & 0x00ff);
+    m_register[Register::IP] += 1;
+}
+
+// out dx, ax
+template<>
+inline void Cpu::ExecuteOpcode<0xef>(uint8_t* ip)
+{
+    PortWrite(m_register[Register::DX], 2, m_register[Register::AX]);
+    m_register[Register::IP] += 1;
+}
+
+// prefix - lock
+template<>
+inline void Cpu::ExecuteOpcode<0xf0>(uint8_t* ip)
+{
+    m_register[Register::IP] += 1;
+    // goto RestartDecoding;
+}
+
+// native interrupt trap f1 nn, only found in the stubs of SetInterruptHandler()
+template<>
+inline void Cpu::ExecuteOpcode<0xf1>(uint8_t* ip)
+{
+    m_register[Register::IP] += 2;
+
+    if (m_interruptHandler[*ip])
+    {
+        CallInterruptHandler(*ip);
+    }
+    else
+    {
+        m_state |= State::InvalidOp;
+    }
+}
+
+template<>
+inline void Cpu::ExecuteOpcode<0xf2>(uint8_t* ip)
+{
+    if (*ip == 0x66 || *ip == 0x67)
+    {
+        m_register[Register::IP] += 1 + HandleREPSized(ip, false, false);
+        return;
+    }
+
+    uint16_t count = m_register[Register::CX];
+
+    HandleREPNE(*ip);
+    m_cycleCnt += static_cast<uint16_t>(count - m_register[Register::CX]) * RepCycles(*ip);
+    m_register[Register::IP] += 2;
+}
+
+template<>
+inline void Cpu::ExecuteOpcode<0xf3>(uint8_t* ip)
+{
+    if (*ip == 0x66 || *ip == 0x67)
+    {
+        m_register[Register::IP] += 1 + HandleREPSized(ip, true, false);
+        return;
+    }
+
+    uint16_t count = m_register[Register::CX];
+
+    HandleREP(*ip);
+    m_cycleCnt += static_cast<uint16_t>(count - m_register[Register::CX]) * RepCycles(*ip);
+    m_register[Register::IP] += 2;
+}
+
+// halt
+template<>
+inline void Cpu::ExecuteOpcode<0xf4>(uint8_t* ip)
+{
+    m_register[Register::IP] += 1;
+    m_state |= State::Halted;
+}
+
+// cmc
+template<>
+inline void Cpu::ExecuteOpcode<0xf5>(uint8_t* ip)
+{
+    SetCF(!GetCF());
+    m_register[Register::IP] += 1;
+}
+
+template<>
+inline void Cpu::ExecuteOpcode<0xf6>(uint8_t* ip)
+{
+    HandleF6h(ip);
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+template<>
+inline void Cpu::ExecuteOpcode<0xf7>(uint8_t* ip)
+{
+    HandleF7h(ip);
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+}
+
+// clc
+template<>
+inline void Cpu::ExecuteOpcode<0xf8>(uint8_t* ip)
+{
+    SetCF(false);
+    m_register[Register::IP] += 1;
+}
+
+// stc
+template<>
+inline void Cpu::ExecuteOpcode<0xf9>(uint8_t* ip)
+{
+    SetCF(true);
+    m_register[Register::IP] += 1;
+}
+
+// cli
+template<>
+inline void Cpu::ExecuteOpcode<0xfa>(uint8_t* ip)
+{
+    m_register[Register::FLAG] &= ~Flag::IF_mask;
+    m_register[Register::IP] += 1;
+}
+
+// sti
+template<>
+inline void Cpu::ExecuteOpcode<0xfb>(uint8_t* ip)
+{
+    m_register[Register::FLAG] |= Flag::IF_mask;
+    m_register[Register::IP] += 1;
+}
+
+// cld
+template<>
+inline void Cpu::ExecuteOpcode<0xfc>(uint8_t* ip)
+{
+    m_register[Register::FLAG] &= ~Flag::DF_mask;
+    m_register[Register::IP] += 1;
+}
+
+// std
+template<>
+inline void Cpu::ExecuteOpcode<0xfd>(uint8_t* ip)
+{
+    m_register[Register::FLAG] |= Flag::DF_mask;
+    m_register[Register::IP] += 1;
+}
+
+// inc / dec r/m8
+template<>
+inline void Cpu::ExecuteOpcode<0xfe>(uint8_t* ip)
+{
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+    HandleFEh(ip);
+}
+
+template<>
+inline void Cpu::ExecuteOpcode<0xff>(uint8_t* ip)
+{
+    m_register[Register::IP] += s_modRmInstLen[*ip];
+    HandleFFh(ip);
+}
+
+void Cpu::ExecuteInstruction()
+{
+    uint16_t opcode;
+    uint8_t  *ip;
+
+    RestartDecoding:
+    ip = m_memory + m_register[Register::CS] * 16 + m_register[Register::IP];
+    opcode = *ip++;
+
+    // for opcodes without a ModR/M byte both forms cost the same
+    m_cycleCnt += s_opcodeCycles[*ip < 0xc0][opcode];
+
+    // if (opcode == 0xcd)
+    // {
+    //     uint8_t func = m_register[Register::AX] >> 8;
+    //     if (*ip == 0x21 && func == 0x48 || func == 0x49)
+    //     {
+    //         m_disasmCnt = 8;
+    //         printf("---\n");
+    //     }
+    // }
+
+    // bool disasm = true;
+    // if (disasm)
+    // if (m_disasmCnt > 0)
+    // {
+    //     m_disasmCnt--;
+    //     printf("AX %04x BX %04x CX %04x DX %04x SI %04x DI %04x SP %04x BP %04x CS %04x DS %04x ES %04x SS %04x ",
+    //         m_register[Register::AX],
+    //         m_register[Register::BX],
+    //         m_register[Register::CX],
+    //         m_register[Register::DX],
+    //         m_register[Register::SI],
+    //         m_register[Register::DI],
+    //         m_register[Register::SP],
+    //         m_register[Register::BP],
+    //         m_register[Register::CS],
+    //         m_register[Register::DS],
+    //         m_register[Register::ES],
+    //         m_register[Register::SS]);
+    //
+    //      printf("%s\n", Disasm(*this, m_rMemory).Process().c_str());
+    // }
+
+    switch(opcode)
+    {
+        Opcode_Case16(0x00);
+        Opcode_Case16(0x10);
+        Opcode_Case16(0x20);
+        Opcode_Case16(0x30);
+        Opcode_Case16(0x40);
+        Opcode_Case16(0x50);
+        Opcode_Case16(0x60);
+        Opcode_Case16(0x70);
+        Opcode_Case16(0x80);
+        Opcode_Case16(0x90);
+        Opcode_Case16(0xa0);
+        Opcode_Case16(0xb0);
+        Opcode_Case16(0xc0);
+        Opcode_Case16(0xd0);
+        Opcode_Case16(0xe0);
+        Opcode_Case16(0xf0);
+    }
+
+    if (m_state)
+    {
+        if (m_state & State::Prefix)
+        {
+            m_state &= ~State::Prefix;
+            goto RestartDecoding;
+        }
+
+        if (m_state & State::InvalidOp)
+        {
+            printf("Invalid opcode 0x%02x\n", *(ip - 1));
+            return;
+        }
+
+        if (m_state & (State::Finished | State::Halted | State::Idle))
+        {
+            return;
+        }
+
+        if (m_state & State::SegmentOverride)
+        {
+            m_segmentBase      = m_register[Register::DS] * 16;
+            m_stackSegmentBase = m_register[Register::SS] * 16;
+        }
+
+        m_state = 0;
+    }
+}
+
+#ifdef X86EMU_THREADED_DISPATCH
+const std::array<Cpu::OpcodeHandler, 256> Cpu::s_threadedTable =
+    Cpu::MakeThreadedTable(std::make_index_sequence<256>());
+
+template<int Opcode>
+void Cpu::ThreadedOpcode(uint8_t* ip)
+{
+    m_cycleCnt += s_opcodeCycles[*ip < 0xc0][Opcode];
+
+    ExecuteOpcode<Opcode>(ip);
+
+    if (m_state)
+    {
+        if (m_state & State::Prefix)
+        {
+            // prefix is part of the instruction, dispatch the rest of it
+            m_state &= ~State::Prefix;
+
+            ip = m_memory + m_register[Register::CS] * 16 + m_register[Register::IP];
+            (this->*s_threadedTable[*ip])(ip + 1);
+            return;
+        }
+
+        m_instructionCnt++;
+
+        if (m_state & State::InvalidOp)
+        {
+            printf("Invalid opcode 0x%02x\n", *(ip - 1));
+            return;
+        }
+
+        if (m_state & (State::Finished | State::Halted | State::Idle))
+        {
+            return;
+        }
+
+        if (m_state & State::SegmentOverride)
+        {
+            m_segmentBase      = m_register[Register::DS] * 16;
+            m_stackSegmentBase = m_register[Register::SS] * 16;
+        }
+
+        m_state = 0;
+    }
+    else
+    {
+        m_instructionCnt++;
+    }
+
+    if (m_cycleCnt >= m_threadedLimit)
+        return;
+
+    ip = m_memory + m_register[Register::CS] * 16 + m_register[Register::IP];
+    (this->*s_threadedTable[*ip])(ip + 1);
+}
+#endif
+
+// Block cache
+//
+// Straight-line code is decoded once into a DecodedBlock: every instruction gets its
+// handler, register operand pointers, effective address components and immediates
+// resolved up front, so executing it is a single indirect call. Instructions without a
+// predecoded handler (string ops, port I/O, interrupts, segment loads, ...) terminate
+// the block and are executed by ExecuteInstruction().
+Cpu::DecodedBlock& Cpu::FetchBlock()
+{
+    uint32_t      linearAddr = m_register[Register::CS] * 16 + m_register[Register::IP];
+    DecodedBlock& block      = m_blockCache[(linearAddr ^ (linearAddr >> 13)) & (BlockCacheSize - 1)];
+
+    // blocks are validated against the guest bytes they were decoded from, this keeps
+    // self-modifying code and memory patched by the Bios / Dos emulation coherent; a
+    // block writing into its own code stops there (ExecuteBlock) and comes back here
+    if (block.linearAddr != linearAddr || ::memcmp(block.code, m_memory + linearAddr, block.length) != 0)
+    {
+        DecodeBlock(block, linearAddr);
+    }
+
+    return block;
+}
+
+void Cpu::ExecuteBlock(DecodedBlock& block, std::size_t cycleLimit)
+{
+    // don't let a block run over the end of the code segment
+    if (m_register[Register::IP] + block.length >= 0x10000)
+    {
+        m_instructionCnt++;
+        ExecuteInstruction();
+        return;
+    }
+
+    uint16_t nextIp = m_register[Register::IP];
+
+    WatchCode(block);
+
+    for(int n = 0; n < block.count; n++)
+    {
+        const DecodedInst& inst = block.inst[n];
+
+        m_instructionCnt++;
+        m_cycleCnt += inst.cycles;
+        (this->*inst.handler)(inst);
+        nextIp += inst.length;
+
+        if (m_state || m_register[Register::IP] != nextIp || m_cycleCnt >= cycleLimit || m_codeWritten)
+            break;
+    }
+
+    m_codeLength = 0;
+}
+
+void Cpu::WatchCode(const DecodedBlock& block)
+{
+    m_codeStart   = block.linearAddr - 3;
+    m_codeLength  = block.length + 3;
+    m_codeWritten = false;
+}
+
+void Cpu::DecodeBlock(DecodedBlock& block, uint32_t linearAddr)
+{
+    uint8_t* start = m_memory + linearAddr;
+    uint8_t* ip    = start;
+
+    block.count        = 0;
+    block.cycles       = 0;
+    block.runCycles[0] = 0;
+
+    // 6 bytes is the longest instruction decoded natively (prefix, opcode, modrm, disp16, imm8)
+    while(block.count < MaxBlockInstructions && ip - start <= MaxBlockBytes - 6)
+    {
+        DecodedInst& inst       = block.inst[block.count++];
+        bool         endOfBlock = DecodeInstruction(ip, inst);
 
-        case 0x73: // jnb rel8
-            offset = Disp8(ip);
-            m_register[Register::IP] += 2;
-            if (!GetCF())
-                m_register[Register::IP] += offset;
-            break;
+        inst.cycles   = (inst.handler == &Cpu::OpFallback) ? 0 : s_opcodeCycles[inst.modRm < 0xc0][inst.opcode];
+        block.cycles += inst.cycles;
+        block.runCycles[block.count] = block.cycles;
 
-        case 0x74: // je rel8
-            offset = Disp8(ip);
-            m_register[Register::IP] += 2;
-            if (GetZF())
-                m_register[Register::IP] += offset;
-            break;
+        ip += inst.length;
 
-        case 0x75: // jne rel8
-            offset = Disp8(ip);
-            m_register[Register::IP] += 2;
-            if (!GetZF())
-                m_register[Register::IP] += offset;
+        if (endOfBlock)
             break;
+    }
 
-        case 0x76: // jbe / jna rel8
-            offset = Disp8(ip);
-            m_register[Register::IP] += 2;
-            if (GetCF() || GetZF())
-                m_register[Register::IP] += offset;
-            break;
+    block.linearAddr = linearAddr;
+    block.length     = ip - start;
+    block.hits       = 0;
+    block.native     = nullptr;
 
-        case 0x77: // jnbe / ja rel8
-            offset = Disp8(ip);
-            m_register[Register::IP] += 2;
-            if (!GetCF() && !GetZF())
-                m_register[Register::IP] += offset;
-            break;
+    ::memcpy(block.code, start, block.length);
+}
 
-        case 0x78: // js rel8
-            offset = Disp8(ip);
-            m_register[Register::IP] += 2;
-            if (GetSF())
-                m_register[Register::IP] += offset;
-            break;
+bool Cpu::DecodeInstruction(uint8_t* ip, DecodedInst& inst)
+{
+    static const InstHandler s_aluRmReg16[8][2]  = AluOp_Handlers(OpAluRmReg16);
+    static const InstHandler s_aluRmReg8[8][2]   = AluOp_Handlers(OpAluRmReg8);
+    static const InstHandler s_aluRegRm16[8][2]  = AluOp_Handlers(OpAluRegRm16);
+    static const InstHandler s_aluRegRm8[8][2]   = AluOp_Handlers(OpAluRegRm8);
+    static const InstHandler s_aluRmImm16[8][2]  = AluOp_Handlers(OpAluRmImm16);
+    static const InstHandler s_aluRmImm8[8][2]   = AluOp_Handlers(OpAluRmImm8);
+
+    static const InstHandler s_aluAccImm16[8] =
+      { &Cpu::OpAluAccImm16<0>, &Cpu::OpAluAccImm16<1>, &Cpu::OpAluAccImm16<2>, &Cpu::OpAluAccImm16<3>,
+        &Cpu::OpAluAccImm16<4>, &Cpu::OpAluAccImm16<5>, &Cpu::OpAluAccImm16<6>, &Cpu::OpAluAccImm16<7> };
+
+    static const InstHandler s_aluAccImm8[8] =
+      { &Cpu::OpAluAccImm8<0>, &Cpu::OpAluAccImm8<1>, &Cpu::OpAluAccImm8<2>, &Cpu::OpAluAccImm8<3>,
+        &Cpu::OpAluAccImm8<4>, &Cpu::OpAluAccImm8<5>, &Cpu::OpAluAccImm8<6>, &Cpu::OpAluAccImm8<7> };
+
+    static const InstHandler s_jcc[16] =
+      { &Cpu::OpJcc<0x0>, &Cpu::OpJcc<0x1>, &Cpu::OpJcc<0x2>, &Cpu::OpJcc<0x3>,
+        &Cpu::OpJcc<0x4>, &Cpu::OpJcc<0x5>, &Cpu::OpJcc<0x6>, &Cpu::OpJcc<0x7>,
+        &Cpu::OpJcc<0x8>, &Cpu::OpJcc<0x9>, &Cpu::OpJcc<0xa>, &Cpu::OpJcc<0xb>,
+        &Cpu::OpJcc<0xc>, &Cpu::OpJcc<0xd>, &Cpu::OpJcc<0xe>, &Cpu::OpJcc<0xf> };
+
+    uint8_t* start   = ip;
+    int      segment = -1;
+    int      length  = 0;
+    bool     mem     = false;
+
+    inst.handler = &Cpu::OpFallback;
+    inst.reg.r16 = nullptr;
+    inst.rm.r16  = nullptr;
+    inst.disp    = 0;
+    inst.imm     = 0;
+    inst.base    = Register::ZERO;
+    inst.index   = Register::ZERO;
+    inst.segment = Register::DS;
+    inst.length  = 0;
+    inst.opcode  = 0;
+    inst.modRm   = 0;
+
+    switch(*ip)
+    {
+        case 0x26: segment = Register::ES; ip++; break;
+        case 0x2e: segment = Register::CS; ip++; break;
+        case 0x36: segment = Register::SS; ip++; break;
+        case 0x3e: segment = Register::DS; ip++; break;
+    }
 
-        case 0x79: // jns rel8
-            offset = Disp8(ip);
-            m_register[Register::IP] += 2;
-            if (!GetSF())
-                m_register[Register::IP] += offset;
-            break;
+    uint8_t opcode = *ip++;
 
-        case 0x7a: // jp rel8
-            offset = Disp8(ip);
-            m_register[Register::IP] += 2;
-            if (GetPF())
-                m_register[Register::IP] += offset;
-            break;
+    inst.opcode = opcode;
+    inst.modRm  = *ip;
 
-        case 0x7b: // jnp rel8
-            offset = Disp8(ip);
-            m_register[Register::IP] += 2;
-            if (!GetPF())
-                m_register[Register::IP] += offset;
-            break;
+    if (opcode < 0x40 && (opcode & 0x07) < 0x06)
+    {
+        int op = opcode >> 3;
 
-        case 0x7c: // jl rel8
-            offset = Disp8(ip);
-            m_register[Register::IP] += 2;
-            if (GetSF() != GetOF())
-                m_register[Register::IP] += offset;
-            break;
+        mem = (*ip & 0xc0) != 0xc0;
 
-        case 0x7d: // jnl rel8
-            offset = Disp8(ip);
-            m_register[Register::IP] += 2;
-            if (GetSF() == GetOF())
-                m_register[Register::IP] += offset;
-            break;
+        switch(opcode & 0x07)
+        {
+            case 0: // op r/m8, r8
+                length       = DecodeModRm(ip, segment, false, inst);
+                inst.handler = s_aluRmReg8[op][mem];
+                break;
 
-        case 0x7e: // jle rel8
-            offset = Disp8(ip);
-            m_register[Register::IP] += 2;
-            if (GetZF() || (GetSF() != GetOF()))
-                m_register[Register::IP] += offset;
-            break;
+            case 1: // op r/m16, r16
+                length       = DecodeModRm(ip, segment, true, inst);
+                inst.handler = s_aluRmReg16[op][mem];
+                break;
 
-        case 0x7f: // jg rel8
-            offset = Disp8(ip);
-            m_register[Register::IP] += 2;
-            if (!GetZF() && (GetSF() == GetOF()))
-                m_register[Register::IP] += offset;
-            break;
+            case 2: // op r8, r/m8
+                length       = DecodeModRm(ip, segment, false, inst);
+                inst.handler = s_aluRegRm8[op][mem];
+                break;
 
-        case 0x80:
-            Handle80h(ip);
-            m_register[Register::IP] += s_modRmInstLen[*ip] + 1;
-            break;
+            case 3: // op r16, r/m16
+                length       = DecodeModRm(ip, segment, true, inst);
+                inst.handler = s_aluRegRm16[op][mem];
+                break;
 
-        case 0x81:
-            Handle81h(ip);
-            m_register[Register::IP] += s_modRmInstLen[*ip] + 2;
-            break;
+            case 4: // op al, imm8
+                length       = 2;
+                inst.imm     = *ip;
+                inst.handler = s_aluAccImm8[op];
+                break;
 
-        case 0x82:
-            Handle80h(ip);
-            m_register[Register::IP] += s_modRmInstLen[*ip] + 1;
-            break;
+            case 5: // op ax, imm16
+                length       = 3;
+                inst.imm     = Imm16(ip);
+                inst.handler = s_aluAccImm16[op];
+                break;
+        }
+    }
+    else
+    {
+        switch(opcode)
+        {
+            case 0x40: case 0x41: case 0x42: case 0x43: // inc reg16
+            case 0x44: case 0x45: case 0x46: case 0x47:
+                length       = 1;
+                inst.reg.r16 = &m_register[opcode - 0x40];
+                inst.handler = &Cpu::OpIncReg16;
+                break;
 
-        case 0x83:
-            Handle83h(ip);
-            m_register[Register::IP] += s_modRmInstLen[*ip] + 1;
-            break;
+            case 0x48: case 0x49: case 0x4a: case 0x4b: // dec reg16
+            case 0x4c: case 0x4d: case 0x4e: case 0x4f:
+                length       = 1;
+                inst.reg.r16 = &m_register[opcode - 0x48];
+                inst.handler = &Cpu::OpDecReg16;
+                break;
 
-        case 0x84: // test r/m8, r8
-            {
-                uint8_t op1    = ModRmLoad8(ip);
-                uint8_t op2    = *Reg8(*ip);
-                uint8_t result = op1 & op2;
+            case 0x50: case 0x51: case 0x52: case 0x53: // push reg16
+            case 0x54: case 0x55: case 0x56: case 0x57:
+                length       = 1;
+                inst.reg.r16 = &m_register[opcode - 0x50];
+                inst.handler = &Cpu::OpPushReg16;
+                break;
 
-                SetLogicFlags8(result);
-                m_register[Register::IP] += s_modRmInstLen[*ip];
+            case 0x58: case 0x59: case 0x5a: case 0x5b: // pop reg16
+            case 0x5c: case 0x5d: case 0x5e: case 0x5f:
+                length       = 1;
+                inst.reg.r16 = &m_register[opcode - 0x58];
+                inst.handler = &Cpu::OpPopReg16;
                 break;
-            }
 
-        case 0x85: // test r/m16, r16
-            {
-                uint16_t op1    = ModRmLoad16(ip);
-                uint16_t op2    = *Reg16(*ip);
-                uint16_t result = op1 & op2;
+            case 0x68: // push imm16
+                length       = 3;
+                inst.imm     = Imm16(ip);
+                inst.handler = &Cpu::OpPushImm;
+                break;
 
-                SetLogicFlags16(result);
-            }
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            break;
+            case 0x6a: // push imm8
+                length       = 2;
+                inst.imm     = *ip;
+                inst.handler = &Cpu::OpPushImm;
+                break;
 
-        case 0x86: // xchg r/m8, r8
-            ModRmModifyOp8(ip,
-                [this, ip](uint8_t op1, uint8_t op2)
-                {
-                    *Reg8(*ip) = op1;
-                    return op2;
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            break;
+            case 0x70: case 0x71: case 0x72: case 0x73: // jcc rel8
+            case 0x74: case 0x75: case 0x76: case 0x77:
+            case 0x78: case 0x79: case 0x7a: case 0x7b:
+            case 0x7c: case 0x7d: case 0x7e: case 0x7f:
+                inst.length  = (ip - start) + 1;
+                inst.imm     = Disp8(ip);
+                inst.handler = s_jcc[opcode & 0x0f];
+                return true;
+
+            case 0x80: case 0x82: // op r/m8, imm8
+                mem          = (*ip & 0xc0) != 0xc0;
+                length       = DecodeModRm(ip, segment, false, inst) + 1;
+                inst.imm     = *(ip + length - 2);
+                inst.handler = s_aluRmImm8[(*ip >> 3) & 0x07][mem];
+                break;
 
-        case 0x87: // xchg r/m16, r16
-            ModRmModifyOp16(ip,
-                [this, ip](uint16_t op1, uint16_t op2)
-                {
-                    *Reg16(*ip) = op1;
-                    return op2;
-                });
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            break;
+            case 0x81: // op r/m16, imm16
+                mem          = (*ip & 0xc0) != 0xc0;
+                length       = DecodeModRm(ip, segment, true, inst) + 2;
+                inst.imm     = Imm16(ip + length - 3);
+                inst.handler = s_aluRmImm16[(*ip >> 3) & 0x07][mem];
+                break;
 
-        case 0x88: // mov r/m8, r8
-            ModRmStore8(ip, *Reg8(*ip));
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            break;
+            case 0x83: // op r/m16, imm8
+                mem          = (*ip & 0xc0) != 0xc0;
+                length       = DecodeModRm(ip, segment, true, inst) + 1;
+                inst.imm     = Disp8(ip + length - 2);
+                inst.handler = s_aluRmImm16[(*ip >> 3) & 0x07][mem];
+                break;
 
-        case 0x89: // mov r/m16, r16
-            ModRmStore16(ip, *Reg16(*ip));
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            break;
+            case 0x84: // test r/m8, r8
+                mem          = (*ip & 0xc0) != 0xc0;
+                length       = DecodeModRm(ip, segment, false, inst);
+                inst.handler = mem ? &Cpu::OpTestRmReg8<true> : &Cpu::OpTestRmReg8<false>;
+                break;
 
-        case 0x8a: // mov r8, r/m8
-            *Reg8(*ip) = ModRmLoad8(ip);
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            break;
+            case 0x85: // test r/m16, r16
+                mem          = (*ip & 0xc0) != 0xc0;
+                length       = DecodeModRm(ip, segment, true, inst);
+                inst.handler = mem ? &Cpu::OpTestRmReg16<true> : &Cpu::OpTestRmReg16<false>;
+                break;
 
-        case 0x8b: // mov r16, r/m16
-            *Reg16(*ip) = ModRmLoad16(ip);
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            break;
+            case 0x86: // xchg r/m8, r8
+                mem          = (*ip & 0xc0) != 0xc0;
+                length       = DecodeModRm(ip, segment, false, inst);
+                inst.handler = mem ? &Cpu::OpXchgRmReg8<true> : &Cpu::OpXchgRmReg8<false>;
+                break;
 
-        case 0x8c: // mov r/m16, Sreg
-            ModRmStore16(ip, *SReg(*ip));
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            break;
+            case 0x87: // xchg r/m16, r16
+                mem          = (*ip & 0xc0) != 0xc0;
+                length       = DecodeModRm(ip, segment, true, inst);
+                inst.handler = mem ? &Cpu::OpXchgRmReg16<true> : &Cpu::OpXchgRmReg16<false>;
+                break;
 
-        case 0x8d: // lea r16, m16
-            ModRmLoadEa(ip);
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            break;
+            case 0x88: // mov r/m8, r8
+                mem          = (*ip & 0xc0) != 0xc0;
+                length       = DecodeModRm(ip, segment, false, inst);
+                inst.handler = mem ? &Cpu::OpMovRmReg8<true> : &Cpu::OpMovRmReg8<false>;
+                break;
 
-        case 0x8e: // mov Sreg, r/m16
-            *SReg(*ip) = ModRmLoad16(ip);
-            m_segmentBase      = m_register[Register::DS] * 16;
-            m_stackSegmentBase = m_register[Register::SS] * 16;
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            break;
+            case 0x89: // mov r/m16, r16
+                mem          = (*ip & 0xc0) != 0xc0;
+                length       = DecodeModRm(ip, segment, true, inst);
+                inst.handler = mem ? &Cpu::OpMovRmReg16<true> : &Cpu::OpMovRmReg16<false>;
+                break;
 
-        case 0x8f:
-            Handle8Fh(ip);
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            break;
+            case 0x8a: // mov r8, r/m8
+                mem          = (*ip & 0xc0) != 0xc0;
+                length       = DecodeModRm(ip, segment, false, inst);
+                inst.handler = mem ? &Cpu::OpMovRegRm8<true> : &Cpu::OpMovRegRm8<false>;
+                break;
 
-        case 0x90: case 0x91: case 0x92: case 0x93:
-        case 0x94: case 0x95: case 0x96: case 0x97:
-            std::swap(m_register[Register::AX], m_register[opcode - 0x90]);
-            m_register[Register::IP] += 1;
-            break;
+            case 0x8b: // mov r16, r/m16
+                mem          = (*ip & 0xc0) != 0xc0;
+                length       = DecodeModRm(ip, segment, true, inst);
+                inst.handler = mem ? &Cpu::OpMovRegRm16<true> : &Cpu::OpMovRegRm16<false>;
+                break;
 
-        case 0x98: // cbw
-            m_register[Register::AX] = static_cast<char>(m_register[Register::AX]);
-            m_register[Register::IP] += 1;
-            break;
+            case 0x8c: // mov r/m16, Sreg
+                mem          = (*ip & 0xc0) != 0xc0;
+                length       = DecodeModRm(ip, segment, true, inst);
+                inst.reg.r16 = SReg(*ip);
+                inst.handler = mem ? &Cpu::OpMovRmReg16<true> : &Cpu::OpMovRmReg16<false>;
+                break;
 
-        case 0x99: // cwd
-            m_register[Register::DX] = static_cast<short>(m_register[Register::AX]) >> 15;
-            m_register[Register::IP] += 1;
-            break;
+            case 0x8d: // lea r16, m16
+                if ((*ip & 0xc0) != 0xc0)
+                {
+                    length       = DecodeModRm(ip, segment, true, inst);
+                    inst.handler = &Cpu::OpLea;
+                }
+                break;
 
-        case 0x9a: // call far ptr16:16
-            m_register[Register::IP] += 5;
-            Push16(m_register[Register::CS]);
-            Push16(m_register[Register::IP]);
-            m_register[Register::CS] = Imm16(ip + 2);
-            m_register[Register::IP] = Imm16(ip);
-            break;
+            case 0x90: case 0x91: case 0x92: case 0x93: // xchg ax, reg16
+            case 0x94: case 0x95: case 0x96: case 0x97:
+                length       = 1;
+                inst.reg.r16 = &m_register[opcode - 0x90];
+                inst.handler = &Cpu::OpXchgAcc;
+                break;
 
-//         case 0x9b: // fwait
-//             break;
+            case 0x98: // cbw
+                length       = 1;
+                inst.handler = &Cpu::OpCbw;
+                break;
 
-        case 0x9c: // pushf
-            RecalcFlags();
-            Push16(m_register[Register::FLAG]);
-            m_register[Register::IP] += 1;
-            break;
+            case 0x99: // cwd
+                length       = 1;
+                inst.handler = &Cpu::OpCwd;
+                break;
 
-        case 0x9d: // popf
-            //m_register[Register::FLAG] = (Pop16() & ~Flag::Always0_mask) | Flag::Always1_mask;
-            //m_register[Register::FLAG] = (Pop16() & 0x0fff) | Flag::Always1_mask;   // 8086
-            m_register[Register::FLAG] = Pop16() & 0x0fff;   // 286
-            m_register[Register::IP] += 1;
-            RestoreLazyFlags();
-            break;
+            case 0xa0: // mov al, moffs8
+            case 0xa1: // mov ax, moffs16
+            case 0xa2: // mov moffs8, al
+            case 0xa3: // mov moffs16, ax
+                {
+                    static const InstHandler s_movAccMem[4] =
+                      { &Cpu::OpMovAccMem8, &Cpu::OpMovAccMem16, &Cpu::OpMovMemAcc8, &Cpu::OpMovMemAcc16 };
 
-        case 0x9e: // sahf
-            m_register[Register::FLAG] &= 0xff00;
-            m_register[Register::FLAG] |= ((m_register[Register::AX] >> 8) & 0xd7) | 2;
-            m_register[Register::IP] += 1;
-            RestoreLazyFlags();
-            break;
+                    length       = 3;
+                    inst.disp    = Imm16(ip);
+                    inst.segment = segment >= 0 ? segment : Register::DS;
+                    inst.handler = s_movAccMem[opcode - 0xa0];
+                    break;
+                }
 
-        case 0x9f: // lahf
-            RecalcFlags();
-            m_register[Register::AX] &= 0x00ff;
-            m_register[Register::AX] |= ((m_register[Register::FLAG] << 8) & 0xd7) | 2;
-            m_register[Register::IP] += 1;
-            break;
+            case 0xa8: // test al, imm8
+                length       = 2;
+                inst.imm     = *ip;
+                inst.handler = &Cpu::OpTestAccImm8;
+                break;
 
-        case 0xa0: // mov al, moffs8
-            m_register[Register::AX] = (m_register[Register::AX] & 0xff00) | Load8(m_segmentBase + Disp16(ip));
-            m_register[Register::IP] += 3;
-            break;
+            case 0xa9: // test ax, imm16
+                length       = 3;
+                inst.imm     = Imm16(ip);
+                inst.handler = &Cpu::OpTestAccImm16;
+                break;
 
-        case 0xa1: // mov ax, moffs16
-            m_register[Register::AX] = Load16(m_segmentBase + Disp16(ip));
-            m_register[Register::IP] += 3;
-            break;
+            case 0xb0: case 0xb1: case 0xb2: case 0xb3: // mov reg8, imm8
+            case 0xb4: case 0xb5: case 0xb6: case 0xb7:
+                length       = 2;
+                inst.imm     = *ip;
+                inst.reg.r8  = Reg8((opcode & 0x07) << 3);
+                inst.handler = &Cpu::OpMovRegImm8;
+                break;
 
-        case 0xa2: // mov moffs8, al
-            Store8(m_segmentBase + Disp16(ip), m_register[Register::AX]);
-            m_register[Register::IP] += 3;
-            break;
+            case 0xb8: case 0xb9: case 0xba: case 0xbb: // mov reg16, imm16
+            case 0xbc: case 0xbd: case 0xbe: case 0xbf:
+                length       = 3;
+                inst.imm     = Imm16(ip);
+                inst.reg.r16 = &m_register[opcode - 0xb8];
+                inst.handler = &Cpu::OpMovRegImm16;
+                break;
 
-        case 0xa3: // mov moffs16, ax
-            Store16(m_segmentBase + Disp16(ip), m_register[Register::AX]);
-            m_register[Register::IP] += 3;
-            break;
+            case 0xc2: // ret imm16
+                inst.length  = (ip - start) + 2;
+                inst.imm     = Imm16(ip);
+                inst.handler = &Cpu::OpRet;
+                return true;
 
-        case 0xa4: // movsb
-            {
-                Store8(m_register[Register::ES] * 16 + m_register[Register::DI],
-                    Load8(m_segmentBase + m_register[Register::SI]));
+            case 0xc3: // ret
+                inst.length  = ip - start;
+                inst.handler = &Cpu::OpRet;
+                return true;
 
-                short delta = (m_register[Register::FLAG] & Flag::DF_mask) ? -1 : 1;
+            case 0xc6: // mov r/m8, imm8
+                if (((*ip >> 3) & 0x07) == 0)
+                {
+                    mem          = (*ip & 0xc0) != 0xc0;
+                    length       = DecodeModRm(ip, segment, false, inst) + 1;
+                    inst.imm     = *(ip + length - 2);
+                    inst.handler = mem ? &Cpu::OpMovRmImm8<true> : &Cpu::OpMovRmImm8<false>;
+                }
+                break;
 
-                m_register[Register::SI] += delta;
-                m_register[Register::DI] += delta;
-                m_register[Register::IP] += 1;
+            case 0xc7: // mov r/m16, imm16
+                if (((*ip >> 3) & 0x07) == 0)
+                {
+                    mem          = (*ip & 0xc0) != 0xc0;
+                    length       = DecodeModRm(ip, segment, true, inst) + 2;
+                    inst.imm     = Imm16(ip + length - 3);
+                    inst.handler = mem ? &Cpu::OpMovRmImm16<true> : &Cpu::OpMovRmImm16<false>;
+                }
                 break;
-            }
 
-        case 0xa5: // movsw
-            {
-                Store16(m_register[Register::ES] * 16 + m_register[Register::DI],
-                    Load16(m_segmentBase + m_register[Register::SI]));
+            case 0xe0: // loopnz rel8
+            case 0xe1: // loopz rel8
+            case 0xe2: // loop rel8
+            case 0xe3: // jcxz rel8
+                {
+                    static const InstHandler s_loop[4] =
+                      { &Cpu::OpLoopnz, &Cpu::OpLoopz, &Cpu::OpLoop, &Cpu::OpJcxz };
 
-                short delta = (m_register[Register::FLAG] & Flag::DF_mask) ? -2 : 2;
+                    inst.length  = (ip - start) + 1;
+                    inst.imm     = Disp8(ip);
+                    inst.handler = s_loop[opcode - 0xe0];
+                    return true;
+                }
 
-                m_register[Register::SI] += delta;
-                m_register[Register::DI] += delta;
-                m_register[Register::IP] += 1;
+            case 0xe8: // call rel16
+                inst.length  = (ip - start) + 2;
+                inst.imm     = Disp16(ip);
+                inst.handler = &Cpu::OpCall;
+                return true;
+
+            case 0xe9: // jmp rel16
+                inst.length  = (ip - start) + 2;
+                inst.imm     = Disp16(ip);
+                inst.handler = &Cpu::OpJmp;
+                return true;
+
+            case 0xeb: // jmp rel8
+                inst.length  = (ip - start) + 1;
+                inst.imm     = Disp8(ip);
+                inst.handler = &Cpu::OpJmp;
+                return true;
+
+            case 0xf5: // cmc
+            case 0xf8: // clc
+            case 0xf9: // stc
+            case 0xfa: // cli
+            case 0xfb: // sti
+            case 0xfc: // cld
+            case 0xfd: // std
+                length       = 1;
+                inst.imm     = opcode;
+                inst.handler = &Cpu::OpSetFlag;
                 break;
-            }
+        }
+    }
 
-        case 0xa6: // cmpsb
-            {
-                uint8_t op1  = Load8(m_segmentBase + m_register[Register::SI]);
-                uint8_t op2  = Load8(m_register[Register::ES] * 16 + m_register[Register::DI]);
-                uint8_t diff = op1 - op2;
+    if (inst.handler == &Cpu::OpFallback)
+        return true;
 
-                SetSubFlags8(op1, op2, diff);
+    // length counts the opcode byte, add the segment override prefix if present
+    inst.length = (ip - 1 - start) + length;
+    return false;
+}
 
-                short delta = (m_register[Register::FLAG] & Flag::DF_mask) ? -1 : 1;
+int Cpu::DecodeModRm(uint8_t* ip, int segment, bool wide, DecodedInst& inst)
+{
+    uint8_t        modRm = *ip;
+    const ModRmEa& ea    = ModRmEa::s_table[modRm];
 
-                m_register[Register::SI] += delta;
-                m_register[Register::DI] += delta;
-                m_register[Register::IP] += 1;
-                break;
-            }
+    if (wide)
+    {
+        inst.reg.r16 = Reg16(modRm);
+        inst.rm.r16  = &m_register[modRm & 0x07];
+    }
+    else
+    {
+        inst.reg.r8 = Reg8(modRm);
+        inst.rm.r8  = Reg8(modRm << 3);
+    }
 
-        case 0xa7: // cmpsw
-            {
-                uint16_t op1  = Load16(m_segmentBase + m_register[Register::SI]);
-                uint16_t op2  = Load16(m_register[Register::ES] * 16 + m_register[Register::DI]);
-                uint16_t diff = op1 - op2;
+    if (!ea.isRegister)
+    {
+        inst.base    = ea.base;
+        inst.index   = ea.index;
+        inst.disp    = ModRmDisp(ea, ip);
+        inst.segment = (segment >= 0) ? segment : ea.stackSegment ? Register::SS : Register::DS;
+    }
 
-                SetSubFlags16(op1, op2, diff);
+    return s_modRmInstLen[modRm];
+}
 
-                short delta = (m_register[Register::FLAG] & Flag::DF_mask) ? -2 : 2;
+inline std::size_t Cpu::DecodedEa(const DecodedInst& inst)
+{
+    return m_register[inst.segment] * 16 +
+        static_cast<uint16_t>(m_register[inst.base] + m_register[inst.index] + inst.disp);
+}
 
-                m_register[Register::SI] += delta;
-                m_register[Register::DI] += delta;
-                m_register[Register::IP] += 1;
-                break;
-            }
+template<int Cond>
+inline bool Cpu::Condition()
+{
+    switch(Cond)
+    {
+        case 0x0: return GetOF();                           // jo
+        case 0x1: return !GetOF();                          // jno
+        case 0x2: return GetCF();                           // jb
+        case 0x3: return !GetCF();                          // jnb
+        case 0x4: return GetZF();                           // je
+        case 0x5: return !GetZF();                          // jne
+        case 0x6: return GetCF() || GetZF();                // jbe
+        case 0x7: return !GetCF() && !GetZF();              // ja
+        case 0x8: return GetSF();                           // js
+        case 0x9: return !GetSF();                          // jns
+        case 0xa: return GetPF();                           // jp
+        case 0xb: return !GetPF();                          // jnp
+        case 0xc: return GetSF() != GetOF();                // jl
+        case 0xd: return GetSF() == GetOF();                // jnl
+        case 0xe: return GetZF() || (GetSF() != GetOF());   // jle
+        case 0xf: return !GetZF() && (GetSF() == GetOF());  // jg
+    }
 
-        case 0xa8: // test al, imm8
-            SetLogicFlags8(m_register[Register::AX] & *ip);
-            m_register[Register::IP] += 2;
-            break;
+    return false;
+}
 
-        case 0xa9: // test ax, imm16
-            SetLogicFlags16(m_register[Register::AX] & Imm16(ip));
-            m_register[Register::IP] += 3;
-            break;
+template<int Op>
+inline uint16_t Cpu::Alu16(uint16_t op1, uint16_t op2)
+{
+    uint16_t result = 0;
 
-        case 0xaa: // stosb
-            {
-                Store8(m_register[Register::ES] * 16 + m_register[Register::DI], m_register[Register::AX]);
-                m_register[Register::DI] += (m_register[Register::FLAG] & Flag::DF_mask) ? -1 : 1;
-                m_register[Register::IP] += 1;
-                break;
-            }
+    switch(Op)
+    {
+        case AluOp::Add: result = op1 + op2; SetAddFlags16(op1, op2, result); break;
+        case AluOp::Or:  result = op1 | op2; SetLogicFlags16(result); break;
+        case AluOp::Adc: result = op1 + op2 + static_cast<uint16_t>(GetCF()); SetAddFlags16(op1, op2, result); break;
+        case AluOp::Sbb: result = op1 - op2 - static_cast<uint16_t>(GetCF()); SetSubFlags16(op1, op2, result); break;
+        case AluOp::And: result = op1 & op2; SetLogicFlags16(result); break;
+        case AluOp::Sub: result = op1 - op2; SetSubFlags16(op1, op2, result); break;
+        case AluOp::Xor: result = op1 ^ op2; SetLogicFlags16(result); break;
+        case AluOp::Cmp: result = op1 - op2; SetSubFlags16(op1, op2, result); break;
+    }
 
-        case 0xab: // stosw
-            {
-                Store16(m_register[Register::ES] * 16 + m_register[Register::DI], m_register[Register::AX]);
-                m_register[Register::DI] += (m_register[Register::FLAG] & Flag::DF_mask) ? -2 : 2;
-                m_register[Register::IP] += 1;
-                break;
-            }
+    return result;
+}
 
-        case 0xac: // lodsb
-            {
-                m_register[Register::AX] =
-                    (m_register[Register::AX] & 0xff00) | Load8(m_segmentBase + m_register[Register::SI]);
-                m_register[Register::SI] += (m_register[Register::FLAG] & Flag::DF_mask) ? -1 : 1;
-                m_register[Register::IP] += 1;
-                break;
-            }
+template<int Op>
+inline uint8_t Cpu::Alu8(uint8_t op1, uint8_t op2)
+{
+    uint8_t result = 0;
 
-        case 0xad: // lodsw
-            {
-                m_register[Register::AX] = Load16(m_segmentBase + m_register[Register::SI]);
-                m_register[Register::SI] += (m_register[Register::FLAG] & Flag::DF_mask) ? -2 : 2;
-                m_register[Register::IP] += 1;
-                break;
-            }
+    switch(Op)
+    {
+        case AluOp::Add: result = op1 + op2; SetAddFlags8(op1, op2, result); break;
+        case AluOp::Or:  result = op1 | op2; SetLogicFlags8(result); break;
+        case AluOp::Adc: result = op1 + op2 + static_cast<uint8_t>(GetCF()); SetAddFlags8(op1, op2, result); break;
+        case AluOp::Sbb: result = op1 - op2 - static_cast<uint8_t>(GetCF()); SetSubFlags8(op1, op2, result); break;
+        case AluOp::And: result = op1 & op2; SetLogicFlags8(result); break;
+        case AluOp::Sub: result = op1 - op2; SetSubFlags8(op1, op2, result); break;
+        case AluOp::Xor: result = op1 ^ op2; SetLogicFlags8(result); break;
+        case AluOp::Cmp: result = op1 - op2; SetSubFlags8(op1, op2, result); break;
+    }
 
-        case 0xae: // scasb
-            {
-                uint8_t op1  = m_register[Register::AX] & 0xff;
-                uint8_t op2  = Load8(m_register[Register::ES] * 16 + m_register[Register::DI]);
-                uint8_t diff = op1 - op2;
+    return result;
+}
 
-                SetSubFlags8(op1, op2, diff);
+void Cpu::OpFallback(const DecodedInst& inst)
+{
+    ExecuteInstruction();
+}
 
-                m_register[Register::DI] += (m_register[Register::FLAG] & Flag::DF_mask) ? -1 : 1;
-                m_register[Register::IP] += 1;
-                break;
-            }
+template<int Op, bool Mem>
+void Cpu::OpAluRmReg16(const DecodedInst& inst)
+{
+    if (Mem)
+    {
+        std::size_t ea     = DecodedEa(inst);
+        uint16_t    result = Alu16<Op>(Load16(ea), *inst.reg.r16);
 
-        case 0xaf: // scasw
-            {
-                uint16_t op1  = m_register[Register::AX];
-                uint16_t op2  = Load16(m_register[Register::ES] * 16 + m_register[Register::DI]);
-                uint16_t diff = op1 - op2;
+        if (Op != AluOp::Cmp)
+            Store16(ea, result);
+    }
+    else
+    {
+        uint16_t result = Alu16<Op>(*inst.rm.r16, *inst.reg.r16);
 
-                SetSubFlags16(op1, op2, diff);
+        if (Op != AluOp::Cmp)
+            *inst.rm.r16 = result;
+    }
 
-                m_register[Register::DI] += (m_register[Register::FLAG] & Flag::DF_mask) ? -2 : 2;
-                m_register[Register::IP] += 1;
-                break;
-            }
+    m_register[Register::IP] += inst.length;
+}
 
-        case 0xb0: case 0xb1: case 0xb2: case 0xb3: // mov reg8, imm8 (reg8 = al, cl, dl, bl)
-            reg  = &m_register[opcode - 0xb0];
-            *reg = (*reg & 0xff00) | *ip;
-            m_register[Register::IP] += 2;
-            break;
+template<int Op, bool Mem>
+void Cpu::OpAluRmReg8(const DecodedInst& inst)
+{
+    if (Mem)
+    {
+        std::size_t ea     = DecodedEa(inst);
+        uint8_t     result = Alu8<Op>(Load8(ea), *inst.reg.r8);
 
-        case 0xb4: case 0xb5: case 0xb6: case 0xb7: // mov reg8, imm8 (reg8 = ah, ch, dh, bh)
-            reg = &m_register[opcode - 0xb4];
-            *reg = (*reg & 0x00ff) | (*ip << 8);
-            m_register[Register::IP] += 2;
-            break;
+        if (Op != AluOp::Cmp)
+            Store8(ea, result);
+    }
+    else
+    {
+        uint8_t result = Alu8<Op>(*inst.rm.r8, *inst.reg.r8);
 
-        case 0xb8: case 0xb9: case 0xba: case 0xbb: // mov reg16, imm16
-        case 0xbc: case 0xbd: case 0xbe: case 0xbf:
-            m_register[opcode - 0xb8] = Imm16(ip);
-            m_register[Register::IP] += 3;
-            break;
+        if (Op != AluOp::Cmp)
+            *inst.rm.r8 = result;
+    }
 
-        case 0xc0: // shift8 imm8
-            HandleShift8(ip, *(ip + s_modRmInstLen[*ip] - 1));
-            m_register[Register::IP] += s_modRmInstLen[*ip] + 1;
-            break;
+    m_register[Register::IP] += inst.length;
+}
 
-        case 0xc1: // shift16 imm8
-            HandleShift16(ip, *(ip + s_modRmInstLen[*ip] - 1));
-            m_register[Register::IP] += s_modRmInstLen[*ip] + 1;
-            break;
+template<int Op, bool Mem>
+void Cpu::OpAluRegRm16(const DecodedInst& inst)
+{
+    uint16_t result = Alu16<Op>(*inst.reg.r16, Mem ? Load16(DecodedEa(inst)) : *inst.rm.r16);
 
-        case 0xc2: // ret imm16
-            m_register[Register::IP] = Pop16();
-            m_register[Register::SP] += Imm16(ip);
-            break;
+    if (Op != AluOp::Cmp)
+        *inst.reg.r16 = result;
 
-        case 0xc3: // ret
-            m_register[Register::IP] = Pop16();
-            break;
+    m_register[Register::IP] += inst.length;
+}
 
-        case 0xc4: // les r16, m16:m16
-            {
-                uint32_t segmentOffset = ModRmLoad32(ip);
+template<int Op, bool Mem>
+void Cpu::OpAluRegRm8(const DecodedInst& inst)
+{
+    uint8_t result = Alu8<Op>(*inst.reg.r8, Mem ? Load8(DecodedEa(inst)) : *inst.rm.r8);
 
-                *Reg16(*ip) = segmentOffset &  0xffff;
-                m_register[Register::ES] = segmentOffset >> 16;
-                m_register[Register::IP] += s_modRmInstLen[*ip];
-                break;
-            }
+    if (Op != AluOp::Cmp)
+        *inst.reg.r8 = result;
 
-        case 0xc5: // lds r16, m16:m16
-            {
-                uint32_t segmentOffset = ModRmLoad32(ip);
+    m_register[Register::IP] += inst.length;
+}
 
-                *Reg16(*ip) = segmentOffset &  0xffff;
-                m_register[Register::DS] = segmentOffset >> 16;
-                m_segmentBase = m_register[Register::DS] * 16;
+template<int Op, bool Mem>
+void Cpu::OpAluRmImm16(const DecodedInst& inst)
+{
+    if (Mem)
+    {
+        std::size_t ea     = DecodedEa(inst);
+        uint16_t    result = Alu16<Op>(Load16(ea), inst.imm);
 
-                m_register[Register::IP] += s_modRmInstLen[*ip];
-                break;
-            }
+        if (Op != AluOp::Cmp)
+            Store16(ea, result);
+    }
+    else
+    {
+        uint16_t result = Alu16<Op>(*inst.rm.r16, inst.imm);
 
-        case 0xc6:
-            HandleC6h(ip);
-            m_register[Register::IP] += s_modRmInstLen[*ip] + 1;
-            break;
+        if (Op != AluOp::Cmp)
+            *inst.rm.r16 = result;
+    }
 
-        case 0xc7:
-            HandleC7h(ip);
-            m_register[Register::IP] += s_modRmInstLen[*ip] + 2;
-            break;
+    m_register[Register::IP] += inst.length;
+}
 
-        case 0xc8: // enter
-            {
-                uint16_t allocSize = Imm16(ip);
-                uint16_t nesting = *(ip + 2) & 0x1f;
+template<int Op, bool Mem>
+void Cpu::OpAluRmImm8(const DecodedInst& inst)
+{
+    if (Mem)
+    {
+        std::size_t ea     = DecodedEa(inst);
+        uint8_t     result = Alu8<Op>(Load8(ea), inst.imm);
 
-                Push16(m_register[Register::BP]);
-                uint16_t frameTemp = m_register[Register::SP];
+        if (Op != AluOp::Cmp)
+            Store8(ea, result);
+    }
+    else
+    {
+        uint8_t result = Alu8<Op>(*inst.rm.r8, inst.imm);
 
-                if (nesting > 0)
-                {
-                    for(int n = 1; n < nesting; n++)
-                    {
-                        m_register[Register::BP] -= 2;
-                        Push16(m_register[Register::BP]);
-                    }
+        if (Op != AluOp::Cmp)
+            *inst.rm.r8 = result;
+    }
 
-                    Push16(frameTemp);
-                }
+    m_register[Register::IP] += inst.length;
+}
 
-                m_register[Register::BP] = frameTemp;
-                m_register[Register::SP] -= allocSize;
-                m_register[Register::IP] += 4;
-                break;
-            }
+template<int Op>
+void Cpu::OpAluAccImm16(const DecodedInst& inst)
+{
+    uint16_t result = Alu16<Op>(m_register[Register::AX], inst.imm);
 
-        case 0xc9: // leave
-            m_register[Register::SP] = m_register[Register::BP];
-            m_register[Register::BP] = Pop16();
-            m_register[Register::IP] += 1;
-            break;
+    if (Op != AluOp::Cmp)
+        m_register[Register::AX] = result;
 
-        case 0xca: // retf imm16
-            m_register[Register::IP] = Pop16();
-            m_register[Register::CS] = Pop16();
-            m_register[Register::SP] += Imm16(ip);
-            break;
+    m_register[Register::IP] += inst.length;
+}
 
-        case 0xcb: // retf
-            m_register[Register::IP] = Pop16();
-            m_register[Register::CS] = Pop16();
-            break;
+template<int Op>
+void Cpu::OpAluAccImm8(const DecodedInst& inst)
+{
+    uint8_t result = Alu8<Op>(m_register[Register::AX], inst.imm);
 
-        case 0xcc: // int 3
-            {
-                RecalcFlags();
-                Push16(m_register[Register::FLAG]);
-                Push16(m_register[Register::CS]);
-                Push16(m_register[Register::IP]);
+    if (Op != AluOp::Cmp)
+        m_register[Register::AX] = (m_register[Register::AX] & 0xff00) | result;
 
-                SetAF(0);
-                m_register[Register::FLAG] &= Flag::TF_mask;
-                m_register[Register::FLAG] &= Flag::IF_mask;
+    m_register[Register::IP] += inst.length;
+}
 
-                m_register[Register::CS] = Load16(3 * 4 + 2);
-                m_register[Register::IP] = Load16(3 * 4);
+template<bool Mem>
+void Cpu::OpTestRmReg16(const DecodedInst& inst)
+{
+    SetLogicFlags16((Mem ? Load16(DecodedEa(inst)) : *inst.rm.r16) & *inst.reg.r16);
+    m_register[Register::IP] += inst.length;
+}
 
-                if (m_register[Register::CS] == 0 && m_register[Register::IP] == 0)
-                {
-                    printf("Empty int vector\n");
-                    m_state |= State::InvalidOp;
-                }
-                break;
-            }
+template<bool Mem>
+void Cpu::OpTestRmReg8(const DecodedInst& inst)
+{
+    SetLogicFlags8((Mem ? Load8(DecodedEa(inst)) : *inst.rm.r8) & *inst.reg.r8);
+    m_register[Register::IP] += inst.length;
+}
 
-        case 0xcd: // int imm8
-            m_register[Register::IP] += 2;
-            onInterrupt(*ip);
-            break;
+template<bool Mem>
+void Cpu::OpXchgRmReg16(const DecodedInst& inst)
+{
+    if (Mem)
+    {
+        std::size_t ea  = DecodedEa(inst);
+        uint16_t    tmp = Load16(ea);
 
-//         case 0xce: // into
-//             break;
+        Store16(ea, *inst.reg.r16);
+        *inst.reg.r16 = tmp;
+    }
+    else
+    {
+        std::swap(*inst.rm.r16, *inst.reg.r16);
+    }
 
-        case 0xcf: // iret
-            m_register[Register::IP] = Pop16();
-            m_register[Register::CS] = Pop16();
-            m_register[Register::FLAG] = Pop16();
-            RestoreLazyFlags();
-            break;
+    m_register[Register::IP] += inst.length;
+}
 
-        case 0xd0: // shift r/m8, 1
-            HandleShift8(ip, 1);
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            break;
+template<bool Mem>
+void Cpu::OpXchgRmReg8(const DecodedInst& inst)
+{
+    if (Mem)
+    {
+        std::size_t ea  = DecodedEa(inst);
+        uint8_t     tmp = Load8(ea);
 
-        case 0xd1: // shift r/m16, 1
-            HandleShift16(ip, 1);
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            break;
+        Store8(ea, *inst.reg.r8);
+        *inst.reg.r8 = tmp;
+    }
+    else
+    {
+        std::swap(*inst.rm.r8, *inst.reg.r8);
+    }
 
-        case 0xd2: // shift r/m8, cl
-            HandleShift8(ip, m_register[Register::CX]);
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            break;
+    m_register[Register::IP] += inst.length;
+}
 
-        case 0xd3: // shift r/m16, cl
-            HandleShift16(ip, m_register[Register::CX]);
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            break;
+template<bool Mem>
+void Cpu::OpMovRmReg16(const DecodedInst& inst)
+{
+    if (Mem)
+        Store16(DecodedEa(inst), *inst.reg.r16);
+    else
+        *inst.rm.r16 = *inst.reg.r16;
 
-        case 0xd4: // aam
-            {
-                uint8_t op1 = m_register[Register::AX] & 0xff;
-                uint8_t op2 = *ip;
+    m_register[Register::IP] += inst.length;
+}
 
-                m_register[Register::AX] = ((op1 / op2) << 8) | (op1 % op2);
-                m_result = m_register[Register::AX] & 0xff;
-                m_auxbits = 0;
+template<bool Mem>
+void Cpu::OpMovRmReg8(const DecodedInst& inst)
+{
+    if (Mem)
+        Store8(DecodedEa(inst), *inst.reg.r8);
+    else
+        *inst.rm.r8 = *inst.reg.r8;
 
-                m_register[Register::IP] += 2;
-                break;
-            }
+    m_register[Register::IP] += inst.length;
+}
 
-//         case 0xd5: // aad
-//             break;
+template<bool Mem>
+void Cpu::OpMovRegRm16(const DecodedInst& inst)
+{
+    *inst.reg.r16 = Mem ? Load16(DecodedEa(inst)) : *inst.rm.r16;
+    m_register[Register::IP] += inst.length;
+}
 
-//         case 0xd6: // salc
-//             break;
+template<bool Mem>
+void Cpu::OpMovRegRm8(const DecodedInst& inst)
+{
+    *inst.reg.r8 = Mem ? Load8(DecodedEa(inst)) : *inst.rm.r8;
+    m_register[Register::IP] += inst.length;
+}
 
-        case 0xd7: // xlatb
-            {
-                uint8_t value =
-                    Load8(m_segmentBase + m_register[Register::BX] + (m_register[Register::AX] & 0xff));
+template<bool Mem>
+void Cpu::OpMovRmImm16(const DecodedInst& inst)
+{
+    if (Mem)
+        Store16(DecodedEa(inst), inst.imm);
+    else
+        *inst.rm.r16 = inst.imm;
 
-                m_register[Register::AX] = (m_register[Register::AX] & 0xff00) | value;
-                m_register[Register::IP] += 1;
-                break;
-            }
+    m_register[Register::IP] += inst.length;
+}
 
-//         case 0xd8: case 0xd9: case 0xda: case 0xdb:
-//         case 0xdc: case 0xdd: case 0xde: case 0xdf: // fpu
-//             break;
+template<bool Mem>
+void Cpu::OpMovRmImm8(const DecodedInst& inst)
+{
+    if (Mem)
+        Store8(DecodedEa(inst), inst.imm);
+    else
+        *inst.rm.r8 = inst.imm;
 
-        case 0xe0: // loopnz rel8
-            m_register[Register::CX] -= 1;
-            m_register[Register::IP] += 2;
-            if (m_register[Register::CX] != 0 && GetZF() == false)
-            {
-                m_register[Register::IP] += Disp8(ip);
-            }
-            break;
+    m_register[Register::IP] += inst.length;
+}
 
-        case 0xe1: // loopz rel8
-            m_register[Register::CX] -= 1;
-            m_register[Register::IP] += 2;
-            if (m_register[Register::CX] != 0 && GetZF() == true)
-            {
-                m_register[Register::IP] += Disp8(ip);
-            }
-            break;
+void Cpu::OpTestAccImm16(const DecodedInst& inst)
+{
+    SetLogicFlags16(m_register[Register::AX] & inst.imm);
+    m_register[Register::IP] += inst.length;
+}
 
-        case 0xe2: // loop rel8
-            m_register[Register::CX] -= 1;
-            m_register[Register::IP] += 2;
-            if (m_register[Register::CX] != 0)
-            {
-                m_register[Register::IP] += Disp8(ip);
-            }
-            break;
+void Cpu::OpTestAccImm8(const DecodedInst& inst)
+{
+    SetLogicFlags8(m_register[Register::AX] & inst.imm);
+    m_register[Register::IP] += inst.length;
+}
 
-        case 0xe3: // jcxz rel8
-            offset = Disp8(ip);
-            m_register[Register::IP] += 2;
-            if (m_register[Register::CX] == 0)
-                m_register[Register::IP] += offset;
-            break;
+void Cpu::OpMovAccMem16(const DecodedInst& inst)
+{
+    m_register[Register::AX] = Load16(DecodedEa(inst));
+    m_register[Register::IP] += inst.length;
+}
 
-        case 0xe4: // in al, imm8
-            m_register[Register::AX] =
-                (m_register[Register::AX] & 0xff00) | (PortRead(*ip, 1) & 0xff);
-            m_register[Register::IP] += 2;
-            break;
+void Cpu::OpMovAccMem8(const DecodedInst& inst)
+{
+    m_register[Register::AX] = (m_register[Register::AX] & 0xff00) | Load8(DecodedEa(inst));
+    m_register[Register::IP] += inst.length;
+}
 
-        case 0xe5: // in ax, imm8
-            m_register[Register::AX] = PortRead(*ip, 2);
-            m_register[Register::IP] += 2;
-            break;
+void Cpu::OpMovMemAcc16(const DecodedInst& inst)
+{
+    Store16(DecodedEa(inst), m_register[Register::AX]);
+    m_register[Register::IP] += inst.length;
+}
 
-        case 0xe6: // out imm8, al
-            PortWrite(*ip, 1, m_register[Register::AX] & 0x00ff);
-            m_register[Register::IP] += 2;
-            break;
+void Cpu::OpMovMemAcc8(const DecodedInst& inst)
+{
+    Store8(DecodedEa(inst), m_register[Register::AX] & 0xff);
+    m_register[Register::IP] += inst.length;
+}
 
-        case 0xe7: // out imm8, ax
-            PortWrite(*ip, 2, m_register[Register::AX]);
-            m_register[Register::IP] += 2;
-            break;
+void Cpu::OpMovRegImm16(const DecodedInst& inst)
+{
+    *inst.reg.r16 = inst.imm;
+    m_register[Register::IP] += inst.length;
+}
 
-        case 0xe8: // call rel16
-            offset = Disp16(ip);
-            m_register[Register::IP] += 3;
-            Push16(m_register[Register::IP]);
-            m_register[Register::IP] += offset;
-            break;
+void Cpu::OpMovRegImm8(const DecodedInst& inst)
+{
+    *inst.reg.r8 = inst.imm;
+    m_register[Register::IP] += inst.length;
+}
 
-        case 0xe9: // jmp rel16
-            offset = Disp16(ip);
-            m_register[Register::IP] += offset + 3;
-            break;
+void Cpu::OpLea(const DecodedInst& inst)
+{
+    *inst.reg.r16 = m_register[inst.base] + m_register[inst.index] + inst.disp;
+    m_register[Register::IP] += inst.length;
+}
 
-        case 0xea: // jmp far ptr16:16
-            m_register[Register::IP] += 5;
-            m_register[Register::CS] = Imm16(ip + 2);
-            m_register[Register::IP] = Imm16(ip);
-            break;
+void Cpu::OpIncReg16(const DecodedInst& inst)
+{
+    uint16_t op1    = *inst.reg.r16;
+    uint16_t result = ++*inst.reg.r16;
 
-        case 0xeb: // jmp rel8
-            offset = Disp8(ip);
-            m_register[Register::IP] += offset + 2;
-            break;
+    SetIncFlags16(op1, result);
 
-        case 0xec: // in al, dx
-            m_register[Register::AX] =
-                (m_register[Register::AX] & 0xff00) | (PortRead(m_register[Register::DX], 1) & 0xff);
-            m_register[Register::IP] += 1;
-            break;
+    m_register[Register::IP] += inst.length;
+}
 
-        case 0xed: // in ax, dx
-            m_register[Register::AX] = PortRead(m_register[Register::DX], 2);
-            m_register[Register::IP] += 1;
-            break;
+void Cpu::OpDecReg16(const DecodedInst& inst)
+{
+    uint16_t op1    = *inst.reg.r16;
+    uint16_t result = --*inst.reg.r16;
 
-        case 0xee: // out dx, al
-            PortWrite(m_register[Register::DX], 1, m_register[Register::AX] & 0x00ff);
-            m_register[Register::IP] += 1;
-            break;
+    SetDecFlags16(op1, result);
 
-        case 0xef: // out dx, ax
-            PortWrite(m_register[Register::DX], 2, m_register[Register::AX]);
-            m_register[Register::IP] += 1;
-            break;
+    m_register[Register::IP] += inst.length;
+}
 
-        case 0xf0: // prefix - lock
-            m_register[Register::IP] += 1;
-            // goto RestartDecoding;
-            break;
+void Cpu::OpPushReg16(const DecodedInst& inst)
+{
+    Push16(*inst.reg.r16);
+    m_register[Register::IP] += inst.length;
+}
 
-//         case 0xf1: // icebp / int 1
-//             break;
+void Cpu::OpPopReg16(const DecodedInst& inst)
+{
+    *inst.reg.r16 = Pop16();
+    m_register[Register::IP] += inst.length;
+}
 
-        case 0xf2:
-            HandleREPNE(*ip);
-            m_register[Register::IP] += 2;
-            break;
+void Cpu::OpPushImm(const DecodedInst& inst)
+{
+    Push16(inst.imm);
+    m_register[Register::IP] += inst.length;
+}
 
-        case 0xf3:
-            HandleREP(*ip);
-            m_register[Register::IP] += 2;
-            break;
+void Cpu::OpXchgAcc(const DecodedInst& inst)
+{
+    std::swap(m_register[Register::AX], *inst.reg.r16);
+    m_register[Register::IP] += inst.length;
+}
 
-        case 0xf4: // halt
-            m_register[Register::IP] += 1;
-            break;
+void Cpu::OpCbw(const DecodedInst& inst)
+{
+    m_register[Register::AX] = static_cast<char>(m_register[Register::AX]);
+    m_register[Register::IP] += inst.length;
+}
 
-        case 0xf5: // cmc
-            SetCF(!GetCF());
-            m_register[Register::IP] += 1;
-            break;
+void Cpu::OpCwd(const DecodedInst& inst)
+{
+    m_register[Register::DX] = static_cast<short>(m_register[Register::AX]) >> 15;
+    m_register[Register::IP] += inst.length;
+}
 
-        case 0xf6:
-            HandleF6h(ip);
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            break;
+void Cpu::OpSetFlag(const DecodedInst& inst)
+{
+    switch(inst.imm)
+    {
+        case 0xf5: SetCF(!GetCF());                               break; // cmc
+        case 0xf8: SetCF(false);                                  break; // clc
+        case 0xf9: SetCF(true);                                   break; // stc
+        case 0xfa: m_register[Register::FLAG] &= ~Flag::IF_mask;  break; // cli
+        case 0xfb: m_register[Register::FLAG] |= Flag::IF_mask;   break; // sti
+        case 0xfc: m_register[Register::FLAG] &= ~Flag::DF_mask;  break; // cld
+        case 0xfd: m_register[Register::FLAG] |= Flag::DF_mask;   break; // std
+    }
 
-        case 0xf7:
-            HandleF7h(ip);
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            break;
+    m_register[Register::IP] += inst.length;
+}
 
-        case 0xf8: // clc
-            SetCF(false);
-            m_register[Register::IP] += 1;
-            break;
+template<int Cond>
+void Cpu::OpJcc(const DecodedInst& inst)
+{
+    m_register[Register::IP] += inst.length;
 
-        case 0xf9: // stc
-            SetCF(true);
-            m_register[Register::IP] += 1;
-            break;
+    if (Condition<Cond>())
+        m_register[Register::IP] += inst.imm;
+}
 
-        case 0xfa: // cli
-            m_register[Register::FLAG] &= ~Flag::IF_mask;
-            m_register[Register::IP] += 1;
-            break;
+void Cpu::OpJmp(const DecodedInst& inst)
+{
+    m_register[Register::IP] += inst.length + inst.imm;
+}
 
-        case 0xfb: // sti
-            m_register[Register::FLAG] |= Flag::IF_mask;
-            m_register[Register::IP] += 1;
-            break;
+void Cpu::OpCall(const DecodedInst& inst)
+{
+    m_register[Register::IP] += inst.length;
+    Push16(m_register[Register::IP]);
+    m_register[Register::IP] += inst.imm;
+}
 
-        case 0xfc: // cld
-            m_register[Register::FLAG] &= ~Flag::DF_mask;
-            m_register[Register::IP] += 1;
-            break;
+void Cpu::OpRet(const DecodedInst& inst)
+{
+    m_register[Register::IP] = Pop16();
+    m_register[Register::SP] += inst.imm;
+}
 
-        case 0xfd: // std
-            m_register[Register::FLAG] |= Flag::DF_mask;
-            m_register[Register::IP] += 1;
-            break;
+void Cpu::OpLoop(const DecodedInst& inst)
+{
+    m_register[Register::CX] -= 1;
+    m_register[Register::IP] += inst.length;
 
-        case 0xfe: // inc / dec r/m8
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            HandleFEh(ip);
-            break;
+    if (m_register[Register::CX] != 0)
+        m_register[Register::IP] += inst.imm;
+}
 
-        case 0xff:
-            m_register[Register::IP] += s_modRmInstLen[*ip];
-            HandleFFh(ip);
-            break;
+void Cpu::OpLoopz(const DecodedInst& inst)
+{
+    m_register[Register::CX] -= 1;
+    m_register[Register::IP] += inst.length;
 
-        default:
-            m_state |= State::InvalidOp;
-            break;
-    }
+    if (m_register[Register::CX] != 0 && GetZF() == true)
+        m_register[Register::IP] += inst.imm;
+}
 
-    if (m_state)
-    {
-        if (m_state & State::InvalidOp)
-        {
-            printf("Invalid opcode 0x%02x\n", *(ip - 1));
-            return;
-        }
+void Cpu::OpLoopnz(const DecodedInst& inst)
+{
+    m_register[Register::CX] -= 1;
+    m_register[Register::IP] += inst.length;
 
-        if (m_state & State::Finished)
-        {
-            return;
-        }
+    if (m_register[Register::CX] != 0 && GetZF() == false)
+        m_register[Register::IP] += inst.imm;
+}
 
-        if (m_state & State::SegmentOverride)
-        {
-            m_segmentBase      = m_register[Register::DS] * 16;
-            m_stackSegmentBase = m_register[Register::SS] * 16;
-        }
+void Cpu::OpJcxz(const DecodedInst& inst)
+{
+    m_register[Register::IP] += inst.length;
 
-        m_state = 0;
-    }
+    if (m_register[Register::CX] == 0)
+        m_register[Register::IP] += inst.imm;
 }
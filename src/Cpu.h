@@ -2,18 +2,25 @@
 #define X86EMU_CPU
 
 #include <inttypes.h>
+#include <array>
 #include <memory>
+#include <utility>
+#include <vector>
 #include "CpuInterface.h"
 
 // forward declarations
+class Bus;
 class Memory;
+class Profiler;
+class SamplingProfiler;
+class Tracer;
 
 class Cpu : public CpuInterface
 {
 public:
     // constructor & destructor
     Cpu(Memory& memory);
-    ~Cpu();
+    virtual ~Cpu();
 
     // public methods
     void SetReg16(Register16 reg, uint16_t value) override;
@@ -32,14 +39,62 @@ public:
     void Interrupt(int num) override;
     bool HardwareInterrupt(int num) override;
 
+    // Devices reached directly instead of through the CpuInterface callbacks, nullptr
+    // (the default) keeps using the callbacks.
+    void SetBus(Bus* bus);
+
+    // Native (HLE) interrupt handlers - the vector is pointed to a stub trapping into
+    // 'handler', an int to it calls the handler directly for as long as the program has
+    // not hooked the vector. Vectors without a handler go to onInterrupt if set, or to
+    // the guest's interrupt vector table.
+    void SetInterruptHandler(uint8_t intNo, std::function<void ()> handler);
+
+    // Opcode / address profiling, nullptr (the default) turns it off. While a profiler
+    // is attached every instruction runs through the interpreter.
+    void SetProfiler(Profiler* profiler);
+
+    // Statistical profiling, nullptr (the default) turns it off. The sampler only reads
+    // what Run() publishes, execution itself takes the usual path.
+    void SetSamplingProfiler(SamplingProfiler* sampler);
+
+    // Binary execution trace, nullptr (the default) turns it off. Like the Profiler it
+    // makes every instruction run through the interpreter.
+    void SetTracer(Tracer* tracer);
+
+    // 386 mode - popf keeps the IOPL / NT bits, so programs detecting the cpu that way
+    // pick their 386 code paths. The 32-bit instructions decoded so far are always
+    // there, the 386 opcodes still missing stop the cpu as invalid.
+    void Set386Enabled(bool enabled);
+
+    void SetBlockCacheEnabled(bool enabled);
+    bool IsBlockCacheEnabled();
+    std::size_t GetInstructionCount();
+    std::size_t GetCycleCount();
+
+    // Idle state - set when Run() stopped early on hlt or on a loop polling the BIOS tick
+    // counter or the VGA input status, there is nothing useful to execute until the next
+    // timer interrupt or retrace edge.
+    void SetIdleDetectionEnabled(bool enabled);
+    bool IsIdle();
+
+    // Memory map - pages of 'linearAddr' .. 'linearAddr + size' are routed to the given
+    // handlers (with addresses relative to 'linearAddr'), or reported through onMemWatch.
+    // Regions with block handlers get whole REP MOVS / STOS runs at once.
+    void MapMemory(uint32_t linearAddr, uint32_t size, std::function<uint8_t (uint32_t addr)> onRead, std::function<void (uint32_t addr, uint8_t value)> onWrite);
+    void MapMemoryBlock(uint32_t linearAddr, std::function<void (uint32_t addr, const uint8_t* data, uint32_t count)> onWriteBlock, std::function<void (uint32_t addr, uint8_t value, uint32_t count)> onFillBlock);
+    void WatchMemory(uint32_t linearAddr, uint32_t size, bool enable);
+
     //void VgaPlaneMode(bool chain4, uint8_t planeMask) override;
 
-private:
+protected:
     enum State
     {
         InvalidOp       = 1,
         SegmentOverride = 2,
-        Finished        = 4
+        Finished        = 4,
+        Prefix          = 8,
+        Halted          = 16,
+        Idle            = 32
     };
 
     enum Register
@@ -59,7 +114,8 @@ private:
         DS = 0x0b,
         IP = 0x0c,
 
-        FLAG = 0x0d
+        FLAG = 0x0d,
+        ZERO = 0x0f     // always 0, ModRmEa::NoReg - an absent base / index register
     };
 
     struct Flag
@@ -117,9 +173,139 @@ private:
         };
     };
 
+    // operation whose flags have not been computed yet, m_auxbits is only valid with LazyOp::None
+    enum LazyOp
+    {
+        None = 0,
+        Logic,
+        Add16,
+        Add8,
+        Add32,
+        Sub16,
+        Sub8,
+        Sub32,
+        Inc16,     // inc / dec from here on, m_lazyOperand2 is the saved carry flag
+        Inc8,
+        Dec16,
+        Dec8,
+        Inc32,
+        Dec32
+    };
+
+    // predecoded instruction, executed by one of the Op*() handlers
+    struct DecodedInst;
+    typedef void (Cpu::*InstHandler)(const DecodedInst& inst);
+
+    union Operand
+    {
+        uint16_t* r16;
+        uint8_t*  r8;
+    };
+
+    struct DecodedInst
+    {
+        InstHandler handler;
+        Operand     reg;        // register selected by the reg field / opcode
+        Operand     rm;         // register selected by the r/m field (mod 11)
+        uint16_t    disp;       // effective address displacement
+        uint16_t    imm;        // immediate or relative branch offset
+        uint8_t     base;       // effective address = segment * 16 + (base + index + disp)
+        uint8_t     index;
+        uint8_t     segment;
+        uint8_t     length;
+        uint8_t     opcode;     // opcode byte following an optional segment override prefix
+        uint8_t     modRm;
+        uint8_t     cycles;     // 0 for fallback instructions, ExecuteInstruction() charges those
+    };
+
+    enum
+    {
+        BlockCacheSize       = 8192,
+        MaxBlockInstructions = 16,
+        MaxBlockBytes        = 96
+    };
+
+    // straight-line run of predecoded instructions starting at a linear address
+    struct DecodedBlock
+    {
+        uint32_t    linearAddr; // ~0 when empty
+        uint16_t    length;     // number of guest bytes decoded natively
+        uint16_t    count;
+        uint16_t    cycles;     // sum of the instructions' cycles
+        uint16_t    runCycles[MaxBlockInstructions + 1];    // of the first n instructions
+        uint32_t    hits;       // executions since decoding, used by JitCpu to find hot blocks
+        void*       native;     // JitCpu translation, nullptr until the block gets hot
+        uint8_t     code[MaxBlockBytes];
+        DecodedInst inst[MaxBlockInstructions];
+    };
+
+    enum AluOp
+    {
+        Add = 0,
+        Or  = 1,
+        Adc = 2,
+        Sbb = 3,
+        And = 4,
+        Sub = 5,
+        Xor = 6,
+        Cmp = 7
+    };
+
+    enum
+    {
+        PageShift = 12,
+        PageSize  = 1 << PageShift,
+        PageCount = 0x200000 >> PageShift   // room for segment + offset beyond 1 MB
+    };
+
+    // native interrupt stubs, f1 nn (trap to handler nn) + retf 2, at F000:E000
+    enum
+    {
+        HleStubSeg    = 0xf000,
+        HleStubOffset = 0xe000,
+        HleStubSize   = 8
+    };
+
+    // seg:offset of the stub of interrupt intNo, as it appears in the vector table
+    static constexpr uint32_t HleStubAddr(int intNo)
+    {
+        return (static_cast<uint32_t>(HleStubSeg) << 16) | (HleStubOffset + intNo * HleStubSize);
+    }
+
+    enum
+    {
+        TickCounterAddr = 0x46c,    // BIOS data area timer tick count, dword
+        InputStatusPort = 0x3da,    // VGA input status, retrace bits
+        PollLoopLength  = 32,       // max instructions between two polls of a wait loop
+        PollLoopCount   = 4         // polls of an unchanged value treated as idle
+    };
+
+    struct MemoryRegion
+    {
+        uint32_t                                           base;
+        std::function<uint8_t (uint32_t addr)>             onRead;
+        std::function<void (uint32_t addr, uint8_t value)> onWrite;
+        std::function<void (uint32_t addr, const uint8_t* data, uint32_t count)> onWriteBlock;
+        std::function<void (uint32_t addr, uint8_t value, uint32_t count)>       onFillBlock;
+    };
+
+    // cycles on top of the opcode table, charged by the instructions themselves
+    enum
+    {
+        MulCycles8  = 10,
+        MulCycles16 = 18,
+        DivCycles8  = 12,
+        DivCycles16 = 20
+    };
+
     static uint16_t s_modRmInstLen[256];
+    static const uint8_t s_opcodeCycles[2][256];
+    static const uint8_t s_repCycles[16];
+    static const uint8_t s_repIoCycles[4];
 
     uint16_t    m_register[16];
+    uint16_t    m_registerHigh[8];  // upper halves of eax .. edi, only 32-bit operations touch them
+    bool        m_386Enabled;
     uint8_t*    m_memory;
     std::size_t m_segmentBase;
     std::size_t m_stackSegmentBase;
@@ -127,11 +313,53 @@ private:
 
     int         m_result;
     int         m_auxbits;
+    int         m_lazyOp;
+    uint32_t    m_lazyOperand1;
+    uint32_t    m_lazyOperand2;     // carry flag before the operation for inc / dec
 
     std::size_t m_disasmCnt;
     std::size_t m_instructionCnt;
+    std::size_t m_cycleCnt;
     Memory&     m_rMemory;
 
+    bool                      m_blockCacheEnabled;
+    std::vector<DecodedBlock> m_blockCache;
+
+    // guest code of the running block, a store into it ends the block after the storing
+    // instruction - start and length take in stores of up to 4 bytes reaching into it
+    uint32_t    m_codeStart;
+    uint32_t    m_codeLength;       // 0 outside of blocks
+    bool        m_codeWritten;
+
+    bool        m_halted;
+    bool        m_idle;
+    bool        m_idleDetectionEnabled;
+    uint16_t    m_pollRegs[Register::IP + 1];
+    uint16_t    m_pollRegsHigh[8];
+    uint32_t    m_pollValue;
+    std::size_t m_pollCnt;
+    int         m_pollCount;
+    bool        m_pollArmed;        // stores go through PageStore*() to be seen by DetectPollLoop()
+    bool        m_pollStored;       // a store since the last poll
+
+    // page map - host address of a directly mapped page is base + linearAddr,
+    // nullptr sends the access to the page's memory region or watch hook
+    uint8_t*                  m_readMap[PageCount];
+    uint8_t*                  m_writeMap[PageCount];
+    int                       m_pageRegion[PageCount];
+    bool                      m_pageWatched[PageCount];
+    std::vector<MemoryRegion> m_regions;
+    int                       m_vgaRegion;
+
+    Bus*        m_bus;
+    Profiler*   m_profiler;
+
+    SamplingProfiler* m_sampler;
+    Tracer*           m_tracer;
+
+    std::function<void ()> m_interruptHandler[256];
+
+    void      CallInterruptHandler(uint8_t intNo);
     uint32_t  PortRead(uint16_t port, int size);
     void      PortWrite(uint16_t port, int size, uint32_t value);
 
@@ -142,15 +370,38 @@ private:
     uint16_t  Disp16(uint8_t* ip);
     int8_t    Disp8(uint8_t* ip);
     uint16_t  Imm16(uint8_t* ip);
+    uint32_t  Imm32(uint8_t* ip);
+
+    uint32_t  GetRegister32(int reg);
+    void      SetRegister32(int reg, uint32_t value);
 
     uint32_t  Load32(std::size_t linearAddr);
     uint16_t  Load16(std::size_t linearAddr);
     uint8_t   Load8(std::size_t linearAddr);
+    void      Store32(std::size_t linearAddr, uint32_t value);
     void      Store16(std::size_t linearAddr, uint16_t value);
     void      Store8(std::size_t linearAddr, uint8_t value);
 
+    uint16_t  PageLoad16(std::size_t linearAddr);
+    uint8_t   PageLoad8(std::size_t linearAddr);
+    void      PageStore16(std::size_t linearAddr, uint16_t value);
+    void      PageStore8(std::size_t linearAddr, uint8_t value);
+    void      UpdatePage(std::size_t page);
+    uint8_t   RegionRead(int region, uint32_t addr);
+    void      RegionWrite(int region, uint32_t addr, uint8_t value);
+    void      DetectPollLoop(uint32_t value);
+    void      ArmPollStores(bool armed);
+
+    // out of line versions of the memory accessors, for code outside of Cpu.cpp
+    uint16_t  ReadMem16(std::size_t linearAddr);
+    uint8_t   ReadMem8(std::size_t linearAddr);
+    void      WriteMem16(std::size_t linearAddr, uint16_t value);
+    void      WriteMem8(std::size_t linearAddr, uint8_t value);
+
     void      Push16(uint16_t value);
     uint16_t  Pop16();
+    void      Push32(uint32_t value);
+    uint32_t  Pop32();
 
     bool GetCF();
     bool GetPF();
@@ -173,16 +424,32 @@ private:
     void SetAddFlags8(uint8_t op1, uint8_t op2, uint8_t result);
     void SetLogicFlags16(uint16_t result);
     void SetLogicFlags8(uint8_t result);
-
+    void SetIncFlags16(uint16_t op1, uint16_t result);
+    void SetIncFlags8(uint8_t op1, uint8_t result);
+    void SetDecFlags16(uint16_t op1, uint16_t result);
+    void SetDecFlags8(uint8_t op1, uint8_t result);
+    void SetSubFlags32(uint32_t op1, uint32_t op2, uint32_t result);
+    void SetAddFlags32(uint32_t op1, uint32_t op2, uint32_t result);
+    void SetLogicFlags32(uint32_t result);
+    void SetIncFlags32(uint32_t op1, uint32_t result);
+    void SetDecFlags32(uint32_t op1, uint32_t result);
+
+    void ResolveFlags();
+    void ResolveLazyFlags();
     void RecalcFlags();
     void RestoreLazyFlags();
 
+    uint16_t    ModRmOffset(uint8_t *ip);
+    std::size_t ModRmAddr(uint8_t *ip);
+
     void      ModRmLoadEa(uint8_t *ip);
 
+    uint32_t  ModRmLoadFar(uint8_t *ip);
     uint32_t  ModRmLoad32(uint8_t *ip);
     uint16_t  ModRmLoad16(uint8_t *ip);
     uint8_t   ModRmLoad8(uint8_t *ip);
 
+    void      ModRmStore32(uint8_t *ip, uint32_t value);
     void      ModRmStore16(uint8_t *ip, uint16_t value);
     void      ModRmStore8(uint8_t *ip, uint8_t value);
 
@@ -197,6 +464,16 @@ private:
 
     void HandleREPNE(uint8_t opcode);
     void HandleREP(uint8_t opcode);
+    int  HandleREPSized(uint8_t* ip, bool repe, bool operand32);
+    int  RepCycles(uint8_t opcode);
+    void RepMovs(int size);
+    void RepStos(uint32_t value, int size);
+    int  StringRun(uint8_t* const* map, std::size_t base, uint16_t offset, int size, bool down, int count);
+    int  RegionRun(int region, std::size_t base, uint16_t offset, int size, bool down, int count);
+    template<typename PageCheck>
+    int  PageRun(std::size_t base, uint16_t offset, int size, bool down, int count, PageCheck pageCheck);
+    int  BlockRegion(std::size_t linearAddr);
+    bool MoveRun(std::size_t src, std::size_t dst, int size, bool down, int count);
     void Handle8xCommon(uint8_t* ip, uint16_t op2);
     void Handle80h(uint8_t* ip);
     void Handle81h(uint8_t* ip);
@@ -211,7 +488,99 @@ private:
     void HandleShift16(uint8_t* ip, uint8_t shift);
     void HandleShift8(uint8_t* ip, uint8_t shift);
 
+    // 386 instructions, 0x66 operand size prefix
+    bool AddressSize32(uint8_t* ip);
+    void HandleOperand32(uint8_t* ip);
+    void Handle0Fh32(uint8_t* ip);
+    void HandleF7h32(uint8_t* ip);
+    void HandleShift32(uint8_t* ip, uint8_t shift);
+    void StringOp32(uint8_t opcode);
+    uint32_t Alu32(int op, uint32_t op1, uint32_t op2);
+
+    template<int Opcode> void ExecuteOpcode(uint8_t* ip);
     void ExecuteInstruction();
+
+#ifdef X86EMU_THREADED_DISPATCH
+    // threaded dispatch - every opcode handler fetches the next opcode and jumps
+    // straight to its handler, until the cycle count reaches the chain limit
+    typedef void (Cpu::*OpcodeHandler)(uint8_t* ip);
+
+    enum
+    {
+        MaxThreadedChain = 512     // cycles, at least 2 per instruction keeps the chain within 256 handlers
+    };
+
+    std::size_t m_threadedLimit;
+
+    template<int Opcode> void ThreadedOpcode(uint8_t* ip);
+
+    template<std::size_t... Opcodes>
+    static constexpr std::array<OpcodeHandler, 256> MakeThreadedTable(std::index_sequence<Opcodes...>)
+    {
+        return {{ &Cpu::ThreadedOpcode<Opcodes>... }};
+    }
+
+    static const std::array<OpcodeHandler, 256> s_threadedTable;
+#endif
+
+    // block cache
+    DecodedBlock& FetchBlock();
+    void ExecuteBlock(DecodedBlock& block, std::size_t cycleLimit);
+    void WatchCode(const DecodedBlock& block);
+    void DecodeBlock(DecodedBlock& block, uint32_t linearAddr);
+    bool DecodeInstruction(uint8_t* ip, DecodedInst& inst);
+    int  DecodeModRm(uint8_t* ip, int segment, bool wide, DecodedInst& inst);
+
+    std::size_t DecodedEa(const DecodedInst& inst);
+    template<int Cond> bool Condition();
+    template<int Op> uint16_t Alu16(uint16_t op1, uint16_t op2);
+    template<int Op> uint8_t  Alu8(uint8_t op1, uint8_t op2);
+
+    void OpFallback(const DecodedInst& inst);
+    template<int Op, bool Mem> void OpAluRmReg16(const DecodedInst& inst);
+    template<int Op, bool Mem> void OpAluRmReg8(const DecodedInst& inst);
+    template<int Op, bool Mem> void OpAluRegRm16(const DecodedInst& inst);
+    template<int Op, bool Mem> void OpAluRegRm8(const DecodedInst& inst);
+    template<int Op, bool Mem> void OpAluRmImm16(const DecodedInst& inst);
+    template<int Op, bool Mem> void OpAluRmImm8(const DecodedInst& inst);
+    template<int Op> void OpAluAccImm16(const DecodedInst& inst);
+    template<int Op> void OpAluAccImm8(const DecodedInst& inst);
+    template<bool Mem> void OpTestRmReg16(const DecodedInst& inst);
+    template<bool Mem> void OpTestRmReg8(const DecodedInst& inst);
+    template<bool Mem> void OpXchgRmReg16(const DecodedInst& inst);
+    template<bool Mem> void OpXchgRmReg8(const DecodedInst& inst);
+    template<bool Mem> void OpMovRmReg16(const DecodedInst& inst);
+    template<bool Mem> void OpMovRmReg8(const DecodedInst& inst);
+    template<bool Mem> void OpMovRegRm16(const DecodedInst& inst);
+    template<bool Mem> void OpMovRegRm8(const DecodedInst& inst);
+    template<bool Mem> void OpMovRmImm16(const DecodedInst& inst);
+    template<bool Mem> void OpMovRmImm8(const DecodedInst& inst);
+    void OpTestAccImm16(const DecodedInst& inst);
+    void OpTestAccImm8(const DecodedInst& inst);
+    void OpMovAccMem16(const DecodedInst& inst);
+    void OpMovAccMem8(const DecodedInst& inst);
+    void OpMovMemAcc16(const DecodedInst& inst);
+    void OpMovMemAcc8(const DecodedInst& inst);
+    void OpMovRegImm16(const DecodedInst& inst);
+    void OpMovRegImm8(const DecodedInst& inst);
+    void OpLea(const DecodedInst& inst);
+    void OpIncReg16(const DecodedInst& inst);
+    void OpDecReg16(const DecodedInst& inst);
+    void OpPushReg16(const DecodedInst& inst);
+    void OpPopReg16(const DecodedInst& inst);
+    void OpPushImm(const DecodedInst& inst);
+    void OpXchgAcc(const DecodedInst& inst);
+    void OpCbw(const DecodedInst& inst);
+    void OpCwd(const DecodedInst& inst);
+    void OpSetFlag(const DecodedInst& inst);
+    template<int Cond> void OpJcc(const DecodedInst& inst);
+    void OpJmp(const DecodedInst& inst);
+    void OpCall(const DecodedInst& inst);
+    void OpRet(const DecodedInst& inst);
+    void OpLoop(const DecodedInst& inst);
+    void OpLoopz(const DecodedInst& inst);
+    void OpLoopnz(const DecodedInst& inst);
+    void OpJcxz(const DecodedInst& inst);
 };
 
 #endif /* X86EMU_CPU */
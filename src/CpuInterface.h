@@ -46,7 +46,10 @@ public:
     std::function<void     (uint16_t port, int size, uint32_t value)> onPortWrite;
     std::function<uint8_t  (uint32_t addr)>                           onVgaMemRead;
     std::function<void     (uint32_t addr, uint8_t value)>            onVgaMemWrite;
+    std::function<void     (uint32_t addr, const uint8_t* data, uint32_t count)> onVgaMemWriteBlock;
+    std::function<void     (uint32_t addr, uint8_t value, uint32_t count)>       onVgaMemFillBlock;
     std::function<void     (uint32_t cycles)>                         onAdvanceTime;
+    std::function<void     (uint32_t addr, int size, uint32_t value, bool write)> onMemWatch;
 };
 
 #endif /* X86EMU_CPU_INTERFACE */
@@ -1,6 +1,7 @@
 #include "Disasm.h"
 #include "CpuInterface.h"
 #include "Memory.h"
+#include "ModRm.h"
 
 const char* Disasm::s_regName16[] = { "ax", "cx", "dx", "bx", "sp", "bp", "si", "di" };
 const char* Disasm::s_regName8l[] = { "al", "cl", "dl", "bl" };
@@ -148,110 +149,40 @@ inline std::string Disasm::ModRmSReg(uint8_t *ip)
     return s_sregName[(*ip >> 3) & 0x07];
 }
 
-std::string Disasm::ModRm16(uint8_t *ip)
+std::string Disasm::ModRmMem(uint8_t *ip)
 {
-    std::string op;
-    uint8_t     modRm = *ip++;
-    int8_t*     disp8  = reinterpret_cast<int8_t *>(ip);
-    uint16_t*   disp16 = reinterpret_cast<uint16_t *>(ip);
+    const ModRmEa& ea   = ModRmEa::s_table[*ip];
+    uint16_t       disp = ModRmDisp(ea, ip);
+    std::string    op;
 
-    switch(((modRm >> 3) & 0x18) + (modRm & 0x07))
-    {
-        // mod 00
-        case 0:  op = "word ptr [bx + si]";                break;
-        case 1:  op = "word ptr [bx + di]";                break;
-        case 2:  op = "word ptr [bp + si]";                break;
-        case 3:  op = "word ptr [bp + di]";                break;
-        case 4:  op = "word ptr [si]";                     break;
-        case 5:  op = "word ptr [di]";                     break;
-        case 6:  op = "word ptr [" + Hex16(*disp16) + "]"; break;
-        case 7:  op = "word ptr [bx]";                     break;
-
-        // mod 01
-        case 8:  op = "word ptr [bx + si " + Dec8(*disp8) + "]"; break;
-        case 9:  op = "word ptr [bx + di " + Dec8(*disp8) + "]"; break;
-        case 10: op = "word ptr [bp + si " + Dec8(*disp8) + "]"; break;
-        case 11: op = "word ptr [bp + di " + Dec8(*disp8) + "]"; break;
-        case 12: op = "word ptr [si "      + Dec8(*disp8) + "]"; break;
-        case 13: op = "word ptr [si "      + Dec8(*disp8) + "]"; break;
-        case 14: op = "word ptr [bp "      + Dec8(*disp8) + "]"; break;
-        case 15: op = "word ptr [bx "      + Dec8(*disp8) + "]"; break;
-
-        // mod 10
-        case 16: op = "word ptr [bx + si + " + Hex16(*disp16) + "]"; break;
-        case 17: op = "word ptr [bx + di + " + Hex16(*disp16) + "]"; break;
-        case 18: op = "word ptr [bp + si + " + Hex16(*disp16) + "]"; break;
-        case 19: op = "word ptr [bp + di + " + Hex16(*disp16) + "]"; break;
-        case 20: op = "word ptr [si + "      + Hex16(*disp16) + "]"; break;
-        case 21: op = "word ptr [si + "      + Hex16(*disp16) + "]"; break;
-        case 22: op = "word ptr [bp + "      + Hex16(*disp16) + "]"; break;
-        case 23: op = "word ptr [bx + "      + Hex16(*disp16) + "]"; break;
-
-        // mod 11
-        case 24: op = "ax"; break;
-        case 25: op = "cx"; break;
-        case 26: op = "dx"; break;
-        case 27: op = "bx"; break;
-        case 28: op = "sp"; break;
-        case 29: op = "bp"; break;
-        case 30: op = "si"; break;
-        case 31: op = "di"; break;
-    }
+    if (ea.base != ModRmEa::NoReg)
+        op = s_regName16[ea.base];
 
-    return op;
+    if (ea.index != ModRmEa::NoReg)
+        op += (op.empty() ? "" : " + ") + std::string(s_regName16[ea.index]);
+
+    if (ea.dispSize == 1)
+        op += " " + Dec8(disp);
+    else if (ea.dispSize == 2)
+        op += (op.empty() ? "" : " + ") + Hex16(disp);
+
+    return "[" + op + "]";
 }
 
-std::string Disasm::ModRm8(uint8_t *ip)
+std::string Disasm::ModRm16(uint8_t *ip)
 {
-    std::string op;
-    uint8_t     modRm = *ip++;
-    int8_t*     disp8  = reinterpret_cast<int8_t *>(ip);
-    uint16_t*   disp16 = reinterpret_cast<uint16_t *>(ip);
+    if (*ip >= 0xc0)
+        return s_regName16[*ip & 0x07];
 
-    switch(((modRm >> 3) & 0x18) + (modRm & 0x07))
-    {
-        // mod 00
-        case 0:  op = "byte ptr [bx + si]";                break;
-        case 1:  op = "byte ptr [bx + di]";                break;
-        case 2:  op = "byte ptr [bp + si]";                break;
-        case 3:  op = "byte ptr [bp + di]";                break;
-        case 4:  op = "byte ptr [si]";                     break;
-        case 5:  op = "byte ptr [di]";                     break;
-        case 6:  op = "byte ptr [" + Hex16(*disp16) + "]"; break;
-        case 7:  op = "byte ptr [bx]";                     break;
-
-        // mod 01
-        case 8:  op = "byte ptr [bx + si " + Dec8(*disp8) + "]"; break;
-        case 9:  op = "byte ptr [bx + di " + Dec8(*disp8) + "]"; break;
-        case 10: op = "byte ptr [bp + si " + Dec8(*disp8) + "]"; break;
-        case 11: op = "byte ptr [bp + di " + Dec8(*disp8) + "]"; break;
-        case 12: op = "byte ptr [si "      + Dec8(*disp8) + "]"; break;
-        case 13: op = "byte ptr [si "      + Dec8(*disp8) + "]"; break;
-        case 14: op = "byte ptr [bp "      + Dec8(*disp8) + "]"; break;
-        case 15: op = "byte ptr [bx "      + Dec8(*disp8) + "]"; break;
-
-        // mod 10
-        case 16: op = "byte ptr [bx + si + " + Hex16(*disp16) + "]"; break;
-        case 17: op = "byte ptr [bx + di + " + Hex16(*disp16) + "]"; break;
-        case 18: op = "byte ptr [bp + si + " + Hex16(*disp16) + "]"; break;
-        case 19: op = "byte ptr [bp + di + " + Hex16(*disp16) + "]"; break;
-        case 20: op = "byte ptr [si + "      + Hex16(*disp16) + "]"; break;
-        case 21: op = "byte ptr [si + "      + Hex16(*disp16) + "]"; break;
-        case 22: op = "byte ptr [bp + "      + Hex16(*disp16) + "]"; break;
-        case 23: op = "byte ptr [bx + "      + Hex16(*disp16) + "]"; break;
-
-        // mod 11
-        case 24: op = "al"; break;
-        case 25: op = "cl"; break;
-        case 26: op = "dl"; break;
-        case 27: op = "bl"; break;
-        case 28: op = "ah"; break;
-        case 29: op = "ch"; break;
-        case 30: op = "dh"; break;
-        case 31: op = "bh"; break;
-    }
+    return "word ptr " + ModRmMem(ip);
+}
+
+std::string Disasm::ModRm8(uint8_t *ip)
+{
+    if (*ip >= 0xc0)
+        return s_regName8[*ip & 0x07];
 
-    return op;
+    return "byte ptr " + ModRmMem(ip);
 }
 
 std::string Disasm::Handle80h(uint8_t* ip)
@@ -485,11 +416,14 @@ std::string Disasm::HandleFFh(uint8_t* ip)
 }
 
 // public methods
+// instruction at the cpu's cs:ip
 std::string Disasm::Process()
 {
-    uint16_t segment = m_cpu.GetReg16(CpuInterface::CS);
-    uint16_t offset  = m_cpu.GetReg16(CpuInterface::IP);
+    return Process(m_cpu.GetReg16(CpuInterface::CS), m_cpu.GetReg16(CpuInterface::IP));
+}
 
+std::string Disasm::Process(uint16_t segment, uint16_t offset)
+{
     uint8_t* ip = m_memory + segment * 16 + offset;
     uint8_t  opcode = *ip++;
     int      length = 0;
@@ -837,6 +771,16 @@ std::string Disasm::Process()
             length = 1;
             break;
 
+        case 0x66: // prefix - operand size
+            instr  = "o32";
+            length = 1;
+            break;
+
+        case 0x67: // prefix - address size
+            instr  = "a32";
+            length = 1;
+            break;
+
         case 0x68: // push imm16
             instr = "push " + Imm16(ip);
             length = 3;
@@ -1353,6 +1297,11 @@ std::string Disasm::Process()
             length = 1;
             break;
 
+        case 0xf1: // native interrupt trap
+            instr = "hle " + Imm8(ip);
+            length = 2;
+            break;
+
         case 0xf2:
             instr = "repne ";
             switch(*ip)
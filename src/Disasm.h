@@ -17,6 +17,7 @@ public:
 
     // public methods
     std::string Process();
+    std::string Process(uint16_t segment, uint16_t offset);
 
 private:
     static const char* s_regName16[];
@@ -51,6 +52,7 @@ private:
     std::string ModRmReg16(uint8_t* ip);
     std::string ModRmReg8(uint8_t* ip);
     std::string ModRmSReg(uint8_t* ip);
+    std::string ModRmMem(uint8_t* ip);
     std::string ModRm16(uint8_t* ip);
     std::string ModRm8(uint8_t* ip);
 
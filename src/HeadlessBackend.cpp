@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <unistd.h>
+#include "HeadlessBackend.h"
+#include "Vga.h"
+
+// constructor & destructor
+HeadlessBackend::HeadlessBackend(Vga* vga, int64_t runTime, int64_t frameInterval, bool realTime)
+    : m_running       (false)
+    , m_vga           (vga)
+    , m_runTime       (runTime)
+    , m_frameInterval (frameInterval)
+    , m_realTime      (realTime)
+    , m_time          (0)
+    , m_nextFrame     (frameInterval)
+    , m_frameCnt      (0)
+{
+}
+
+HeadlessBackend::~HeadlessBackend()
+{
+    m_vga = nullptr;
+}
+
+// public methods
+bool HeadlessBackend::Initialize()
+{
+    printf("HeadlessBackend::Initialize() %s, run time %" PRId64 " ms, frame interval %" PRId64 " ms\n",
+        m_realTime ? "real time" : "unthrottled", m_runTime / 1000, m_frameInterval / 1000);
+
+    // set here rather than in MainLoop(), the emulator may stop before the loop starts
+    m_running = true;
+
+    return true;
+}
+
+void HeadlessBackend::MainLoop()
+{
+    while(m_running)
+    {
+        ::usleep(10 * 1000);
+    }
+}
+
+void HeadlessBackend::StopMainLoop()
+{
+    m_running = false;
+}
+
+bool HeadlessBackend::IsRealTime()
+{
+    return m_realTime;
+}
+
+void HeadlessBackend::Advance(int64_t usec)
+{
+    m_time += usec;
+
+    while(m_frameInterval > 0 && m_time >= m_nextFrame)
+    {
+        DumpFrame();
+        m_nextFrame += m_frameInterval;
+    }
+
+    if (m_runTime > 0 && m_time >= m_runTime && m_running)
+    {
+        printf("HeadlessBackend::Advance() %" PRId64 " ms of emulated time done\n", m_time / 1000);
+        StopMainLoop();
+    }
+}
+
+// private methods
+void HeadlessBackend::DumpFrame()
+{
+    char fname[32];
+
+    m_frame.resize(FrameWidth * FrameHeight);
+    m_vga->DrawScreen(reinterpret_cast<uint8_t *>(m_frame.data()), FrameWidth, FrameHeight, FrameWidth * 4);
+
+    snprintf(fname, sizeof(fname), "frame%05d.ppm", m_frameCnt++);
+    FILE* file = ::fopen(fname, "wb");
+
+    if (file == nullptr)
+        return;
+
+    // xrgb pixels, as on the SDL window surface
+    std::vector<uint8_t> rgb;
+
+    rgb.reserve(FrameWidth * FrameHeight * 3);
+
+    for(uint32_t pixel : m_frame)
+    {
+        rgb.push_back(pixel >> 16);
+        rgb.push_back(pixel >> 8);
+        rgb.push_back(pixel);
+    }
+
+    fprintf(file, "P6\n%d %d\n%d\n", FrameWidth, FrameHeight, 255);
+    fwrite(rgb.data(), 1, rgb.size(), file);
+    fclose(file);
+}
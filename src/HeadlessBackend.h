@@ -0,0 +1,52 @@
+#ifndef X86EMU_HEADLESS_BACKEND
+#define X86EMU_HEADLESS_BACKEND
+
+#include <inttypes.h>
+#include <atomic>
+#include <vector>
+#include "Backend.h"
+
+class Vga;
+
+// Backend without a display, for batch runs and benchmarks. The emulator runs as fast
+// as the host allows unless realTime is set; it stops after runTime of emulated time
+// (0 - when the program exits) and every frameInterval (0 - never) the screen is
+// written to frameNNNNN.ppm. Both times are in microseconds.
+class HeadlessBackend : public Backend
+{
+public:
+    // constructor & destructor
+    HeadlessBackend(Vga* vga, int64_t runTime, int64_t frameInterval, bool realTime);
+    ~HeadlessBackend();
+
+    // public methods
+    bool Initialize() override;
+    void MainLoop() override;
+    void StopMainLoop() override;
+
+    bool IsRealTime() override;
+    void Advance(int64_t usec) override;
+
+private:
+    enum
+    {
+        FrameWidth  = 640,
+        FrameHeight = 480
+    };
+
+    std::atomic<bool>     m_running;
+    Vga*                  m_vga;
+    int64_t               m_runTime;
+    int64_t               m_frameInterval;
+    bool                  m_realTime;
+
+    int64_t               m_time;           // emulated time so far, us
+    int64_t               m_nextFrame;
+    int                   m_frameCnt;
+    std::vector<uint32_t> m_frame;
+
+    // private methods
+    void DumpFrame();
+};
+
+#endif /* X86EMU_HEADLESS_BACKEND */
@@ -0,0 +1,137 @@
+#include "InputLog.h"
+#include "Keyboard.h"
+
+// constructor & destructor
+InputLog::InputLog(Keyboard& keyboard)
+    : m_keyboard   (keyboard)
+    , m_mode       (Mode::Live)
+    , m_file       (nullptr)
+    , m_time       (0)
+    , m_lastTime   (UINT64_MAX)
+    , m_lastCycles (0)
+    , m_repeat     (0)
+    , m_nextEvent  (0)
+    , m_desync     (false)
+{
+}
+
+InputLog::~InputLog()
+{
+    if (m_file)
+        fclose(m_file);
+}
+
+// public methods
+bool InputLog::StartRecording(const char* path)
+{
+    m_file = fopen(path, "w");
+
+    if (m_file == nullptr)
+    {
+        printf("InputLog::StartRecording() unable to create %s\n", path);
+        return false;
+    }
+
+    m_mode = Mode::Record;
+    return true;
+}
+
+bool InputLog::StartReplay(const char* path)
+{
+    FILE* file = fopen(path, "r");
+
+    if (file == nullptr)
+    {
+        printf("InputLog::StartReplay() unable to open %s\n", path);
+        return false;
+    }
+
+    uint64_t time, cycles;
+    int      repeat;
+    unsigned scancode;
+
+    while(fscanf(file, "%" SCNu64 " %" SCNu64 " %d %x", &time, &cycles, &repeat, &scancode) == 4)
+    {
+        m_events.push_back({ time, cycles, repeat, static_cast<uint8_t>(scancode) });
+    }
+
+    fclose(file);
+    printf("InputLog::StartReplay() %zu keys from %s\n", m_events.size(), path);
+
+    m_mode = Mode::Replay;
+    return true;
+}
+
+void InputLog::AddKey(uint8_t scancode)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    if (m_mode != Mode::Replay)
+    {
+        m_pending.push(scancode);
+    }
+}
+
+void InputLog::Process(int64_t nsec)
+{
+    m_time += nsec;
+}
+
+void InputLog::Deliver(uint64_t cycles)
+{
+    m_repeat     = (m_time == m_lastTime && cycles == m_lastCycles) ? m_repeat + 1 : 0;
+    m_lastTime   = m_time;
+    m_lastCycles = cycles;
+
+    if (m_mode == Mode::Replay)
+    {
+        // everything due up to this point, (time, cycles, repeat) only ever grows
+        while(m_nextEvent < m_events.size() && IsDue(m_events[m_nextEvent], cycles))
+        {
+            const Event& event = m_events[m_nextEvent++];
+
+            if (event.time != m_time || event.cycles != cycles || event.repeat != m_repeat)
+            {
+                if (!m_desync)
+                {
+                    printf("InputLog::Deliver() replay out of sync, key %02x due at %" PRIu64 " ns / %" PRIu64 " cycles, now %" PRIu64 " ns / %" PRIu64 " cycles\n",
+                        event.scancode, event.time, event.cycles, m_time, cycles);
+                }
+
+                m_desync = true;
+            }
+
+            m_keyboard.AddKey(event.scancode);
+        }
+
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    while(!m_pending.empty())
+    {
+        uint8_t scancode = m_pending.front();
+
+        m_pending.pop();
+        m_keyboard.AddKey(scancode);
+
+        if (m_mode == Mode::Record)
+        {
+            fprintf(m_file, "%" PRIu64 " %" PRIu64 " %d %02x\n", m_time, cycles, m_repeat, scancode);
+            fflush(m_file);
+        }
+    }
+}
+
+// private methods
+bool InputLog::IsDue(const Event& event, uint64_t cycles)
+{
+    if (event.time != m_time)
+        return event.time < m_time;
+
+    if (event.cycles != cycles)
+        return event.cycles < cycles;
+
+    return event.repeat <= m_repeat;
+}
@@ -0,0 +1,75 @@
+#ifndef X86EMU_INPUT_LOG
+#define X86EMU_INPUT_LOG
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+class Keyboard;
+
+// Hands the keys of the backend to the Keyboard on the emulator thread, at a point of
+// emulated time rather than whenever they arrive - optionally logging each one with
+// that time, or replaying a log instead of the live keys. A replayed run sees every
+// key at the same emulated time and cycle count as the recorded one, so it behaves
+// the same.
+//
+// Log format, one key per line: <emulated time, ns> <cpu cycle count> <repeat>
+// <scancode, hex>, where repeat counts the earlier delivery points at the same time and
+// cycle count - idle steps and interrupts may pass without either moving on.
+class InputLog
+{
+public:
+    // constructor & destructor
+    InputLog(Keyboard& keyboard);
+    ~InputLog();
+
+    // public methods
+    bool StartRecording(const char* path);
+    bool StartReplay(const char* path);
+
+    // main thread, a key from the backend; ignored while replaying
+    void AddKey(uint8_t scancode);
+
+    // emulator thread - time passing like for the other devices, and the keys due at
+    // the current point, called before the keyboard interrupt is raised
+    void Process(int64_t nsec);
+    void Deliver(uint64_t cycles);
+
+private:
+    enum class Mode
+    {
+        Live,
+        Record,
+        Replay
+    };
+
+    struct Event
+    {
+        uint64_t time;
+        uint64_t cycles;
+        int      repeat;
+        uint8_t  scancode;
+    };
+
+    Keyboard&           m_keyboard;
+    Mode                m_mode;
+    FILE*               m_file;
+    uint64_t            m_time;         // emulated time, ns
+    uint64_t            m_lastTime;     // of the previous Deliver()
+    uint64_t            m_lastCycles;
+    int                 m_repeat;
+
+    std::mutex          m_mutex;
+    std::queue<uint8_t> m_pending;      // live keys not delivered yet
+
+    std::vector<Event>  m_events;       // replay
+    std::size_t         m_nextEvent;
+    bool                m_desync;
+
+    // private methods
+    bool IsDue(const Event& event, uint64_t cycles);
+};
+
+#endif /* X86EMU_INPUT_LOG */
@@ -0,0 +1,980 @@
+#include <stdio.h>
+#include <string.h>
+#include <initializer_list>
+#include <vector>
+#include "JitCpu.h"
+#include "Memory.h"
+#include "SamplingProfiler.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define X86EMU_JIT_SUPPORTED
+#endif
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+namespace
+{
+    enum HostReg
+    {
+        RAX = 0, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+        R8,      R9,  R10, R11, R12, R13, R14, R15
+    };
+
+    enum HostCond
+    {
+        JAE = 0x3,
+        JE  = 0x4
+    };
+
+#ifdef _WIN32
+    const int Arg0 = RCX;
+    const int Arg1 = RDX;
+    const int Arg2 = R8;
+#else
+    const int Arg0 = RDI;
+    const int Arg1 = RSI;
+    const int Arg2 = RDX;
+#endif
+
+    // Register usage of translated blocks:
+    //   rbx - &m_register[0]
+    //   r12 - this
+    //   r14 - linear address of the current memory operand
+    //   rax, rdx - operands / result, rcx, r8 - r11 - scratch
+}
+
+// Minimal x86-64 instruction encoder, only what the translator needs
+class CodeEmitter
+{
+public:
+    // constructor & destructor
+    CodeEmitter(uint8_t* code, std::size_t size)
+        : m_code     (code)
+        , m_size     (size)
+        , m_pos      (0)
+        , m_overflow (false)
+    {
+    }
+
+    // public methods
+    std::size_t Size()     { return m_pos; }
+    bool        Overflow() { return m_overflow; }
+
+    void Byte(uint8_t value)
+    {
+        if (m_pos < m_size)
+            m_code[m_pos++] = value;
+        else
+            m_overflow = true;
+    }
+
+    void Dword(uint32_t value)
+    {
+        for(int n = 0; n < 4; n++)
+            Byte(value >> (n * 8));
+    }
+
+    void Qword(uint64_t value)
+    {
+        for(int n = 0; n < 8; n++)
+            Byte(value >> (n * 8));
+    }
+
+    // movzx / mov of guest sized values from and to [base + disp]
+    void Load32(int dst, int base, int32_t disp)  { OpMem({ 0x8b }, dst, base, disp); }
+    void Load16(int dst, int base, int32_t disp)  { OpMem({ 0x0f, 0xb7 }, dst, base, disp); }
+    void Load8(int dst, int base, int32_t disp)   { OpMem({ 0x0f, 0xb6 }, dst, base, disp); }
+    void Store32(int base, int32_t disp, int src) { OpMem({ 0x89 }, src, base, disp); }
+    void Store16(int base, int32_t disp, int src) { Byte(0x66); OpMem({ 0x89 }, src, base, disp); }
+    void Store8(int base, int32_t disp, int src)  { OpMem({ 0x88 }, src, base, disp, src >= RSP && src <= RDI); }
+
+    // same for [base + index]
+    void LoadIndexed16(int dst, int base, int index)  { OpMemIndexed({ 0x0f, 0xb7 }, dst, base, index); }
+    void LoadIndexed8(int dst, int base, int index)   { OpMemIndexed({ 0x0f, 0xb6 }, dst, base, index); }
+    void StoreIndexed16(int base, int index, int src) { Byte(0x66); OpMemIndexed({ 0x89 }, src, base, index); }
+    void StoreIndexed8(int base, int index, int src)  { OpMemIndexed({ 0x88 }, src, base, index, src >= RSP && src <= RDI); }
+
+    // mov dst, [base + index * 8 + disp], 64-bit
+    void LoadScaled64(int dst, int base, int index, int32_t disp)
+    {
+        Rex(true, dst, index, base);
+        Byte(0x8b);
+        Byte(0x84 | ((dst & 7) << 3));                  // mod 10, sib follows
+        Byte(0xc0 | ((index & 7) << 3) | (base & 7));   // scale 8
+        Dword(disp);
+    }
+
+    // 32-bit register operations, 'op' uses the x86 ALU numbering (add, or, adc, sbb, and, sub, xor, cmp)
+    void Alu(int op, int dst, int src)          { OpReg({ static_cast<uint8_t>(op * 8 + 1) }, src, dst); }
+    void AluImm(int op, int dst, uint32_t imm)  { OpReg({ 0x81 }, op, dst); Dword(imm); }
+    void Shl(int reg, uint8_t count)            { OpReg({ 0xc1 }, 4, reg); Byte(count); }
+    void Shr(int reg, uint8_t count)            { OpReg({ 0xc1 }, 5, reg); Byte(count); }
+    void Sar(int reg, uint8_t count)            { OpReg({ 0xc1 }, 7, reg); Byte(count); }
+    void Not(int reg)                           { OpReg({ 0xf7 }, 2, reg); }
+    void Test64(int dst, int src)               { OpReg({ 0x85 }, src, dst, true); }
+    void Mov(int dst, int src)                  { OpReg({ 0x89 }, src, dst); }
+    void Mov64(int dst, int src)                { OpReg({ 0x89 }, src, dst, true); }
+    void Movzx16(int dst, int src)              { OpReg({ 0x0f, 0xb7 }, dst, src); }
+    void Movzx8(int dst, int src)               { OpReg({ 0x0f, 0xb6 }, dst, src, false, src >= RSP && src <= RDI); }
+    void Movsx16(int dst, int src)              { OpReg({ 0x0f, 0xbf }, dst, src); }
+    void Movsx8(int dst, int src)               { OpReg({ 0x0f, 0xbe }, dst, src, false, src >= RSP && src <= RDI); }
+
+    void MovImm(int dst, uint32_t imm)
+    {
+        Rex(false, 0, 0, dst);
+        Byte(0xb8 + (dst & 7));
+        Dword(imm);
+    }
+
+    void MovImm64(int dst, const void* imm)
+    {
+        Rex(true, 0, 0, dst);
+        Byte(0xb8 + (dst & 7));
+        Qword(reinterpret_cast<uintptr_t>(imm));
+    }
+
+    void Call(const void* function)
+    {
+        MovImm64(RAX, function);
+        Byte(0xff);
+        Byte(0xd0);
+    }
+
+    void Push(int reg)          { Rex(false, 0, 0, reg); Byte(0x50 + (reg & 7)); }
+    void Pop(int reg)           { Rex(false, 0, 0, reg); Byte(0x58 + (reg & 7)); }
+    void SubRsp(uint8_t value)  { Byte(0x48); Byte(0x83); Byte(0xec); Byte(value); }
+    void AddRsp(uint8_t value)  { Byte(0x48); Byte(0x83); Byte(0xc4); Byte(value); }
+    void Ret()                  { Byte(0xc3); }
+
+    // forward jumps, returning the position to be passed to Bind()
+    std::size_t Jcc(int cond)   { Byte(0x0f); Byte(0x80 | cond); Dword(0); return m_pos; }
+    std::size_t Jmp()           { Byte(0xe9); Dword(0); return m_pos; }
+
+    void Bind(std::size_t pos)
+    {
+        uint32_t rel = m_pos - pos;
+
+        if (pos <= m_size)
+            ::memcpy(m_code + pos - 4, &rel, 4);
+    }
+
+private:
+    uint8_t*    m_code;
+    std::size_t m_size;
+    std::size_t m_pos;
+    bool        m_overflow;
+
+    void Rex(bool w, int r, int x, int b, bool force = false)
+    {
+        uint8_t rex = 0x40 | (w << 3) | (((r >> 3) & 1) << 2) | (((x >> 3) & 1) << 1) | ((b >> 3) & 1);
+
+        if (rex != 0x40 || force)
+            Byte(rex);
+    }
+
+    void OpReg(std::initializer_list<uint8_t> opcode, int reg, int rm, bool w = false, bool forceRex = false)
+    {
+        Rex(w, reg, 0, rm, forceRex);
+
+        for(uint8_t byte : opcode)
+            Byte(byte);
+
+        Byte(0xc0 | ((reg & 7) << 3) | (rm & 7));
+    }
+
+    void OpMem(std::initializer_list<uint8_t> opcode, int reg, int base, int32_t disp, bool forceRex = false)
+    {
+        bool disp8 = disp >= -128 && disp <= 127;
+
+        Rex(false, reg, 0, base, forceRex);
+
+        for(uint8_t byte : opcode)
+            Byte(byte);
+
+        Byte(((disp8 ? 1 : 2) << 6) | ((reg & 7) << 3) | (base & 7));
+
+        if ((base & 7) == RSP)
+            Byte(0x24);
+
+        if (disp8)
+            Byte(disp);
+        else
+            Dword(disp);
+    }
+
+    void OpMemIndexed(std::initializer_list<uint8_t> opcode, int reg, int base, int index, bool forceRex = false)
+    {
+        Rex(false, reg, index, base, forceRex);
+
+        for(uint8_t byte : opcode)
+            Byte(byte);
+
+        Byte(0x44 | ((reg & 7) << 3));             // mod 01, sib follows
+        Byte(((index & 7) << 3) | (base & 7));      // scale 1
+        Byte(0);                                    // disp8
+    }
+};
+
+// constructor & destructor
+JitCpu::JitCpu(Memory& memory)
+    : Cpu          (memory)
+    , m_codeBuffer (nullptr)
+    , m_codeSize   (0)
+    , m_translating(nullptr)
+{
+#ifdef X86EMU_JIT_SUPPORTED
+#ifdef _WIN32
+    m_codeBuffer = static_cast<uint8_t *>(
+        ::VirtualAlloc(nullptr, CodeBufferSize, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE));
+#else
+    void* buffer = ::mmap(nullptr, CodeBufferSize, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    m_codeBuffer = (buffer != MAP_FAILED) ? static_cast<uint8_t *>(buffer) : nullptr;
+#endif
+#endif
+
+    if (m_codeBuffer == nullptr)
+    {
+        printf("JitCpu::JitCpu() native code generation not available, interpreting\n");
+    }
+
+    SetBlockCacheEnabled(true);
+}
+
+JitCpu::~JitCpu()
+{
+    if (m_codeBuffer != nullptr)
+    {
+#ifdef _WIN32
+        ::VirtualFree(m_codeBuffer, 0, MEM_RELEASE);
+#else
+        ::munmap(m_codeBuffer, CodeBufferSize);
+#endif
+    }
+}
+
+// public methods
+bool JitCpu::Run(int nCycles)
+{
+    if (!m_blockCacheEnabled || m_codeBuffer == nullptr || m_profiler || m_tracer)
+        return Cpu::Run(nCycles);
+
+    // left the wait loop, stores can take the direct mapping again
+    if (m_pollArmed && m_instructionCnt - m_pollCnt > PollLoopLength)
+        ArmPollStores(false);
+
+    m_idle = m_halted;
+
+    if (m_halted)
+        return true;
+
+    m_state            = 0;
+    m_segmentBase      = m_register[Register::DS] * 16;
+    m_stackSegmentBase = m_register[Register::SS] * 16;
+
+    std::size_t cycleLimit = m_cycleCnt + nCycles;
+
+    while(m_cycleCnt < cycleLimit)
+    {
+        DecodedBlock& block = FetchBlock();
+
+        if (block.native == nullptr && ++block.hits == HotThreshold)
+        {
+            block.native = Translate(block);
+        }
+
+        // a translated block always runs to its end, so it has to fit into the budget
+        if (block.native != nullptr &&
+            m_cycleCnt + block.cycles <= cycleLimit &&
+            m_register[Register::IP] + block.length < 0x10000)
+        {
+            if (m_sampler)
+                m_sampler->Publish(m_register[Register::CS], m_register[Register::IP], SamplingProfiler::Jit);
+
+            WatchCode(block);
+
+            // fewer than block.count when it wrote into its own code
+            int executed = reinterpret_cast<NativeBlock>(block.native)(this);
+
+            m_codeLength      = 0;
+            m_instructionCnt += executed;
+            m_cycleCnt       += block.runCycles[executed];
+        }
+        else
+        {
+            if (m_sampler)
+                m_sampler->Publish(m_register[Register::CS], m_register[Register::IP], SamplingProfiler::BlockCache);
+
+            ExecuteBlock(block, cycleLimit);
+        }
+
+        if (m_state)
+        {
+            if ((m_state & State::InvalidOp) || (m_state & State::Finished))
+                return false;
+
+            if (m_state & (State::Halted | State::Idle))
+            {
+                m_halted = (m_state & State::Halted) != 0;
+                m_idle   = true;
+                break;
+            }
+        }
+    }
+
+    if (m_sampler)
+    {
+        m_sampler->Publish(m_register[Register::CS], m_register[Register::IP], m_idle ? SamplingProfiler::Idle : SamplingProfiler::Host);
+    }
+
+    return true;
+}
+
+// private methods
+void* JitCpu::Translate(DecodedBlock& block)
+{
+    if (block.count < 2)
+        return nullptr;
+
+    m_translating = &block;
+
+    for(int attempt = 0; attempt < 2; attempt++)
+    {
+        CodeEmitter              e(m_codeBuffer + m_codeSize, CodeBufferSize - m_codeSize);
+        int                      ipDelta = 0;
+        std::vector<std::size_t> exits;
+
+        // prologue, keeps the stack 16 byte aligned and leaves shadow space for Win64 calls
+        e.Push(RBX);
+        e.Push(R12);
+        e.Push(R14);
+        e.SubRsp(48);
+        e.Mov64(R12, Arg0);
+        e.MovImm64(RBX, m_register);
+
+        for(int n = 0; n < block.count; n++)
+        {
+            const DecodedInst& inst = block.inst[n];
+
+            if (EmitNative(e, inst))
+            {
+                // IP is only written back before leaving native code
+                ipDelta += inst.length;
+            }
+            else
+            {
+                EmitAdvanceIp(e, ipDelta);
+                ipDelta = 0;
+
+                e.Mov64(Arg0, R12);
+                e.MovImm64(Arg1, &inst);
+                e.Call(reinterpret_cast<const void *>(&JitCpu::CallHandler));
+            }
+
+            // an instruction that wrote into the block's code is the last one run, the
+            // rest is decoded again from memory
+            if (n + 1 < block.count)
+            {
+                e.Load8(RCX, R12, CodeWrittenDisp());
+                e.Test64(RCX, RCX);
+
+                std::size_t next = e.Jcc(HostCond::JE);
+
+                EmitAdvanceIp(e, ipDelta);
+                e.MovImm(RAX, n + 1);
+                exits.push_back(e.Jmp());
+                e.Bind(next);
+            }
+        }
+
+        EmitAdvanceIp(e, ipDelta);
+        e.MovImm(RAX, block.count);
+
+        for(std::size_t exit : exits)
+            e.Bind(exit);
+
+        e.AddRsp(48);
+        e.Pop(R14);
+        e.Pop(R12);
+        e.Pop(RBX);
+        e.Ret();
+
+        if (!e.Overflow())
+        {
+            void* code = m_codeBuffer + m_codeSize;
+
+            m_codeSize += (e.Size() + 15) & ~15;
+            return code;
+        }
+
+        FlushTranslations();
+    }
+
+    return nullptr;
+}
+
+void JitCpu::FlushTranslations()
+{
+    for(auto& block : m_blockCache)
+    {
+        block.native = nullptr;
+        block.hits   = 0;
+    }
+
+    m_codeSize = 0;
+}
+
+bool JitCpu::EmitNative(CodeEmitter& e, const DecodedInst& inst)
+{
+    uint8_t opcode = inst.opcode;
+    bool    mem    = (inst.modRm & 0xc0) != 0xc0;
+
+    if (inst.handler == &JitCpu::OpFallback)
+        return false;
+
+    if (opcode < 0x40 && (opcode & 0x07) < 0x06)
+    {
+        int  op   = opcode >> 3;
+        bool wide = opcode & 0x01;
+
+        switch(opcode & 0x07)
+        {
+            case 0: // op r/m8, r8
+            case 1: // op r/m16, r16
+                if (mem)
+                {
+                    EmitEa(e, inst);
+                    EmitLoad(e, wide);
+                }
+                else
+                {
+                    EmitLoadReg(e, RAX, inst.rm.r8, wide);
+                }
+
+                EmitLoadReg(e, RDX, inst.reg.r8, wide);
+                EmitAlu(e, op, wide, false);
+
+                if (op != AluOp::Cmp)
+                {
+                    if (mem)
+                        EmitStore(e, wide);
+                    else
+                        EmitStoreReg(e, inst.rm.r8, RAX, wide);
+                }
+                return true;
+
+            case 2: // op r8, r/m8
+            case 3: // op r16, r/m16
+                if (mem)
+                {
+                    EmitEa(e, inst);
+                    EmitLoad(e, wide);
+                    e.Mov(RDX, RAX);
+                }
+                else
+                {
+                    EmitLoadReg(e, RDX, inst.rm.r8, wide);
+                }
+
+                EmitLoadReg(e, RAX, inst.reg.r8, wide);
+                EmitAlu(e, op, wide, false);
+
+                if (op != AluOp::Cmp)
+                    EmitStoreReg(e, inst.reg.r8, RAX, wide);
+                return true;
+
+            default: // op al, imm8 / op ax, imm16
+                EmitLoadReg(e, RAX, &m_register[Register::AX], wide);
+                e.MovImm(RDX, inst.imm);
+                EmitAlu(e, op, wide, false);
+
+                if (op != AluOp::Cmp)
+                    EmitStoreReg(e, &m_register[Register::AX], RAX, wide);
+                return true;
+        }
+    }
+
+    switch(opcode)
+    {
+        case 0x40: case 0x41: case 0x42: case 0x43: // inc reg16
+        case 0x44: case 0x45: case 0x46: case 0x47:
+        case 0x48: case 0x49: case 0x4a: case 0x4b: // dec reg16
+        case 0x4c: case 0x4d: case 0x4e: case 0x4f:
+            EmitLoadReg(e, RAX, inst.reg.r16, true);
+            e.MovImm(RDX, 1);
+            EmitAlu(e, opcode < 0x48 ? AluOp::Add : AluOp::Sub, true, true);
+            EmitStoreReg(e, inst.reg.r16, RAX, true);
+            return true;
+
+        case 0x50: case 0x51: case 0x52: case 0x53: // push reg16
+        case 0x54: case 0x55: case 0x56: case 0x57:
+        case 0x68: // push imm16
+        case 0x6a: // push imm8
+            if (opcode == 0x68 || opcode == 0x6a)
+                e.MovImm(RAX, inst.imm);
+            else
+                EmitLoadReg(e, RAX, inst.reg.r16, true);
+
+            e.Load16(RCX, RBX, Register::SP * 2);
+            e.AluImm(AluOp::Sub, RCX, 2);
+            e.Store16(RBX, Register::SP * 2, RCX);
+            EmitStackEa(e);
+            EmitStore(e, true);
+            return true;
+
+        case 0x58: case 0x59: case 0x5a: case 0x5b: // pop reg16
+        case 0x5c: case 0x5d: case 0x5e: case 0x5f:
+            EmitStackEa(e);
+            EmitLoad(e, true);
+            e.Load16(RCX, RBX, Register::SP * 2);
+            e.AluImm(AluOp::Add, RCX, 2);
+            e.Store16(RBX, Register::SP * 2, RCX);
+            EmitStoreReg(e, inst.reg.r16, RAX, true);
+            return true;
+
+        case 0x80: case 0x81: case 0x82: case 0x83: // op r/m, imm
+            {
+                int  op   = (inst.modRm >> 3) & 0x07;
+                bool wide = opcode & 0x01;
+
+                if (mem)
+                {
+                    EmitEa(e, inst);
+                    EmitLoad(e, wide);
+                }
+                else
+                {
+                    EmitLoadReg(e, RAX, inst.rm.r8, wide);
+                }
+
+                e.MovImm(RDX, inst.imm);
+                EmitAlu(e, op, wide, false);
+
+                if (op != AluOp::Cmp)
+                {
+                    if (mem)
+                        EmitStore(e, wide);
+                    else
+                        EmitStoreReg(e, inst.rm.r8, RAX, wide);
+                }
+                return true;
+            }
+
+        case 0x84: // test r/m8, r8
+        case 0x85: // test r/m16, r16
+            {
+                bool wide = opcode & 0x01;
+
+                if (mem)
+                {
+                    EmitEa(e, inst);
+                    EmitLoad(e, wide);
+                }
+                else
+                {
+                    EmitLoadReg(e, RAX, inst.rm.r8, wide);
+                }
+
+                EmitLoadReg(e, RDX, inst.reg.r8, wide);
+                EmitAlu(e, AluOp::And, wide, false);
+                return true;
+            }
+
+        case 0x86: // xchg r8, r8
+        case 0x87: // xchg r16, r16
+            {
+                bool wide = opcode & 0x01;
+
+                if (mem)
+                    return false;
+
+                EmitLoadReg(e, RAX, inst.rm.r8, wide);
+                EmitLoadReg(e, RDX, inst.reg.r8, wide);
+                EmitStoreReg(e, inst.rm.r8, RDX, wide);
+                EmitStoreReg(e, inst.reg.r8, RAX, wide);
+                return true;
+            }
+
+        case 0x88: // mov r/m8, r8
+        case 0x89: // mov r/m16, r16
+        case 0x8c: // mov r/m16, Sreg
+            {
+                bool wide = opcode != 0x88;
+
+                EmitLoadReg(e, RAX, inst.reg.r8, wide);
+
+                if (mem)
+                {
+                    EmitEa(e, inst);
+                    EmitStore(e, wide);
+                }
+                else
+                {
+                    EmitStoreReg(e, inst.rm.r8, RAX, wide);
+                }
+                return true;
+            }
+
+        case 0x8a: // mov r8, r/m8
+        case 0x8b: // mov r16, r/m16
+            {
+                bool wide = opcode & 0x01;
+
+                if (mem)
+                {
+                    EmitEa(e, inst);
+                    EmitLoad(e, wide);
+                }
+                else
+                {
+                    EmitLoadReg(e, RAX, inst.rm.r8, wide);
+                }
+
+                EmitStoreReg(e, inst.reg.r8, RAX, wide);
+                return true;
+            }
+
+        case 0x8d: // lea r16, m16
+            EmitOffset(e, inst);
+            EmitStoreReg(e, inst.reg.r16, R14, true);
+            return true;
+
+        case 0x90: case 0x91: case 0x92: case 0x93: // xchg ax, reg16
+        case 0x94: case 0x95: case 0x96: case 0x97:
+            EmitLoadReg(e, RAX, &m_register[Register::AX], true);
+            EmitLoadReg(e, RDX, inst.reg.r16, true);
+            EmitStoreReg(e, &m_register[Register::AX], RDX, true);
+            EmitStoreReg(e, inst.reg.r16, RAX, true);
+            return true;
+
+        case 0x98: // cbw
+            e.Load8(RAX, RBX, Register::AX * 2);
+            e.Movsx8(RAX, RAX);
+            e.Store16(RBX, Register::AX * 2, RAX);
+            return true;
+
+        case 0x99: // cwd
+            e.Load16(RAX, RBX, Register::AX * 2);
+            e.Movsx16(RAX, RAX);
+            e.Sar(RAX, 15);
+            e.Store16(RBX, Register::DX * 2, RAX);
+            return true;
+
+        case 0xa0: // mov al, moffs8
+        case 0xa1: // mov ax, moffs16
+            EmitEa(e, inst);
+            EmitLoad(e, opcode & 0x01);
+            EmitStoreReg(e, &m_register[Register::AX], RAX, opcode & 0x01);
+            return true;
+
+        case 0xa2: // mov moffs8, al
+        case 0xa3: // mov moffs16, ax
+            EmitLoadReg(e, RAX, &m_register[Register::AX], opcode & 0x01);
+            EmitEa(e, inst);
+            EmitStore(e, opcode & 0x01);
+            return true;
+
+        case 0xa8: // test al, imm8
+        case 0xa9: // test ax, imm16
+            EmitLoadReg(e, RAX, &m_register[Register::AX], opcode & 0x01);
+            e.MovImm(RDX, inst.imm);
+            EmitAlu(e, AluOp::And, opcode & 0x01, false);
+            return true;
+
+        case 0xb0: case 0xb1: case 0xb2: case 0xb3: // mov reg8, imm8
+        case 0xb4: case 0xb5: case 0xb6: case 0xb7:
+            e.MovImm(RAX, inst.imm);
+            EmitStoreReg(e, inst.reg.r8, RAX, false);
+            return true;
+
+        case 0xb8: case 0xb9: case 0xba: case 0xbb: // mov reg16, imm16
+        case 0xbc: case 0xbd: case 0xbe: case 0xbf:
+            e.MovImm(RAX, inst.imm);
+            EmitStoreReg(e, inst.reg.r16, RAX, true);
+            return true;
+
+        case 0xc6: // mov r/m8, imm8
+        case 0xc7: // mov r/m16, imm16
+            e.MovImm(RAX, inst.imm);
+
+            if (mem)
+            {
+                EmitEa(e, inst);
+                EmitStore(e, opcode & 0x01);
+            }
+            else
+            {
+                EmitStoreReg(e, inst.rm.r8, RAX, opcode & 0x01);
+            }
+            return true;
+    }
+
+    return false;
+}
+
+// eax = op1, edx = op2 -> eax = result, the operation is recorded for lazy flag
+// evaluation like Cpu::Set*Flags*()
+void JitCpu::EmitAlu(CodeEmitter& e, int op, bool wide, bool preserveCF)
+{
+    int resultDisp   = reinterpret_cast<uint8_t *>(&m_result) - reinterpret_cast<uint8_t *>(this);
+    int auxDisp      = reinterpret_cast<uint8_t *>(&m_auxbits) - reinterpret_cast<uint8_t *>(this);
+    int lazyOpDisp   = reinterpret_cast<uint8_t *>(&m_lazyOp) - reinterpret_cast<uint8_t *>(this);
+    int operand1Disp = reinterpret_cast<uint8_t *>(&m_lazyOperand1) - reinterpret_cast<uint8_t *>(this);
+    int operand2Disp = reinterpret_cast<uint8_t *>(&m_lazyOperand2) - reinterpret_cast<uint8_t *>(this);
+
+    auto storeResult =
+        [&e, wide, resultDisp]()
+        {
+            if (wide)
+                e.Movsx16(R11, RAX);
+            else
+                e.Movsx8(R11, RAX);
+
+            e.Store32(R12, resultDisp, R11);
+        };
+
+    auto storeLazyOp =
+        [&e, lazyOpDisp](int lazyOp)
+        {
+            e.MovImm(R9, lazyOp);
+            e.Store32(R12, lazyOpDisp, R9);
+        };
+
+    if (op == AluOp::Or || op == AluOp::And || op == AluOp::Xor)
+    {
+        e.Alu(op, RAX, RDX);
+        storeResult();
+        storeLazyOp(LazyOp::Logic);
+        return;
+    }
+
+    bool add = (op == AluOp::Add || op == AluOp::Adc);
+
+    if (op == AluOp::Adc || op == AluOp::Sbb || preserveCF)
+    {
+        EmitResolveFlags(e);
+        e.Load32(RCX, R12, auxDisp);
+        e.Shr(RCX, 31);
+    }
+
+    // inc / dec record the old carry flag instead of the second operand
+    e.Store32(R12, operand1Disp, RAX);
+    e.Store32(R12, operand2Disp, preserveCF ? RCX : RDX);
+
+    e.Alu(add ? AluOp::Add : AluOp::Sub, RAX, RDX);
+
+    if (op == AluOp::Adc || op == AluOp::Sbb)
+        e.Alu(add ? AluOp::Add : AluOp::Sub, RAX, RCX);
+
+    if (wide)
+        e.Movzx16(RAX, RAX);
+    else
+        e.Movzx8(RAX, RAX);
+
+    storeResult();
+
+    if (preserveCF)
+        storeLazyOp(add ? (wide ? LazyOp::Inc16 : LazyOp::Inc8) : (wide ? LazyOp::Dec16 : LazyOp::Dec8));
+    else
+        storeLazyOp(add ? (wide ? LazyOp::Add16 : LazyOp::Add8) : (wide ? LazyOp::Sub16 : LazyOp::Sub8));
+}
+
+// computes m_auxbits of a recorded operation, eax and edx are preserved
+void JitCpu::EmitResolveFlags(CodeEmitter& e)
+{
+    int lazyOpDisp = reinterpret_cast<uint8_t *>(&m_lazyOp) - reinterpret_cast<uint8_t *>(this);
+
+    e.Load32(RCX, R12, lazyOpDisp);
+    e.Alu(AluOp::Or, RCX, RCX);
+
+    std::size_t resolved = e.Jcc(HostCond::JE);
+
+    e.Push(RAX);
+    e.Push(RDX);
+    e.SubRsp(32);
+    e.Mov64(Arg0, R12);
+    e.Call(reinterpret_cast<const void *>(&JitCpu::UpdateFlags));
+    e.AddRsp(32);
+    e.Pop(RDX);
+    e.Pop(RAX);
+    e.Bind(resolved);
+}
+
+// r14 = (base + index + disp) & 0xffff
+void JitCpu::EmitOffset(CodeEmitter& e, const DecodedInst& inst)
+{
+    e.MovImm(R14, inst.disp);
+
+    if (inst.base != Register::ZERO)
+    {
+        e.Load16(RCX, RBX, inst.base * 2);
+        e.Alu(AluOp::Add, R14, RCX);
+    }
+
+    if (inst.index != Register::ZERO)
+    {
+        e.Load16(RCX, RBX, inst.index * 2);
+        e.Alu(AluOp::Add, R14, RCX);
+    }
+
+    e.Movzx16(R14, R14);
+}
+
+// r14 = segment * 16 + offset
+void JitCpu::EmitEa(CodeEmitter& e, const DecodedInst& inst)
+{
+    EmitOffset(e, inst);
+    e.Load16(RCX, RBX, inst.segment * 2);
+    e.Shl(RCX, 4);
+    e.Alu(AluOp::Add, R14, RCX);
+}
+
+// r14 = ss * 16 + sp
+void JitCpu::EmitStackEa(CodeEmitter& e)
+{
+    e.Load16(R14, RBX, Register::SP * 2);
+    e.Load16(RCX, RBX, Register::SS * 2);
+    e.Shl(RCX, 4);
+    e.Alu(AluOp::Add, R14, RCX);
+}
+
+// rcx = page map entry for [r14], zero flag set if the page has no direct mapping
+void JitCpu::EmitPageLookup(CodeEmitter& e, uint8_t* const* map)
+{
+    int mapDisp = reinterpret_cast<const uint8_t *>(map) - reinterpret_cast<const uint8_t *>(this);
+
+    e.Mov(RCX, R14);
+    e.Shr(RCX, PageShift);
+    e.LoadScaled64(RCX, R12, RCX, mapDisp);
+    e.Test64(RCX, RCX);
+}
+
+// eax = [r14], memory mapped devices and watched pages go through Cpu::ReadMem*()
+void JitCpu::EmitLoad(CodeEmitter& e, bool wide)
+{
+    EmitPageLookup(e, m_readMap);
+
+    std::size_t slow = e.Jcc(HostCond::JE);
+
+    if (wide)
+        e.LoadIndexed16(RAX, RCX, R14);
+    else
+        e.LoadIndexed8(RAX, RCX, R14);
+
+    std::size_t done = e.Jmp();
+
+    e.Bind(slow);
+    e.Mov64(Arg0, R12);
+    e.Mov(Arg1, R14);
+    e.Call(wide ? reinterpret_cast<const void *>(&JitCpu::MemRead16) : reinterpret_cast<const void *>(&JitCpu::MemRead8));
+
+    if (wide)
+        e.Movzx16(RAX, RAX);
+    else
+        e.Movzx8(RAX, RAX);
+
+    e.Bind(done);
+}
+
+// [r14] = eax, memory mapped devices and watched pages go through Cpu::WriteMem*()
+void JitCpu::EmitStore(CodeEmitter& e, bool wide)
+{
+    EmitPageLookup(e, m_writeMap);
+
+    std::size_t slow = e.Jcc(HostCond::JE);
+
+    if (wide)
+        e.StoreIndexed16(RCX, R14, RAX);
+    else
+        e.StoreIndexed8(RCX, R14, RAX);
+
+    std::size_t done = e.Jmp();
+
+    e.Bind(slow);
+    e.Mov(Arg2, RAX);
+    e.Mov64(Arg0, R12);
+    e.Mov(Arg1, R14);
+    e.Call(wide ? reinterpret_cast<const void *>(&JitCpu::MemWrite16) : reinterpret_cast<const void *>(&JitCpu::MemWrite8));
+    e.Bind(done);
+
+    // a store into the block's own code, the same range check as Cpu::Store16()
+    e.Mov(RCX, R14);
+    e.AluImm(AluOp::Sub, RCX, m_translating->linearAddr - 3);
+    e.AluImm(AluOp::Cmp, RCX, m_translating->length + 3);
+
+    std::size_t outside = e.Jcc(HostCond::JAE);
+
+    e.MovImm(RCX, 1);
+    e.Store8(R12, CodeWrittenDisp(), RCX);
+    e.Bind(outside);
+}
+
+void JitCpu::EmitLoadReg(CodeEmitter& e, int hostReg, const void* reg, bool wide)
+{
+    int disp = reinterpret_cast<const uint8_t *>(reg) - reinterpret_cast<const uint8_t *>(m_register);
+
+    if (wide)
+        e.Load16(hostReg, RBX, disp);
+    else
+        e.Load8(hostReg, RBX, disp);
+}
+
+void JitCpu::EmitStoreReg(CodeEmitter& e, const void* reg, int hostReg, bool wide)
+{
+    int disp = reinterpret_cast<const uint8_t *>(reg) - reinterpret_cast<const uint8_t *>(m_register);
+
+    if (wide)
+        e.Store16(RBX, disp, hostReg);
+    else
+        e.Store8(RBX, disp, hostReg);
+}
+
+void JitCpu::EmitAdvanceIp(CodeEmitter& e, int delta)
+{
+    if (delta == 0)
+        return;
+
+    e.Load16(RCX, RBX, Register::IP * 2);
+    e.AluImm(AluOp::Add, RCX, delta);
+    e.Store16(RBX, Register::IP * 2, RCX);
+}
+
+// offset of m_codeWritten from 'this' (r12)
+int JitCpu::CodeWrittenDisp()
+{
+    return reinterpret_cast<const uint8_t *>(&m_codeWritten) - reinterpret_cast<const uint8_t *>(this);
+}
+
+void JitCpu::CallHandler(JitCpu* cpu, const DecodedInst* inst)
+{
+    (cpu->*inst->handler)(*inst);
+}
+
+void JitCpu::UpdateFlags(JitCpu* cpu)
+{
+    cpu->ResolveLazyFlags();
+}
+
+uint16_t JitCpu::MemRead16(JitCpu* cpu, uint32_t linearAddr)
+{
+    return cpu->ReadMem16(linearAddr);
+}
+
+uint8_t JitCpu::MemRead8(JitCpu* cpu, uint32_t linearAddr)
+{
+    return cpu->ReadMem8(linearAddr);
+}
+
+void JitCpu::MemWrite16(JitCpu* cpu, uint32_t linearAddr, uint16_t value)
+{
+    cpu->WriteMem16(linearAddr, value);
+}
+
+void JitCpu::MemWrite8(JitCpu* cpu, uint32_t linearAddr, uint8_t value)
+{
+    cpu->WriteMem8(linearAddr, value);
+}
@@ -0,0 +1,63 @@
+#ifndef X86EMU_JITCPU
+#define X86EMU_JITCPU
+
+#include <inttypes.h>
+#include "Cpu.h"
+
+// forward declarations
+class Memory;
+class CodeEmitter;
+
+// Cpu translating hot predecoded blocks into x86-64 code. Moves, ALU ops, inc/dec,
+// push/pop and lea are emitted natively, every other instruction calls its predecoded
+// handler - which for port I/O, interrupts and anything else not predecoded falls back
+// to Cpu::ExecuteInstruction().
+class JitCpu : public Cpu
+{
+public:
+    // constructor & destructor
+    JitCpu(Memory& memory);
+    ~JitCpu();
+
+    // public methods
+    bool Run(int nCycles) override;
+
+private:
+    typedef int (*NativeBlock)(JitCpu* cpu);
+
+    enum
+    {
+        HotThreshold   = 8,
+        CodeBufferSize = 32 * 1024 * 1024
+    };
+
+    uint8_t*            m_codeBuffer;
+    std::size_t         m_codeSize;
+    const DecodedBlock* m_translating;      // block Translate() is working on
+
+    void* Translate(DecodedBlock& block);
+    void  FlushTranslations();
+
+    bool  EmitNative(CodeEmitter& e, const DecodedInst& inst);
+    void  EmitAlu(CodeEmitter& e, int op, bool wide, bool preserveCF);
+    void  EmitResolveFlags(CodeEmitter& e);
+    void  EmitOffset(CodeEmitter& e, const DecodedInst& inst);
+    void  EmitEa(CodeEmitter& e, const DecodedInst& inst);
+    void  EmitStackEa(CodeEmitter& e);
+    void  EmitPageLookup(CodeEmitter& e, uint8_t* const* map);
+    void  EmitLoad(CodeEmitter& e, bool wide);
+    void  EmitStore(CodeEmitter& e, bool wide);
+    void  EmitLoadReg(CodeEmitter& e, int hostReg, const void* reg, bool wide);
+    void  EmitStoreReg(CodeEmitter& e, const void* reg, int hostReg, bool wide);
+    void  EmitAdvanceIp(CodeEmitter& e, int delta);
+    int   CodeWrittenDisp();
+
+    static void     CallHandler(JitCpu* cpu, const DecodedInst* inst);
+    static void     UpdateFlags(JitCpu* cpu);
+    static uint16_t MemRead16(JitCpu* cpu, uint32_t linearAddr);
+    static uint8_t  MemRead8(JitCpu* cpu, uint32_t linearAddr);
+    static void     MemWrite16(JitCpu* cpu, uint32_t linearAddr, uint16_t value);
+    static void     MemWrite8(JitCpu* cpu, uint32_t linearAddr, uint8_t value);
+};
+
+#endif /* X86EMU_JITCPU */
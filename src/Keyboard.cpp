@@ -1,5 +1,23 @@
+#include <stdio.h>
+#include "Bus.h"
 #include "Keyboard.h"
 
+void Keyboard::RegisterPorts(Bus& bus)
+{
+    bus.Register(0x60, 1, this);
+}
+
+// data port, the scancode of the pending key
+uint8_t Keyboard::PortRead(uint16_t port)
+{
+    return GetKey();
+}
+
+void Keyboard::PortWrite(uint16_t port, uint8_t value)
+{
+    printf("Unhandled write port = 0x%04x, value = %d (0x%02x)\n", port, value, value);
+}
+
 void Keyboard::AddKey(uint8_t key)
 {
     std::lock_guard<std::mutex> lock(m_mutex);
@@ -5,10 +5,17 @@
 #include <mutex>
 #include <queue>
 
+// forward declarations
+class Bus;
+
 class Keyboard
 {
 public:
     // public methods
+    void    RegisterPorts(Bus& bus);
+    uint8_t PortRead(uint16_t port);
+    void    PortWrite(uint16_t port, uint8_t value);
+
     void    AddKey(uint8_t key);
     void    RemoveKey();
     uint8_t GetKey();
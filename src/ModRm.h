@@ -0,0 +1,90 @@
+#ifndef X86EMU_MODRM
+#define X86EMU_MODRM
+
+#include <inttypes.h>
+#include <array>
+
+// Memory operand of a ModR/M byte, ea = base + index + displacement (16 bit wrap).
+// Registers are numbered like the Cpu's register file - AX, CX, DX, BX, SP, BP, SI,
+// DI - and NoReg stands for an absent base or index. The displacement is read as
+// 16 bits after the ModR/M byte and reduced with dispShift / dispMask, so decoding
+// needs no branch on the addressing mode:
+//
+//     disp = (int16_t(raw << dispShift) >> dispShift) & dispMask
+struct ModRmEa
+{
+    enum
+    {
+        NoReg = 0x0f
+    };
+
+    uint8_t  base;
+    uint8_t  index;
+    uint8_t  dispSize;      // displacement bytes following the ModR/M byte
+    uint8_t  dispShift;     // 8 sign extends a disp8
+    uint16_t dispMask;      // 0 without displacement
+    bool     stackSegment;  // BP based, SS is the default segment
+    bool     isRegister;    // mod 11, no memory operand
+
+    static const std::array<ModRmEa, 256> s_table;
+};
+
+constexpr ModRmEa DecodeModRmEa(uint8_t modRm)
+{
+    constexpr uint8_t bx = 3, bp = 5, si = 6, di = 7, none = ModRmEa::NoReg;
+    constexpr uint8_t base[8]  = { bx, bx, bp, bp, none, none, bp, bx };
+    constexpr uint8_t index[8] = { si, di, si, di, si, di, none, none };
+
+    uint8_t mod = modRm >> 6;
+    uint8_t rm  = modRm & 0x07;
+
+    ModRmEa ea = { base[rm], index[rm], 0, 0, 0, base[rm] == bp, mod == 3 };
+
+    if (mod == 0 && rm == 6)
+    {
+        // disp16 only
+        ea.base         = none;
+        ea.stackSegment = false;
+        ea.dispSize     = 2;
+    }
+    else if (mod == 1 || mod == 2)
+    {
+        ea.dispSize = mod;
+    }
+
+    if (mod == 3)
+    {
+        ea.base         = none;
+        ea.index        = none;
+        ea.stackSegment = false;
+    }
+
+    ea.dispShift = (ea.dispSize == 1) ? 8 : 0;
+    ea.dispMask  = (ea.dispSize == 0) ? 0 : 0xffff;
+
+    return ea;
+}
+
+constexpr std::array<ModRmEa, 256> MakeModRmTable()
+{
+    std::array<ModRmEa, 256> table = {};
+
+    for(int n = 0; n < 256; n++)
+    {
+        table[n] = DecodeModRmEa(n);
+    }
+
+    return table;
+}
+
+inline constexpr std::array<ModRmEa, 256> ModRmEa::s_table = MakeModRmTable();
+
+// sign extended / masked displacement of the ModR/M byte at 'ip'
+inline uint16_t ModRmDisp(const ModRmEa& ea, const uint8_t* ip)
+{
+    uint16_t raw = ip[1] | (ip[2] << 8);
+
+    return static_cast<uint16_t>(static_cast<int16_t>(raw << ea.dispShift) >> ea.dispShift) & ea.dispMask;
+}
+
+#endif /* X86EMU_MODRM */
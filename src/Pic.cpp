@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include "Bus.h"
 #include "Pic.h"
 #include "CpuInterface.h"
 
@@ -14,6 +15,11 @@ Pic::~Pic()
 }
 
 // public methods
+void Pic::RegisterPorts(Bus& bus)
+{
+    bus.Register(0x20, 2, this);
+}
+
 uint8_t Pic::PortRead(uint16_t port)
 {
     return 0;
@@ -5,6 +5,7 @@
 #include <functional>
 
 // forward declarations
+class Bus;
 class CpuInterface;
 
 class Pic
@@ -15,6 +16,7 @@ public:
     ~Pic();
 
     // public methods
+    void    RegisterPorts(Bus& bus);
     uint8_t PortRead(uint16_t port);
     void    PortWrite(uint16_t port, uint8_t value);
 
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <algorithm>
+#include "Bus.h"
 #include "Pic.h"
 #include "Pit.h"
 
@@ -16,6 +17,11 @@ Pit::~Pit()
 }
 
 // public methods
+void Pit::RegisterPorts(Bus& bus)
+{
+    bus.Register(0x40, 4, this);
+}
+
 uint8_t Pit::PortRead(uint16_t port)
 {
     PitChannel& channel = m_channel[port - 0x40];
@@ -89,3 +95,9 @@ void Pit::Process(int64_t nsec)
         m_channel[2].tickCount += m_channel[2].divisor;
     }
 }
+
+int64_t Pit::TimeToNextEvent()
+{
+    // nanoseconds until Process() raises the next timer interrupt
+    return static_cast<int64_t>(m_channel[0].tickCount * 1000000000.0 / 1191181.6666) + 1;
+}
@@ -4,6 +4,7 @@
 #include <inttypes.h>
 
 // forward declarations
+class Bus;
 class Pic;
 
 class Pit
@@ -14,10 +15,12 @@ public:
     ~Pit();
 
     // public methods
+    void    RegisterPorts(Bus& bus);
     uint8_t PortRead(uint16_t port);
     void    PortWrite(uint16_t port, uint8_t value);
 
-    void Process(int64_t nsec);
+    void    Process(int64_t nsec);
+    int64_t TimeToNextEvent();
 
 private:
     struct PitChannel
@@ -0,0 +1,144 @@
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include "Profiler.h"
+#include "Disasm.h"
+#include "Memory.h"
+
+// segment overrides, operand / address size, lock and rep
+const bool Profiler::s_prefix[256] =
+  { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0,
+    0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 1, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 };
+
+// opcodes selecting the operation by the reg field of the ModR/M byte
+const bool Profiler::s_group[256] =
+  { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 1, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0,
+    1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 1, 1, 0, 0, 0, 0, 0, 0, 1, 1 };
+
+// constructor & destructor
+Profiler::Profiler(Memory& memory)
+    : m_memory        (memory.GetMem())
+    , m_addressCount  (AddressCount)
+    , m_addressSegment(AddressCount)
+{
+    Reset();
+}
+
+Profiler::~Profiler()
+{
+}
+
+// public methods
+void Profiler::Reset()
+{
+    m_total = 0;
+
+    ::memset(m_opcode, 0, sizeof(m_opcode));
+    std::fill(m_addressCount.begin(), m_addressCount.end(), 0);
+    std::fill(m_addressSegment.begin(), m_addressSegment.end(), 0);
+}
+
+void Profiler::Report(FILE* file, Disasm& disasm, int maxAddresses)
+{
+    struct Entry
+    {
+        uint64_t    count;
+        std::string name;
+        uint16_t    cs;
+        uint16_t    ip;
+    };
+
+    std::vector<Entry> entries;
+    double             percent = (m_total > 0) ? 100.0 / m_total : 0.0;
+    char               name[16];
+
+    fprintf(file, "%" PRIu64 " instructions\n\n", m_total);
+
+    for(int rep = 0; rep < 2; rep++)
+    {
+        for(int opcode = 0; opcode < 256; opcode++)
+        {
+            for(int reg = 0; reg < 8; reg++)
+            {
+                const OpcodeStats& stats = m_opcode[rep][opcode][reg];
+
+                if (stats.count == 0)
+                    continue;
+
+                if (s_group[opcode])
+                    snprintf(name, sizeof(name), "%s%02x /%d", rep ? "rep " : "", opcode, reg);
+                else
+                    snprintf(name, sizeof(name), "%s%02x", rep ? "rep " : "", opcode);
+
+                entries.push_back({ stats.count, name, static_cast<uint16_t>(stats.sample >> 16), static_cast<uint16_t>(stats.sample) });
+            }
+        }
+    }
+
+    std::sort(entries.begin(), entries.end(),
+        [](const Entry& a, const Entry& b) { return a.count > b.count; });
+
+    fprintf(file, "opcode         count      %%   sample\n");
+
+    for(const Entry& entry : entries)
+    {
+        fprintf(file, "%-8s %12" PRIu64 " %6.2f   %s\n",
+            entry.name.c_str(), entry.count, entry.count * percent, disasm.Process(entry.cs, entry.ip).c_str());
+    }
+
+    // hot addresses
+    std::vector<uint32_t> addresses;
+
+    for(uint32_t addr = 0; addr < AddressCount; addr++)
+    {
+        if (m_addressCount[addr] != 0)
+            addresses.push_back(addr);
+    }
+
+    std::size_t count = std::min<std::size_t>(addresses.size(), maxAddresses);
+
+    std::partial_sort(addresses.begin(), addresses.begin() + count, addresses.end(),
+        [this](uint32_t a, uint32_t b) { return m_addressCount[a] > m_addressCount[b]; });
+
+    fprintf(file, "\n       count      %%   instruction\n");
+
+    for(std::size_t n = 0; n < count; n++)
+    {
+        uint32_t addr = addresses[n];
+        uint16_t cs   = m_addressSegment[addr];
+        uint16_t ip   = addr - cs * 16;
+
+        fprintf(file, "%12" PRIu64 " %6.2f   %s\n",
+            m_addressCount[addr], m_addressCount[addr] * percent, disasm.Process(cs, ip).c_str());
+    }
+
+    fflush(file);
+}
@@ -0,0 +1,75 @@
+#ifndef X86EMU_PROFILER
+#define X86EMU_PROFILER
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <vector>
+
+// forward declarations
+class Disasm;
+class Memory;
+
+// Counts executed guest instructions per opcode - group opcodes (80h, F6h, FFh, ...)
+// split by the reg field of their ModR/M byte, rep string instructions apart from
+// single ones - and per linear address. Cpu::SetProfiler() attaches it, after which
+// Run() executes every instruction through the interpreter so that each one is seen.
+class Profiler
+{
+public:
+    // constructor & destructor
+    Profiler(Memory& memory);
+    ~Profiler();
+
+    // public methods
+    void Record(uint16_t cs, uint16_t ip);
+    void Reset();
+
+    // sorted opcode and address tables, each entry disassembled at a place it ran at
+    void Report(FILE* file, Disasm& disasm, int maxAddresses);
+
+private:
+    enum
+    {
+        AddressCount = 0x110000     // room for segment + offset beyond 1 MB
+    };
+
+    struct OpcodeStats
+    {
+        uint64_t count;
+        uint32_t sample;    // cs:ip of the last execution
+    };
+
+    static const bool s_prefix[256];
+    static const bool s_group[256];
+
+    uint8_t*              m_memory;
+    uint64_t              m_total;
+    OpcodeStats           m_opcode[2][256][8];  // [rep][opcode][reg field]
+    std::vector<uint64_t> m_addressCount;
+    std::vector<uint16_t> m_addressSegment;     // cs of the last execution
+};
+
+// public methods
+inline void Profiler::Record(uint16_t cs, uint16_t ip)
+{
+    uint32_t       linearAddr = cs * 16 + ip;
+    const uint8_t* code       = m_memory + linearAddr;
+    int            rep        = 0;
+
+    // prefixes count towards the instruction they belong to
+    for(int n = 0; n < 4 && s_prefix[*code]; n++, code++)
+    {
+        rep |= (*code == 0xf2 || *code == 0xf3);
+    }
+
+    OpcodeStats& stats = m_opcode[rep][code[0]][s_group[code[0]] ? (code[1] >> 3) & 0x07 : 0];
+
+    stats.count++;
+    stats.sample = (cs << 16) | ip;
+
+    m_addressCount[linearAddr]++;
+    m_addressSegment[linearAddr] = cs;
+    m_total++;
+}
+
+#endif /* X86EMU_PROFILER */
@@ -225,7 +225,7 @@ void SDLInterface::MainLoop()
             }
         }
 
-        m_vga->DrawScreenFiltered(reinterpret_cast<uint8_t *>(surface->pixels), surface->w, surface->h - 1, surface->pitch);
+        m_vga->DrawScreen(reinterpret_cast<uint8_t *>(surface->pixels), surface->w, surface->h - 1, surface->pitch);
         SDL_UpdateWindowSurface(window);
 
         if (m_memoryView)
@@ -248,3 +248,12 @@ void SDLInterface::StopMainLoop()
 {
     m_running = false;
 }
+
+bool SDLInterface::IsRealTime()
+{
+    return true;
+}
+
+void SDLInterface::Advance(int64_t usec)
+{
+}
@@ -3,12 +3,12 @@
 
 #include <inttypes.h>
 #include <atomic>
-#include <functional>
+#include "Backend.h"
 
 class Vga;
 class MemoryView;
 
-class SDLInterface
+class SDLInterface : public Backend
 {
 public:
     // constructor & destructor
@@ -16,11 +16,12 @@ public:
     ~SDLInterface();
 
     // public methods
-    bool Initialize();
-    void MainLoop();
-    void StopMainLoop();
+    bool Initialize() override;
+    void MainLoop() override;
+    void StopMainLoop() override;
 
-    std::function<void (uint8_t scancode)>  onKeyEvent;
+    bool IsRealTime() override;
+    void Advance(int64_t usec) override;
 
 private:
     std::atomic<bool> m_running;
@@ -0,0 +1,122 @@
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "SamplingProfiler.h"
+
+namespace
+{
+    const char* const HandlerName[] =
+    {
+        "host",
+        "idle",
+        "interpreter",
+        "threaded",
+        "blockcache",
+        "jit"
+    };
+}
+
+// constructor & destructor
+SamplingProfiler::SamplingProfiler(int intervalUs)
+    : m_current    (0)
+    , m_running    (false)
+    , m_intervalUs (intervalUs)
+{
+}
+
+SamplingProfiler::~SamplingProfiler()
+{
+    Stop();
+}
+
+// public methods
+void SamplingProfiler::Start()
+{
+    if (m_running)
+        return;
+
+    m_running = true;
+    m_thread  = std::thread(&SamplingProfiler::SamplerThread, this);
+}
+
+void SamplingProfiler::Stop()
+{
+    m_running = false;
+
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+void SamplingProfiler::Reset()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_counts.clear();
+}
+
+void SamplingProfiler::WriteFolded(FILE* file)
+{
+    std::vector<std::pair<uint64_t, uint64_t>> samples;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        samples.assign(m_counts.begin(), m_counts.end());
+    }
+
+    std::sort(samples.begin(), samples.end(),
+        [](const std::pair<uint64_t, uint64_t>& a, const std::pair<uint64_t, uint64_t>& b) { return a.second > b.second; });
+
+    for(const std::pair<uint64_t, uint64_t>& entry : samples)
+    {
+        uint64_t sample  = entry.first;
+        int      handler = (sample >> HandlerShift) & 0x0f;
+        uint16_t cs      = sample >> 16;
+        uint16_t ip      = sample;
+
+        if (handler == Host || handler == Idle)
+        {
+            fprintf(file, "%s", HandlerName[handler]);
+        }
+        else
+        {
+            // the segment frame groups the code of one guest module / overlay
+            fprintf(file, "%s;%04x;%04x:%04x", HandlerName[handler], cs, cs, ip);
+        }
+
+        if (sample & (1ull << InterruptFlag))
+        {
+            fprintf(file, ";int %02xh;ah=%02xh", static_cast<int>((sample >> InterruptShift) & 0xff), static_cast<int>((sample >> FunctionShift) & 0xff));
+        }
+
+        fprintf(file, " %" PRIu64 "\n", entry.second);
+    }
+
+    fflush(file);
+}
+
+// private methods
+void SamplingProfiler::SamplerThread()
+{
+    auto interval = std::chrono::microseconds(m_intervalUs);
+    auto next     = std::chrono::steady_clock::now() + interval;
+
+    while(m_running)
+    {
+        // fixed rate, a late wakeup does not shift the following samples - unless the
+        // host stalled us for longer than an interval, no burst of samples after that
+        std::this_thread::sleep_until(next);
+        next = std::max(next + interval, std::chrono::steady_clock::now());
+
+        uint64_t sample  = m_current.load(std::memory_order_relaxed);
+        int      handler = (sample >> HandlerShift) & 0x0f;
+
+        // the cs:ip the guest stopped at says nothing about host / idle time
+        if (handler == Host || handler == Idle)
+            sample &= ~0xffffffffull;
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        m_counts[sample]++;
+    }
+}
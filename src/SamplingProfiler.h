@@ -0,0 +1,89 @@
+#ifndef X86EMU_SAMPLING_PROFILER
+#define X86EMU_SAMPLING_PROFILER
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+// Statistical profiler - the emulator thread publishes where it is (cs:ip of the
+// instruction / block about to run, the code path running it, the HLE interrupt it is
+// in) with plain atomic stores, a host thread reads that every interval and counts it.
+// Unlike Profiler the guest runs at full speed, only Cpu::Run() pays a pointer test per
+// instruction / block. Cpu::SetSamplingProfiler() attaches it.
+class SamplingProfiler
+{
+public:
+    // code path running the guest
+    enum Handler
+    {
+        Host = 0,       // outside Cpu::Run(), device emulation and frame pacing
+        Idle,           // halted or waiting for the timer tick / retrace
+        Interpreter,
+        Threaded,
+        BlockCache,
+        Jit
+    };
+
+    // constructor & destructor
+    SamplingProfiler(int intervalUs);
+    ~SamplingProfiler();
+
+    // public methods
+    void Start();
+    void Stop();
+    void Reset();
+
+    // emulator thread
+    void Publish(uint16_t cs, uint16_t ip, Handler handler);
+    void EnterInterrupt(uint8_t intNo, uint8_t function);
+    void LeaveInterrupt();
+
+    // one "handler;segment;cs:ip[;int nn/ah] count" line per sampled location, the
+    // folded stack format of flamegraph.pl / speedscope / inferno
+    void WriteFolded(FILE* file);
+
+private:
+    // sample layout: cs:ip in bits 0 - 31, handler in 32 - 35, the HLE interrupt in
+    // 40 - 47 with bit 36 set while inside one, its function (ah) in 48 - 55
+    enum
+    {
+        HandlerShift   = 32,
+        InterruptFlag  = 36,
+        InterruptShift = 40,
+        FunctionShift  = 48
+    };
+
+    std::atomic<uint64_t> m_current;
+    std::atomic<bool>     m_running;
+    std::thread           m_thread;
+    int                   m_intervalUs;
+
+    std::mutex                             m_mutex;
+    std::unordered_map<uint64_t, uint64_t> m_counts;
+
+    void SamplerThread();
+};
+
+// public methods, the emulator thread is the only writer of m_current
+inline void SamplingProfiler::Publish(uint16_t cs, uint16_t ip, Handler handler)
+{
+    m_current.store((static_cast<uint64_t>(handler) << HandlerShift) | (static_cast<uint32_t>(cs) << 16) | ip, std::memory_order_relaxed);
+}
+
+inline void SamplingProfiler::EnterInterrupt(uint8_t intNo, uint8_t function)
+{
+    uint64_t sample = m_current.load(std::memory_order_relaxed) & 0xfffffffffull;
+
+    sample |= (1ull << InterruptFlag) | (static_cast<uint64_t>(intNo) << InterruptShift) | (static_cast<uint64_t>(function) << FunctionShift);
+    m_current.store(sample, std::memory_order_relaxed);
+}
+
+inline void SamplingProfiler::LeaveInterrupt()
+{
+    m_current.store(m_current.load(std::memory_order_relaxed) & 0xfffffffffull, std::memory_order_relaxed);
+}
+
+#endif /* X86EMU_SAMPLING_PROFILER */
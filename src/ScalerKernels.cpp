@@ -0,0 +1,337 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <immintrin.h>
+#include <algorithm>
+#include "ScalerKernels.h"
+
+#define TARGET_AVX2   __attribute__((target("avx2")))
+#define TARGET_AVX512 __attribute__((target("avx2,avx512f,avx512bw")))
+
+namespace
+{
+    // Output pixels of one filterLines8 step - the 24 samples of a pixel are spread
+    // over the a, b and c vectors, with 'lanes' pixels side by side in each
+    inline void storePixels(const short* out, int lanes, short* pixels, int stride)
+    {
+        for(int n = 0; n < lanes; n++)
+        {
+            short  s[24];
+            short* pixel = pixels + n * 3;
+
+            ::memcpy(s,      out + n * 8,             8 * sizeof(short));
+            ::memcpy(s + 8,  out + (lanes + n) * 8,   8 * sizeof(short));
+            ::memcpy(s + 16, out + (2 * lanes + n) * 8, 8 * sizeof(short));
+
+            for(int k = 0; k < 8; k++)
+            {
+                pixel[0] = s[k * 3];
+                pixel[1] = s[k * 3 + 1];
+                pixel[2] = s[k * 3 + 2];
+                pixel += stride;
+            }
+        }
+    }
+
+    inline int nextPhase(int fb, int bankLength)
+    {
+        return fb + 1 < bankLength ? fb + 1 : 0;
+    }
+
+    inline void filterPixelSse2(const short* lines, const short* coeffs, short* pixels, int stride)
+    {
+        __m128i a = _mm_setzero_si128();
+        __m128i b = _mm_setzero_si128();
+        __m128i c = _mm_setzero_si128();
+
+        const __m128i* lbt = reinterpret_cast<const __m128i *>(lines);
+
+        for(int m = 0; m < 8; m++)
+        {
+            __m128i cfp = _mm_set1_epi16(coeffs[m]);
+
+            a = _mm_add_epi16(a, _mm_mulhi_epi16(cfp, _mm_load_si128(lbt++)));
+            b = _mm_add_epi16(b, _mm_mulhi_epi16(cfp, _mm_load_si128(lbt++)));
+            c = _mm_add_epi16(c, _mm_mulhi_epi16(cfp, _mm_load_si128(lbt++)));
+        }
+
+        alignas(16) short out[24];
+
+        _mm_store_si128(reinterpret_cast<__m128i *>(out),      a);
+        _mm_store_si128(reinterpret_cast<__m128i *>(out + 8),  b);
+        _mm_store_si128(reinterpret_cast<__m128i *>(out + 16), c);
+
+        storePixels(out, 1, pixels, stride);
+    }
+
+    inline __m128i filterSamplesSse2(const short* const* rows, const __m128i* cfp, int n)
+    {
+        __m128i a = _mm_set1_epi16(-32768);
+
+        for(int m = 0; m < 4; m++)
+            a = _mm_add_epi16(a, _mm_mulhi_epi16(cfp[m], _mm_loadu_si128(reinterpret_cast<const __m128i *>(rows[m] + n))));
+
+        return a;
+    }
+
+    // 'count' rgb samples through the gamma table into xrgb pixels
+    inline void storeRgb(const uint16_t* samples, const uint8_t* linear, uint32_t* pixels, int count)
+    {
+        for(int x = 0; x < count; x++)
+        {
+            *pixels++ = (linear[samples[0]] << 16) +
+                        (linear[samples[1]] << 8) +
+                        (linear[samples[2]]);
+            samples += 3;
+        }
+    }
+
+    // SSE2
+    void filterLines8Sse2(const short* lines, short* pixels, int stride, int width,
+                          const short* coeffs, const char* incTbl, int bankLength)
+    {
+        int fb = 0;
+
+        for(int x = 0; x < width; x++)
+        {
+            filterPixelSse2(lines, coeffs + fb * 8, pixels + x * 3, stride);
+
+            lines += incTbl[fb] * 24;
+            fb     = nextPhase(fb, bankLength);
+        }
+    }
+
+    void filterRow4Sse2(const short* const* rows, const short* coeffs, const uint8_t* linear, uint32_t* pixels, int width)
+    {
+        alignas(16) uint16_t samples[24];
+        __m128i              cfp[4];
+
+        for(int m = 0; m < 4; m++)
+            cfp[m] = _mm_set1_epi16(coeffs[m]);
+
+        for(int x = 0; x < width; x += 8)
+        {
+            for(int k = 0; k < 3; k++)
+                _mm_store_si128(reinterpret_cast<__m128i *>(samples + k * 8), filterSamplesSse2(rows, cfp, x * 3 + k * 8));
+
+            storeRgb(samples, linear, pixels + x, std::min(width - x, 8));
+        }
+    }
+
+    // AVX2, two output pixels / 16 samples at a time
+    TARGET_AVX2 void filterLines8Avx2(const short* lines, short* pixels, int stride, int width,
+                                      const short* coeffs, const char* incTbl, int bankLength)
+    {
+        alignas(32) short out[48];
+
+        int fb = 0;
+        int x  = 0;
+
+        for(; x + 2 <= width; x += 2)
+        {
+            int          fb1    = nextPhase(fb, bankLength);
+            const short* lines1 = lines + incTbl[fb] * 24;
+            const short* cf0    = coeffs + fb * 8;
+            const short* cf1    = coeffs + fb1 * 8;
+
+            __m256i a = _mm256_setzero_si256();
+            __m256i b = _mm256_setzero_si256();
+            __m256i c = _mm256_setzero_si256();
+
+            const __m128i* lbt0 = reinterpret_cast<const __m128i *>(lines);
+            const __m128i* lbt1 = reinterpret_cast<const __m128i *>(lines1);
+
+            for(int m = 0; m < 8; m++)
+            {
+                __m256i cfp = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_set1_epi16(cf0[m])), _mm_set1_epi16(cf1[m]), 1);
+
+                a = _mm256_add_epi16(a, _mm256_mulhi_epi16(cfp, _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_load_si128(lbt0++)), _mm_load_si128(lbt1++), 1)));
+                b = _mm256_add_epi16(b, _mm256_mulhi_epi16(cfp, _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_load_si128(lbt0++)), _mm_load_si128(lbt1++), 1)));
+                c = _mm256_add_epi16(c, _mm256_mulhi_epi16(cfp, _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_load_si128(lbt0++)), _mm_load_si128(lbt1++), 1)));
+            }
+
+            _mm256_store_si256(reinterpret_cast<__m256i *>(out),      a);
+            _mm256_store_si256(reinterpret_cast<__m256i *>(out + 16), b);
+            _mm256_store_si256(reinterpret_cast<__m256i *>(out + 32), c);
+
+            storePixels(out, 2, pixels + x * 3, stride);
+
+            lines = lines1 + incTbl[fb1] * 24;
+            fb    = nextPhase(fb1, bankLength);
+        }
+
+        for(; x < width; x++)
+        {
+            filterPixelSse2(lines, coeffs + fb * 8, pixels + x * 3, stride);
+
+            lines += incTbl[fb] * 24;
+            fb     = nextPhase(fb, bankLength);
+        }
+    }
+
+    TARGET_AVX2 void filterRow4Avx2(const short* const* rows, const short* coeffs, const uint8_t* linear, uint32_t* pixels, int width)
+    {
+        alignas(32) uint16_t samples[24];
+        __m256i              cfp[4];
+        __m128i              cfp128[4];
+
+        for(int m = 0; m < 4; m++)
+        {
+            cfp[m]    = _mm256_set1_epi16(coeffs[m]);
+            cfp128[m] = _mm_set1_epi16(coeffs[m]);
+        }
+
+        for(int x = 0; x < width; x += 8)
+        {
+            __m256i a = _mm256_set1_epi16(-32768);
+            int     n = x * 3;
+
+            for(int m = 0; m < 4; m++)
+                a = _mm256_add_epi16(a, _mm256_mulhi_epi16(cfp[m], _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rows[m] + n))));
+
+            _mm256_store_si256(reinterpret_cast<__m256i *>(samples), a);
+            _mm_store_si128(reinterpret_cast<__m128i *>(samples + 16), filterSamplesSse2(rows, cfp128, n + 16));
+
+            storeRgb(samples, linear, pixels + x, std::min(width - x, 8));
+        }
+    }
+
+    // AVX-512, four output pixels / 32 samples at a time
+    TARGET_AVX512 inline __m512i load4(const __m128i* p0, const __m128i* p1, const __m128i* p2, const __m128i* p3)
+    {
+        __m512i v = _mm512_castsi128_si512(_mm_load_si128(p0));
+
+        v = _mm512_inserti32x4(v, _mm_load_si128(p1), 1);
+        v = _mm512_inserti32x4(v, _mm_load_si128(p2), 2);
+        v = _mm512_inserti32x4(v, _mm_load_si128(p3), 3);
+
+        return v;
+    }
+
+    TARGET_AVX512 void filterLines8Avx512(const short* lines, short* pixels, int stride, int width,
+                                          const short* coeffs, const char* incTbl, int bankLength)
+    {
+        alignas(64) short out[96];
+
+        int fb = 0;
+        int x  = 0;
+
+        for(; x + 4 <= width; x += 4)
+        {
+            const __m128i* lbt[4];
+            const short*   cf[4];
+
+            for(int n = 0; n < 4; n++)
+            {
+                lbt[n] = reinterpret_cast<const __m128i *>(lines);
+                cf[n]  = coeffs + fb * 8;
+                lines += incTbl[fb] * 24;
+                fb     = nextPhase(fb, bankLength);
+            }
+
+            __m512i a = _mm512_setzero_si512();
+            __m512i b = _mm512_setzero_si512();
+            __m512i c = _mm512_setzero_si512();
+
+            for(int m = 0; m < 8; m++)
+            {
+                __m512i cfp = _mm512_castsi128_si512(_mm_set1_epi16(cf[0][m]));
+
+                cfp = _mm512_inserti32x4(cfp, _mm_set1_epi16(cf[1][m]), 1);
+                cfp = _mm512_inserti32x4(cfp, _mm_set1_epi16(cf[2][m]), 2);
+                cfp = _mm512_inserti32x4(cfp, _mm_set1_epi16(cf[3][m]), 3);
+
+                a = _mm512_add_epi16(a, _mm512_mulhi_epi16(cfp, load4(lbt[0]++, lbt[1]++, lbt[2]++, lbt[3]++)));
+                b = _mm512_add_epi16(b, _mm512_mulhi_epi16(cfp, load4(lbt[0]++, lbt[1]++, lbt[2]++, lbt[3]++)));
+                c = _mm512_add_epi16(c, _mm512_mulhi_epi16(cfp, load4(lbt[0]++, lbt[1]++, lbt[2]++, lbt[3]++)));
+            }
+
+            _mm512_store_si512(out,      a);
+            _mm512_store_si512(out + 32, b);
+            _mm512_store_si512(out + 64, c);
+
+            storePixels(out, 4, pixels + x * 3, stride);
+        }
+
+        for(; x < width; x++)
+        {
+            filterPixelSse2(lines, coeffs + fb * 8, pixels + x * 3, stride);
+
+            lines += incTbl[fb] * 24;
+            fb     = nextPhase(fb, bankLength);
+        }
+    }
+
+    TARGET_AVX512 void filterRow4Avx512(const short* const* rows, const short* coeffs, const uint8_t* linear, uint32_t* pixels, int width)
+    {
+        alignas(64) uint16_t samples[48];
+        __m512i              cfp[4];
+        __m256i              cfp256[4];
+
+        for(int m = 0; m < 4; m++)
+        {
+            cfp[m]    = _mm512_set1_epi16(coeffs[m]);
+            cfp256[m] = _mm256_set1_epi16(coeffs[m]);
+        }
+
+        int x = 0;
+
+        for(; x + 16 <= width; x += 16)
+        {
+            __m512i a = _mm512_set1_epi16(-32768);
+            __m256i b = _mm256_set1_epi16(-32768);
+            int     n = x * 3;
+
+            for(int m = 0; m < 4; m++)
+            {
+                a = _mm512_add_epi16(a, _mm512_mulhi_epi16(cfp[m], _mm512_loadu_si512(rows[m] + n)));
+                b = _mm256_add_epi16(b, _mm256_mulhi_epi16(cfp256[m], _mm256_loadu_si256(reinterpret_cast<const __m256i *>(rows[m] + n + 32))));
+            }
+
+            _mm512_store_si512(samples, a);
+            _mm256_store_si256(reinterpret_cast<__m256i *>(samples + 32), b);
+
+            storeRgb(samples, linear, pixels + x, 16);
+        }
+
+        if (x < width)
+        {
+            const short* rest[4] = { rows[0] + x * 3, rows[1] + x * 3, rows[2] + x * 3, rows[3] + x * 3 };
+
+            filterRow4Avx2(rest, coeffs, linear, pixels + x, width - x);
+        }
+    }
+
+    const ScalerKernels s_sse2   = { "sse2",    filterLines8Sse2,   filterRow4Sse2   };
+    const ScalerKernels s_avx2   = { "avx2",    filterLines8Avx2,   filterRow4Avx2   };
+    const ScalerKernels s_avx512 = { "avx512",  filterLines8Avx512, filterRow4Avx512 };
+
+    const ScalerKernels& selectKernels()
+    {
+        bool        avx2   = __builtin_cpu_supports("avx2");
+        bool        avx512 = __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+        const char* force  = ::getenv("X86EMU_SCALER");
+
+        // X86EMU_SCALER=sse2|avx2|avx512 limits the choice, for testing and comparison
+        if (force != nullptr)
+        {
+            if (::strcmp(force, "sse2") == 0)
+                avx2 = avx512 = false;
+            else if (::strcmp(force, "avx2") == 0)
+                avx512 = false;
+        }
+
+        const ScalerKernels& kernels = avx512 ? s_avx512 : (avx2 ? s_avx2 : s_sse2);
+
+        printf("ScalerKernels::Get() using %s\n", kernels.name);
+        return kernels;
+    }
+
+} // anonymous namespace
+
+const ScalerKernels& ScalerKernels::Get()
+{
+    static const ScalerKernels& kernels = selectKernels();
+
+    return kernels;
+}
@@ -0,0 +1,33 @@
+#ifndef X86EMU_SCALER_KERNELS
+#define X86EMU_SCALER_KERNELS
+
+#include <inttypes.h>
+
+// Inner loops of the filtered VGA scaler, built for SSE2, AVX2 and AVX-512 from the
+// same binary. Get() picks the widest set the host runs on first use, the rest of the
+// build only assumes SSE2. All of them give bit-identical results.
+//
+// Samples are 16 bit linear light values; coefficients multiply as signed 1.15 fixed
+// point (the high half of the product), the same as _mm_mulhi_epi16().
+struct ScalerKernels
+{
+    const char* name;
+
+    // Horizontal pass over 8 source lines at once. Source pixel n of the line buffer
+    // is 24 shorts, rgb of line 0 to 7; output pixel x is written as 3 shorts to x * 3
+    // of 8 rows of 'pixels', 'stride' shorts apart. Output pixel x takes the 8 taps of
+    // filter phase fb from 'coeffs', then the line buffer moves on incTbl[fb] source
+    // pixels and fb to the next phase, wrapping at bankLength.
+    void (*filterLines8)(const short* lines, short* pixels, int stride, int width,
+                         const short* coeffs, const char* incTbl, int bankLength);
+
+    // Vertical pass, 'width' pixels of four pixel buffer rows weighted by coeffs[0 .. 3]
+    // into xrgb through the gamma table 'linear', indexed by the sum offset by 32768.
+    // The rows hold 'width' rounded up to 8 pixels.
+    void (*filterRow4)(const short* const* rows, const short* coeffs, const uint8_t* linear,
+                       uint32_t* pixels, int width);
+
+    static const ScalerKernels& Get();
+};
+
+#endif /* X86EMU_SCALER_KERNELS */
@@ -0,0 +1,182 @@
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include "Tracer.h"
+
+// constructor & destructor
+Tracer::Tracer(const char* path, std::size_t fileRecords)
+    : m_file         (fopen(path, "wb"))
+    , m_capacity     (std::max<std::size_t>(fileRecords, KeyframeInterval))
+    , m_ring         (RingSize)
+    , m_head         (0)
+    , m_tail         (0)
+    , m_running      (false)
+    , m_nextKeyframe (0)
+{
+    ::memset(m_shadow, 0, sizeof(m_shadow));
+
+    if (m_file)
+    {
+        WriteHeader(0);
+
+        m_running = true;
+        m_thread  = std::thread(&Tracer::FlushThread, this);
+    }
+}
+
+Tracer::~Tracer()
+{
+    Stop();
+
+    if (m_file)
+        fclose(m_file);
+}
+
+// public methods
+bool Tracer::IsOpen()
+{
+    return m_file != nullptr;
+}
+
+void Tracer::Record(uint16_t cs, uint16_t ip, const uint8_t* code, const uint16_t* regs, const uint16_t* regsHigh)
+{
+    uint16_t    current[TraceRecord::RegisterCount];
+    TraceRecord record;
+
+    ::memcpy(current, regs, 16 * sizeof(uint16_t));
+    ::memcpy(current + 16, regsHigh, 8 * sizeof(uint16_t));
+
+    record.instruction.type  = TraceRecord::Instruction;
+    record.instruction.count = 0;
+    record.instruction.cs    = cs;
+    record.instruction.ip    = ip;
+    ::memcpy(record.instruction.code, code, TraceRecord::CodeBytes);
+
+    bool keyframe = m_head.load(std::memory_order_relaxed) >= m_nextKeyframe;
+
+    for(int reg = 0; reg < TraceRecord::RegisterCount && !keyframe; reg++)
+    {
+        if (current[reg] == m_shadow[reg] || reg == TraceRecord::RegisterCS || reg == TraceRecord::RegisterIP)
+            continue;
+
+        // pusha, popa & co. - cheaper to write the whole register file
+        if (record.instruction.count == TraceRecord::MaxDeltas)
+        {
+            keyframe = true;
+            break;
+        }
+
+        record.instruction.reg[record.instruction.count]   = reg;
+        record.instruction.value[record.instruction.count] = current[reg];
+        record.instruction.count++;
+    }
+
+    if (keyframe)
+    {
+        PushState(current);
+
+        record.instruction.count = 0;
+        m_nextKeyframe           = m_head.load(std::memory_order_relaxed) + KeyframeInterval;
+    }
+
+    ::memcpy(m_shadow, current, sizeof(m_shadow));
+    Push(record);
+}
+
+void Tracer::Stop()
+{
+    m_running = false;
+
+    if (m_thread.joinable())
+        m_thread.join();
+}
+
+// private methods
+void Tracer::Push(const TraceRecord& record)
+{
+    uint64_t head = m_head.load(std::memory_order_relaxed);
+
+    // ring full, wait for the background thread
+    while(head - m_tail.load(std::memory_order_acquire) >= RingSize && m_running)
+    {
+        std::this_thread::yield();
+    }
+
+    m_ring[head & (RingSize - 1)] = record;
+    m_head.store(head + 1, std::memory_order_release);
+}
+
+void Tracer::PushState(const uint16_t* regs)
+{
+    for(int first = 0; first < TraceRecord::RegisterCount; first += TraceRecord::StateValues)
+    {
+        TraceRecord record;
+        int         count = std::min<int>(TraceRecord::RegisterCount - first, TraceRecord::StateValues);
+
+        ::memset(&record, 0, sizeof(record));
+        record.state.type  = TraceRecord::State;
+        record.state.first = first;
+        ::memcpy(record.state.value, regs + first, count * sizeof(uint16_t));
+
+        Push(record);
+    }
+}
+
+void Tracer::Flush(uint64_t head)
+{
+    uint64_t tail = m_tail.load(std::memory_order_relaxed);
+
+    while(tail < head)
+    {
+        // a run contiguous in both the ring and the file
+        uint64_t slot  = tail % m_capacity;
+        uint64_t count = std::min<uint64_t>({ head - tail, RingSize - (tail & (RingSize - 1)), m_capacity - slot });
+
+        fseek(m_file, sizeof(TraceFileHeader) + slot * sizeof(TraceRecord), SEEK_SET);
+        fwrite(&m_ring[tail & (RingSize - 1)], sizeof(TraceRecord), count, m_file);
+
+        tail += count;
+        m_tail.store(tail, std::memory_order_release);
+    }
+
+    WriteHeader(tail);
+}
+
+void Tracer::WriteHeader(uint64_t count)
+{
+    TraceFileHeader header;
+
+    ::memset(&header, 0, sizeof(header));
+    ::memcpy(header.magic, "X86TRACE", sizeof(header.magic));
+    header.version    = 1;
+    header.recordSize = sizeof(TraceRecord);
+    header.capacity   = m_capacity;
+    header.count      = count;
+
+    fseek(m_file, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, m_file);
+    fflush(m_file);
+}
+
+void Tracer::FlushThread()
+{
+    while(true)
+    {
+        // read before the head, so the last records are written before leaving
+        bool     running = m_running;
+        uint64_t head    = m_head.load(std::memory_order_acquire);
+
+        if (head != m_tail.load(std::memory_order_relaxed))
+        {
+            Flush(head);
+        }
+        else if (!running)
+        {
+            break;
+        }
+        else
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
@@ -0,0 +1,111 @@
+#ifndef X86EMU_TRACER
+#define X86EMU_TRACER
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// One 32 byte slot of the trace. An instruction record holds cs:ip and the first code
+// bytes of the instruction about to run plus up to six registers that changed since
+// the previous record; state records carry the full register file instead, 15 values
+// each starting at register 'first'. Registers are numbered like the Cpu's register
+// file (AX .. FLAG), 16 - 23 are the upper halves of eax .. edi.
+union TraceRecord
+{
+    enum Type
+    {
+        Empty = 0,
+        Instruction,
+        State
+    };
+
+    enum
+    {
+        CodeBytes     = 8,
+        MaxDeltas     = 6,
+        StateValues   = 15,
+        RegisterCount = 24,
+
+        RegisterCS    = 0x09,   // part of every instruction record
+        RegisterIP    = 0x0c
+    };
+
+    struct
+    {
+        uint8_t  type;
+        uint8_t  count;
+        uint16_t cs;
+        uint16_t ip;
+        uint8_t  code[CodeBytes];
+        uint8_t  reg[MaxDeltas];
+        uint16_t value[MaxDeltas];
+    } instruction;
+
+    struct
+    {
+        uint8_t  type;
+        uint8_t  first;
+        uint16_t value[StateValues];
+    } state;
+};
+
+// Trace file - the header followed by 'capacity' record slots. Record n goes to slot
+// n % capacity, so the file always holds the last 'capacity' records of 'count'.
+struct TraceFileHeader
+{
+    char     magic[8];      // "X86TRACE"
+    uint32_t version;
+    uint32_t recordSize;
+    uint64_t capacity;
+    uint64_t count;
+};
+
+// Binary execution trace. The emulator thread appends records to a single producer /
+// single consumer ring without locking, a background thread moves them to the trace
+// file; a full ring makes the emulator wait rather than lose records, since every
+// record depends on the one before. The full register state is written every
+// KeyframeInterval records, so a reader can start anywhere in the file. Cpu::SetTracer()
+// attaches it, after which Run() executes every instruction through the interpreter.
+class Tracer
+{
+public:
+    // constructor & destructor
+    Tracer(const char* path, std::size_t fileRecords);
+    ~Tracer();
+
+    // public methods
+    bool IsOpen();
+    void Record(uint16_t cs, uint16_t ip, const uint8_t* code, const uint16_t* regs, const uint16_t* regsHigh);
+
+    // writes out what is still in the ring and stops the background thread
+    void Stop();
+
+private:
+    enum
+    {
+        RingSize         = 1 << 16,     // records, a power of two
+        KeyframeInterval = 1 << 16
+    };
+
+    FILE*                    m_file;
+    uint64_t                 m_capacity;
+    std::vector<TraceRecord> m_ring;
+    std::atomic<uint64_t>    m_head;            // next record to write, emulator thread
+    std::atomic<uint64_t>    m_tail;            // next record to flush, background thread
+    std::atomic<bool>        m_running;
+    std::thread              m_thread;
+
+    uint16_t                 m_shadow[TraceRecord::RegisterCount];
+    uint64_t                 m_nextKeyframe;
+
+    // private methods
+    void Push(const TraceRecord& record);
+    void PushState(const uint16_t* regs);
+    void Flush(uint64_t head);
+    void WriteHeader(uint64_t count);
+    void FlushThread();
+};
+
+#endif /* X86EMU_TRACER */
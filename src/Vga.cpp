@@ -2,10 +2,15 @@
 #include <stdlib.h>
 #include <math.h>
 #include <string.h>
+#include <immintrin.h>
+#include <algorithm>
 #include <vector>
+#include "Bus.h"
 #include "Memory.h"
 #include "Vga.h"
+#include "ScalerKernels.h"
 #include "VgaTables.h"
+#include "WorkerPool.h"
 
 #define MAX_H_CUTOFF 0.8
 #define MAX_V_CUTOFF 0.85
@@ -42,6 +47,56 @@ namespace
         return value > 63 ? 63 : value;
     }
 
+    // 'count' pixels of src with each repeated 'scale' times
+    void replicatePixels(const uint32_t* src, int scale, uint32_t* dst, int count)
+    {
+        int x = 0;
+
+        if (scale == 1)
+        {
+            ::memcpy(dst, src, count * sizeof(uint32_t));
+            return;
+        }
+
+        if (scale == 2)
+        {
+            for(; x + 8 <= count; x += 8)
+            {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x / 2));
+
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x),     _mm_unpacklo_epi32(v, v));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x + 4), _mm_unpackhi_epi32(v, v));
+            }
+        }
+        else
+        {
+            // four copies at a time, the last store may run into the next pixel's
+            // place which is written right after
+            for(; x + scale + 3 <= count; x += scale)
+            {
+                __m128i v = _mm_set1_epi32(src[x / scale]);
+
+                for(int n = 0; n < scale; n += 4)
+                    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + x + n), v);
+            }
+        }
+
+        for(; x < count; x++)
+            dst[x] = src[x / scale];
+    }
+
+    // any of the lines first..last changed, lines outside 0..count-1 never do
+    bool anyDirty(const bool* dirty, int count, int first, int last)
+    {
+        for(int n = std::max(first, 0); n <= last && n < count; n++)
+        {
+            if (dirty[n])
+                return true;
+        }
+
+        return false;
+    }
+
     void BlackmanNuttallWindow(double* window, int size)
     {
         double a0 = 0.3635819;
@@ -79,7 +134,7 @@ Vga::Vga(Memory& memory)
     for(int n = 0; n < 35; n++)
         m_crtCtrlReg[n] = 0;
 
-    m_verticalRetraceCnt = 0;
+    m_frameTime = 0;
 
     m_chain4            = true;
     m_readPlaneIdx      = 0;
@@ -95,11 +150,25 @@ Vga::Vga(Memory& memory)
     m_cursorBlinkCnt = 0;
 
     // Alloc memory
-    m_linear       = reinterpret_cast<uint8_t *>(aligned_alloc(32,  64 * 1024 + 1024));
-    m_videoMem     = memory.GetVgaMem();
-    m_videoMemText = m_videoMem + 0x18000; //memory.GetMem() + 0xb8000;
-    m_linebuffer   = reinterpret_cast<__m128i *>(aligned_alloc(32, 2048 * 8 * 3 * sizeof(short)));
-    m_pixelbuffer  = nullptr;
+    m_linear          = reinterpret_cast<uint8_t *>(aligned_alloc(32,  64 * 1024 + 1024));
+    m_videoMem        = memory.GetVgaMem();
+    m_videoMemText    = m_videoMem + 0x18000; //memory.GetMem() + 0xb8000;
+    m_workers         = new WorkerPool(std::max(std::min<int>(std::thread::hardware_concurrency(), MaxRenderThreads), 1));
+    m_linebuffer      = reinterpret_cast<short *>(aligned_alloc(64, m_workers->GetThreadCount() * LineBufferSize * sizeof(short)));
+    m_pixelbuffer     = nullptr;
+    m_pixelbufferSize = 0;
+    m_kernels         = &ScalerKernels::Get();
+
+    // Nothing drawn yet
+    for(int n = 0; n < SourceLines; n++)
+        m_lineDirty[n] = 0;
+
+    m_allDirty     = true;
+    m_lastPixels   = nullptr;
+    m_lastStride   = 0;
+    m_lastWidth    = 0;
+    m_lastHeight   = 0;
+    m_integerScale = false;
 
     // Setup conversion tables (gamma correct <-> linear)
     for(int n = 0; n < 64; n++)
@@ -160,11 +229,23 @@ Vga::~Vga()
     ::free(m_linear);
     ::free(m_linebuffer);
 
+    delete m_workers;
+
     if (m_pixelbuffer)
         ::free(m_pixelbuffer);
 }
 
 // public methods
+void Vga::RegisterPorts(Bus& bus)
+{
+    bus.Register(0x3c0, 0x20, this);
+
+    // index / data register pairs take out dx, ax in one go
+    bus.Register16(0x3c4, 2, this);
+    bus.Register16(0x3ce, 2, this);
+    bus.Register16(0x3d4, 2, this);
+}
+
 uint8_t Vga::PortRead(uint16_t port)
 {
     if (port == 0x3c9)
@@ -256,27 +337,14 @@ uint8_t Vga::PortRead(uint16_t port)
     }
     else if (port == 0x3da)
     {
-        // TODO: stub
-        m_verticalRetraceCnt++;
-        uint8_t result;
-
-        if (m_verticalRetraceCnt >= 6000)
-            m_verticalRetraceCnt = 0;
+        // status follows emulated time, see Process()
+        int     line   = m_frameTime / LineNs;
+        bool    active = line < DisplayLines && (m_frameTime % LineNs) < ActiveLineNs;
+        uint8_t result = active ? 0x00 : 0x01; // display disabled
 
-        if (m_verticalRetraceCnt < 4000)
-        {
-            result = m_verticalRetraceCnt & 1;
-        }
-        else if (m_verticalRetraceCnt < 5000)
-        {
-            result =  0x08;
-        }
-        else
-        {
-            result =  0x01; // no retrace, no display
-        }
+        if (line >= RetraceStartLine && line < RetraceEndLine)
+            result |= 0x08; // vertical retrace
 
-        //printf("VGA retrace cnt %d res %02x\n", m_verticalRetraceCnt, result);
         return result;
     }
     else
@@ -311,6 +379,8 @@ void Vga::PortWrite(uint16_t port, uint8_t value)
             (static_cast<uint64_t>(m_luminance[maxBright(m_vgaColorMap[idx][0])]) << 32) +
             (static_cast<uint64_t>(m_luminance[maxBright(m_vgaColorMap[idx][1])]) << 16) +
             (static_cast<uint64_t>(m_luminance[maxBright(m_vgaColorMap[idx][2])]));
+
+        m_allDirty = true;
     }
     else if (port == 0x3c4) // Sequencer register index
     {
@@ -367,16 +437,7 @@ void Vga::PortWrite(uint16_t port, uint8_t value)
 
         if (m_sequencerIdx == 2 || m_sequencerIdx == 4)
         {
-            uint8_t planeMask = m_sequencerReg[2];
-
-            m_chain4 = (m_sequencerReg[4] & 8) != 0;
-
-            m_writePlaneMask  =  (planeMask & 1) ? 0xff : 0x00;
-            m_writePlaneMask |= ((planeMask & 2) ? 0xff : 0x00) << 8;
-            m_writePlaneMask |= ((planeMask & 4) ? 0xff : 0x00) << 16;
-            m_writePlaneMask |= ((planeMask & 8) ? 0xff : 0x00) << 24;
-
-            m_writePlaneMaskInv = ~m_writePlaneMask;
+            UpdateWritePlaneMask();
         }
     }
     else if (port == 0x3cf && m_graphicsCtrlIdx < 9) // Graphics Controller register write
@@ -468,7 +529,13 @@ void Vga::PortWrite(uint16_t port, uint8_t value)
         }
         else if (m_crtCtrlIdx == 12 || m_crtCtrlIdx == 13)
         {
-            m_startAddress = (m_crtCtrlReg[12] << 10) | (m_crtCtrlReg[13] << 2);
+            uint32_t startAddress = (m_crtCtrlReg[12] << 10) | (m_crtCtrlReg[13] << 2);
+
+            if (startAddress != m_startAddress)
+            {
+                m_startAddress = startAddress;
+                m_allDirty     = true;
+            }
         }
     }
     else
@@ -477,6 +544,23 @@ void Vga::PortWrite(uint16_t port, uint8_t value)
     }
 }
 
+void Vga::PortWrite16(uint16_t port, uint16_t value)
+{
+    // out dx, ax to an index register loads the index and its data register at once;
+    // plane mask writes are the common case in planar modes and skip the logging path
+    if (port == 0x3c4 && (value & 0xff) == 2)
+    {
+        m_sequencerIdx    = 2;
+        m_sequencerReg[2] = value >> 8;
+        UpdateWritePlaneMask();
+    }
+    else
+    {
+        PortWrite(port, value & 0xff);
+        PortWrite(port + 1, value >> 8);
+    }
+}
+
 uint8_t Vga::MemRead(uint32_t addr)
 {
     if (m_chain4)
@@ -495,9 +579,12 @@ void Vga::MemWrite(uint32_t addr, uint8_t value)
     if (m_chain4)
     {
         m_videoMem[addr] = value;
+        MarkDirty(addr);
     }
     else
     {
+        MarkDirty(addr * 4);
+
         if (m_writeMode == 0)
         {
             uint32_t *pixels = reinterpret_cast<uint32_t*>(m_videoMem) + addr;
@@ -512,16 +599,139 @@ void Vga::MemWrite(uint32_t addr, uint8_t value)
     }
 }
 
+// Same as MemWrite() for 'count' consecutive addresses, with the write mode and plane
+// mask applied to four pixels (16 planar bytes) at a time
+void Vga::MemWriteBlock(uint32_t addr, const uint8_t* data, uint32_t count)
+{
+    if (m_chain4)
+    {
+        ::memcpy(m_videoMem + addr, data, count);
+        MarkDirty(addr, count);
+        return;
+    }
+
+    if (m_writeMode != 0)
+    {
+        MemFillBlock(addr, 0, count);
+        return;
+    }
+
+    MarkDirty(addr * 4, count * 4);
+
+    uint32_t* pixels = reinterpret_cast<uint32_t*>(m_videoMem) + addr;
+    __m128i   mask   = _mm_set1_epi32(m_writePlaneMask);
+    __m128i   inv    = _mm_set1_epi32(m_writePlaneMaskInv);
+    uint32_t  n      = 0;
+
+    for(; n + 16 <= count; n += 16)
+    {
+        // replicate every byte to all four planes
+        __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + n));
+        __m128i lo    = _mm_unpacklo_epi8(bytes, bytes);
+        __m128i hi    = _mm_unpackhi_epi8(bytes, bytes);
+        __m128i values[4] =
+        {
+            _mm_unpacklo_epi16(lo, lo), _mm_unpackhi_epi16(lo, lo),
+            _mm_unpacklo_epi16(hi, hi), _mm_unpackhi_epi16(hi, hi)
+        };
+
+        for(int i = 0; i < 4; i++)
+        {
+            __m128i* dst = reinterpret_cast<__m128i*>(pixels + n + i * 4);
+            __m128i  old = _mm_loadu_si128(dst);
+
+            _mm_storeu_si128(dst, _mm_or_si128(_mm_and_si128(old, inv), _mm_and_si128(values[i], mask)));
+        }
+    }
+
+    for(; n < count; n++)
+    {
+        uint32_t values = data[n] * 0x01010101u;
+
+        pixels[n] = (pixels[n] & m_writePlaneMaskInv) | (values & m_writePlaneMask);
+    }
+}
+
+void Vga::MemFillBlock(uint32_t addr, uint8_t value, uint32_t count)
+{
+    if (m_chain4)
+    {
+        ::memset(m_videoMem + addr, value, count);
+        MarkDirty(addr, count);
+        return;
+    }
+
+    MarkDirty(addr * 4, count * 4);
+
+    uint32_t* pixels = reinterpret_cast<uint32_t*>(m_videoMem) + addr;
+    uint32_t  keep   = m_writePlaneMaskInv;
+    uint32_t  values = value * 0x01010101u;
+    uint32_t  n      = 0;
+
+    // write mode 1 stores the latches to every pixel
+    if (m_writeMode != 0)
+    {
+        keep   = 0;
+        values = m_latch;
+    }
+    else
+    {
+        values &= m_writePlaneMask;
+    }
+
+    __m128i vkeep   = _mm_set1_epi32(keep);
+    __m128i vvalues = _mm_set1_epi32(values);
+
+    for(; n + 4 <= count; n += 4)
+    {
+        __m128i* dst = reinterpret_cast<__m128i*>(pixels + n);
+
+        _mm_storeu_si128(dst, _mm_or_si128(_mm_and_si128(_mm_loadu_si128(dst), vkeep), vvalues));
+    }
+
+    for(; n < count; n++)
+        pixels[n] = (pixels[n] & keep) | values;
+}
+
+void Vga::Process(int64_t nsec)
+{
+    m_frameTime = (m_frameTime + nsec) % FrameNs;
+}
+
+int64_t Vga::TimeToNextEvent()
+{
+    // nanoseconds until the input status register at 0x3da changes
+    int64_t line = m_frameTime / LineNs;
+    int64_t x    = m_frameTime % LineNs;
+
+    if (line < DisplayLines && x < ActiveLineNs)
+        return ActiveLineNs - x;
+
+    if (line < DisplayLines - 1)
+        return LineNs - x;
+
+    if (line < RetraceStartLine)
+        return RetraceStartLine * LineNs - m_frameTime;
+
+    if (line < RetraceEndLine)
+        return RetraceEndLine * LineNs - m_frameTime;
+
+    return FrameNs - m_frameTime;
+}
+
 void Vga::SetCursorPos(uint8_t x, uint8_t y)
 {
+    MarkCursorDirty();
     m_cursorX = x;
     m_cursorY = y;
+    MarkCursorDirty();
 }
 
 void Vga::SetCursorType(uint8_t start, uint8_t end)
 {
     m_cursorStart = start;
     m_cursorEnd = end;
+    MarkCursorDirty();
 }
 
 
@@ -576,6 +786,7 @@ void Vga::SetMode(Vga::Mode mode)
     m_currentWidth  = 0;
     m_currentHeight = 0;
     m_chain4        = true;
+    m_allDirty      = true;
 
     if (m_currentMode == Vga::Mode13h)
     {
@@ -594,8 +805,29 @@ void Vga::SetMode(Vga::Mode mode)
     }
 }
 
+void Vga::SetIntegerScale(bool enabled)
+{
+    m_integerScale = enabled;
+    m_allDirty     = true;
+}
+
+// The frame in the scaling mode selected with SetIntegerScale()
+void Vga::DrawScreen(uint8_t* pixels, int width, int height, int stride)
+{
+    if (m_integerScale)
+    {
+        DrawScreenInteger(pixels, width, height, stride);
+    }
+    else
+    {
+        DrawScreenFiltered(pixels, width, height, stride);
+    }
+}
+
 void Vga::DrawScreenFiltered(uint8_t* pixels, int width, int height, int stride)
 {
+    BeginFrame(pixels, width, height, stride);
+
     if (m_currentMode == Mode::Mode13h)
     {
         DrawMode13hScreenFiltered(pixels, width, height, stride);
@@ -605,10 +837,79 @@ void Vga::DrawScreenFiltered(uint8_t* pixels, int width, int height, int stride)
         DrawTextModeScreenFiltered(pixels, width, height, stride);
     }
 
-    if (++m_cursorBlinkCnt > 36)
+    EndFrame();
+}
+
+// Nearest neighbour scaling of 320x200 / 720x400 by the largest whole factor that fits,
+// centred on black; a fraction of the cost of the filtered scaler
+void Vga::DrawScreenInteger(uint8_t* pixels, int width, int height, int stride)
+{
+    BeginFrame(pixels, width, height, stride);
+
+    bool text      = m_currentMode == Mode::Text;
+    int  srcWidth  = text ? 720 : 320;
+    int  srcHeight = text ? 400 : 200;
+    int  scale     = std::max(std::min(width / srcWidth, height / srcHeight), 1);
+    int  outWidth  = std::min(srcWidth * scale, width);
+    int  outHeight = std::min(srcHeight * scale, height);
+    int  left      = (width - outWidth) / 2;
+    int  top       = (height - outHeight) / 2;
+
+    bool dirty[SourceLines];
+
+    // a full redraw clears the borders too
+    if (TakeDirtyLines(dirty, srcHeight))
     {
-        m_cursorBlinkCnt = 0;
+        for(int y = 0; y < height; y++)
+        {
+            uint8_t* row = pixels + y * stride;
+
+            if (y < top || y >= top + outHeight)
+            {
+                ::memset(row, 0, width * sizeof(uint32_t));
+            }
+            else
+            {
+                ::memset(row, 0, left * sizeof(uint32_t));
+                ::memset(row + (left + outWidth) * sizeof(uint32_t), 0, (width - left - outWidth) * sizeof(uint32_t));
+            }
+        }
+    }
+
+    uint32_t palette[256];
+    uint32_t line[720];
+
+    for(int n = 0; n < 256; n++)
+    {
+        palette[n] = 0;
+
+        for(int c = 0; c < 3; c++)
+        {
+            uint8_t value = maxBright(m_vgaColorMap[n][c]);
+
+            palette[n] = (palette[n] << 8) | (value << 2) | (value >> 4);
+        }
     }
+
+    for(int y = 0; y < srcHeight && y * scale < outHeight; y++)
+    {
+        if (!dirty[y])
+            continue;
+
+        if (text)
+            DrawTextModeLineXrgb(line, y, palette);
+        else
+            DrawMode13hLineXrgb(line, y, palette);
+
+        uint32_t* row = reinterpret_cast<uint32_t *>(pixels + (top + y * scale) * stride) + left;
+
+        replicatePixels(line, scale, row, outWidth);
+
+        for(int n = 1; n < scale && y * scale + n < outHeight; n++)
+            ::memcpy(pixels + (top + y * scale + n) * stride + left * sizeof(uint32_t), row, outWidth * sizeof(uint32_t));
+    }
+
+    EndFrame();
 }
 
 void Vga::Screenshot()
@@ -640,6 +941,121 @@ void Vga::Screenshot()
     fclose(file);
 }
 
+// File of designed filter banks, so a window size seen in an earlier run is ready at
+// once: "X86FLTR1", then per bank the DesignFilter() parameters and the bank.
+bool Vga::LoadFilterCache(const char* path)
+{
+    FILE* file = ::fopen(path, "rb");
+
+    if (file == nullptr)
+        return false;
+
+    char magic[8];
+    bool damaged = false;
+
+    std::list<std::pair<FilterKey, FilterBank>> banks;
+
+    if (::fread(magic, 1, 8, file) != 8 || ::memcmp(magic, "X86FLTR1", 8) != 0)
+    {
+        printf("Vga::LoadFilterCache() %s is not a filter cache\n", path);
+        ::fclose(file);
+        return false;
+    }
+
+    while(m_filterCache.size() + banks.size() < FilterCacheSize)
+    {
+        FilterKey  key;
+        FilterBank bank;
+        int32_t    header[7];
+        std::size_t count = ::fread(header, sizeof(int32_t), 7, file);
+
+        // end of the file, only between two banks
+        if (count == 0)
+            break;
+
+        if (count != 7 || ::fread(&key.cutoff, sizeof(double), 1, file) != 1)
+        {
+            damaged = true;
+            break;
+        }
+
+        key.inputRate     = header[0];
+        key.outputRate    = header[1];
+        key.taps          = header[2];
+        bank.I            = header[3];
+        bank.D            = header[4];
+        bank.bankLength   = header[5];
+        bank.filterLength = header[6];
+
+        // sizes are checked before reading the bank, everything else after
+        if (bank.bankLength <= 0 || bank.bankLength > 65536 || bank.filterLength <= 0 || bank.filterLength > 64)
+        {
+            damaged = true;
+            break;
+        }
+
+        bank.coeffs.resize(bank.bankLength * bank.filterLength);
+        bank.incTbl.resize(bank.bankLength);
+
+        if (::fread(bank.coeffs.data(), sizeof(short), bank.coeffs.size(), file) != bank.coeffs.size() ||
+            ::fread(bank.incTbl.data(), sizeof(char), bank.incTbl.size(), file) != bank.incTbl.size() ||
+            !IsValidFilterBank(key, bank))
+        {
+            damaged = true;
+            break;
+        }
+
+        banks.emplace_back(key, std::move(bank));
+    }
+
+    ::fclose(file);
+
+    // a truncated, damaged or stale file is dropped as a whole
+    if (damaged)
+    {
+        printf("Vga::LoadFilterCache() %s is damaged or out of date, ignored\n", path);
+        return false;
+    }
+
+    printf("Vga::LoadFilterCache() %zu filter banks from %s\n", banks.size(), path);
+    m_filterCache.splice(m_filterCache.end(), banks);
+
+    return true;
+}
+
+bool Vga::SaveFilterCache(const char* path)
+{
+    FILE* file = ::fopen(path, "wb");
+
+    if (file == nullptr)
+    {
+        printf("Vga::SaveFilterCache() unable to create %s\n", path);
+        return false;
+    }
+
+    ::fwrite("X86FLTR1", 1, 8, file);
+
+    for(const auto& entry : m_filterCache)
+    {
+        const FilterKey&  key  = entry.first;
+        const FilterBank& bank = entry.second;
+
+        int32_t header[7] =
+        {
+            key.inputRate, key.outputRate, key.taps,
+            bank.I, bank.D, bank.bankLength, bank.filterLength
+        };
+
+        ::fwrite(header, sizeof(int32_t), 7, file);
+        ::fwrite(&key.cutoff, sizeof(double), 1, file);
+        ::fwrite(bank.coeffs.data(), sizeof(short), bank.coeffs.size(), file);
+        ::fwrite(bank.incTbl.data(), sizeof(char), bank.incTbl.size(), file);
+    }
+
+    ::fclose(file);
+    return true;
+}
+
 // private methods
 Vga::FilterBank Vga::DesignFilter(int inputRate, int outputRate, int taps, double cutoff)
 {
@@ -708,6 +1124,79 @@ Vga::FilterBank Vga::DesignFilter(int inputRate, int outputRate, int taps, doubl
     return result;
 }
 
+// A bank from the filter cache file has to be the one DesignFilter() gives for its key,
+// the scaler trusts bankLength and incTbl to keep it inside the line buffers
+bool Vga::IsValidFilterBank(const FilterKey& key, const FilterBank& bank)
+{
+    if (key.inputRate <= 0 || key.outputRate <= 0 || key.taps <= 0)
+        return false;
+
+    int tmp = gcd(key.inputRate, key.outputRate);
+
+    if (bank.I != key.outputRate / tmp || bank.D != key.inputRate / tmp ||
+        bank.bankLength != bank.I || bank.filterLength != key.taps ||
+        bank.coeffs.size() != static_cast<std::size_t>(bank.bankLength * bank.filterLength) ||
+        bank.incTbl.size() != static_cast<std::size_t>(bank.bankLength))
+    {
+        return false;
+    }
+
+    // the source pixel steps, walked like DesignFilter() does
+    int firstTap = 0;
+
+    for(int n = 0; n < bank.I; n++)
+    {
+        int step = 0;
+
+        for(firstTap -= bank.D; firstTap < 0; firstTap += bank.I)
+            step++;
+
+        if (bank.incTbl[n] != step)
+            return false;
+    }
+
+    return true;
+}
+
+// DesignFilter() through a small LRU cache - resizing the window back and forth or
+// switching modes finds the banks designed before
+const Vga::FilterBank& Vga::GetFilter(int inputRate, int outputRate, int taps, double cutoff)
+{
+    FilterKey key = { inputRate, outputRate, taps, cutoff };
+
+    for(auto it = m_filterCache.begin(); it != m_filterCache.end(); ++it)
+    {
+        if (it->first == key)
+        {
+            m_filterCache.splice(m_filterCache.begin(), m_filterCache, it);
+            return m_filterCache.front().second;
+        }
+    }
+
+    if (m_filterCache.size() >= FilterCacheSize)
+        m_filterCache.pop_back();
+
+    m_filterCache.emplace_front(key, DesignFilter(inputRate, outputRate, taps, cutoff));
+
+    return m_filterCache.front().second;
+}
+
+// Zeroed pixel buffer of 'size' bytes. The allocation only grows, with some headroom,
+// so a window being resized doesn't reallocate on every frame.
+void Vga::PreparePixelBuffer(std::size_t size)
+{
+    if (size > m_pixelbufferSize)
+    {
+        if (m_pixelbuffer)
+            free(m_pixelbuffer);
+
+        m_pixelbufferSize = ((size + size / 4) + 63) & ~static_cast<std::size_t>(63);
+        m_pixelbuffer     = reinterpret_cast<short *>(aligned_alloc(64, m_pixelbufferSize));
+    }
+
+    ::memset(m_pixelbuffer, 0, size);
+}
+
 void Vga::DrawMode13hLine8(short *pixel, int y)
 {
     for(int n = 0; n < 96; n++)
@@ -840,11 +1329,45 @@ void Vga::DrawTextModeLine8(short *pixel, int y)
 
 }
 
+// Source line y in xrgb, for the integer scaler
+void Vga::DrawMode13hLineXrgb(uint32_t* pixel, int y, const uint32_t* palette)
+{
+    uint8_t* line = m_videoMem + ((m_startAddress + y * 320) & 0x3ffff);
+
+    for(int n = 0; n < 320; n++)
+        pixel[n] = palette[line[n]];
+}
+
+void Vga::DrawTextModeLineXrgb(uint32_t* pixel, int y, const uint32_t* palette)
+{
+    uint8_t* textLine = m_videoMemText + (y >> 4) * 160;
+    int      row      = y & 15;
+    bool     cursor   = m_cursorY == (y >> 4) && row >= m_cursorStart && row <= m_cursorEnd && m_cursorBlinkCnt < 18;
+
+    for(int n = 0; n < 80; n++)
+    {
+        uint8_t  bits  = s_defaultFont[textLine[n * 2] * 16 + row];
+        uint8_t  attr  = textLine[n * 2 + 1];
+        uint32_t color[2];
+
+        color[0] = palette[attr >> 4];
+        color[1] = palette[attr & 15];
+
+        if (cursor && m_cursorX == n)
+        {
+            bits = 0xff;
+        }
+
+        for(int m = 0; m < 8; m++)
+            *pixel++ = color[(bits >> (7 - m)) & 1];
+
+        *pixel++ = color[0];
+    }
+}
+
 void Vga::DrawMode13hScreenFiltered(uint8_t* pixels, int width, int height, int stride)
 {
-    uint8_t* linear   = m_linear;
-    int      pstride  = ((width + 7) & (~7)) * 3;
-    int      pstride8 = pstride >> 3;
+    int pstride = ((width + 7) & (~7)) * 3;
 
     // Prepare filter banks
     if (m_currentWidth != width)
@@ -854,16 +1377,11 @@ void Vga::DrawMode13hScreenFiltered(uint8_t* pixels, int width, int height, int
         if (hcf > MAX_H_CUTOFF)
             hcf = MAX_H_CUTOFF;
 
-        m_hFilter      = DesignFilter(1280, width, 8, hcf);
+        m_hFilter      = GetFilter(1280, width, 8, hcf);
         m_currentWidth = width;
+        m_allDirty     = true;
 
-        if (m_pixelbuffer)
-            free(m_pixelbuffer);
-
-        std::size_t pbSize = 216 * pstride * sizeof(short);
-
-        m_pixelbuffer = reinterpret_cast<__m128i *>(aligned_alloc(32, pbSize));
-        ::memset(m_pixelbuffer, 0, pbSize);
+        PreparePixelBuffer(216 * pstride * sizeof(short));
     }
 
     if (m_currentHeight != height)
@@ -873,166 +1391,85 @@ void Vga::DrawMode13hScreenFiltered(uint8_t* pixels, int width, int height, int
         if (vcf > MAX_V_CUTOFF)
             vcf = MAX_V_CUTOFF;
 
-        m_vFilter = DesignFilter(800, height, 8, vcf);
+        m_vFilter = GetFilter(800, height, 8, vcf);
         m_currentHeight = height;
+        m_allDirty      = true;
     }
 
-    // Scale content and draw
-    __m128i cfp  = _mm_setzero_si128();
-    __m128i fix  = _mm_setzero_si128();
-
-    (reinterpret_cast<short *>(&fix))[0] = 32768;
-    fix = _mm_broadcastw_epi16(fix);
+    // Only the changed source lines are filtered again, and only the output lines
+    // depending on them redrawn
+    bool dirty[SourceLines];
 
-    for(int y = 0; y < 200; y += 8)
-    {
-        __m128i* lb = m_linebuffer;
-        short*   pb = reinterpret_cast<short *>(m_pixelbuffer) + (y + 1) * pstride;
+    TakeDirtyLines(dirty, 200);
 
-        DrawMode13hLine8(reinterpret_cast<short *>(lb), y);
+    // Scale content and draw. The horizontal pass is done for every line before the
+    // vertical one starts, so the stripes of the latter can read the pixel buffer rows
+    // of their neighbours without any overlap handling.
+    int threadCount = m_workers->GetThreadCount();
 
-        short* coeffs = m_hFilter.coeffs.data();
-        char*  incTbl = m_hFilter.incTbl.data();
-        int    fb     = 0;
+    m_workers->Run(25, [&](int task, int thread)
+    {
+        short* lb = m_linebuffer + thread * LineBufferSize;
+        int    y  = task * 8;
 
-        for(int x = 0; x < width; x++)
+        if (anyDirty(dirty, 200, y, y + 7))
         {
-            __m128i a = _mm_setzero_si128();
-            __m128i b = _mm_setzero_si128();
-            __m128i c = _mm_setzero_si128();
-
-            __m128i* lbt = lb;
-
-            for(int m = 0; m < 8; m++)
-            {
-                (reinterpret_cast<short *>(&cfp))[0] = *coeffs++;
-
-                cfp = _mm_broadcastw_epi16(cfp);
-
-                a = _mm_add_epi16(a, _mm_mulhi_epi16(cfp, *lbt++));
-                b = _mm_add_epi16(b, _mm_mulhi_epi16(cfp, *lbt++));
-                c = _mm_add_epi16(c, _mm_mulhi_epi16(cfp, *lbt++));
-            }
-
-            lb += incTbl[fb++] * 3;
-
-            if (fb >= m_hFilter.bankLength)
-            {
-                coeffs = m_hFilter.coeffs.data();
-                fb = 0;
-            }
-
-            short* aa = reinterpret_cast<short *>(&a);
-            short* bb = reinterpret_cast<short *>(&b);
-            short* cc = reinterpret_cast<short *>(&c);
-
-            short* pixel = pb;
+            DrawMode13hLine8(lb, y);
+            FilterLines8(lb, y + 1, width, pstride);
+        }
+    });
 
-            pixel[0] = aa[0];   pixel[1] = aa[1];   pixel[2] = aa[2];   pixel += pstride;
-            pixel[0] = aa[3];   pixel[1] = aa[4];   pixel[2] = aa[5];   pixel += pstride;
-            pixel[0] = aa[6];   pixel[1] = aa[7];   pixel[2] = bb[0];   pixel += pstride;
-            pixel[0] = bb[1];   pixel[1] = bb[2];   pixel[2] = bb[3];   pixel += pstride;
-            pixel[0] = bb[4];   pixel[1] = bb[5];   pixel[2] = bb[6];   pixel += pstride;
-            pixel[0] = bb[7];   pixel[1] = cc[0];   pixel[2] = cc[1];   pixel += pstride;
-            pixel[0] = cc[2];   pixel[1] = cc[3];   pixel[2] = cc[4];   pixel += pstride;
-            pixel[0] = cc[5];   pixel[1] = cc[6];   pixel[2] = cc[7];
+    // Stripes of about 32 output lines, a few per thread for balance as unchanged lines
+    // are skipped; each gets the vertical filter phase the line by line walk would have
+    // at its first line.
+    int stripeCount = std::max(std::min(threadCount * 4, height / 32), 1);
 
-            pb += 3;
-        }
-    }
+    std::vector<Stripe> stripes(stripeCount + 1);
 
-    short*   coeffs = m_vFilter.coeffs.data();
-    char*    incTbl = m_vFilter.incTbl.data();
-    int      fb     = 0;
-    int      sy     = 0;
+    int sy = 0;
+    int fb = 0;
+    int n  = 0;
 
     for(int y = 0; y < height; y++)
     {
-        uint32_t* pixel = reinterpret_cast<uint32_t *>(pixels + y * stride);
-
-        __m128i* pb[4];
-
-        pb[0] = m_pixelbuffer + ((sy + 1) >> 2) * pstride8;
-        pb[1] = m_pixelbuffer + ((sy + 2) >> 2) * pstride8;
-        pb[2] = m_pixelbuffer + ((sy + 3) >> 2) * pstride8;
-        pb[3] = m_pixelbuffer + ((sy + 4) >> 2) * pstride8;
-
-        for(int x = 0; x < width; x += 8)
-        {
-            __m128i a = _mm_setzero_si128();
-            __m128i b = _mm_setzero_si128();
-            __m128i c = _mm_setzero_si128();
+        if (y == (static_cast<int64_t>(height) * n) / stripeCount)
+            stripes[n++] = { y, sy, fb };
 
-            __m128i* pbt[4];
-            int      xoff = (x >> 3) * 3;
+        sy += m_vFilter.incTbl[fb++];
 
-            pbt[0] = pb[0] + xoff;
-            pbt[1] = pb[1] + xoff;
-            pbt[2] = pb[2] + xoff;
-            pbt[3] = pb[3] + xoff;
+        if (fb >= m_vFilter.bankLength)
+            fb = 0;
+    }
 
-            if (sy & 1)
-            {
-                for(int m = 0; m < 8; m += 2)
-                {
-                    (reinterpret_cast<short *>(&cfp))[0] = coeffs[m];
-                    cfp = _mm_broadcastw_epi16(cfp);
+    stripes[stripeCount] = { height, sy, fb };
 
-                    __m128i* pbtt = pbt[m >> 1];
+    m_workers->Run(stripeCount, [&](int task, int thread)
+    {
+        FilterMode13hRows(pixels, stride, width, stripes[task], stripes[task + 1].y, dirty);
+    });
+}
 
-                    a = _mm_add_epi16(a, _mm_mulhi_epi16(cfp, pbtt[0]));
-                    b = _mm_add_epi16(b, _mm_mulhi_epi16(cfp, pbtt[1]));
-                    c = _mm_add_epi16(c, _mm_mulhi_epi16(cfp, pbtt[2]));
-                }
-            }
-            else
-            {
-                for(int m = 1; m < 8; m += 2)
-                {
-                    (reinterpret_cast<short *>(&cfp))[0] = coeffs[m];
-                    cfp = _mm_broadcastw_epi16(cfp);
+// Vertical pass of the output lines from stripe.y up to yEnd
+void Vga::FilterMode13hRows(uint8_t* pixels, int stride, int width, const Stripe& stripe, int yEnd, const bool* dirty)
+{
+    int      pstride = ((width + 7) & (~7)) * 3;
+    short*   coeffs  = m_vFilter.coeffs.data() + stripe.fb * 8;
+    char*    incTbl  = m_vFilter.incTbl.data();
+    int      fb      = stripe.fb;
+    int      sy      = stripe.sy;
 
-                    __m128i* pbtt = pbt[m >> 1];
+    for(int y = stripe.y; y < yEnd; y++)
+    {
+        const short* pb[4];
 
-                    a = _mm_add_epi16(a, _mm_mulhi_epi16(cfp, pbtt[0]));
-                    b = _mm_add_epi16(b, _mm_mulhi_epi16(cfp, pbtt[1]));
-                    c = _mm_add_epi16(c, _mm_mulhi_epi16(cfp, pbtt[2]));
-                }
-            }
+        pb[0] = m_pixelbuffer + ((sy + 1) >> 2) * pstride;
+        pb[1] = m_pixelbuffer + ((sy + 2) >> 2) * pstride;
+        pb[2] = m_pixelbuffer + ((sy + 3) >> 2) * pstride;
+        pb[3] = m_pixelbuffer + ((sy + 4) >> 2) * pstride;
 
-            a = _mm_add_epi16(a, fix);
-            b = _mm_add_epi16(b, fix);
-            c = _mm_add_epi16(c, fix);
-
-            uint16_t* aa = reinterpret_cast<uint16_t *>(&a);
-            uint16_t* bb = reinterpret_cast<uint16_t *>(&b);
-            uint16_t* cc = reinterpret_cast<uint16_t *>(&c);
-
-            *pixel++ =  (linear[aa[0]] << 16) +
-                        (linear[aa[1]] << 8) +
-                        (linear[aa[2]]);
-            *pixel++ =  (linear[aa[3]] << 16) +
-                        (linear[aa[4]] << 8) +
-                        (linear[aa[5]]);
-            *pixel++ =  (linear[aa[6]] << 16) +
-                        (linear[aa[7]] << 8) +
-                        (linear[bb[0]]);
-            *pixel++ =  (linear[bb[1]] << 16) +
-                        (linear[bb[2]] << 8) +
-                        (linear[bb[3]]);
-            *pixel++ =  (linear[bb[4]] << 16) +
-                        (linear[bb[5]] << 8) +
-                        (linear[bb[6]]);
-            *pixel++ =  (linear[bb[7]] << 16) +
-                        (linear[cc[0]] << 8) +
-                        (linear[cc[1]]);
-            *pixel++ =  (linear[cc[2]] << 16) +
-                        (linear[cc[3]] << 8) +
-                        (linear[cc[4]]);
-            *pixel++ =  (linear[cc[5]] << 16) +
-                        (linear[cc[6]] << 8) +
-                        (linear[cc[7]]);
-        }
+        // pixel buffer row n holds source line n - 1
+        if (anyDirty(dirty, 200, ((sy + 1) >> 2) - 1, ((sy + 4) >> 2) - 1))
+            FilterRow(reinterpret_cast<uint32_t *>(pixels + y * stride), pb, coeffs, sy & 1, width);
 
         coeffs += 8;
         sy += incTbl[fb++];
@@ -1047,9 +1484,7 @@ void Vga::DrawMode13hScreenFiltered(uint8_t* pixels, int width, int height, int
 
 void Vga::DrawTextModeScreenFiltered(uint8_t* pixels, int width, int height, int stride)
 {
-    uint8_t* linear   = m_linear;
-    int      pstride  = ((width + 7) & (~7)) * 3;
-    int      pstride8 = pstride >> 3;
+    int pstride = ((width + 7) & (~7)) * 3;
 
     // Prepare filter banks
     if (m_currentWidth != width)
@@ -1059,16 +1494,11 @@ void Vga::DrawTextModeScreenFiltered(uint8_t* pixels, int width, int height, int
         if (hcf > MAX_H_CUTOFF)
             hcf = MAX_H_CUTOFF;
 
-        m_hFilter      = DesignFilter(1440, width, 8, hcf);
+        m_hFilter      = GetFilter(1440, width, 8, hcf);
         m_currentWidth = width;
+        m_allDirty     = true;
 
-        if (m_pixelbuffer)
-            free(m_pixelbuffer);
-
-        std::size_t pbSize = 416 * pstride * sizeof(short);
-
-        m_pixelbuffer = reinterpret_cast<__m128i *>(aligned_alloc(32, pbSize));
-        ::memset(m_pixelbuffer, 0, pbSize);
+        PreparePixelBuffer(416 * pstride * sizeof(short));
     }
 
     if (m_currentHeight != height)
@@ -1078,162 +1508,190 @@ void Vga::DrawTextModeScreenFiltered(uint8_t* pixels, int width, int height, int
         if (vcf > MAX_V_CUTOFF)
             vcf = MAX_V_CUTOFF;
 
-        m_vFilter = DesignFilter(800, height, 8, vcf);
+        m_vFilter = GetFilter(800, height, 8, vcf);
         m_currentHeight = height;
+        m_allDirty      = true;
     }
 
-    // Scale content and draw
-    __m128i cfp  = _mm_setzero_si128();
-    __m128i fix  = _mm_setzero_si128();
+    // Only the changed source lines are filtered again, and only the output lines
+    // depending on them redrawn
+    bool dirty[SourceLines];
 
-    (reinterpret_cast<short *>(&fix))[0] = 32768;
-    fix = _mm_broadcastw_epi16(fix);
+    TakeDirtyLines(dirty, 400);
 
+    // Scale content and draw
     for(int y = 0; y < 400; y += 8)
     {
-        __m128i* lb = m_linebuffer;
-        short*   pb = reinterpret_cast<short *>(m_pixelbuffer) + (y + 2) * pstride;
+        if (!anyDirty(dirty, 400, y, y + 7))
+            continue;
+
+        DrawTextModeLine8(m_linebuffer, y);
+        FilterLines8(m_linebuffer, y + 2, width, pstride);
+    }
+
+    short*   coeffs = m_vFilter.coeffs.data();
+    char*    incTbl = m_vFilter.incTbl.data();
+    int      fb     = 0;
+    int      sy     = 0;
+
+    for(int y = 0; y < height; y++)
+    {
+        const short* pb[4];
 
-        DrawTextModeLine8(reinterpret_cast<short *>(lb), y);
+        // four pixel buffer rows from sy / 2, row n holds source line n - 2
+        for(int m = 0; m < 4; m++)
+            pb[m] = m_pixelbuffer + ((sy >> 1) + m) * pstride;
 
-        short* coeffs = m_hFilter.coeffs.data();
-        char*  incTbl = m_hFilter.incTbl.data();
-        int    fb     = 0;
+        if (anyDirty(dirty, 400, (sy >> 1) - 2, (sy >> 1) + 1))
+            FilterRow(reinterpret_cast<uint32_t *>(pixels + y * stride), pb, coeffs, sy & 1, width);
 
-        for(int x = 0; x < width; x++)
+        coeffs += 8;
+        sy += incTbl[fb++];
+
+        if (fb >= m_vFilter.bankLength)
         {
-            __m128i a = _mm_setzero_si128();
-            __m128i b = _mm_setzero_si128();
-            __m128i c = _mm_setzero_si128();
+            coeffs = m_vFilter.coeffs.data();
+            fb = 0;
+        }
+    }
+}
 
-            __m128i* lbt = lb;
+// Horizontal pass of the 8 source lines in the line buffer into pixel buffer rows
+// row .. row + 7
+void Vga::FilterLines8(const short* lb, int row, int width, int pstride)
+{
+    m_kernels->filterLines8(lb, m_pixelbuffer + row * pstride, pstride, width,
+                            m_hFilter.coeffs.data(), m_hFilter.incTbl.data(), m_hFilter.bankLength);
+}
 
-            for(int m = 0; m < 8; m++)
-            {
-                (reinterpret_cast<short *>(&cfp))[0] = *coeffs++;
+// One output line from four pixel buffer rows. The vertical filter runs at twice the
+// rate of the rows, even and odd phases take every other one of its 8 taps.
+void Vga::FilterRow(uint32_t* pixel, const short* const* pb, const short* coeffs, bool odd, int width)
+{
+    short taps[4];
 
-                cfp = _mm_broadcastw_epi16(cfp);
+    for(int m = 0; m < 4; m++)
+        taps[m] = coeffs[m * 2 + (odd ? 0 : 1)];
 
-                a = _mm_add_epi16(a, _mm_mulhi_epi16(cfp, *lbt++));
-                b = _mm_add_epi16(b, _mm_mulhi_epi16(cfp, *lbt++));
-                c = _mm_add_epi16(c, _mm_mulhi_epi16(cfp, *lbt++));
-            }
+    m_kernels->filterRow4(pb, taps, m_linear, pixel, width);
+}
 
-            lb += incTbl[fb++] * 3;
 
-            if (fb >= m_hFilter.bankLength)
-            {
-                coeffs = m_hFilter.coeffs.data();
-                fb = 0;
-            }
+void Vga::UpdateWritePlaneMask()
+{
+    uint8_t planeMask = m_sequencerReg[2];
+
+    m_chain4 = (m_sequencerReg[4] & 8) != 0;
 
-            short* aa = reinterpret_cast<short *>(&a);
-            short* bb = reinterpret_cast<short *>(&b);
-            short* cc = reinterpret_cast<short *>(&c);
+    m_writePlaneMask  =  (planeMask & 1) ? 0xff : 0x00;
+    m_writePlaneMask |= ((planeMask & 2) ? 0xff : 0x00) << 8;
+    m_writePlaneMask |= ((planeMask & 4) ? 0xff : 0x00) << 16;
+    m_writePlaneMask |= ((planeMask & 8) ? 0xff : 0x00) << 24;
 
-            short* pixel = pb;
+    m_writePlaneMaskInv = ~m_writePlaneMask;
+}
 
-            pixel[0] = aa[0];   pixel[1] = aa[1];   pixel[2] = aa[2];   pixel += pstride;
-            pixel[0] = aa[3];   pixel[1] = aa[4];   pixel[2] = aa[5];   pixel += pstride;
-            pixel[0] = aa[6];   pixel[1] = aa[7];   pixel[2] = bb[0];   pixel += pstride;
-            pixel[0] = bb[1];   pixel[1] = bb[2];   pixel[2] = bb[3];   pixel += pstride;
-            pixel[0] = bb[4];   pixel[1] = bb[5];   pixel[2] = bb[6];   pixel += pstride;
-            pixel[0] = bb[7];   pixel[1] = cc[0];   pixel[2] = cc[1];   pixel += pstride;
-            pixel[0] = cc[2];   pixel[1] = cc[3];   pixel[2] = cc[4];   pixel += pstride;
-            pixel[0] = cc[5];   pixel[1] = cc[6];   pixel[2] = cc[7];
+// Marks the source line shown from byte 'offset' of the video memory (planar modes pass
+// the pixel offset, four times the address) as changed
+void Vga::MarkDirty(uint32_t offset)
+{
+    if (m_currentMode == Mode::Mode13h)
+    {
+        uint32_t rel = (offset - m_startAddress) & 0x3ffff;
 
-            pb += 3;
-        }
+        if (rel < Mode13hSize)
+            m_lineDirty[rel / Mode13hPitch].store(1, std::memory_order_relaxed);
     }
+    else
+    {
+        uint32_t rel = offset - TextBase;
 
-    short*   coeffs = m_vFilter.coeffs.data();
-    char*    incTbl = m_vFilter.incTbl.data();
-    int      fb     = 0;
-    int      sy     = 0;
+        if (rel < TextSize)
+            MarkLinesDirty((rel / 160) * 16, (rel / 160) * 16 + 15);
+    }
+}
 
-    for(int y = 0; y < height; y++)
+void Vga::MarkDirty(uint32_t offset, uint32_t size)
+{
+    if (size == 0)
+        return;
+
+    if (m_currentMode == Mode::Mode13h)
     {
-        uint32_t* pixel = reinterpret_cast<uint32_t *>(pixels + y * stride);
-        __m128i*  pb = m_pixelbuffer + (sy >> 1) * pstride8;
+        uint32_t rel = (offset - m_startAddress) & 0x3ffff;
+        uint32_t end = rel + size;
 
-        for(int x = 0; x < width; x += 8)
+        if (size >= 0x40000)
         {
-            __m128i a = _mm_setzero_si128();
-            __m128i b = _mm_setzero_si128();
-            __m128i c = _mm_setzero_si128();
+            m_allDirty = true;
+            return;
+        }
 
-            __m128i* pbt = pb + (x >> 3) * 3;
+        if (rel < Mode13hSize)
+            MarkLinesDirty(rel / Mode13hPitch, (std::min<uint32_t>(end, Mode13hSize) - 1) / Mode13hPitch);
 
-            if (sy & 1)
-            {
-                for(int m = 0; m < 8; m += 2)
-                {
-                    (reinterpret_cast<short *>(&cfp))[0] = coeffs[m];
-                    cfp = _mm_broadcastw_epi16(cfp);
+        // wrapped around the end of the video memory
+        if (end > 0x40000)
+            MarkLinesDirty(0, (std::min<uint32_t>(end - 0x40000, Mode13hSize) - 1) / Mode13hPitch);
+    }
+    else
+    {
+        int64_t first = std::max<int64_t>(static_cast<int64_t>(offset) - TextBase, 0);
+        int64_t last  = std::min<int64_t>(static_cast<int64_t>(offset) + size - TextBase, TextSize) - 1;
+
+        if (first <= last)
+            MarkLinesDirty((first / 160) * 16, (last / 160) * 16 + 15);
+    }
+}
 
-                    a = _mm_add_epi16(a, _mm_mulhi_epi16(cfp, pbt[0]));
-                    b = _mm_add_epi16(b, _mm_mulhi_epi16(cfp, pbt[1]));
-                    c = _mm_add_epi16(c, _mm_mulhi_epi16(cfp, pbt[2]));
+void Vga::MarkLinesDirty(int first, int last)
+{
+    for(int n = first; n <= last; n++)
+        m_lineDirty[n].store(1, std::memory_order_relaxed);
+}
 
-                    pbt += pstride8;
-                }
-            }
-            else
-            {
-                for(int m = 1; m < 8; m += 2)
-                {
-                    (reinterpret_cast<short *>(&cfp))[0] = coeffs[m];
-                    cfp = _mm_broadcastw_epi16(cfp);
+void Vga::MarkCursorDirty()
+{
+    if (m_currentMode == Mode::Text && m_cursorY < 25)
+        MarkLinesDirty(m_cursorY * 16, m_cursorY * 16 + 15);
+}
 
-                    a = _mm_add_epi16(a, _mm_mulhi_epi16(cfp, pbt[0]));
-                    b = _mm_add_epi16(b, _mm_mulhi_epi16(cfp, pbt[1]));
-                    c = _mm_add_epi16(c, _mm_mulhi_epi16(cfp, pbt[2]));
+// Fetches and clears the changed flags of the first 'count' source lines; everything is
+// reported as changed when the whole screen has to be redrawn. A flag is cleared before
+// the renderer reads its line, so a write racing with the renderer shows up next frame.
+bool Vga::TakeDirtyLines(bool* dirty, int count)
+{
+    bool all = m_allDirty.exchange(false);
 
-                    pbt += pstride8;
-                }
-            }
+    for(int n = 0; n < count; n++)
+        dirty[n] = m_lineDirty[n].exchange(0) != 0 || all;
 
-            a = _mm_add_epi16(a, fix);
-            b = _mm_add_epi16(b, fix);
-            c = _mm_add_epi16(c, fix);
-
-            uint16_t* aa = reinterpret_cast<uint16_t *>(&a);
-            uint16_t* bb = reinterpret_cast<uint16_t *>(&b);
-            uint16_t* cc = reinterpret_cast<uint16_t *>(&c);
-
-            *pixel++ =  (linear[aa[0]] << 16) +
-                        (linear[aa[1]] << 8) +
-                        (linear[aa[2]]);
-            *pixel++ =  (linear[aa[3]] << 16) +
-                        (linear[aa[4]] << 8) +
-                        (linear[aa[5]]);
-            *pixel++ =  (linear[aa[6]] << 16) +
-                        (linear[aa[7]] << 8) +
-                        (linear[bb[0]]);
-            *pixel++ =  (linear[bb[1]] << 16) +
-                        (linear[bb[2]] << 8) +
-                        (linear[bb[3]]);
-            *pixel++ =  (linear[bb[4]] << 16) +
-                        (linear[bb[5]] << 8) +
-                        (linear[bb[6]]);
-            *pixel++ =  (linear[bb[7]] << 16) +
-                        (linear[cc[0]] << 8) +
-                        (linear[cc[1]]);
-            *pixel++ =  (linear[cc[2]] << 16) +
-                        (linear[cc[3]] << 8) +
-                        (linear[cc[4]]);
-            *pixel++ =  (linear[cc[5]] << 16) +
-                        (linear[cc[6]] << 8) +
-                        (linear[cc[7]]);
-        }
+    return all;
+}
 
-        coeffs += 8;
-        sy += incTbl[fb++];
+void Vga::BeginFrame(uint8_t* pixels, int width, int height, int stride)
+{
+    // unchanged lines are left as they are, which needs the previous frame underneath
+    if (pixels != m_lastPixels || stride != m_lastStride || width != m_lastWidth || height != m_lastHeight)
+    {
+        m_lastPixels = pixels;
+        m_lastStride = stride;
+        m_lastWidth  = width;
+        m_lastHeight = height;
+        m_allDirty   = true;
+    }
+}
 
-        if (fb >= m_vFilter.bankLength)
-        {
-            coeffs = m_vFilter.coeffs.data();
-            fb = 0;
-        }
+void Vga::EndFrame()
+{
+    if (++m_cursorBlinkCnt > 36)
+    {
+        m_cursorBlinkCnt = 0;
+    }
+
+    // the cursor shows while the count is below 18
+    if (m_cursorBlinkCnt == 0 || m_cursorBlinkCnt == 18)
+    {
+        MarkCursorDirty();
     }
 }
@@ -2,12 +2,16 @@
 #define X86EMU_VGA
 
 #include <inttypes.h>
-#include <immintrin.h>
+#include <atomic>
+#include <list>
 #include <vector>
 #include <functional>
 
 // forward declarations
+class Bus;
 class Memory;
+class WorkerPool;
+struct ScalerKernels;
 
 class Vga
 {
@@ -23,10 +27,17 @@ public:
     ~Vga();
 
     // public methods
+    void    RegisterPorts(Bus& bus);
     uint8_t PortRead(uint16_t port);
     void    PortWrite(uint16_t port, uint8_t value);
+    void    PortWrite16(uint16_t port, uint16_t value);
     uint8_t MemRead(uint32_t addr);
     void    MemWrite(uint32_t addr, uint8_t value);
+    void    MemWriteBlock(uint32_t addr, const uint8_t* data, uint32_t count);
+    void    MemFillBlock(uint32_t addr, uint8_t value, uint32_t count);
+
+    void    Process(int64_t nsec);
+    int64_t TimeToNextEvent();
 
     void SetCursorPos(uint8_t x, uint8_t y);
     void SetCursorType(uint8_t start, uint8_t end);
@@ -34,10 +45,55 @@ public:
     uint8_t* GetColorMap();
 
     void SetMode(Mode mode);
+    void SetIntegerScale(bool enabled);
+
+    void DrawScreen(uint8_t* pixels, int width, int height, int stride);
     void DrawScreenFiltered(uint8_t* pixels, int width, int height, int stride);
+    void DrawScreenInteger(uint8_t* pixels, int width, int height, int stride);
     void Screenshot();
 
+    // designed filter banks kept across runs, main thread
+    bool LoadFilterCache(const char* path);
+    bool SaveFilterCache(const char* path);
+
 private:
+    // 70 Hz frame of 449 lines, 400 of them displayed
+    enum
+    {
+        LineNs           = 31778,
+        ActiveLineNs     = 25422,
+        FrameLines       = 449,
+        FrameNs          = LineNs * FrameLines,
+        DisplayLines     = 400,
+        RetraceStartLine = 412,
+        RetraceEndLine   = 414
+    };
+
+    // source lines of the renderer - 25 text rows of 16 lines, or 200 mode 13h lines
+    // starting at the start address
+    enum
+    {
+        SourceLines  = 400,
+        TextBase     = 0x18000,
+        TextSize     = 80 * 25 * 2,
+        Mode13hPitch = 320,
+        Mode13hSize  = 320 * 200
+    };
+
+    enum
+    {
+        MaxRenderThreads = 16,
+        LineBufferSize   = 2048 * 8 * 3 // shorts, 8 lines of 2048 rgb pixels
+    };
+
+    // first output line of a stripe of the vertical pass and the filter phase there
+    struct Stripe
+    {
+        int y;
+        int sy;
+        int fb;
+    };
+
     struct FilterBank
     {
         std::vector<short> coeffs;
@@ -49,6 +105,26 @@ private:
         int filterLength;   // number of filter taps
     };
 
+    // DesignFilter() parameters of a cached bank
+    struct FilterKey
+    {
+        int    inputRate;
+        int    outputRate;
+        int    taps;
+        double cutoff;
+
+        bool operator==(const FilterKey& other) const
+        {
+            return inputRate == other.inputRate && outputRate == other.outputRate &&
+                   taps == other.taps && cutoff == other.cutoff;
+        }
+    };
+
+    enum
+    {
+        FilterCacheSize = 16    // a few window sizes of both modes
+    };
+
     static const uint8_t s_defaultColorMap[256][3];
     static const uint8_t s_defaultFont[256 * 16];
 
@@ -60,7 +136,7 @@ private:
     uint8_t     m_sequencerReg[5];
     uint8_t     m_graphicsCtrlReg[9];
     uint8_t     m_crtCtrlReg[35];
-    int         m_verticalRetraceCnt;
+    int64_t     m_frameTime;        // emulated time since start of frame, ns
 
     bool        m_chain4;
     uint32_t    m_readPlaneIdx;
@@ -90,16 +166,53 @@ private:
     Mode        m_currentMode;
     FilterBank  m_hFilter;
     FilterBank  m_vFilter;
-    __m128i*    m_linebuffer;
-    __m128i*    m_pixelbuffer;
+    short*      m_linebuffer;       // one per render thread
+    short*      m_pixelbuffer;
+    std::size_t m_pixelbufferSize;  // bytes allocated, kept when the window shrinks
+    WorkerPool* m_workers;
+
+    std::list<std::pair<FilterKey, FilterBank>> m_filterCache;  // most recently used first
+
+    const ScalerKernels* m_kernels;
+
+    // Changed source lines since the last DrawScreenFiltered(), set by the emulator
+    // thread and cleared by the renderer before it reads the line. Palette, start
+    // address and mode changes redraw everything.
+    std::atomic<uint8_t> m_lineDirty[SourceLines];
+    std::atomic<bool>    m_allDirty;
+    uint8_t*             m_lastPixels;
+    int                  m_lastStride;
+    int                  m_lastWidth;
+    int                  m_lastHeight;
+
+    bool        m_integerScale;
 
     int         m_screenshotCnt;
 
     // private methods
     FilterBank DesignFilter(int inputRate, int outputRate, int taps, double cutoff);
+    const FilterBank& GetFilter(int inputRate, int outputRate, int taps, double cutoff);
+    bool IsValidFilterBank(const FilterKey& key, const FilterBank& bank);
+    void PreparePixelBuffer(std::size_t size);
+
+    void UpdateWritePlaneMask();
+
+    void MarkDirty(uint32_t offset);
+    void MarkDirty(uint32_t offset, uint32_t size);
+    void MarkLinesDirty(int first, int last);
+    void MarkCursorDirty();
+    bool TakeDirtyLines(bool* dirty, int count);
+
+    void BeginFrame(uint8_t* pixels, int width, int height, int stride);
+    void EndFrame();
 
     void DrawMode13hLine8(short *pixel, int y);
+    void FilterMode13hRows(uint8_t* pixels, int stride, int width, const Stripe& stripe, int yEnd, const bool* dirty);
+    void FilterLines8(const short* lb, int row, int width, int pstride);
+    void FilterRow(uint32_t* pixel, const short* const* pb, const short* coeffs, bool odd, int width);
     void DrawTextModeLine8(short *pixel, int y);
+    void DrawMode13hLineXrgb(uint32_t* pixel, int y, const uint32_t* palette);
+    void DrawTextModeLineXrgb(uint32_t* pixel, int y, const uint32_t* palette);
 
     void DrawTextModeScreenFiltered(uint8_t* pixels, int width, int height, int stride);
     void DrawMode13hScreenFiltered(uint8_t* pixels, int width, int height, int stride);
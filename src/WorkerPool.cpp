@@ -0,0 +1,98 @@
+#include "WorkerPool.h"
+
+// constructor & destructor
+WorkerPool::WorkerPool(int threadCount)
+    : m_generation (0)
+    , m_busy       (0)
+    , m_stop       (false)
+    , m_job        (nullptr)
+    , m_taskCount  (0)
+    , m_nextTask   (0)
+{
+    // the calling thread is one of them
+    for(int n = 1; n < threadCount; n++)
+        m_threads.emplace_back(&WorkerPool::WorkerThread, this, n);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_start.notify_all();
+
+    for(std::thread& thread : m_threads)
+        thread.join();
+}
+
+// public methods
+int WorkerPool::GetThreadCount()
+{
+    return m_threads.size() + 1;
+}
+
+void WorkerPool::Run(int taskCount, const std::function<void (int task, int thread)>& job)
+{
+    if (m_threads.empty() || taskCount <= 1)
+    {
+        for(int n = 0; n < taskCount; n++)
+            job(n, 0);
+
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        m_job       = &job;
+        m_taskCount = taskCount;
+        m_nextTask  = 0;
+        m_busy      = m_threads.size();
+        m_generation++;
+    }
+
+    m_start.notify_all();
+    RunTasks(0);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    m_done.wait(lock, [this] { return m_busy == 0; });
+    m_job = nullptr;
+}
+
+// private methods
+void WorkerPool::WorkerThread(int thread)
+{
+    uint64_t generation = 0;
+
+    while(true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+
+            m_start.wait(lock, [&] { return m_stop || m_generation != generation; });
+
+            if (m_stop)
+                return;
+
+            generation = m_generation;
+        }
+
+        RunTasks(thread);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (--m_busy == 0)
+            m_done.notify_one();
+    }
+}
+
+void WorkerPool::RunTasks(int thread)
+{
+    int task;
+
+    while((task = m_nextTask.fetch_add(1)) < m_taskCount)
+        (*m_job)(task, thread);
+}
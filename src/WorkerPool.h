@@ -0,0 +1,45 @@
+#ifndef X86EMU_WORKER_POOL
+#define X86EMU_WORKER_POOL
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Persistent host threads for splitting a frame of rendering. Run() hands the tasks
+// 0 .. count - 1 out to the pool threads and the calling thread, and returns once all of
+// them are done. The job gets the task and the index of the thread running it, 0 being
+// the caller, so it can pick per-thread scratch buffers.
+class WorkerPool
+{
+public:
+    // constructor & destructor
+    WorkerPool(int threadCount);
+    ~WorkerPool();
+
+    // public methods
+    int  GetThreadCount();
+    void Run(int taskCount, const std::function<void (int task, int thread)>& job);
+
+private:
+    std::vector<std::thread>    m_threads;
+
+    std::mutex                  m_mutex;
+    std::condition_variable     m_start;
+    std::condition_variable     m_done;
+    uint64_t                    m_generation;   // of the current Run()
+    int                         m_busy;         // pool threads still in it
+    bool                        m_stop;
+
+    const std::function<void (int, int)>* m_job;
+    int                                   m_taskCount;
+    std::atomic<int>                      m_nextTask;
+
+    // private methods
+    void WorkerThread(int thread);
+    void RunTasks(int thread);
+};
+
+#endif /* X86EMU_WORKER_POOL */
@@ -1,36 +1,86 @@
 #include <SDL2/SDL.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <inttypes.h>
 #include <algorithm>
 #include <thread>
 #include <atomic>
+#include <chrono>
 #include <unistd.h>
 #include "Memory.h"
 #include "MemoryView.h"
 #include "Vga.h"
 #include "Bios.h"
 #include "Cpu.h"
+#include "JitCpu.h"
 #include "Pic.h"
 #include "Pit.h"
 #include "Keyboard.h"
+#include "InputLog.h"
+#include "Bus.h"
+#include "HeadlessBackend.h"
 #include "SDLInterface.h"
 
 int main(int argc, char **argv)
 {
     printf("x86emu v0.1\n\n");
 
+    bool    useJit        = false;
+    bool    headless      = false;
+    bool    realTime      = false;
+    bool    blockCache    = false;
+    bool    idleSkip      = false;
+    bool    integerScale  = false;
+    int64_t runTime       = 0;
+    int64_t frameInterval = 0;
+
+    const char* recordFile = nullptr;
+    const char* replayFile = nullptr;
+    const char* filterFile = nullptr;
+
+    // --time=<s> and --frames=<ms> go with --headless
+    for(int n = 1; n < argc; n++)
+    {
+        useJit   |= ::strcmp(argv[n], "--jit") == 0;
+        headless |= ::strcmp(argv[n], "--headless") == 0;
+        realTime |= ::strcmp(argv[n], "--realtime") == 0;
+
+        blockCache   |= ::strcmp(argv[n], "--blockcache") == 0;
+        idleSkip     |= ::strcmp(argv[n], "--idle") == 0;
+        integerScale |= ::strcmp(argv[n], "--integer") == 0;
+
+        if (::strncmp(argv[n], "--time=", 7) == 0)
+            runTime = static_cast<int64_t>(::atof(argv[n] + 7) * 1000000);
+
+        if (::strncmp(argv[n], "--frames=", 9) == 0)
+            frameInterval = static_cast<int64_t>(::atof(argv[n] + 9) * 1000);
+
+        if (::strncmp(argv[n], "--record=", 9) == 0)
+            recordFile = argv[n] + 9;
+
+        if (::strncmp(argv[n], "--replay=", 9) == 0)
+            replayFile = argv[n] + 9;
+
+        if (::strncmp(argv[n], "--filtercache=", 14) == 0)
+            filterFile = argv[n] + 14;
+    }
+
     // Initialize emulator
     Memory*       memory     = new Memory(4096);
     Vga*          vga        = new Vga(*memory);
     MemoryView*   memoryView = nullptr;
     //MemoryView*   memoryView = new MemoryView(memory, vga);
     Bios*         bios       = new Bios(*memory, *vga);
-    CpuInterface* cpu        = new Cpu(*memory);
+    Cpu*          cpu        = useJit ? new JitCpu(*memory) : new Cpu(*memory);
     Pic*          pic        = new Pic(*cpu);
     Pit*          pit        = new Pit(*pic);
     Keyboard*     keyboard   = new Keyboard;
-    SDLInterface* sdl        = new SDLInterface(vga, memoryView);
+    InputLog*     input      = new InputLog(*keyboard);
+    Bus*          bus        = new Bus(*vga);
+    Backend*      backend    = headless ?
+        static_cast<Backend *>(new HeadlessBackend(vga, runTime, frameInterval, realTime)) :
+        static_cast<Backend *>(new SDLInterface(vga, memoryView));
 
     pic->onAck = [keyboard](int irqNo)
         {
@@ -40,147 +90,25 @@ int main(int argc, char **argv)
             }
         };
 
-    cpu->onInterrupt =
-        [cpu, bios](int intNo)
-        {
-            if (intNo == 0x10)
-            {
-                bios->Int10h(cpu);
-            }
-            else if (intNo == 0x11)
-            {
-                bios->Int11h(cpu);
-            }
-            else if (intNo == 0x12)
-            {
-                bios->Int12h(cpu);
-            }
-            else if (intNo == 0x13)
-            {
-                bios->Int13h(cpu);
-            }
-            else if (intNo == 0x14)
-            {
-                // Do nothing (serial port)
-            }
-            else if (intNo == 0x15)
-            {
-                bios->Int15h(cpu);
-            }
-            else if (intNo == 0x16)
-            {
-                bios->Int16h(cpu);
-            }
-            else if (intNo == 0x17)
-            {
-                // Do nothing
-            }
-            else if (intNo == 0x1a)
-            {
-                bios->Int1Ah(cpu);
-            }
-            else
-            {
-                cpu->Interrupt(intNo);
-            }
-        };
-
-    cpu->onPortRead =
-        [vga, pic, pit, keyboard](uint16_t port, int size) -> uint32_t
-        {
-            //printf("read port = 0x%04x, size = %d\n", port, size);
-            switch(port)
-            {
-                case 0x20: case 0x21:
-                    return pic->PortRead(port);
-
-                case 0x40: case 0x41:
-                case 0x42: case 0x43:
-                    return pit->PortRead(port);
-
-                case 0x60:
-                    {
-                        uint8_t key = keyboard->GetKey();
-                        //printf("onPortRead() got key %02x\n", key);
-                        return key;
-                    }
-
-                case 0x3c5:
-                case 0x3c9:
-                case 0x3cf:
-                case 0x3d5:
-                case 0x3da:
-                    return vga->PortRead(port);
-
-                case 0x61:
-                case 0x388: // Adlib Address / Status, ignore
-                case 0x389: // Adlib Data port, ignore
-                    return 0;
-
-                case 0x201: // Joystick, ignore
-                    return 0xff;
-
-                default:
-                    printf("Unhandled read port = 0x%04x, size = %d\n", port, size);
-                    return 0;
-            }
-        };
-
-    cpu->onPortWrite =
-        [vga, pic, pit, bios, keyboard](uint16_t port, int size, uint32_t value)
-        {
-            //printf("write port = 0x%04x, size = %d, value = %d (0x%04x)\n", port, size, value, value);
-            switch(port)
-            {
-                case 0x20: case 0x21:
-                    pic->PortWrite(port, value);
-                    break;
-
-                case 0x68:
-                    //printf("onPortWrite() got write on pseudoport 0x68\n");
-                    if (keyboard->HasKey())
-                    {
-                        bios->AddKey(keyboard->GetKey());
-                    }
-                    break;
-
-                case 0x40: case 0x41:
-                case 0x42: case 0x43:
-                    pit->PortWrite(port, value);
-                    break;
-
-                case 0x3c4: case 0x3c5:
-                case 0x3ce: case 0x3cf:
-                case 0x3d4: case 0x3d5:
-                    if (size == 2)
-                    {
-                        vga->PortWrite(port, value & 0xff);
-                        vga->PortWrite(port + 1, (value >> 8) & 0xff);
-                    }
-                    else
-                    {
-                        vga->PortWrite(port, value);
-                    }
-                    break;
-
-                case 0x3c7:
-                case 0x3c8:
-                case 0x3c9:
-                    vga->PortWrite(port, value);
-                    break;
-
-                case 0x61:
-                case 0x201:
-                    break;
-
-                default:
-                    printf("Unhandled write port = 0x%04x, size = %d, value = %d (0x%04x)\n", port, size, value, value);
-                    break;
-            }
-        };
-
-    cpu->onVgaMemRead  = [vga](uint32_t addr) { return vga->MemRead(addr); };
-    cpu->onVgaMemWrite = [vga](uint32_t addr, uint8_t value) { vga->MemWrite(addr, value); };
+    // BIOS services, called natively until the program hooks their vectors
+    cpu->SetInterruptHandler(0x10, [cpu, bios]() { bios->Int10h(cpu); });
+    cpu->SetInterruptHandler(0x11, [cpu, bios]() { bios->Int11h(cpu); });
+    cpu->SetInterruptHandler(0x12, [cpu, bios]() { bios->Int12h(cpu); });
+    cpu->SetInterruptHandler(0x13, [cpu, bios]() { bios->Int13h(cpu); });
+    cpu->SetInterruptHandler(0x14, []()          { });                    // serial port
+    cpu->SetInterruptHandler(0x15, [cpu, bios]() { bios->Int15h(cpu); });
+    cpu->SetInterruptHandler(0x16, [cpu, bios]() { bios->Int16h(cpu); });
+    cpu->SetInterruptHandler(0x17, []()          { });
+    cpu->SetInterruptHandler(0x1a, [cpu, bios]() { bios->Int1Ah(cpu); });
+
+    // ports and video memory go straight to the devices, no std::function callbacks
+    pic->RegisterPorts(*bus);
+    pit->RegisterPorts(*bus);
+    keyboard->RegisterPorts(*bus);
+    vga->RegisterPorts(*bus);
+    bios->RegisterPorts(*bus, *keyboard);
+
+    cpu->SetBus(bus);
 
     cpu->SetReg16(CpuInterface::IP, 0x7c00);
 
@@ -205,7 +133,31 @@ int main(int argc, char **argv)
     //bios->LoadMBR(0);
     bios->LoadMBR(0x80);
 
-    sdl->onKeyEvent = [keyboard, vga, bios, &diskIdx, &diskList](uint8_t scancode) {
+    // predecoded basic blocks instead of decoding every instruction, --blockcache
+    cpu->SetBlockCacheEnabled(blockCache);
+
+    // skip emulated time of guest loops waiting for the timer tick or vertical retrace, --idle
+    cpu->SetIdleDetectionEnabled(idleSkip);
+
+    // scaler filter banks designed in earlier runs
+    if (filterFile)
+    {
+        vga->LoadFilterCache(filterFile);
+    }
+
+    vga->SetIntegerScale(integerScale);
+
+    // keys reach the keyboard on the emulator thread, stamped with emulated time
+    if (replayFile)
+    {
+        input->StartReplay(replayFile);
+    }
+    else if (recordFile)
+    {
+        input->StartRecording(recordFile);
+    }
+
+    backend->onKeyEvent = [input, vga, bios, &diskIdx, &diskList](uint8_t scancode) {
         if (scancode == 0x58) // F12, change floppy disk
         {
             diskIdx++;
@@ -223,34 +175,60 @@ int main(int argc, char **argv)
         }
         else
         {
-            keyboard->AddKey(scancode);
+            input->AddKey(scancode);
         }
     };
 
     auto runEmulator =
-        [cpu, pic, pit, keyboard](int64_t usec, int64_t instructionsPerSecond) -> bool
+        [cpu, vga, pic, pit, keyboard, input](int64_t usec, int64_t cyclesPerSecond) -> bool
         {
-            constexpr int64_t batchSize = 100;
-            int64_t instructionsToExecute = (instructionsPerSecond * usec) / 1000000;
+            constexpr int64_t batchSize = 500;
+            int64_t cyclesToExecute = (cyclesPerSecond * usec) / 1000000;
 
-            while(instructionsToExecute > 0)
+            while(cyclesToExecute > 0)
             {
-                int64_t itr = std::min(batchSize, instructionsToExecute);
+                input->Deliver(cpu->GetCycleCount());
 
                 if (keyboard->HasKey() && !pic->IsInService(1))
                 {
                     pic->Interrupt(1);
                 }
 
-                if (!cpu->Run(itr))
+                // halted or polling the tick counter / retrace, skip straight to the next timer event
+                if (cpu->IsIdle())
+                {
+                    int64_t nsec = std::min(pit->TimeToNextEvent(), (1000000000 * cyclesToExecute) / cyclesPerSecond);
+
+                    nsec = std::min(nsec, vga->TimeToNextEvent());
+
+                    pit->Process(nsec);
+                    vga->Process(nsec);
+                    input->Process(nsec);
+                    pic->HandleInterrupts();
+
+                    cyclesToExecute -= std::max<int64_t>((nsec * cyclesPerSecond) / 1000000000, 1);
+
+                    if (cyclesToExecute <= 0)
+                        break;
+                }
+
+                int64_t     cycles     = std::min(batchSize, cyclesToExecute);
+                std::size_t cycleCount = cpu->GetCycleCount();
+
+                if (!cpu->Run(cycles))
                 {
                     return false;
                 }
 
-                pit->Process((1000000000 * itr) / instructionsPerSecond);
+                // an idle cpu still lets the batch time pass, a long rep instruction runs past it
+                cycles = std::max<int64_t>(cycles, cpu->GetCycleCount() - cycleCount);
+
+                pit->Process((1000000000 * cycles) / cyclesPerSecond);
+                vga->Process((1000000000 * cycles) / cyclesPerSecond);
+                input->Process((1000000000 * cycles) / cyclesPerSecond);
                 pic->HandleInterrupts();
 
-                instructionsToExecute -= itr;
+                cyclesToExecute -= cycles;
             }
 
             return true;
@@ -260,36 +238,65 @@ int main(int argc, char **argv)
     std::atomic<bool> running;
     std::thread       thread;
 
-    if (sdl->Initialize())
+    if (backend->Initialize())
     {
         running = true;
 
         thread = std::thread(
-            [&running, cpu, runEmulator, sdl]
+            [&running, cpu, runEmulator, backend]
             {
+                int64_t     busyNs       = 0;
+                std::size_t instructions = 0;
+
                 printf("Running...\n");
                 while(running)
                 {
-                    if (!runEmulator(5000, 16000000))
+                    auto        start            = std::chrono::steady_clock::now();
+                    std::size_t instructionCount = cpu->GetInstructionCount();
+
+                    // 5 ms of emulated time at 64 MHz
+                    if (!runEmulator(5000, 64000000))
                     {
-                        sdl->StopMainLoop();
+                        backend->StopMainLoop();
                         break;
                     }
 
-                    ::usleep(5000);
+                    busyNs       += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+                    instructions += cpu->GetInstructionCount() - instructionCount;
+
+                    backend->Advance(5000);
+
+                    if (backend->IsRealTime())
+                    {
+                        ::usleep(5000);
+                    }
+                }
+
+                if (busyNs > 0)
+                {
+                    printf("cpu: %.2f MIPS with block cache %s\n",
+                        instructions * 1000.0 / busyNs, cpu->IsBlockCacheEnabled() ? "on" : "off");
                 }
+
                 printf("Finished...\n");
             });
 
-        sdl->MainLoop();
+        backend->MainLoop();
         running = false;
 
         if (thread.joinable())
             thread.join();
     }
 
-    delete sdl;
+    if (filterFile)
+    {
+        vga->SaveFilterCache(filterFile);
+    }
+
+    delete backend;
     delete cpu;
+    delete bus;
+    delete input;
     delete bios;
     delete memoryView;
     delete vga;
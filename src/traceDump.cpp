@@ -0,0 +1,158 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include <algorithm>
+#include <vector>
+#include "Memory.h"
+#include "Cpu.h"
+#include "Disasm.h"
+#include "Tracer.h"
+
+// Renders a trace file written by Tracer - one line per instruction with the register
+// state before it ran and its disassembly.
+//
+//     traceDump <trace file> [instructions to show, default all] [--32]
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        printf("usage: %s <trace file> [count] [--32]\n", argv[0]);
+        return 1;
+    }
+
+    const char* path = argv[1];
+    uint64_t    show = UINT64_MAX;
+    bool        wide = false;
+
+    for(int n = 2; n < argc; n++)
+    {
+        if (::strcmp(argv[n], "--32") == 0)
+            wide = true;
+        else
+            show = ::strtoull(argv[n], nullptr, 10);
+    }
+
+    FILE*           file = fopen(path, "rb");
+    TraceFileHeader header;
+
+    if (file == nullptr || fread(&header, sizeof(header), 1, file) != 1)
+    {
+        printf("Unable to read %s\n", path);
+        return 1;
+    }
+
+    if (::memcmp(header.magic, "X86TRACE", sizeof(header.magic)) != 0 ||
+        header.version != 1 || header.recordSize != sizeof(TraceRecord) || header.capacity == 0)
+    {
+        printf("%s is not a trace file\n", path);
+        return 1;
+    }
+
+    // the file holds the last 'capacity' records, the oldest one in slot first % capacity
+    uint64_t first = (header.count > header.capacity) ? header.count - header.capacity : 0;
+
+    // the code bytes of every record are put into memory for the disassembler
+    Memory   memory(4096);
+    Cpu      cpu(memory);
+    Disasm   disasm(cpu, memory);
+    uint8_t* mem = memory.GetMem();
+
+    // register values are only known from the first complete state on
+    uint16_t regs[TraceRecord::RegisterCount] = {};
+    bool     lowKnown = false;
+    bool     synced   = false;
+
+    std::vector<TraceRecord> chunk(4096);
+
+    printf("%" PRIu64 " records, %" PRIu64 " in the file\n", header.count, header.count - first);
+
+    // count instructions first, to know where the last 'show' of them start
+    uint64_t total = 0;
+    uint64_t printFrom;
+
+    for(int pass = 0; pass < 2; pass++)
+    {
+        uint64_t index       = first;
+        uint64_t instruction = 0;
+
+        printFrom = (total > show) ? total - show : 0;
+        lowKnown  = false;
+        synced    = false;
+
+        while(index < header.count)
+        {
+            uint64_t slot  = index % header.capacity;
+            uint64_t count = std::min<uint64_t>({ header.count - index, header.capacity - slot, chunk.size() });
+
+            fseek(file, sizeof(TraceFileHeader) + slot * sizeof(TraceRecord), SEEK_SET);
+
+            if (fread(chunk.data(), sizeof(TraceRecord), count, file) != count)
+            {
+                printf("%s is truncated\n", path);
+                return 1;
+            }
+
+            for(uint64_t n = 0; n < count; n++, index++)
+            {
+                const TraceRecord& record = chunk[n];
+
+                if (record.state.type == TraceRecord::State)
+                {
+                    int values = std::min<int>(TraceRecord::RegisterCount - record.state.first, TraceRecord::StateValues);
+
+                    ::memcpy(regs + record.state.first, record.state.value, values * sizeof(uint16_t));
+
+                    lowKnown |= (record.state.first == 0);
+                    synced   |= lowKnown && (record.state.first + values == TraceRecord::RegisterCount);
+                    continue;
+                }
+
+                if (record.instruction.type != TraceRecord::Instruction || !synced)
+                    continue;
+
+                for(int delta = 0; delta < record.instruction.count; delta++)
+                {
+                    regs[record.instruction.reg[delta]] = record.instruction.value[delta];
+                }
+
+                regs[TraceRecord::RegisterCS] = record.instruction.cs;
+                regs[TraceRecord::RegisterIP] = record.instruction.ip;
+
+                if (pass == 0 || instruction++ < printFrom)
+                {
+                    total += (pass == 0);
+                    continue;
+                }
+
+                ::memcpy(mem + record.instruction.cs * 16 + record.instruction.ip, record.instruction.code, TraceRecord::CodeBytes);
+
+                if (wide)
+                {
+                    printf("EAX %08x EBX %08x ECX %08x EDX %08x ESI %08x EDI %08x ESP %08x EBP %08x ",
+                        (static_cast<uint32_t>(regs[16 + 0]) << 16) | regs[0],
+                        (static_cast<uint32_t>(regs[16 + 3]) << 16) | regs[3],
+                        (static_cast<uint32_t>(regs[16 + 1]) << 16) | regs[1],
+                        (static_cast<uint32_t>(regs[16 + 2]) << 16) | regs[2],
+                        (static_cast<uint32_t>(regs[16 + 6]) << 16) | regs[6],
+                        (static_cast<uint32_t>(regs[16 + 7]) << 16) | regs[7],
+                        (static_cast<uint32_t>(regs[16 + 4]) << 16) | regs[4],
+                        (static_cast<uint32_t>(regs[16 + 5]) << 16) | regs[5]);
+                }
+                else
+                {
+                    printf("AX %04x BX %04x CX %04x DX %04x SI %04x DI %04x SP %04x BP %04x ",
+                        regs[0], regs[3], regs[1], regs[2], regs[6], regs[7], regs[4], regs[5]);
+                }
+
+                printf("CS %04x DS %04x ES %04x SS %04x FL %04x %s\n",
+                    regs[0x09], regs[0x0b], regs[0x08], regs[0x0a], regs[0x0d],
+                    disasm.Process(record.instruction.cs, record.instruction.ip).c_str());
+            }
+        }
+    }
+
+    fclose(file);
+
+    return 0;
+}